@@ -0,0 +1,267 @@
+#include "CRTBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "rapidjson/ostreamwrapper.h"
+#include "rapidjson/prettywriter.h"
+
+namespace
+{
+	double secondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double timeBatch(const CRTBenchmarkSuite::Kernel& kernel, uint64_t iterations)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		kernel(iterations);
+		return secondsSince(start);
+	}
+
+	const char* compilerName()
+	{
+#if defined(__clang__)
+		return "clang " __clang_version__;
+#elif defined(__GNUC__)
+		return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+		return "msvc";
+#else
+		return "unknown";
+#endif
+	}
+}
+
+bool CRTBenchmarkSettings::parseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (strcmp(arg, "--warmup") == 0 && hasValue)
+			warmupRepetitions = atoi(argv[++i]);
+		else if (strcmp(arg, "--repetitions") == 0 && hasValue)
+			repetitions = atoi(argv[++i]);
+		else if (strcmp(arg, "--min-time") == 0 && hasValue)
+			minRepetitionSeconds = atof(argv[++i]) / 1000.0;
+		else if (strcmp(arg, "--filter") == 0 && hasValue)
+			filter = argv[++i];
+		else if (strcmp(arg, "--json") == 0 && hasValue)
+			jsonPath = argv[++i];
+		else if (strcmp(arg, "--list") == 0)
+			list = true;
+		else
+		{
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if (warmupRepetitions < 0 || repetitions < 1 || minRepetitionSeconds < 0.0)
+	{
+		printUsage(argv[0]);
+		return false;
+	}
+
+	return true;
+}
+
+void CRTBenchmarkSettings::printUsage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options]\n"
+		<< "  --warmup N        untimed repetitions before the timed ones (default 2)\n"
+		<< "  --repetitions N   timed repetitions (default 15)\n"
+		<< "  --min-time MS     minimal duration of one repetition (default 10)\n"
+		<< "  --filter TEXT     run only the benchmarks whose name contains TEXT\n"
+		<< "  --json PATH       write the results as JSON\n"
+		<< "  --list            print the benchmark names and exit\n";
+}
+
+CRTBenchmarkStats CRTBenchmarkStats::compute(std::vector<double> samples)
+{
+	CRTBenchmarkStats stats;
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+
+	const size_t count = samples.size();
+	stats.min = samples.front();
+	stats.max = samples.back();
+	stats.median = count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+
+	double sum = 0.0;
+	for (double sample : samples)
+		sum += sample;
+	stats.mean = sum / count;
+
+	double squares = 0.0;
+	for (double sample : samples)
+		squares += (sample - stats.mean) * (sample - stats.mean);
+	stats.stddev = count > 1 ? std::sqrt(squares / (count - 1)) : 0.0;
+
+	return stats;
+}
+
+CRTBenchmarkSuite::CRTBenchmarkSuite(const std::string& name) : name(name)
+{
+}
+
+void CRTBenchmarkSuite::add(const std::string& name, uint64_t itemsPerIteration, Kernel kernel)
+{
+	benchmarks.push_back({ name, itemsPerIteration ? itemsPerIteration : 1, std::move(kernel) });
+}
+
+int CRTBenchmarkSuite::run(const CRTBenchmarkSettings& settings)
+{
+	if (settings.list)
+	{
+		for (const Benchmark& benchmark : benchmarks)
+			std::cout << benchmark.name << std::endl;
+
+		return 0;
+	}
+
+	results.clear();
+
+	printf("%-36s %12s %12s %12s %9s %12s\n", "benchmark", "median ns", "min ns", "mean ns", "stddev %", "iterations");
+
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (!settings.filter.empty() && benchmark.name.find(settings.filter) == std::string::npos)
+			continue;
+
+		results.push_back(runBenchmark(benchmark, settings));
+
+		const CRTBenchmarkResult& result = results.back();
+		const double relativeStddev = result.stats.mean > 0.0 ? 100.0 * result.stats.stddev / result.stats.mean : 0.0;
+
+		printf("%-36s %12.3f %12.3f %12.3f %9.2f %12llu\n", result.name.c_str(), result.stats.median,
+			result.stats.min, result.stats.mean, relativeStddev, static_cast<unsigned long long>(result.iterations));
+		fflush(stdout);
+	}
+
+	if (!settings.jsonPath.empty() && !writeJSON(settings.jsonPath, settings))
+	{
+		std::cerr << "Cannot write " << settings.jsonPath << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+const std::vector<CRTBenchmarkResult>& CRTBenchmarkSuite::getResults() const
+{
+	return results;
+}
+
+CRTBenchmarkResult CRTBenchmarkSuite::runBenchmark(const Benchmark& benchmark, const CRTBenchmarkSettings& settings) const
+{
+	CRTBenchmarkResult result;
+	result.name = benchmark.name;
+	result.itemsPerIteration = benchmark.itemsPerIteration;
+
+	// Grow the batch until it is long enough for the clock, aiming a bit past the minimum
+	uint64_t iterations = 1;
+	double elapsed = timeBatch(benchmark.kernel, iterations);
+
+	while (elapsed < settings.minRepetitionSeconds)
+	{
+		double factor = elapsed > 0.0 ? 1.4 * settings.minRepetitionSeconds / elapsed : 10.0;
+		factor = std::clamp(factor, 2.0, 10.0);
+
+		iterations = static_cast<uint64_t>(iterations * factor);
+		elapsed = timeBatch(benchmark.kernel, iterations);
+	}
+
+	result.iterations = iterations;
+
+	for (int i = 0; i < settings.warmupRepetitions; i++)
+		timeBatch(benchmark.kernel, iterations);
+
+	const double items = static_cast<double>(iterations) * benchmark.itemsPerIteration;
+
+	result.samples.reserve(settings.repetitions);
+	for (int i = 0; i < settings.repetitions; i++)
+		result.samples.push_back(timeBatch(benchmark.kernel, iterations) * 1e9 / items);
+
+	result.stats = CRTBenchmarkStats::compute(result.samples);
+
+	return result;
+}
+
+bool CRTBenchmarkSuite::writeJSON(const std::string& path, const CRTBenchmarkSettings& settings) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	rapidjson::OStreamWrapper stream(file);
+	rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(stream);
+
+	writer.StartObject();
+
+	writer.Key("suite");
+	writer.String(name.c_str());
+
+	writer.Key("context");
+	writer.StartObject();
+	writer.Key("compiler");
+	writer.String(compilerName());
+	writer.Key("hardwareThreads");
+	writer.Uint(std::thread::hardware_concurrency());
+	writer.Key("warmupRepetitions");
+	writer.Int(settings.warmupRepetitions);
+	writer.Key("repetitions");
+	writer.Int(settings.repetitions);
+	writer.Key("minRepetitionSeconds");
+	writer.Double(settings.minRepetitionSeconds);
+	writer.EndObject();
+
+	writer.Key("benchmarks");
+	writer.StartArray();
+	for (const CRTBenchmarkResult& result : results)
+	{
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(result.name.c_str());
+		writer.Key("unit");
+		writer.String("ns/item");
+		writer.Key("iterations");
+		writer.Uint64(result.iterations);
+		writer.Key("itemsPerIteration");
+		writer.Uint64(result.itemsPerIteration);
+		writer.Key("min");
+		writer.Double(result.stats.min);
+		writer.Key("median");
+		writer.Double(result.stats.median);
+		writer.Key("mean");
+		writer.Double(result.stats.mean);
+		writer.Key("stddev");
+		writer.Double(result.stats.stddev);
+		writer.Key("max");
+		writer.Double(result.stats.max);
+
+		writer.Key("samples");
+		writer.StartArray();
+		for (double sample : result.samples)
+			writer.Double(sample);
+		writer.EndArray();
+
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	writer.EndObject();
+	file << std::endl;
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Keeps the compiler from optimising away a value computed by a benchmark kernel
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+struct CRTBenchmarkSettings
+{
+	int warmupRepetitions = 2;
+	int repetitions = 15;
+
+	// The batch of iterations grows until one repetition takes at least this long
+	double minRepetitionSeconds = 0.01;
+
+	std::string filter; // Only benchmarks whose name contains it
+	std::string jsonPath; // Empty for no JSON output
+	bool list = false;
+
+	// Returns false and prints the usage on unknown or malformed arguments
+	bool parseArguments(int argc, char** argv);
+	static void printUsage(const char* program);
+};
+
+// Of the per-repetition samples, in nanoseconds per item
+struct CRTBenchmarkStats
+{
+	double min = 0.0;
+	double median = 0.0;
+	double mean = 0.0;
+	double stddev = 0.0;
+	double max = 0.0;
+
+	static CRTBenchmarkStats compute(std::vector<double> samples);
+};
+
+struct CRTBenchmarkResult
+{
+	std::string name;
+	uint64_t iterations = 0; // Kernel iterations per repetition
+	uint64_t itemsPerIteration = 1;
+	std::vector<double> samples; // Nanoseconds per item of every repetition
+	CRTBenchmarkStats stats;
+};
+
+// Named kernels timed the same way: calibrate a batch size, run the warm-up
+// repetitions, then time every repetition of the batch separately.
+class CRTBenchmarkSuite
+{
+public:
+	// Runs the kernel the given number of times
+	using Kernel = std::function<void(uint64_t iterations)>;
+
+	explicit CRTBenchmarkSuite(const std::string& name);
+
+	// itemsPerIteration is the number of elements one iteration processes, the results are per element
+	void add(const std::string& name, uint64_t itemsPerIteration, Kernel kernel);
+
+	// Returns the process exit code
+	int run(const CRTBenchmarkSettings& settings);
+
+	const std::vector<CRTBenchmarkResult>& getResults() const;
+
+	bool writeJSON(const std::string& path, const CRTBenchmarkSettings& settings) const;
+
+private:
+	struct Benchmark
+	{
+		std::string name;
+		uint64_t itemsPerIteration;
+		Kernel kernel;
+	};
+
+	CRTBenchmarkResult runBenchmark(const Benchmark& benchmark, const CRTBenchmarkSettings& settings) const;
+
+	std::string name;
+	std::vector<Benchmark> benchmarks;
+	std::vector<CRTBenchmarkResult> results;
+};
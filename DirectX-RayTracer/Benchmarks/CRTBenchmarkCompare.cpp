@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "rapidjson/document.h"
+#include "rapidjson/istreamwrapper.h"
+
+// Compares the JSON of two runs of the benchmarks and fails when a benchmark got
+// slower than the threshold. Every benchmark keeps its repetitions, the delta is
+// given with a bootstrap confidence interval so noisy runs do not fail the gate.
+
+namespace
+{
+	struct CompareSettings
+	{
+		std::string baseline;
+		std::string current;
+		float threshold = 5.f; // Percent
+		float confidence = 95.f; // Percent
+		int resamples = 2000;
+		int top = 10;
+	};
+
+	// One timed benchmark of a run, lower values are better
+	struct Metric
+	{
+		std::string unit;
+		std::vector<double> samples;
+		bool paired = false; // The samples of both runs are the same frames, in the same order
+	};
+
+	using MetricMap = std::map<std::string, Metric>;
+
+	enum class Verdict
+	{
+		UNCHANGED,
+		REGRESSION,
+		IMPROVEMENT
+	};
+
+	struct Delta
+	{
+		std::string name;
+		std::string unit;
+		double baseline = 0.0;
+		double current = 0.0;
+		double ratio = 1.0;
+		double low = 1.0; // Confidence interval of the ratio
+		double high = 1.0;
+		Verdict verdict = Verdict::UNCHANGED;
+	};
+
+	void printUsage(const char* program)
+	{
+		std::cerr << "Usage: " << program << " [options] BASELINE CURRENT\n"
+			<< "  BASELINE and CURRENT are benchmark JSON files, or directories of them, benchmarks are paired by suite and name\n"
+			<< "  --threshold PCT       slowdown that fails the comparison (default 5)\n"
+			<< "  --confidence PCT      confidence of the intervals (default 95)\n"
+			<< "  --resamples N         bootstrap resamples per benchmark (default 2000)\n"
+			<< "  --top N               slowest benchmarks listed in the report (default 10)\n";
+	}
+
+	bool parseArguments(int argc, char** argv, CompareSettings& settings)
+	{
+		std::vector<std::string> paths;
+		for (int i = 1; i < argc; i++)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (strcmp(arg, "--threshold") == 0 && hasValue)
+				settings.threshold = static_cast<float>(atof(argv[++i]));
+			else if (strcmp(arg, "--confidence") == 0 && hasValue)
+				settings.confidence = static_cast<float>(atof(argv[++i]));
+			else if (strcmp(arg, "--resamples") == 0 && hasValue)
+				settings.resamples = atoi(argv[++i]);
+			else if (strcmp(arg, "--top") == 0 && hasValue)
+				settings.top = atoi(argv[++i]);
+			else if (arg[0] != '-')
+				paths.push_back(arg);
+			else
+			{
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+
+		if (paths.size() != 2 || settings.threshold < 0.f || settings.confidence <= 0.f ||
+			settings.confidence >= 100.f || settings.resamples < 1 || settings.top < 0)
+		{
+			printUsage(argv[0]);
+			return false;
+		}
+
+		settings.baseline = paths[0];
+		settings.current = paths[1];
+		return true;
+	}
+
+	std::vector<double> readSamples(const rapidjson::Value& array)
+	{
+		std::vector<double> samples;
+		for (const rapidjson::Value& sample : array.GetArray())
+			if (sample.IsNumber())
+				samples.push_back(sample.GetDouble());
+
+		return samples;
+	}
+
+	// Collects the metrics of the kernel ("benchmarks"), scene load ("scenes" with
+	// "phases") and ray ("scenes" with "frames") JSON formats
+	bool readMetrics(const std::string& path, MetricMap& metrics)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			std::cerr << "Cannot open " << path << std::endl;
+			return false;
+		}
+
+		rapidjson::IStreamWrapper stream(file);
+		rapidjson::Document document;
+		document.ParseStream(stream);
+		if (document.HasParseError() || !document.IsObject() || !document.HasMember("suite") || !document["suite"].IsString())
+		{
+			std::cerr << path << " is not benchmark JSON" << std::endl;
+			return false;
+		}
+
+		const std::string suite = document["suite"].GetString();
+
+		if (document.HasMember("benchmarks") && document["benchmarks"].IsArray())
+		{
+			for (const rapidjson::Value& benchmark : document["benchmarks"].GetArray())
+			{
+				if (!benchmark.HasMember("name") || !benchmark.HasMember("samples"))
+					continue;
+
+				Metric& metric = metrics[suite + "/" + benchmark["name"].GetString()];
+				metric.unit = benchmark.HasMember("unit") ? benchmark["unit"].GetString() : "";
+				metric.samples = readSamples(benchmark["samples"]);
+			}
+		}
+
+		if (document.HasMember("scenes") && document["scenes"].IsArray())
+		{
+			for (const rapidjson::Value& scene : document["scenes"].GetArray())
+			{
+				if (!scene.HasMember("name"))
+					continue;
+
+				const std::string prefix = suite + "/" + scene["name"].GetString();
+
+				if (scene.HasMember("phases") && scene["phases"].IsArray())
+				{
+					for (const rapidjson::Value& phase : scene["phases"].GetArray())
+					{
+						if (!phase.HasMember("name"))
+							continue;
+
+						Metric& metric = metrics[prefix + "/" + phase["name"].GetString()];
+						metric.unit = "s";
+						if (phase.HasMember("samples"))
+							metric.samples = readSamples(phase["samples"]);
+						else if (phase.HasMember("wallSeconds")) // Written before the repetitions were kept
+							metric.samples = { phase["wallSeconds"].GetDouble() };
+					}
+				}
+
+				if (scene.HasMember("frames") && scene["frames"].IsArray())
+				{
+					Metric& metric = metrics[prefix + "/frame"];
+					metric.unit = "s";
+					metric.paired = true;
+					for (const rapidjson::Value& frame : scene["frames"].GetArray())
+						if (frame.HasMember("seconds"))
+							metric.samples.push_back(frame["seconds"].GetDouble());
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Reads a file, or every JSON file of a directory
+	bool readRun(const std::string& path, MetricMap& metrics)
+	{
+		if (!std::filesystem::is_directory(path))
+			return readMetrics(path, metrics);
+
+		std::vector<std::filesystem::path> files;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(path))
+			if (entry.is_regular_file() && entry.path().extension() == ".json")
+				files.push_back(entry.path());
+
+		std::sort(files.begin(), files.end());
+		for (const std::filesystem::path& file : files)
+			if (!readMetrics(file.string(), metrics))
+				return false;
+
+		return true;
+	}
+
+	double getMedian(std::vector<double> samples)
+	{
+		assert(!samples.empty());
+
+		const size_t middle = samples.size() / 2;
+		std::nth_element(samples.begin(), samples.begin() + middle, samples.end());
+		if (samples.size() % 2)
+			return samples[middle];
+
+		const double upper = samples[middle];
+		return (*std::max_element(samples.begin(), samples.begin() + middle) + upper) * 0.5;
+	}
+
+	double getMean(const std::vector<double>& samples)
+	{
+		assert(!samples.empty());
+
+		double sum = 0.0;
+		for (double sample : samples)
+			sum += sample;
+
+		return sum / samples.size();
+	}
+
+	double getRatio(double current, double baseline)
+	{
+		return baseline > 0.0 ? current / baseline : 1.0;
+	}
+
+	// Paired runs compare the mean time of the same frames, the others the medians.
+	// The interval is the percentile bootstrap of that ratio, with a fixed seed so
+	// the same two files always give the same report.
+	Delta compareMetric(const std::string& name, const Metric& baseline, const Metric& current, const CompareSettings& settings)
+	{
+		Delta delta;
+		delta.name = name;
+		delta.unit = current.unit;
+
+		const bool paired = baseline.paired && current.paired && baseline.samples.size() == current.samples.size();
+		auto estimate = [paired](const std::vector<double>& samples) { return paired ? getMean(samples) : getMedian(samples); };
+
+		delta.baseline = estimate(baseline.samples);
+		delta.current = estimate(current.samples);
+		delta.ratio = getRatio(delta.current, delta.baseline);
+
+		std::mt19937_64 generator(0x5eed);
+		std::vector<double> ratios(settings.resamples);
+		std::vector<double> baselineResample(baseline.samples.size());
+		std::vector<double> currentResample(current.samples.size());
+
+		for (double& ratio : ratios)
+		{
+			if (paired)
+			{
+				std::uniform_int_distribution<size_t> index(0, baseline.samples.size() - 1);
+				for (size_t i = 0; i < baselineResample.size(); i++)
+				{
+					const size_t frame = index(generator);
+					baselineResample[i] = baseline.samples[frame];
+					currentResample[i] = current.samples[frame];
+				}
+			}
+			else
+			{
+				std::uniform_int_distribution<size_t> baselineIndex(0, baseline.samples.size() - 1);
+				std::uniform_int_distribution<size_t> currentIndex(0, current.samples.size() - 1);
+				for (double& sample : baselineResample)
+					sample = baseline.samples[baselineIndex(generator)];
+				for (double& sample : currentResample)
+					sample = current.samples[currentIndex(generator)];
+			}
+
+			ratio = getRatio(estimate(currentResample), estimate(baselineResample));
+		}
+
+		std::sort(ratios.begin(), ratios.end());
+		const double tail = (1.0 - settings.confidence / 100.0) * 0.5;
+		delta.low = ratios[static_cast<size_t>(tail * (ratios.size() - 1))];
+		delta.high = ratios[static_cast<size_t>((1.0 - tail) * (ratios.size() - 1) + 0.5)];
+
+		// A change counts only past the threshold and when the whole interval is on one
+		// side of no change. Single samples have no spread and are judged on the threshold.
+		const double limit = 1.0 + settings.threshold / 100.0;
+		if (delta.ratio > limit && delta.low > 1.0)
+			delta.verdict = Verdict::REGRESSION;
+		else if (delta.ratio < 1.0 / limit && delta.high < 1.0)
+			delta.verdict = Verdict::IMPROVEMENT;
+
+		return delta;
+	}
+
+	std::string formatPercent(double ratio)
+	{
+		std::ostringstream stream;
+		stream << std::showpos << std::fixed << std::setprecision(1) << (ratio - 1.0) * 100.0 << "%";
+		return stream.str();
+	}
+
+	std::string formatValue(double value, const std::string& unit)
+	{
+		std::ostringstream stream;
+		stream << std::setprecision(4) << value;
+		if (!unit.empty())
+			stream << " " << unit;
+
+		return stream.str();
+	}
+
+	void printDeltas(const char* title, const std::vector<Delta>& deltas, size_t nameWidth)
+	{
+		if (deltas.empty())
+			return;
+
+		std::cout << "\n" << title << "\n";
+		for (const Delta& delta : deltas)
+		{
+			std::cout << "  " << std::left << std::setw(static_cast<int>(nameWidth)) << delta.name << std::right
+				<< std::setw(14) << formatValue(delta.baseline, delta.unit) << " -> " << std::setw(14) << formatValue(delta.current, delta.unit)
+				<< std::setw(10) << formatPercent(delta.ratio)
+				<< "  [" << formatPercent(delta.low) << ", " << formatPercent(delta.high) << "]\n";
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	CompareSettings settings;
+	if (!parseArguments(argc, argv, settings))
+		return 1;
+
+	MetricMap baseline;
+	MetricMap current;
+	if (!readRun(settings.baseline, baseline) || !readRun(settings.current, current))
+		return 1;
+
+	std::vector<Delta> deltas;
+	std::vector<std::string> missing;
+	std::vector<std::string> added;
+	for (const auto& [name, metric] : baseline)
+	{
+		const auto found = current.find(name);
+		if (found == current.end() || found->second.samples.empty())
+			missing.push_back(name);
+		else if (!metric.samples.empty())
+			deltas.push_back(compareMetric(name, metric, found->second, settings));
+	}
+
+	for (const auto& [name, metric] : current)
+		if (baseline.find(name) == baseline.end())
+			added.push_back(name);
+
+	if (deltas.empty())
+	{
+		std::cerr << "No benchmark is in both runs" << std::endl;
+		return 1;
+	}
+
+	std::vector<Delta> regressions;
+	int improvements = 0;
+	size_t nameWidth = 0;
+	for (const Delta& delta : deltas)
+	{
+		if (delta.verdict == Verdict::REGRESSION)
+			regressions.push_back(delta);
+		else if (delta.verdict == Verdict::IMPROVEMENT)
+			improvements++;
+
+		nameWidth = nameWidth > delta.name.size() ? nameWidth : delta.name.size();
+	}
+
+	auto slowerFirst = [](const Delta& a, const Delta& b) { return a.ratio > b.ratio; };
+	std::sort(regressions.begin(), regressions.end(), slowerFirst);
+
+	std::vector<Delta> slowest = deltas;
+	std::sort(slowest.begin(), slowest.end(), slowerFirst);
+	slowest.resize(std::min(slowest.size(), static_cast<size_t>(settings.top)));
+
+	std::cout << "Compared " << deltas.size() << " benchmarks: " << regressions.size() << " regressions, "
+		<< improvements << " improvements, " << deltas.size() - regressions.size() - improvements << " unchanged"
+		<< " (threshold " << settings.threshold << "%, " << settings.confidence << "% confidence)\n";
+
+	printDeltas("Regressions", regressions, nameWidth);
+	printDeltas("Largest slowdowns", slowest, nameWidth);
+
+	if (!missing.empty())
+	{
+		std::cout << "\nMissing from the current run\n";
+		for (const std::string& name : missing)
+			std::cout << "  " << name << "\n";
+	}
+
+	if (!added.empty())
+	{
+		std::cout << "\nNew in the current run\n";
+		for (const std::string& name : added)
+			std::cout << "  " << name << "\n";
+	}
+
+	return regressions.empty() ? 0 : 2;
+}
@@ -0,0 +1,352 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "CRTBenchmark.h"
+#include "CRTBufferSuballocator.h"
+#include "CRTMatrix.h"
+#include "CRTMesh.h"
+#include "CRTRay.h"
+#include "CRTTextureAlbedo.h"
+#include "CRTTextureBitmap.h"
+#include "CRTTextureChecker.h"
+#include "CRTTextureEdges.h"
+#include "CRTTriangle.h"
+#include "CRTVector.h"
+
+// Microbenchmarks of the CRT math, mesh and texture kernels. Inputs come from
+// a fixed seed, so two runs time the same work.
+
+namespace
+{
+	const size_t batchSize = 1024;
+
+	std::vector<CRTVector> randomVectors(std::mt19937& rng, size_t count, float range)
+	{
+		std::uniform_real_distribution<float> dist(-range, range);
+
+		std::vector<CRTVector> vectors;
+		vectors.reserve(count);
+		for (size_t i = 0; i < count; i++)
+			vectors.emplace_back(dist(rng), dist(rng), dist(rng));
+
+		return vectors;
+	}
+
+	std::vector<CRTVector> randomUVs(std::mt19937& rng, size_t count)
+	{
+		std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+		std::vector<CRTVector> uvs;
+		uvs.reserve(count);
+		for (size_t i = 0; i < count; i++)
+			uvs.emplace_back(dist(rng), dist(rng), 0.f);
+
+		return uvs;
+	}
+
+	// Rotation about an arbitrary axis, so no entry is zero
+	CRTMatrix rotation(float angle)
+	{
+		const float c = std::cos(angle);
+		const float s = std::sin(angle);
+
+		return CRTMatrix(c, s * s, -s * c,
+			0.f, c, s,
+			s, -c * s, c * c);
+	}
+
+	// Regular grid of quads in the XZ plane, bumped in Y
+	CRTMesh gridMesh(int size)
+	{
+		CRTMesh mesh;
+		mesh.setMaterialIndex(0);
+
+		for (int z = 0; z <= size; z++)
+			for (int x = 0; x <= size; x++)
+				mesh.addVertex(CRTVector(static_cast<float>(x), std::sin(x * 0.3f) * std::cos(z * 0.2f), static_cast<float>(z)));
+
+		const int row = size + 1;
+		for (int z = 0; z < size; z++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const int i = z * row + x;
+
+				mesh.addIndex(i);
+				mesh.addIndex(i + row);
+				mesh.addIndex(i + 1);
+
+				mesh.addIndex(i + 1);
+				mesh.addIndex(i + row);
+				mesh.addIndex(i + row + 1);
+			}
+		}
+
+		return mesh;
+	}
+
+	// CRTTextureBitmap loads from disk, so the benchmark writes a small binary PPM first
+	std::string writeTestBitmap(int size)
+	{
+		const std::string path = (std::filesystem::temp_directory_path() / "crt_benchmark_bitmap.ppm").string();
+
+		std::ofstream file(path, std::ios::binary);
+		file << "P6\n" << size << ' ' << size << "\n255\n";
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const unsigned char pixel[3] = {
+					static_cast<unsigned char>(x), static_cast<unsigned char>(y), static_cast<unsigned char>(x ^ y) };
+				file.write(reinterpret_cast<const char*>(pixel), sizeof(pixel));
+			}
+		}
+
+		return path;
+	}
+
+	void addVectorBenchmarks(CRTBenchmarkSuite& suite, std::mt19937& rng)
+	{
+		auto lhs = std::make_shared<std::vector<CRTVector>>(randomVectors(rng, batchSize, 10.f));
+		auto rhs = std::make_shared<std::vector<CRTVector>>(randomVectors(rng, batchSize, 10.f));
+
+		suite.add("vector/add", batchSize, [lhs, rhs](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					CRTVector sum;
+					for (size_t i = 0; i < batchSize; i++)
+						sum += (*lhs)[i] + (*rhs)[i];
+					doNotOptimize(sum);
+				}
+			});
+
+		suite.add("vector/dot", batchSize, [lhs, rhs](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					float sum = 0.f;
+					for (size_t i = 0; i < batchSize; i++)
+						sum += dot((*lhs)[i], (*rhs)[i]);
+					doNotOptimize(sum);
+				}
+			});
+
+		suite.add("vector/cross", batchSize, [lhs, rhs](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					CRTVector sum;
+					for (size_t i = 0; i < batchSize; i++)
+						sum += cross((*lhs)[i], (*rhs)[i]);
+					doNotOptimize(sum);
+				}
+			});
+
+		suite.add("vector/normalise", batchSize, [lhs](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					CRTVector sum;
+					for (size_t i = 0; i < batchSize; i++)
+					{
+						CRTVector normal = (*lhs)[i];
+						normal.normalise();
+						sum += normal;
+					}
+					doNotOptimize(sum);
+				}
+			});
+	}
+
+	void addMatrixBenchmarks(CRTBenchmarkSuite& suite, std::mt19937& rng)
+	{
+		auto vectors = std::make_shared<std::vector<CRTVector>>(randomVectors(rng, batchSize, 10.f));
+		auto matrices = std::make_shared<std::vector<CRTMatrix>>();
+
+		std::uniform_real_distribution<float> angles(0.f, 6.2831853f);
+		for (size_t i = 0; i < batchSize; i++)
+			matrices->push_back(rotation(angles(rng)));
+
+		suite.add("matrix/multiply", batchSize, [matrices](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					CRTMatrix product;
+					for (size_t i = 0; i < batchSize; i++)
+						product = product * (*matrices)[i];
+					doNotOptimize(product);
+				}
+			});
+
+		suite.add("matrix/transformVector", batchSize, [vectors, matrices](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					CRTVector sum;
+					for (size_t i = 0; i < batchSize; i++)
+						sum += (*vectors)[i] * (*matrices)[i];
+					doNotOptimize(sum);
+				}
+			});
+	}
+
+	void addTriangleBenchmarks(CRTBenchmarkSuite& suite, std::mt19937& rng)
+	{
+		auto verts = std::make_shared<std::vector<CRTVector>>(randomVectors(rng, 3 * batchSize, 10.f));
+
+		suite.add("triangle/construct", batchSize, [verts](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					CRTVector sum;
+					for (size_t i = 0; i < batchSize; i++)
+					{
+						CRTTriangle triangle((*verts)[3 * i], (*verts)[3 * i + 1], (*verts)[3 * i + 2]);
+						sum += triangle.getNormal();
+					}
+					doNotOptimize(sum);
+				}
+			});
+
+		// Rays start outside the triangle and aim near its centroid, about half of them hit
+		auto triangles = std::make_shared<std::vector<CRTTriangle>>();
+		auto rays = std::make_shared<std::vector<CRTRay>>();
+
+		std::uniform_real_distribution<float> jitter(-1.f, 1.f);
+		for (size_t i = 0; i < batchSize; i++)
+		{
+			const CRTTriangle triangle((*verts)[3 * i], (*verts)[3 * i + 1], (*verts)[3 * i + 2]);
+			const CRTVector centroid = (triangle.getVertex(0) + triangle.getVertex(1) + triangle.getVertex(2)) * (1.f / 3.f);
+			const CRTVector origin = centroid + triangle.getNormal() * 20.f + CRTVector(jitter(rng), jitter(rng), jitter(rng)) * 5.f;
+
+			CRTVector target = centroid + CRTVector(jitter(rng), jitter(rng), jitter(rng)) * 2.f;
+			CRTVector direction = target - origin;
+			direction.normalise();
+
+			triangles->push_back(triangle);
+			rays->push_back(CRTRay(origin, direction));
+		}
+
+		suite.add("triangle/intersect", batchSize, [triangles, rays](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					int hits = 0;
+					float t = 0.f, u = 0.f, v = 0.f;
+					for (size_t i = 0; i < batchSize; i++)
+						hits += (*triangles)[i].intersect((*rays)[i], 1e30f, t, u, v);
+					doNotOptimize(hits);
+					doNotOptimize(t);
+				}
+			});
+	}
+
+	void addMeshBenchmarks(CRTBenchmarkSuite& suite)
+	{
+		const int gridSize = 128;
+		auto mesh = std::make_shared<CRTMesh>(gridMesh(gridSize));
+		const uint64_t triangleCount = mesh->getIndices().size() / 3;
+
+		// Repeated calls keep accumulating into the same normals, the work per call stays the same
+		suite.add("mesh/calculateVertexNormals", triangleCount, [mesh](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					mesh->calculateVertexNormals();
+					doNotOptimize(mesh->getVertexNormals().front());
+				}
+			});
+	}
+
+	void addTextureBenchmarks(CRTBenchmarkSuite& suite, std::mt19937& rng)
+	{
+		auto uvs = std::make_shared<std::vector<CRTVector>>(randomUVs(rng, batchSize));
+
+		const CRTVector red(1.f, 0.f, 0.f);
+		const CRTVector white(1.f, 1.f, 1.f);
+
+		std::vector<std::shared_ptr<CRTTexture>> textures = {
+			std::make_shared<CRTTextureAlbedo>(red, "albedo"),
+			std::make_shared<CRTTextureChecker>(red, white, 0.125f, "checker"),
+			std::make_shared<CRTTextureEdges>(red, white, 0.05f, "edges"),
+			std::make_shared<CRTTextureBitmap>(writeTestBitmap(256), "bitmap")
+		};
+
+		for (const auto& texture : textures)
+		{
+			suite.add("texture/" + texture->getName(), batchSize, [texture, uvs](uint64_t iterations)
+				{
+					const CRTTexture& base = *texture;
+					for (uint64_t it = 0; it < iterations; it++)
+					{
+						CRTVector sum;
+						for (size_t i = 0; i < batchSize; i++)
+							sum += base.getColor((*uvs)[i].getX(), (*uvs)[i].getY());
+						doNotOptimize(sum);
+					}
+				});
+		}
+	}
+
+	void addAllocatorBenchmarks(CRTBenchmarkSuite& suite, std::mt19937& rng)
+	{
+		// Buffers of a few vertices up to a big mesh, every eighth one placed like a texture
+		const size_t liveCount = 256;
+		std::uniform_int_distribution<uint64_t> sizeDist(256, 1 << 20);
+		std::uniform_int_distribution<size_t> slotDist(0, liveCount - 1);
+
+		auto sizes = std::make_shared<std::vector<uint64_t>>();
+		auto slots = std::make_shared<std::vector<size_t>>();
+		for (size_t i = 0; i < batchSize; i++)
+		{
+			sizes->push_back(sizeDist(rng));
+			slots->push_back(slotDist(rng));
+		}
+
+		auto getAlignment = [](size_t i) { return i % 8 == 0 ? 65536ull : 256ull; };
+
+		// The allocator keeps its live ranges between iterations, so it runs fragmented like after a long session
+		auto allocator = std::make_shared<CRTBufferSuballocator>(64ull << 20);
+		auto live = std::make_shared<std::vector<CRTSuballocation>>();
+		for (size_t i = 0; i < liveCount; i++)
+			live->push_back(allocator->allocate((*sizes)[i], getAlignment(i)));
+
+		// One item is a free of a random live range and an allocation in its place
+		suite.add("allocator/churn", batchSize, [allocator, live, sizes, slots, getAlignment](uint64_t iterations)
+			{
+				for (uint64_t it = 0; it < iterations; it++)
+				{
+					for (size_t i = 0; i < batchSize; i++)
+					{
+						CRTSuballocation& allocation = (*live)[(*slots)[i]];
+						allocator->free(allocation);
+						allocation = allocator->allocate((*sizes)[i], getAlignment(i));
+						doNotOptimize(allocation.offset);
+					}
+				}
+			});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	CRTBenchmarkSettings settings;
+	if (!settings.parseArguments(argc, argv))
+		return 1;
+
+	std::mt19937 rng(20240601);
+
+	CRTBenchmarkSuite suite("kernels");
+	addVectorBenchmarks(suite, rng);
+	addMatrixBenchmarks(suite, rng);
+	addTriangleBenchmarks(suite, rng);
+	addMeshBenchmarks(suite);
+	addTextureBenchmarks(suite, rng);
+	addAllocatorBenchmarks(suite, rng);
+
+	return suite.run(settings);
+}
@@ -0,0 +1,474 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CRTAccelerationStructure.h"
+#include "CRTFrameStats.h"
+#include "CRTRenderer.h"
+#include "CRTScene.h"
+#include "CRTSceneGenerator.h"
+#include "CRTTrace.h"
+#include "rapidjson/ostreamwrapper.h"
+#include "rapidjson/prettywriter.h"
+
+// Renders fixed camera orbits through reference scenes with the CPU tracer and
+// reports the ray throughput. The frames are checked against stored reference
+// images, so a faster tracer can prove it still renders the same pictures.
+
+namespace
+{
+	struct RaySettings
+	{
+		std::vector<std::string> scenes;
+		bool generatedScenes = true;
+		int frames = 4;
+		int width = 320;
+		int height = 180;
+		int samples = 4;
+		int threads = 0;
+		bool counters = true;
+		std::string referenceDir;
+		bool updateReferences = false;
+		double minPSNR = 50.0;
+		std::string jsonPath;
+		std::string tracePath;
+		std::string frameStatsDir;
+	};
+
+	struct FrameResult
+	{
+		float seconds = 0.f;
+		uint64_t hash = 0;
+		double psnr = 0.0; // Against the reference, infinity when identical
+		bool hasReference = false;
+	};
+
+	struct SceneResult
+	{
+		std::string name;
+		bool loaded = true;
+		uint64_t triangles = 0;
+		std::vector<FrameResult> frames;
+		CRTFrameStats frameStats;
+
+		float seconds = 0.f;
+		long long primaryRays = 0;
+		long long secondaryRays = 0;
+		long long shadowRays = 0;
+		long long nodesVisited = 0;
+		long long trianglesTested = 0;
+		std::vector<float> threadBusySeconds;
+
+		long long getRays() const
+		{
+			return primaryRays + secondaryRays + shadowRays;
+		}
+	};
+
+	void printUsage(const char* program)
+	{
+		std::cerr << "Usage: " << program << " [options]\n"
+			<< "  --scene PATH          add a scene file, repeatable\n"
+			<< "  --no-generated        skip the generated grid, soup and long-thin scenes\n"
+			<< "  --frames N            frames on the camera orbit (default 4)\n"
+			<< "  --size W H            render size (default 320 180)\n"
+			<< "  --samples N           samples per pixel (default 4)\n"
+			<< "  --threads N           worker threads, 0 for all (default 0)\n"
+			<< "  --no-counters         do not count BVH nodes and triangles, for the pure ray rate\n"
+			<< "  --references DIR      compare the frames with the reference images in DIR\n"
+			<< "  --update-references   write the frames as the new reference images instead\n"
+			<< "  --min-psnr DB         lowest PSNR accepted against a reference (default 50)\n"
+			<< "  --json PATH           write the results as JSON\n"
+			<< "  --trace PATH          write the timeline as Chrome trace JSON, needs CRT_ENABLE_TRACING\n"
+			<< "  --frame-stats DIR     write the frame times of every scene as <scene>.csv into DIR\n";
+	}
+
+	bool parseArguments(int argc, char** argv, RaySettings& settings)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (strcmp(arg, "--scene") == 0 && hasValue)
+				settings.scenes.push_back(argv[++i]);
+			else if (strcmp(arg, "--no-generated") == 0)
+				settings.generatedScenes = false;
+			else if (strcmp(arg, "--frames") == 0 && hasValue)
+				settings.frames = atoi(argv[++i]);
+			else if (strcmp(arg, "--size") == 0 && i + 2 < argc)
+			{
+				settings.width = atoi(argv[++i]);
+				settings.height = atoi(argv[++i]);
+			}
+			else if (strcmp(arg, "--samples") == 0 && hasValue)
+				settings.samples = atoi(argv[++i]);
+			else if (strcmp(arg, "--threads") == 0 && hasValue)
+				settings.threads = atoi(argv[++i]);
+			else if (strcmp(arg, "--no-counters") == 0)
+				settings.counters = false;
+			else if (strcmp(arg, "--references") == 0 && hasValue)
+				settings.referenceDir = argv[++i];
+			else if (strcmp(arg, "--update-references") == 0)
+				settings.updateReferences = true;
+			else if (strcmp(arg, "--min-psnr") == 0 && hasValue)
+				settings.minPSNR = atof(argv[++i]);
+			else if (strcmp(arg, "--json") == 0 && hasValue)
+				settings.jsonPath = argv[++i];
+			else if (strcmp(arg, "--trace") == 0 && hasValue)
+				settings.tracePath = argv[++i];
+			else if (strcmp(arg, "--frame-stats") == 0 && hasValue)
+				settings.frameStatsDir = argv[++i];
+			else
+			{
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+
+		if (settings.frames < 1 || settings.width < 1 || settings.height < 1 || settings.samples < 1 ||
+			(settings.scenes.empty() && !settings.generatedScenes) || (settings.updateReferences && settings.referenceDir.empty()))
+		{
+			printUsage(argv[0]);
+			return false;
+		}
+
+		return true;
+	}
+
+	// Fixed seeds and sizes, the reference images depend on them
+	std::vector<std::string> writeGeneratedScenes()
+	{
+		std::vector<std::string> paths;
+
+		for (CRTSceneLayout layout : { CRTSceneLayout::GRID, CRTSceneLayout::SOUP, CRTSceneLayout::LONG_THIN })
+		{
+			CRTSceneGeneratorSettings settings;
+			settings.seed = 7;
+			settings.layout = layout;
+			settings.objectCount = 16;
+			settings.trianglesPerObject = 20000;
+			settings.instancingRatio = 2.f;
+			settings.textureCount = 2;
+
+			const std::string path = (std::filesystem::temp_directory_path() /
+				(std::string(CRTSceneGenerator::getLayoutName(layout)) + ".crtscene")).string();
+
+			if (CRTSceneGenerator(settings).write(path))
+				paths.push_back(path);
+		}
+
+		return paths;
+	}
+
+	std::string referencePath(const RaySettings& settings, const std::string& scene, int frame)
+	{
+		return (std::filesystem::path(settings.referenceDir) / (scene + "_" + std::to_string(frame) + ".ppm")).string();
+	}
+
+	SceneResult benchmarkScene(const std::string& path, const RaySettings& settings)
+	{
+		SceneResult result;
+		result.name = std::filesystem::path(path).stem().string();
+
+		CRTScene scene(path);
+		if (!scene.isLoaded())
+		{
+			result.loaded = false;
+			return result;
+		}
+
+		scene.getSettings().imageWidth = settings.width;
+		scene.getSettings().imageHeight = settings.height;
+
+		for (const CRTMesh& mesh : scene.getObjects())
+			result.triangles += mesh.getIndices().size() / 3;
+
+		// The orbit goes around the middle of everything in the scene
+		const CRTVector target = CRTAccelerationStructure(scene).getBounds().getCenter();
+		const CRTCamera start = scene.getCamera();
+
+		CRTRenderSettings renderSettings;
+		renderSettings.threadCount = settings.threads;
+		renderSettings.minSamples = settings.samples;
+		renderSettings.maxSamples = settings.samples;
+		renderSettings.aovMask = 0;
+		renderSettings.collectTraversalStats = settings.counters;
+
+		CRTRenderer renderer(scene);
+
+		for (int frame = 0; frame < settings.frames; frame++)
+		{
+			scene.getCamera() = start;
+			scene.getCamera().panAroundTarget(360.f * frame / settings.frames, target);
+
+			renderer.render(renderSettings);
+
+			const CRTRenderStats& stats = renderer.getStats();
+			const CRTImage& image = renderer.getImage();
+
+			FrameResult frameResult;
+			frameResult.seconds = stats.renderSeconds;
+			frameResult.hash = image.getHash();
+
+			result.seconds += stats.renderSeconds;
+			result.primaryRays += stats.primaryRays;
+			result.secondaryRays += stats.secondaryRays;
+			result.shadowRays += stats.shadowRays;
+			result.nodesVisited += stats.nodesVisited;
+			result.trianglesTested += stats.trianglesTested;
+
+			if (result.threadBusySeconds.size() < stats.threadBusySeconds.size())
+				result.threadBusySeconds.resize(stats.threadBusySeconds.size(), 0.f);
+			for (size_t i = 0; i < stats.threadBusySeconds.size(); i++)
+				result.threadBusySeconds[i] += stats.threadBusySeconds[i];
+
+			if (settings.updateReferences)
+			{
+				std::filesystem::create_directories(settings.referenceDir);
+				image.writePPM(referencePath(settings, result.name, frame));
+			}
+			else if (!settings.referenceDir.empty())
+			{
+				CRTImage reference;
+				frameResult.hasReference = reference.readPPM(referencePath(settings, result.name, frame));
+				if (frameResult.hasReference)
+					frameResult.psnr = CRTImage::getPSNR(image, reference);
+			}
+
+			result.frames.push_back(frameResult);
+
+			// Every frame is CPU work, there is nothing to wait for
+			CRTFrameSample sample;
+			sample.frameSeconds = stats.renderSeconds;
+			sample.cpuSeconds = stats.renderSeconds;
+			sample.raysTraced = stats.raysTraced;
+			result.frameStats.addFrame(sample);
+		}
+
+		return result;
+	}
+
+	double perSecond(long long count, float seconds)
+	{
+		return seconds > 0.f ? count / static_cast<double>(seconds) : 0.0;
+	}
+
+	double perRay(long long count, const SceneResult& result)
+	{
+		return result.getRays() > 0 ? static_cast<double>(count) / result.getRays() : 0.0;
+	}
+
+	// Returns false when a frame is below the PSNR threshold
+	bool printResult(const SceneResult& result, const RaySettings& settings)
+	{
+		printf("\n%s: %llu triangles, %zu frames in %.3f s\n", result.name.c_str(),
+			static_cast<unsigned long long>(result.triangles), result.frames.size(), result.seconds);
+		printf("  rays/s      %12.0f (primary %.0f, secondary %.0f, shadow %.0f)\n",
+			perSecond(result.getRays(), result.seconds), perSecond(result.primaryRays, result.seconds),
+			perSecond(result.secondaryRays, result.seconds), perSecond(result.shadowRays, result.seconds));
+
+		if (settings.counters)
+			printf("  per ray     %8.2f nodes, %.2f triangles\n", perRay(result.nodesVisited, result), perRay(result.trianglesTested, result));
+
+		printf("  frame ms    p50 %.2f, p95 %.2f, p99 %.2f\n", result.frameStats.getPercentile(CRTFrameMetric::FRAME, 50.0) * 1000.0,
+			result.frameStats.getPercentile(CRTFrameMetric::FRAME, 95.0) * 1000.0, result.frameStats.getPercentile(CRTFrameMetric::FRAME, 99.0) * 1000.0);
+
+		printf("  utilization");
+		for (float busy : result.threadBusySeconds)
+			printf(" %.0f%%", result.seconds > 0.f ? 100.f * busy / result.seconds : 0.f);
+		printf("\n");
+
+		bool passed = true;
+		for (size_t frame = 0; frame < result.frames.size(); frame++)
+		{
+			const FrameResult& frameResult = result.frames[frame];
+
+			printf("  frame %zu     %8.3f s  hash %016llx", frame, frameResult.seconds, static_cast<unsigned long long>(frameResult.hash));
+			if (frameResult.hasReference)
+			{
+				const bool frameMatches = frameResult.psnr >= settings.minPSNR;
+				passed = passed && frameMatches;
+
+				if (std::isinf(frameResult.psnr))
+					printf("  identical to the reference");
+				else
+					printf("  PSNR %.2f dB%s", frameResult.psnr, frameMatches ? "" : "  BELOW THRESHOLD");
+			}
+			else if (!settings.referenceDir.empty() && !settings.updateReferences)
+			{
+				printf("  no reference");
+			}
+			printf("\n");
+		}
+
+		return passed;
+	}
+
+	bool writeJSON(const std::string& path, const std::vector<SceneResult>& results, const RaySettings& settings)
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		rapidjson::OStreamWrapper stream(file);
+		rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(stream);
+
+		writer.StartObject();
+		writer.Key("suite");
+		writer.String("rays");
+
+		writer.Key("context");
+		writer.StartObject();
+		writer.Key("width");
+		writer.Int(settings.width);
+		writer.Key("height");
+		writer.Int(settings.height);
+		writer.Key("samples");
+		writer.Int(settings.samples);
+		writer.Key("frames");
+		writer.Int(settings.frames);
+		writer.EndObject();
+
+		writer.Key("scenes");
+		writer.StartArray();
+		for (const SceneResult& result : results)
+		{
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(result.name.c_str());
+			writer.Key("triangles");
+			writer.Uint64(result.triangles);
+			writer.Key("seconds");
+			writer.Double(result.seconds);
+			writer.Key("raysPerSecond");
+			writer.Double(perSecond(result.getRays(), result.seconds));
+			writer.Key("primaryRaysPerSecond");
+			writer.Double(perSecond(result.primaryRays, result.seconds));
+			writer.Key("secondaryRaysPerSecond");
+			writer.Double(perSecond(result.secondaryRays, result.seconds));
+			writer.Key("shadowRaysPerSecond");
+			writer.Double(perSecond(result.shadowRays, result.seconds));
+
+			if (settings.counters)
+			{
+				writer.Key("nodesPerRay");
+				writer.Double(perRay(result.nodesVisited, result));
+				writer.Key("trianglesPerRay");
+				writer.Double(perRay(result.trianglesTested, result));
+			}
+
+			writer.Key("threadUtilization");
+			writer.StartArray();
+			for (float busy : result.threadBusySeconds)
+				writer.Double(result.seconds > 0.f ? busy / result.seconds : 0.0);
+			writer.EndArray();
+
+			writer.Key("frames");
+			writer.StartArray();
+			for (const FrameResult& frame : result.frames)
+			{
+				char hash[17];
+				snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(frame.hash));
+
+				writer.StartObject();
+				writer.Key("seconds");
+				writer.Double(frame.seconds);
+				writer.Key("hash");
+				writer.String(hash);
+				if (frame.hasReference)
+				{
+					// JSON has no infinity, identical frames get a null PSNR
+					writer.Key("psnr");
+					if (std::isinf(frame.psnr))
+						writer.Null();
+					else
+						writer.Double(frame.psnr);
+				}
+				writer.EndObject();
+			}
+			writer.EndArray();
+
+			writer.EndObject();
+		}
+		writer.EndArray();
+		writer.EndObject();
+		file << std::endl;
+
+		return static_cast<bool>(file);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	RaySettings settings;
+	if (!parseArguments(argc, argv, settings))
+		return 1;
+
+	CRT_TRACE_THREAD_NAME("Main");
+
+	std::vector<std::string> scenes = settings.scenes;
+	std::vector<std::string> generated;
+	if (settings.generatedScenes)
+	{
+		generated = writeGeneratedScenes();
+		scenes.insert(scenes.end(), generated.begin(), generated.end());
+	}
+
+	std::vector<SceneResult> results;
+	for (const std::string& scene : scenes)
+	{
+		if (!std::filesystem::exists(scene))
+		{
+			std::cerr << "Cannot open " << scene << std::endl;
+			return 1;
+		}
+
+		results.push_back(benchmarkScene(scene, settings));
+		if (!results.back().loaded)
+		{
+			std::cerr << "Cannot load " << scene << std::endl;
+			return 1;
+		}
+	}
+
+	for (const std::string& path : generated)
+		std::filesystem::remove(path);
+
+	bool passed = true;
+	for (const SceneResult& result : results)
+		passed = printResult(result, settings) && passed;
+
+	if (!settings.jsonPath.empty() && !writeJSON(settings.jsonPath, results, settings))
+	{
+		std::cerr << "Cannot write " << settings.jsonPath << std::endl;
+		return 1;
+	}
+
+	if (!settings.frameStatsDir.empty())
+	{
+		std::filesystem::create_directories(settings.frameStatsDir);
+		for (const SceneResult& result : results)
+		{
+			const std::string path = (std::filesystem::path(settings.frameStatsDir) / (result.name + ".csv")).string();
+			if (!result.frameStats.writeCSV(path))
+			{
+				std::cerr << "Cannot write " << path << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	if (!settings.tracePath.empty() && !CRTTrace::writeChromeJSON(settings.tracePath))
+	{
+		std::cerr << "Cannot write " << settings.tracePath << std::endl;
+		return 1;
+	}
+
+	return passed ? 0 : 2;
+}
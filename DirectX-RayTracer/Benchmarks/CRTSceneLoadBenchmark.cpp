@@ -0,0 +1,363 @@
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "CRTBenchmark.h"
+#include "CRTLoadProfile.h"
+#include "CRTMemory.h"
+#include "CRTScene.h"
+#include "CRTSceneGenerator.h"
+#include "rapidjson/ostreamwrapper.h"
+#include "rapidjson/prettywriter.h"
+
+// Loads scenes through CRTScene with a CRTLoadProfile and reports where the
+// time and the allocations of every phase went.
+
+namespace
+{
+	std::atomic<uint64_t> allocatedBytes{ 0 };
+
+	uint64_t countAllocatedBytes()
+	{
+		return allocatedBytes.load(std::memory_order_relaxed);
+	}
+
+	void* countedAllocation(std::size_t size)
+	{
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+		if (void* ptr = std::malloc(size ? size : 1))
+			return ptr;
+
+		throw std::bad_alloc();
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	return countedAllocation(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return countedAllocation(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace
+{
+	struct LoadSettings
+	{
+		int repetitions = 3;
+		std::vector<std::string> scenes;
+		std::vector<uint64_t> syntheticTriangles;
+		std::string jsonPath;
+	};
+
+	struct SceneResult
+	{
+		std::string name;
+		bool loaded = true;
+		uint64_t fileBytes = 0;
+		uint64_t triangleCount = 0;
+		uint64_t sceneBytes = 0; // Tracked CPU memory of the loaded scene
+		uint64_t peakBytes = 0;  // Highest tracked CPU memory during the loads
+		std::vector<CRTLoadProfile> profiles; // One per repetition
+	};
+
+	void printUsage(const char* program)
+	{
+		std::cerr << "Usage: " << program << " [options] [scene.crtscene...]\n"
+			<< "  --repetitions N      loads of every scene (default 3)\n"
+			<< "  --synthetic TRIS     also load a generated grid scene of about TRIS triangles, repeatable\n"
+			<< "  --json PATH          write the per-phase results as JSON\n";
+	}
+
+	bool parseArguments(int argc, char** argv, LoadSettings& settings)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (strcmp(arg, "--repetitions") == 0 && hasValue)
+				settings.repetitions = atoi(argv[++i]);
+			else if (strcmp(arg, "--synthetic") == 0 && hasValue)
+			{
+				// Also rejects negative and non-numeric counts, which strtoull would wrap or read as 0
+				const char* value = argv[++i];
+				char* end = nullptr;
+				const unsigned long long triangles = strtoull(value, &end, 10);
+				if (!isdigit(static_cast<unsigned char>(value[0])) || *end != '\0' || triangles == 0)
+				{
+					std::cerr << "--synthetic needs a triangle count above 0, got " << value << std::endl;
+					return false;
+				}
+				settings.syntheticTriangles.push_back(triangles);
+			}
+			else if (strcmp(arg, "--json") == 0 && hasValue)
+				settings.jsonPath = argv[++i];
+			else if (arg[0] == '-')
+			{
+				printUsage(argv[0]);
+				return false;
+			}
+			else
+				settings.scenes.push_back(arg);
+		}
+
+		if (settings.repetitions < 1 || (settings.scenes.empty() && settings.syntheticTriangles.empty()))
+		{
+			printUsage(argv[0]);
+			return false;
+		}
+
+		return true;
+	}
+
+	// Grid scene from CRTSceneGenerator, in meshes of at most a million triangles
+	std::string writeSyntheticScene(uint64_t triangleCount)
+	{
+		const std::string path = (std::filesystem::temp_directory_path() /
+			("crt_load_synthetic_" + std::to_string(triangleCount) + ".crtscene")).string();
+
+		const uint64_t meshTriangles = 1000000;
+
+		CRTSceneGeneratorSettings settings;
+		settings.objectCount = static_cast<int>((triangleCount + meshTriangles - 1) / meshTriangles);
+		settings.trianglesPerObject = static_cast<int>(triangleCount / settings.objectCount);
+		settings.materialCount = 1;
+
+		return CRTSceneGenerator(settings).write(path) ? path : std::string();
+	}
+
+	SceneResult loadScene(const std::string& path, const std::string& name, int repetitions)
+	{
+		SceneResult result;
+		result.name = name;
+
+		const uint64_t bytesBefore = CRTMemory::getCurrentTotal(false);
+		CRTMemory::resetPeaks();
+
+		for (int i = 0; i < repetitions; i++)
+		{
+			CRTLoadProfile profile;
+			{
+				CRTScene scene(path, &profile);
+				if (!scene.isLoaded())
+				{
+					result.loaded = false;
+					return result;
+				}
+
+				if (i == 0)
+				{
+					for (const CRTMesh& mesh : scene.getObjects())
+						result.triangleCount += mesh.getIndices().size() / 3;
+
+					result.sceneBytes = CRTMemory::getCurrentTotal(false) - bytesBefore;
+				}
+			}
+
+			result.fileBytes = profile.getFileBytes();
+			result.profiles.push_back(profile);
+		}
+
+		result.peakBytes = CRTMemory::getPeakTotal(false) - bytesBefore;
+
+		return result;
+	}
+
+	// Median over the repetitions, per phase
+	CRTLoadPhaseStats medianPhase(const SceneResult& result, int phase)
+	{
+		std::vector<double> wall, cpu, bytes;
+		for (const CRTLoadProfile& profile : result.profiles)
+		{
+			const CRTLoadPhaseStats& stats = phase < 0 ? profile.getTotal() : profile.getPhase(static_cast<CRTLoadPhase>(phase));
+			wall.push_back(stats.wallSeconds);
+			cpu.push_back(stats.cpuSeconds);
+			bytes.push_back(static_cast<double>(stats.allocatedBytes));
+		}
+
+		CRTLoadPhaseStats median;
+		median.wallSeconds = CRTBenchmarkStats::compute(wall).median;
+		median.cpuSeconds = CRTBenchmarkStats::compute(cpu).median;
+		median.allocatedBytes = static_cast<uint64_t>(CRTBenchmarkStats::compute(bytes).median);
+		median.calls = result.profiles.front().getPhase(static_cast<CRTLoadPhase>(phase < 0 ? 0 : phase)).calls;
+
+		return median;
+	}
+
+	void printResult(const SceneResult& result)
+	{
+		const CRTLoadPhaseStats total = medianPhase(result, -1);
+
+		printf("\n%s: %.1f MB, %llu triangles, median of %zu loads\n", result.name.c_str(), result.fileBytes / 1048576.0,
+			static_cast<unsigned long long>(result.triangleCount), result.profiles.size());
+		printf("%-16s %10s %10s %12s %7s\n", "phase", "wall ms", "cpu ms", "alloc MB", "wall %");
+
+		for (int phase = 0; phase < static_cast<int>(CRTLoadPhase::COUNT); phase++)
+		{
+			const CRTLoadPhaseStats stats = medianPhase(result, phase);
+			printf("%-16s %10.2f %10.2f %12.2f %7.1f\n", CRTLoadProfile::getPhaseName(static_cast<CRTLoadPhase>(phase)),
+				stats.wallSeconds * 1e3, stats.cpuSeconds * 1e3, stats.allocatedBytes / 1048576.0,
+				total.wallSeconds > 0.0 ? 100.0 * stats.wallSeconds / total.wallSeconds : 0.0);
+		}
+
+		printf("%-16s %10.2f %10.2f %12.2f\n", "total", total.wallSeconds * 1e3, total.cpuSeconds * 1e3, total.allocatedBytes / 1048576.0);
+		printf("%.1f MB/s, %.2f M triangles/s\n", result.fileBytes / 1048576.0 / total.wallSeconds,
+			result.triangleCount / 1e6 / total.wallSeconds);
+		printf("scene memory %.2f MB, peak %.2f MB\n", result.sceneBytes / 1048576.0, result.peakBytes / 1048576.0);
+	}
+
+	bool writeJSON(const std::string& path, const std::vector<SceneResult>& results)
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		rapidjson::OStreamWrapper stream(file);
+		rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(stream);
+
+		writer.StartObject();
+		writer.Key("suite");
+		writer.String("scene_load");
+		writer.Key("scenes");
+		writer.StartArray();
+
+		for (const SceneResult& result : results)
+		{
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(result.name.c_str());
+			writer.Key("fileBytes");
+			writer.Uint64(result.fileBytes);
+			writer.Key("triangles");
+			writer.Uint64(result.triangleCount);
+			writer.Key("sceneBytes");
+			writer.Uint64(result.sceneBytes);
+			writer.Key("peakBytes");
+			writer.Uint64(result.peakBytes);
+			writer.Key("repetitions");
+			writer.Uint64(result.profiles.size());
+
+			writer.Key("phases");
+			writer.StartArray();
+			for (int phase = -1; phase < static_cast<int>(CRTLoadPhase::COUNT); phase++)
+			{
+				const CRTLoadPhaseStats stats = medianPhase(result, phase);
+
+				writer.StartObject();
+				writer.Key("name");
+				writer.String(phase < 0 ? "total" : CRTLoadProfile::getPhaseName(static_cast<CRTLoadPhase>(phase)));
+				writer.Key("wallSeconds");
+				writer.Double(stats.wallSeconds);
+				writer.Key("cpuSeconds");
+				writer.Double(stats.cpuSeconds);
+				writer.Key("allocatedBytes");
+				writer.Uint64(stats.allocatedBytes);
+
+				// Wall time of every repetition, for crt_benchmark_compare
+				writer.Key("samples");
+				writer.StartArray();
+				for (const CRTLoadProfile& profile : result.profiles)
+					writer.Double(phase < 0 ? profile.getTotal().wallSeconds : profile.getPhase(static_cast<CRTLoadPhase>(phase)).wallSeconds);
+				writer.EndArray();
+				writer.EndObject();
+			}
+			writer.EndArray();
+
+			writer.EndObject();
+		}
+
+		writer.EndArray();
+		writer.EndObject();
+		file << std::endl;
+
+		return static_cast<bool>(file);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	LoadSettings settings;
+	if (!parseArguments(argc, argv, settings))
+		return 1;
+
+	CRTLoadProfile::setAllocationCounter(countAllocatedBytes);
+
+	std::vector<SceneResult> results;
+
+	for (const std::string& scene : settings.scenes)
+	{
+		if (!std::filesystem::exists(scene))
+		{
+			std::cerr << "Cannot open " << scene << std::endl;
+			return 1;
+		}
+
+		results.push_back(loadScene(scene, scene, settings.repetitions));
+		if (!results.back().loaded)
+		{
+			std::cerr << "Cannot load " << scene << std::endl;
+			return 1;
+		}
+	}
+
+	for (uint64_t triangles : settings.syntheticTriangles)
+	{
+		const std::string path = writeSyntheticScene(triangles);
+		if (path.empty())
+		{
+			std::cerr << "Cannot write the synthetic scene" << std::endl;
+			return 1;
+		}
+
+		results.push_back(loadScene(path, "synthetic " + std::to_string(triangles), settings.repetitions));
+		std::filesystem::remove(path);
+
+		if (!results.back().loaded)
+		{
+			std::cerr << "Cannot load the synthetic scene" << std::endl;
+			return 1;
+		}
+	}
+
+	for (const SceneResult& result : results)
+		printResult(result);
+
+	if (!settings.jsonPath.empty() && !writeJSON(settings.jsonPath, results))
+	{
+		std::cerr << "Cannot write " << settings.jsonPath << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
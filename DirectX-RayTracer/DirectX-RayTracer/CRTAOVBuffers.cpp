@@ -0,0 +1,97 @@
+#include "CRTAOVBuffers.h"
+#include <algorithm>
+#include <cmath>
+
+// Hash of the triangle debug shading, shifted by one so ID 0 does not come out black
+static CRTVector idColor(int id)
+{
+	if (id < 0)
+		return CRTVector();
+
+	auto channel = [id](float scale)
+		{
+			const float value = sinf((id + 1) * scale) * 43758.5453f;
+			return value - floorf(value);
+		};
+
+	return CRTVector(channel(12.9898f), channel(78.233f), channel(45.164f));
+}
+
+void CRTAOVBuffers::resize(int width, int height, uint32_t mask)
+{
+	this->mask = mask;
+	this->width = width;
+	this->height = height;
+
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+
+	depth.assign(has(CRTAOVMask::depth) ? pixelCount : 0, 0.f);
+	primitiveID.assign(has(CRTAOVMask::primitiveID) ? pixelCount : 0, -1);
+	instanceID.assign(has(CRTAOVMask::instanceID) ? pixelCount : 0, -1);
+
+	normal.resize(has(CRTAOVMask::normal) ? width : 0, has(CRTAOVMask::normal) ? height : 0);
+	barycentrics.resize(has(CRTAOVMask::barycentrics) ? width : 0, has(CRTAOVMask::barycentrics) ? height : 0);
+	albedo.resize(has(CRTAOVMask::albedo) ? width : 0, has(CRTAOVMask::albedo) ? height : 0);
+}
+
+bool CRTAOVBuffers::has(uint32_t aov) const
+{
+	return (mask & aov) == aov;
+}
+
+CRTImage CRTAOVBuffers::visualise(uint32_t aov) const
+{
+	CRTImage result(width, height);
+
+	if (!has(aov))
+		return result;
+
+	float maxDepth = 0.f;
+	if (aov == CRTAOVMask::depth && !depth.empty())
+		maxDepth = *std::max_element(depth.begin(), depth.end());
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const size_t i = static_cast<size_t>(y) * width + x;
+			CRTVector color;
+
+			switch (aov)
+			{
+			case CRTAOVMask::depth:
+			{
+				// Near is bright, misses stay black
+				const float value = depth[i] > 0.f ? 1.f - depth[i] / maxDepth * 0.9f : 0.f;
+				color = CRTVector(value, value, value);
+				break;
+			}
+			case CRTAOVMask::normal:
+			{
+				const CRTVector& n = normal.getPixel(x, y);
+				if (n.length() > 0.f)
+					color = n * 0.5f + CRTVector(0.5f, 0.5f, 0.5f);
+				break;
+			}
+			case CRTAOVMask::barycentrics:
+				color = barycentrics.getPixel(x, y);
+				break;
+			case CRTAOVMask::primitiveID:
+				color = idColor(primitiveID[i]);
+				break;
+			case CRTAOVMask::instanceID:
+				color = idColor(instanceID[i]);
+				break;
+			case CRTAOVMask::albedo:
+				color = albedo.getPixel(x, y);
+				break;
+			default:
+				break;
+			}
+
+			result.setPixel(x, y, color);
+		}
+	}
+
+	return result;
+}
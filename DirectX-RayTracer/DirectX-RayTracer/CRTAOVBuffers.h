@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CRTImage.h"
+
+// Bits selecting the auxiliary outputs (AOVs) filled next to the color.
+// The same bits are used by the CPU renderer and the DXR shaders.
+namespace CRTAOVMask
+{
+	static constexpr uint32_t depth = 1u << 0;
+	static constexpr uint32_t normal = 1u << 1;
+	static constexpr uint32_t barycentrics = 1u << 2;
+	static constexpr uint32_t primitiveID = 1u << 3;
+	static constexpr uint32_t instanceID = 1u << 4;
+	static constexpr uint32_t albedo = 1u << 5;
+
+	static constexpr uint32_t denoiserGuides = depth | normal | albedo;
+	static constexpr uint32_t all = depth | normal | barycentrics | primitiveID | instanceID | albedo;
+}
+
+// Auxiliary buffers of the primary hits. Buffers outside the mask stay empty.
+struct CRTAOVBuffers
+{
+	uint32_t mask = 0;
+	int width = 0;
+	int height = 0;
+
+	std::vector<float> depth; // Distance along the camera ray, zero where it missed
+	CRTImage normal; // World space, facing the camera, zero where the camera ray missed
+	CRTImage barycentrics; // Weights of the three triangle vertices
+	std::vector<int> primitiveID; // Triangle index inside its mesh, -1 where the camera ray missed
+	std::vector<int> instanceID; // Index of the instance in the top level, -1 where the camera ray missed
+	CRTImage albedo; // Background color where the camera ray missed
+
+	void resize(int width, int height, uint32_t mask);
+
+	bool has(uint32_t aov) const;
+
+	// False color view of a single AOV, for writing it out and inspecting it
+	CRTImage visualise(uint32_t aov) const;
+};
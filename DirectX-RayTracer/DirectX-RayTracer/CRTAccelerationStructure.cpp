@@ -0,0 +1,151 @@
+#include "CRTAccelerationStructure.h"
+#include <limits>
+
+CRTAccelerationStructure::CRTAccelerationStructure(const CRTScene& scene)
+{
+	const auto& objects = scene.getObjects();
+	meshTrees.resize(objects.size());
+	meshBounds.resize(objects.size());
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const auto& vertices = objects[i].getVertices();
+		const auto& indices = objects[i].getIndices();
+
+		MeshTree& tree = meshTrees[i];
+		tree.triangles.reserve(indices.size() / CRTTriangle::vertsInTriangle);
+
+		std::vector<CRTBoundingBox> triangleBounds;
+		triangleBounds.reserve(indices.size() / CRTTriangle::vertsInTriangle);
+
+		for (size_t j = 0; j + 2 < indices.size(); j += 3)
+		{
+			CRTTriangle triangle(vertices[indices[j]], vertices[indices[j + 1]], vertices[indices[j + 2]]);
+
+			CRTBoundingBox box;
+			box.expand(triangle.getVertex(0));
+			box.expand(triangle.getVertex(1));
+			box.expand(triangle.getVertex(2));
+
+			tree.triangles.push_back(triangle);
+			triangleBounds.push_back(box);
+		}
+
+		tree.bvh.build(triangleBounds);
+		meshBounds[i] = tree.bvh.getBounds();
+	}
+
+	update(scene.getInstances());
+}
+
+CRTTopLevelUpdate CRTAccelerationStructure::update(const CRTInstanceSet& instanceSet)
+{
+	const CRTTopLevelUpdate result = tracker.update(instanceSet);
+
+	if (result == CRTTopLevelUpdate::NONE)
+		return result;
+
+	instances.clear();
+
+	for (const CRTInstance& instance : instanceSet.getInstances())
+	{
+		instances.push_back({ instance, instance.transform.isIdentity() });
+	}
+
+	if (result == CRTTopLevelUpdate::REBUILD)
+		topLevel.build(getInstanceBounds());
+	else
+		topLevel.refit(getInstanceBounds());
+
+	return result;
+}
+
+bool CRTAccelerationStructure::intersect(const CRTRay& ray, CRTIntersection& intersection, CRTTraversalStats* stats) const
+{
+	float closestT = std::numeric_limits<float>::max();
+
+	return topLevel.traverse(ray, closestT, [&](int instanceIndex, float& maxT)
+		{
+			const TopLevelInstance& instance = instances[instanceIndex];
+			const int objectIndex = instance.instance.meshIndex;
+			const MeshTree& tree = meshTrees[objectIndex];
+			const CRTRay objectRay = toObjectSpace(ray, instance);
+
+			return tree.bvh.traverse(objectRay, maxT, [&](int triangleIndex, float& meshMaxT)
+				{
+					if (stats)
+						stats->trianglesTested++;
+
+					float t, u, v;
+					if (!tree.triangles[triangleIndex].intersect(objectRay, meshMaxT, t, u, v))
+						return false;
+
+					meshMaxT = t;
+					intersection.t = t;
+					intersection.u = u;
+					intersection.v = v;
+					intersection.objectIndex = objectIndex;
+					intersection.instanceIndex = instanceIndex;
+					intersection.triangleIndex = triangleIndex;
+					return true;
+				}, false, stats);
+		}, false, stats);
+}
+
+bool CRTAccelerationStructure::isOccluded(const CRTRay& ray, float maxDistance, CRTTraversalStats* stats) const
+{
+	float maxT = maxDistance;
+
+	return topLevel.traverse(ray, maxT, [&](int instanceIndex, float& instanceMaxT)
+		{
+			const TopLevelInstance& instance = instances[instanceIndex];
+			const MeshTree& tree = meshTrees[instance.instance.meshIndex];
+			const CRTRay objectRay = toObjectSpace(ray, instance);
+
+			return tree.bvh.traverse(objectRay, instanceMaxT, [&](int triangleIndex, float& meshMaxT)
+				{
+					if (stats)
+						stats->trianglesTested++;
+
+					float t, u, v;
+					return tree.triangles[triangleIndex].intersect(objectRay, meshMaxT, t, u, v);
+				}, true, stats);
+		}, true, stats);
+}
+
+const CRTTriangle& CRTAccelerationStructure::getTriangle(int objectIndex, int triangleIndex) const
+{
+	return meshTrees[objectIndex].triangles[triangleIndex];
+}
+
+const CRTTransform& CRTAccelerationStructure::getInstanceTransform(int instanceIndex) const
+{
+	return instances[instanceIndex].instance.transform;
+}
+
+const CRTBoundingBox& CRTAccelerationStructure::getBounds() const
+{
+	return topLevel.getBounds();
+}
+
+std::vector<CRTBoundingBox> CRTAccelerationStructure::getInstanceBounds() const
+{
+	std::vector<CRTBoundingBox> bounds;
+	bounds.reserve(instances.size());
+
+	for (const TopLevelInstance& instance : instances)
+	{
+		bounds.push_back(instance.instance.transform.transformBounds(meshBounds[instance.instance.meshIndex]));
+	}
+
+	return bounds;
+}
+
+CRTRay CRTAccelerationStructure::toObjectSpace(const CRTRay& ray, const TopLevelInstance& instance) const
+{
+	if (instance.isIdentity)
+		return ray;
+
+	const CRTTransform& transform = instance.instance.transform;
+	return CRTRay(transform.inverseTransformPoint(ray.getOrigin()), transform.inverseTransformDirection(ray.getDirection()));
+}
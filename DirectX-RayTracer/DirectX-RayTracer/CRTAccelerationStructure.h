@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include "CRTBVH.h"
+#include "CRTTriangle.h"
+#include "CRTScene.h"
+
+struct CRTIntersection
+{
+	float t = 0.f;
+	float u = 0.f; // Barycentric of vertex 1
+	float v = 0.f; // Barycentric of vertex 2
+	int objectIndex = -1; // Mesh of the hit instance
+	int instanceIndex = -1;
+	int triangleIndex = -1;
+};
+
+// Two-level hierarchy for the CPU renderer: one BVH per mesh over its
+// triangles and a top-level BVH over the mesh instances, mirroring the
+// BLAS/TLAS split used on the GPU.
+class CRTAccelerationStructure
+{
+public:
+	explicit CRTAccelerationStructure(const CRTScene& scene);
+
+	// Refits the top level when only instance transforms changed since the
+	// last update, rebuilds it when instances were added or removed
+	CRTTopLevelUpdate update(const CRTInstanceSet& instances);
+
+	// Closest hit along the ray
+	bool intersect(const CRTRay& ray, CRTIntersection& intersection, CRTTraversalStats* stats = nullptr) const;
+
+	// Any hit closer than maxDistance
+	bool isOccluded(const CRTRay& ray, float maxDistance, CRTTraversalStats* stats = nullptr) const;
+
+	// In the object space of the mesh
+	const CRTTriangle& getTriangle(int objectIndex, int triangleIndex) const;
+	const CRTTransform& getInstanceTransform(int instanceIndex) const;
+	const CRTBoundingBox& getBounds() const;
+
+private:
+	struct MeshTree
+	{
+		CRTTaggedVector<CRTTriangle, CRTMemoryCategory::BVH_TRIANGLES> triangles;
+		CRTBVH bvh;
+	};
+
+	struct TopLevelInstance
+	{
+		CRTInstance instance;
+		bool isIdentity;
+	};
+
+	std::vector<CRTBoundingBox> getInstanceBounds() const;
+
+	// Ray in the object space of the instance. A rigid transform keeps the
+	// direction length, so distances along both rays are the same.
+	CRTRay toObjectSpace(const CRTRay& ray, const TopLevelInstance& instance) const;
+
+	std::vector<MeshTree> meshTrees;
+	std::vector<CRTBoundingBox> meshBounds;
+	std::vector<TopLevelInstance> instances;
+	CRTBVH topLevel;
+	CRTInstanceTracker tracker;
+};
@@ -0,0 +1,112 @@
+#include "CRTBVH.h"
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+void CRTBVH::build(const std::vector<CRTBoundingBox>& primitiveBounds)
+{
+	nodes.clear();
+	primitiveIndices.resize(primitiveBounds.size());
+	std::iota(primitiveIndices.begin(), primitiveIndices.end(), 0);
+
+	if (primitiveBounds.empty())
+		return;
+
+	std::vector<CRTVector> centers;
+	centers.reserve(primitiveBounds.size());
+
+	for (const CRTBoundingBox& box : primitiveBounds)
+	{
+		centers.push_back(box.getCenter());
+	}
+
+	nodes.reserve(2 * primitiveBounds.size() / maxLeafSize + 1);
+	nodes.emplace_back();
+	buildNode(0, primitiveBounds, centers, 0, static_cast<int>(primitiveBounds.size()));
+}
+
+void CRTBVH::refit(const std::vector<CRTBoundingBox>& primitiveBounds)
+{
+	assert(primitiveBounds.size() == primitiveIndices.size());
+
+	// Children are always stored after their parent
+	for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; i--)
+	{
+		CRTBVHNode& node = nodes[i];
+		CRTBoundingBox bounds;
+
+		if (node.primitiveCount > 0)
+		{
+			for (int j = 0; j < node.primitiveCount; j++)
+			{
+				bounds.expand(primitiveBounds[primitiveIndices[node.firstIndex + j]]);
+			}
+		}
+		else
+		{
+			bounds.expand(nodes[node.firstIndex].bounds);
+			bounds.expand(nodes[node.firstIndex + 1].bounds);
+		}
+
+		node.bounds = bounds;
+	}
+}
+
+const CRTBoundingBox& CRTBVH::getBounds() const
+{
+	static const CRTBoundingBox emptyBox;
+	return nodes.empty() ? emptyBox : nodes[0].bounds;
+}
+
+bool CRTBVH::isEmpty() const
+{
+	return nodes.empty();
+}
+
+void CRTBVH::buildNode(int nodeIndex, const std::vector<CRTBoundingBox>& primitiveBounds,
+	const std::vector<CRTVector>& centers, int first, int count)
+{
+	CRTBoundingBox bounds;
+	CRTBoundingBox centerBounds;
+
+	for (int i = first; i < first + count; i++)
+	{
+		bounds.expand(primitiveBounds[primitiveIndices[i]]);
+		centerBounds.expand(centers[primitiveIndices[i]]);
+	}
+
+	nodes[nodeIndex].bounds = bounds;
+
+	if (count <= maxLeafSize)
+	{
+		nodes[nodeIndex].firstIndex = first;
+		nodes[nodeIndex].primitiveCount = count;
+		return;
+	}
+
+	// Median split along the axis with the widest spread of centers
+	const int axis = centerBounds.getLongestAxis();
+	const int middle = first + count / 2;
+
+	std::nth_element(
+		primitiveIndices.begin() + first,
+		primitiveIndices.begin() + middle,
+		primitiveIndices.begin() + first + count,
+		[&](int lhs, int rhs)
+		{
+			return centers[lhs].getByIndex(axis) < centers[rhs].getByIndex(axis);
+		}
+	);
+
+	// Children are allocated next to each other, the node keeps only the left one
+	const int leftChild = static_cast<int>(nodes.size());
+	nodes.emplace_back();
+	nodes.emplace_back();
+
+	nodes[nodeIndex].firstIndex = leftChild;
+	nodes[nodeIndex].primitiveCount = 0;
+	nodes[nodeIndex].splitAxis = axis;
+
+	buildNode(leftChild, primitiveBounds, centers, first, middle - first);
+	buildNode(leftChild + 1, primitiveBounds, centers, middle, first + count - middle);
+}
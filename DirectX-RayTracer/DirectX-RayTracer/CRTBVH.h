@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CRTBoundingBox.h"
+#include "CRTMemory.h"
+
+struct CRTBVHNode
+{
+	CRTBoundingBox bounds;
+	int firstIndex = 0; // First primitive for leaves, left child for inner nodes
+	int primitiveCount = 0; // 0 for inner nodes, the right child is firstIndex + 1
+	int splitAxis = 0;
+};
+
+// Counters of the BVH walks done by one thread. The node fetches go through a
+// simulated 32 KB direct-mapped cache of 64 byte lines, which shows how much
+// consecutive rays share the nodes they visit.
+struct CRTTraversalStats
+{
+	static constexpr int cacheLineSize = 64;
+	static constexpr int cacheLineCount = 512;
+
+	long long nodesVisited = 0;
+	long long nodeCacheHits = 0;
+	long long trianglesTested = 0; // Counted by the callers of traverse, it only sees primitive indices
+	uintptr_t cacheTags[cacheLineCount] = {};
+
+	void visitNode(const void* node)
+	{
+		const uintptr_t line = reinterpret_cast<uintptr_t>(node) / cacheLineSize;
+		uintptr_t& tag = cacheTags[line % cacheLineCount];
+
+		nodesVisited++;
+		if (tag == line)
+			nodeCacheHits++;
+
+		tag = line;
+	}
+};
+
+// Bounding volume hierarchy over an arbitrary set of primitives, described
+// only by their bounding boxes. Used both for the triangles of a mesh and for
+// the meshes of a scene.
+class CRTBVH
+{
+public:
+	static constexpr int maxLeafSize = 4;
+
+	void build(const std::vector<CRTBoundingBox>& primitiveBounds);
+
+	// Recomputes the node bounds for moved primitives and keeps the tree layout.
+	// Cheaper than build, but the tree degrades when the primitives move far.
+	void refit(const std::vector<CRTBoundingBox>& primitiveBounds);
+
+	// Walks the nodes hit by the ray. intersectPrimitive(primitiveIndex, maxT)
+	// returns true and shrinks maxT when the primitive is hit closer. With
+	// anyHit the walk stops at the first reported hit. Visited nodes are counted in stats when given.
+	template<typename PrimitiveIntersector>
+	bool traverse(const CRTRay& ray, float& maxT, PrimitiveIntersector&& intersectPrimitive, bool anyHit = false,
+		CRTTraversalStats* stats = nullptr) const;
+
+	const CRTBoundingBox& getBounds() const;
+	bool isEmpty() const;
+
+private:
+	void buildNode(int nodeIndex, const std::vector<CRTBoundingBox>& primitiveBounds,
+		const std::vector<CRTVector>& centers, int first, int count);
+
+	CRTTaggedVector<CRTBVHNode, CRTMemoryCategory::BVH_NODES> nodes;
+	CRTTaggedVector<int, CRTMemoryCategory::BVH_NODES> primitiveIndices;
+};
+
+template<typename PrimitiveIntersector>
+bool CRTBVH::traverse(const CRTRay& ray, float& maxT, PrimitiveIntersector&& intersectPrimitive, bool anyHit,
+	CRTTraversalStats* stats) const
+{
+	if (nodes.empty())
+		return false;
+
+	const int maxStackSize = 64;
+	int stack[maxStackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	bool hit = false;
+
+	while (stackSize > 0)
+	{
+		const CRTBVHNode& node = nodes[stack[--stackSize]];
+
+		if (stats)
+			stats->visitNode(&node);
+
+		if (!node.bounds.intersect(ray, maxT))
+			continue;
+
+		if (node.primitiveCount > 0)
+		{
+			for (int i = 0; i < node.primitiveCount; i++)
+			{
+				if (intersectPrimitive(primitiveIndices[node.firstIndex + i], maxT))
+				{
+					hit = true;
+
+					if (anyHit)
+						return true;
+				}
+			}
+		}
+		else
+		{
+			// Visit the child on the side the ray comes from first
+			const bool leftFirst = ray.getDirection().getByIndex(node.splitAxis) >= 0.f;
+
+			stack[stackSize++] = leftFirst ? node.firstIndex + 1 : node.firstIndex;
+			stack[stackSize++] = leftFirst ? node.firstIndex : node.firstIndex + 1;
+		}
+	}
+
+	return hit;
+}
@@ -0,0 +1,96 @@
+#include "CRTBoundingBox.h"
+#include <algorithm>
+#include <limits>
+
+CRTBoundingBox::CRTBoundingBox()
+	: min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()),
+	max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest())
+{
+}
+
+CRTBoundingBox::CRTBoundingBox(const CRTVector& min, const CRTVector& max) : min(min), max(max)
+{
+}
+
+void CRTBoundingBox::expand(const CRTVector& point)
+{
+	min = CRTVector(
+		std::min(min.getX(), point.getX()),
+		std::min(min.getY(), point.getY()),
+		std::min(min.getZ(), point.getZ())
+	);
+
+	max = CRTVector(
+		std::max(max.getX(), point.getX()),
+		std::max(max.getY(), point.getY()),
+		std::max(max.getZ(), point.getZ())
+	);
+}
+
+void CRTBoundingBox::expand(const CRTBoundingBox& box)
+{
+	if (box.isEmpty())
+		return;
+
+	expand(box.min);
+	expand(box.max);
+}
+
+const CRTVector& CRTBoundingBox::getMin() const
+{
+	return min;
+}
+
+const CRTVector& CRTBoundingBox::getMax() const
+{
+	return max;
+}
+
+CRTVector CRTBoundingBox::getCenter() const
+{
+	return (min + max) * 0.5f;
+}
+
+int CRTBoundingBox::getLongestAxis() const
+{
+	CRTVector extent = max - min;
+
+	if (extent.getX() >= extent.getY() && extent.getX() >= extent.getZ())
+		return 0;
+
+	if (extent.getY() >= extent.getZ())
+		return 1;
+
+	return 2;
+}
+
+bool CRTBoundingBox::isEmpty() const
+{
+	return min.getX() > max.getX() || min.getY() > max.getY() || min.getZ() > max.getZ();
+}
+
+bool CRTBoundingBox::intersect(const CRTRay& ray, float maxT) const
+{
+	float tNear = 0.f;
+	float tFar = maxT;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float origin = ray.getOrigin().getByIndex(axis);
+		const float invDir = ray.getInverseDirection().getByIndex(axis);
+
+		float t0 = (min.getByIndex(axis) - origin) * invDir;
+		float t1 = (max.getByIndex(axis) - origin) * invDir;
+
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		tNear = std::max(tNear, t0);
+		tFar = std::min(tFar, t1);
+
+		if (tNear > tFar)
+			return false;
+	}
+
+	return true;
+}
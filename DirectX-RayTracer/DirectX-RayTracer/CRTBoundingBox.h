@@ -0,0 +1,28 @@
+#pragma once
+#include "CRTVector.h"
+#include "CRTRay.h"
+
+// Axis-aligned bounding box. A default constructed box is empty and grows
+// with every expand() call.
+class CRTBoundingBox
+{
+public:
+	CRTBoundingBox();
+	CRTBoundingBox(const CRTVector& min, const CRTVector& max);
+
+	void expand(const CRTVector& point);
+	void expand(const CRTBoundingBox& box);
+
+	const CRTVector& getMin() const;
+	const CRTVector& getMax() const;
+	CRTVector getCenter() const;
+	int getLongestAxis() const;
+	bool isEmpty() const;
+
+	// Slab test. Succeeds when the ray enters the box before maxT
+	bool intersect(const CRTRay& ray, float maxT) const;
+
+private:
+	CRTVector min;
+	CRTVector max;
+};
@@ -0,0 +1,172 @@
+#include "CRTBufferSuballocator.h"
+#include <algorithm>
+#include <cassert>
+
+bool CRTSuballocation::isValid() const
+{
+	return block >= 0;
+}
+
+CRTRangeAllocator::CRTRangeAllocator(uint64_t capacity) : capacity(capacity)
+{
+	if (capacity > 0)
+		freeRanges[0] = capacity;
+}
+
+bool CRTRangeAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	assert(size > 0 && alignment > 0);
+
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+	{
+		const uint64_t rangeStart = it->first;
+		const uint64_t rangeEnd = it->first + it->second;
+		const uint64_t alignedStart = (rangeStart + alignment - 1) / alignment * alignment;
+
+		if (alignedStart + size > rangeEnd)
+			continue;
+
+		// The padding in front of the allocation stays free
+		freeRanges.erase(it);
+
+		if (alignedStart > rangeStart)
+			freeRanges[rangeStart] = alignedStart - rangeStart;
+
+		if (alignedStart + size < rangeEnd)
+			freeRanges[alignedStart + size] = rangeEnd - alignedStart - size;
+
+		usedSize += size;
+		offset = alignedStart;
+		return true;
+	}
+
+	return false;
+}
+
+void CRTRangeAllocator::free(uint64_t offset, uint64_t size)
+{
+	assert(offset + size <= capacity && size <= usedSize);
+
+	usedSize -= size;
+
+	auto next = freeRanges.lower_bound(offset);
+	assert(next == freeRanges.end() || next->first >= offset + size);
+
+	// Merge with the free range right after
+	if (next != freeRanges.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = freeRanges.erase(next);
+	}
+
+	// Merge with the free range right before
+	if (next != freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		assert(previous->first + previous->second <= offset);
+
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += size;
+			return;
+		}
+	}
+
+	freeRanges[offset] = size;
+}
+
+uint64_t CRTRangeAllocator::getCapacity() const
+{
+	return capacity;
+}
+
+uint64_t CRTRangeAllocator::getUsedSize() const
+{
+	return usedSize;
+}
+
+uint64_t CRTRangeAllocator::getLargestFreeRange() const
+{
+	uint64_t largest = 0;
+
+	for (const auto& range : freeRanges)
+	{
+		largest = std::max(largest, range.second);
+	}
+
+	return largest;
+}
+
+int CRTRangeAllocator::getFreeRangeCount() const
+{
+	return static_cast<int>(freeRanges.size());
+}
+
+CRTBufferSuballocator::CRTBufferSuballocator(uint64_t blockSize) : blockSize(blockSize)
+{
+	assert(blockSize > 0);
+}
+
+CRTSuballocation CRTBufferSuballocator::allocate(uint64_t size, uint64_t alignment)
+{
+	CRTSuballocation allocation;
+	allocation.size = size;
+
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (blocks[i].allocate(size, alignment, allocation.offset))
+		{
+			allocation.block = static_cast<int>(i);
+			return allocation;
+		}
+	}
+
+	blocks.emplace_back(std::max(blockSize, size));
+
+	[[maybe_unused]] const bool isAllocated = blocks.back().allocate(size, alignment, allocation.offset);
+	assert(isAllocated);
+
+	allocation.block = static_cast<int>(blocks.size()) - 1;
+	return allocation;
+}
+
+void CRTBufferSuballocator::free(const CRTSuballocation& allocation)
+{
+	assert(allocation.isValid() && allocation.block < static_cast<int>(blocks.size()));
+
+	blocks[allocation.block].free(allocation.offset, allocation.size);
+}
+
+int CRTBufferSuballocator::getBlockCount() const
+{
+	return static_cast<int>(blocks.size());
+}
+
+uint64_t CRTBufferSuballocator::getBlockSize(int block) const
+{
+	return blocks[block].getCapacity();
+}
+
+uint64_t CRTBufferSuballocator::getUsedSize() const
+{
+	uint64_t used = 0;
+
+	for (const CRTRangeAllocator& block : blocks)
+	{
+		used += block.getUsedSize();
+	}
+
+	return used;
+}
+
+uint64_t CRTBufferSuballocator::getReservedSize() const
+{
+	uint64_t reserved = 0;
+
+	for (const CRTRangeAllocator& block : blocks)
+	{
+		reserved += block.getCapacity();
+	}
+
+	return reserved;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Range of a block handed out by CRTBufferSuballocator
+struct CRTSuballocation
+{
+	int block = -1;
+	uint64_t offset = 0;
+	uint64_t size = 0;
+
+	bool isValid() const;
+};
+
+// First fit allocator over one contiguous range of memory.
+// Freed ranges are merged with their free neighbours.
+class CRTRangeAllocator
+{
+public:
+	explicit CRTRangeAllocator(uint64_t capacity);
+
+	// Returns false if no free range can hold size bytes at the alignment
+	bool allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+
+	void free(uint64_t offset, uint64_t size);
+
+	uint64_t getCapacity() const;
+	uint64_t getUsedSize() const;
+	uint64_t getLargestFreeRange() const;
+	int getFreeRangeCount() const;
+
+private:
+	uint64_t capacity;
+	uint64_t usedSize = 0;
+	std::map<uint64_t, uint64_t> freeRanges; // Offset to size, ordered so neighbours can be found
+};
+
+// Hands out ranges from a list of equally sized blocks, adding a block when
+// none of them has room. The caller backs every block with its own memory,
+// for example one D3D12 heap with a buffer placed over the whole of it.
+class CRTBufferSuballocator
+{
+public:
+	explicit CRTBufferSuballocator(uint64_t blockSize);
+
+	// Allocations bigger than the block size get a block of their own
+	CRTSuballocation allocate(uint64_t size, uint64_t alignment);
+
+	void free(const CRTSuballocation& allocation);
+
+	int getBlockCount() const;
+	uint64_t getBlockSize(int block) const;
+
+	uint64_t getUsedSize() const;
+	uint64_t getReservedSize() const;
+
+private:
+	uint64_t blockSize;
+	std::vector<CRTRangeAllocator> blocks;
+};
@@ -126,7 +126,32 @@ void CRTCamera::panAroundTarget(const float degrees, const CRTVector& target)
 
 	position = target + rotated;
 
-	rotationMatrix = rotationMatrix * rotateAroundY;
+	// The renderer applies rotationMatrix to column vectors, so the view is turned
+	// by the transpose of the row vector rotation used for the position
+	const CRTMatrix turnView(
+		cosf(rads), 0.f, sinf(rads),
+		0.f, 1.f, 0.f,
+		-sinf(rads), 0.f, cosf(rads)
+	);
+
+	rotationMatrix = turnView * rotationMatrix;
+}
+
+void CRTCamera::lookAt(const CRTVector& target)
+{
+	// The camera looks down -Z, so column 2 points from the target back to the camera
+	CRTVector back = position - target;
+	back.normalise();
+
+	CRTVector right = cross(CRTVector(0.f, 1.f, 0.f), back);
+	right.normalise();
+	const CRTVector up = cross(back, right);
+
+	rotationMatrix = CRTMatrix(
+		right.getX(), up.getX(), back.getX(),
+		right.getY(), up.getY(), back.getY(),
+		right.getZ(), up.getZ(), back.getZ()
+	);
 }
 
 const CRTVector& CRTCamera::getPosition() const
@@ -17,6 +17,9 @@ public:
 
 	void panAroundTarget(const float degrees, const CRTVector& target);
 
+	// Turns the camera to look at target, with the world Y axis up
+	void lookAt(const CRTVector& target);
+
 	const CRTVector& getPosition() const;
 	const CRTMatrix& getRotationMatrix() const;
 
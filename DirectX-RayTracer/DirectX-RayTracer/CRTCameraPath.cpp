@@ -0,0 +1,258 @@
+#include "CRTCameraPath.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include "rapidjson/document.h"
+#include "rapidjson/istreamwrapper.h"
+
+namespace
+{
+	bool readVector(const rapidjson::Value& object, const char* name, CRTVector& vector)
+	{
+		if (!object.HasMember(name) || !object[name].IsArray() || object[name].Size() != 3)
+			return false;
+
+		const rapidjson::Value& array = object[name];
+		for (rapidjson::SizeType i = 0; i < 3; i++)
+			if (!array[i].IsNumber())
+				return false;
+
+		vector = CRTVector(array[0].GetFloat(), array[1].GetFloat(), array[2].GetFloat());
+		return true;
+	}
+
+	CRTVector catmullRom(const CRTVector& p0, const CRTVector& p1, const CRTVector& p2, const CRTVector& p3, float t)
+	{
+		const float t2 = t * t;
+		const float t3 = t2 * t;
+
+		return (p1 * 2.f + (p2 - p0) * t + (p0 * 2.f - p1 * 5.f + p2 * 4.f - p3) * t2 + (p1 * 3.f - p0 - p2 * 3.f + p3) * t3) * 0.5f;
+	}
+}
+
+bool CRTCameraPath::load(const std::string& fileName)
+{
+	std::ifstream file(fileName);
+	if (!file)
+		return false;
+
+	rapidjson::IStreamWrapper stream(file);
+	rapidjson::Document document;
+	document.ParseStream(stream);
+	if (document.HasParseError() || !document.IsObject() || !document.HasMember("keyframes") || !document["keyframes"].IsArray())
+		return false;
+
+	CRTCameraPath path;
+
+	if (document.HasMember("fps"))
+	{
+		if (!document["fps"].IsNumber() || document["fps"].GetFloat() <= 0.f)
+			return false;
+		path.framesPerSecond = document["fps"].GetFloat();
+	}
+
+	if (document.HasMember("interpolation") &&
+		(!document["interpolation"].IsString() || !parseInterpolation(document["interpolation"].GetString(), path.interpolation)))
+		return false;
+
+	if (document.HasMember("loop"))
+	{
+		if (!document["loop"].IsBool())
+			return false;
+		path.looped = document["loop"].GetBool();
+	}
+
+	for (const rapidjson::Value& keyframeVal : document["keyframes"].GetArray())
+	{
+		CRTCameraKeyframe keyframe;
+		if (!keyframeVal.IsObject() || !keyframeVal.HasMember("time") || !keyframeVal["time"].IsNumber() ||
+			!readVector(keyframeVal, "position", keyframe.position) || !readVector(keyframeVal, "target", keyframe.target))
+			return false;
+
+		keyframe.time = keyframeVal["time"].GetFloat();
+		path.addKeyframe(keyframe);
+	}
+
+	if (path.keyframes.empty())
+		return false;
+
+	*this = path;
+	return true;
+}
+
+CRTCameraPath CRTCameraPath::createTurntable(const CRTVector& position, const CRTVector& target, float seconds, int keyframeCount)
+{
+	assert(keyframeCount >= 3);
+
+	CRTCameraPath path;
+	path.looped = true;
+
+	CRTCamera camera;
+	for (int i = 0; i <= keyframeCount; i++)
+	{
+		camera.setPosition(position);
+		camera.panAroundTarget(360.f * i / keyframeCount, target);
+
+		CRTCameraKeyframe keyframe;
+		keyframe.time = seconds * i / keyframeCount;
+		keyframe.position = i < keyframeCount ? camera.getPosition() : position;
+		keyframe.target = target;
+		path.keyframes.push_back(keyframe);
+	}
+
+	return path;
+}
+
+void CRTCameraPath::addKeyframe(const CRTCameraKeyframe& keyframe)
+{
+	auto after = std::upper_bound(keyframes.begin(), keyframes.end(), keyframe.time,
+		[](float time, const CRTCameraKeyframe& other) { return time < other.time; });
+
+	keyframes.insert(after, keyframe);
+}
+
+const std::vector<CRTCameraKeyframe>& CRTCameraPath::getKeyframes() const
+{
+	return keyframes;
+}
+
+void CRTCameraPath::setInterpolation(CRTCameraInterpolation interpolation)
+{
+	this->interpolation = interpolation;
+}
+
+CRTCameraInterpolation CRTCameraPath::getInterpolation() const
+{
+	return interpolation;
+}
+
+void CRTCameraPath::setLooped(bool looped)
+{
+	this->looped = looped;
+}
+
+bool CRTCameraPath::isLooped() const
+{
+	return looped;
+}
+
+void CRTCameraPath::setFramesPerSecond(float framesPerSecond)
+{
+	assert(framesPerSecond > 0.f);
+	this->framesPerSecond = framesPerSecond;
+}
+
+float CRTCameraPath::getFramesPerSecond() const
+{
+	return framesPerSecond;
+}
+
+float CRTCameraPath::getDuration() const
+{
+	return keyframes.empty() ? 0.f : keyframes.back().time - keyframes.front().time;
+}
+
+int CRTCameraPath::getFrameCount() const
+{
+	if (keyframes.empty())
+		return 0;
+
+	// Both ends are frames, the small bias keeps a whole number of frames from losing the last one
+	const int frames = static_cast<int>(std::floor(getDuration() * framesPerSecond + 1e-3f)) + 1;
+	return looped && frames > 1 ? frames - 1 : frames;
+}
+
+CRTCamera CRTCameraPath::evaluate(float time) const
+{
+	assert(!keyframes.empty());
+
+	CRTVector position = keyframes.front().position;
+	CRTVector target = keyframes.front().target;
+
+	if (time >= keyframes.back().time)
+	{
+		position = keyframes.back().position;
+		target = keyframes.back().target;
+	}
+	else if (time > keyframes.front().time)
+	{
+		// Segment from keyframe i to i + 1
+		const auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+			[](float time, const CRTCameraKeyframe& other) { return time < other.time; });
+		const int i = static_cast<int>(next - keyframes.begin()) - 1;
+
+		const CRTCameraKeyframe& start = keyframes[i];
+		const CRTCameraKeyframe& end = keyframes[i + 1];
+		const float t = (time - start.time) / (end.time - start.time);
+
+		if (interpolation == CRTCameraInterpolation::LINEAR)
+		{
+			position = start.position * (1.f - t) + end.position * t;
+			target = start.target * (1.f - t) + end.target * t;
+		}
+		else
+		{
+			const CRTCameraKeyframe& before = keyframes[getNeighbour(i - 1)];
+			const CRTCameraKeyframe& after = keyframes[getNeighbour(i + 2)];
+
+			position = catmullRom(before.position, start.position, end.position, after.position, t);
+			target = catmullRom(before.target, start.target, end.target, after.target, t);
+		}
+	}
+
+	CRTCamera camera;
+	camera.setPosition(position);
+	camera.lookAt(target);
+	return camera;
+}
+
+CRTCamera CRTCameraPath::getFrameCamera(int frame) const
+{
+	assert(!keyframes.empty());
+	return evaluate(keyframes.front().time + frame / framesPerSecond);
+}
+
+const char* CRTCameraPath::getInterpolationName(CRTCameraInterpolation interpolation)
+{
+	switch (interpolation)
+	{
+	case CRTCameraInterpolation::LINEAR:
+		return "linear";
+	case CRTCameraInterpolation::SMOOTH:
+		return "smooth";
+	default:
+		return "unknown";
+	}
+}
+
+bool CRTCameraPath::parseInterpolation(const std::string& name, CRTCameraInterpolation& interpolation)
+{
+	for (CRTCameraInterpolation candidate : { CRTCameraInterpolation::LINEAR, CRTCameraInterpolation::SMOOTH })
+	{
+		if (name == getInterpolationName(candidate))
+		{
+			interpolation = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int CRTCameraPath::getNeighbour(int index) const
+{
+	const int count = static_cast<int>(keyframes.size());
+
+	// The last keyframe of a looped path is the first one again
+	if (looped && count > 2)
+	{
+		if (index < 0)
+			return index + count - 1;
+		if (index >= count)
+			return index - count + 1;
+		return index;
+	}
+
+	return index < 0 ? 0 : (index >= count ? count - 1 : index);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "CRTCamera.h"
+
+enum class CRTCameraInterpolation
+{
+	LINEAR,
+	SMOOTH // Catmull-Rom spline through the keyframes
+};
+
+// Where the camera is at a point in time and what it looks at, with the world Y axis up
+struct CRTCameraKeyframe
+{
+	float time = 0.f; // Seconds
+	CRTVector position;
+	CRTVector target;
+};
+
+// Keyframed camera animation for turntables and flythroughs. Positions and targets
+// are interpolated separately and the camera is turned to the target every frame.
+class CRTCameraPath
+{
+public:
+	// Reads a camera path file:
+	// { "fps": 24, "interpolation": "smooth", "loop": false,
+	//   "keyframes": [ { "time": 0, "position": [x, y, z], "target": [x, y, z] }, ... ] }
+	// Returns false when the file cannot be read or has no keyframes.
+	bool load(const std::string& fileName);
+
+	// One turn around target, starting at position, through keyframeCount keyframes
+	static CRTCameraPath createTurntable(const CRTVector& position, const CRTVector& target, float seconds, int keyframeCount = 36);
+
+	// Keyframes are kept sorted by time
+	void addKeyframe(const CRTCameraKeyframe& keyframe);
+	const std::vector<CRTCameraKeyframe>& getKeyframes() const;
+
+	void setInterpolation(CRTCameraInterpolation interpolation);
+	CRTCameraInterpolation getInterpolation() const;
+
+	// A looped path ends where it starts. The spline wraps around and the last
+	// frame, a copy of the first one, is not rendered.
+	void setLooped(bool looped);
+	bool isLooped() const;
+
+	void setFramesPerSecond(float framesPerSecond);
+	float getFramesPerSecond() const;
+
+	float getDuration() const;
+	int getFrameCount() const;
+
+	// Times outside the keyframes are clamped to the first or the last one
+	CRTCamera evaluate(float time) const;
+	CRTCamera getFrameCamera(int frame) const;
+
+	static const char* getInterpolationName(CRTCameraInterpolation interpolation);
+	static bool parseInterpolation(const std::string& name, CRTCameraInterpolation& interpolation);
+
+private:
+	// Keyframe index past either end, wrapped around for looped paths and clamped otherwise
+	int getNeighbour(int index) const;
+
+	std::vector<CRTCameraKeyframe> keyframes;
+	CRTCameraInterpolation interpolation = CRTCameraInterpolation::SMOOTH;
+	bool looped = false;
+	float framesPerSecond = 24.f;
+};
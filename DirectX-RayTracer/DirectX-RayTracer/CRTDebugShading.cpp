@@ -0,0 +1,153 @@
+#include "CRTDebugShading.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+const char* CRTDebugShading::getModeName(CRTShadingMode mode)
+{
+	switch (mode)
+	{
+	case CRTShadingMode::TRIANGLE_COLORS:
+		return "triangle-colors";
+	case CRTShadingMode::OBJECT_SPATIAL:
+		return "object-spatial";
+	case CRTShadingMode::OBJECT_TRIANGLE_SHADES:
+		return "object-triangle-shades";
+	case CRTShadingMode::BARYCENTRICS:
+		return "barycentrics";
+	case CRTShadingMode::HEIGHT_GRADIENT:
+		return "height-gradient";
+	case CRTShadingMode::CAMERA_DISTANCE:
+		return "camera-distance";
+	case CRTShadingMode::CHECKER:
+		return "checker";
+	default:
+		return "unknown";
+	}
+}
+
+bool CRTDebugShading::parseMode(const std::string& name, CRTShadingMode& mode)
+{
+	for (int i = 0; i < static_cast<int>(CRTShadingMode::COUNT); i++)
+	{
+		const CRTShadingMode candidate = static_cast<CRTShadingMode>(i);
+		if (name == getModeName(candidate))
+		{
+			mode = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+CRTDebugRenderer::CRTDebugRenderer(const CRTScene& scene)
+	: scene(scene), accelerationStructure(scene)
+{
+}
+
+void CRTDebugRenderer::render(CRTShadingMode mode, CRTImage& image)
+{
+	accelerationStructure.update(scene.getInstances());
+	image.resize(scene.getSettings().imageWidth, scene.getSettings().imageHeight);
+
+	// The only branch on the mode, once per image
+	switch (mode)
+	{
+	case CRTShadingMode::TRIANGLE_COLORS:
+		renderMode<CRTShadingMode::TRIANGLE_COLORS>(image);
+		break;
+	case CRTShadingMode::OBJECT_SPATIAL:
+		renderMode<CRTShadingMode::OBJECT_SPATIAL>(image);
+		break;
+	case CRTShadingMode::OBJECT_TRIANGLE_SHADES:
+		renderMode<CRTShadingMode::OBJECT_TRIANGLE_SHADES>(image);
+		break;
+	case CRTShadingMode::BARYCENTRICS:
+		renderMode<CRTShadingMode::BARYCENTRICS>(image);
+		break;
+	case CRTShadingMode::HEIGHT_GRADIENT:
+		renderMode<CRTShadingMode::HEIGHT_GRADIENT>(image);
+		break;
+	case CRTShadingMode::CAMERA_DISTANCE:
+		renderMode<CRTShadingMode::CAMERA_DISTANCE>(image);
+		break;
+	default:
+		renderMode<CRTShadingMode::CHECKER>(image);
+		break;
+	}
+}
+
+template<CRTShadingMode Mode>
+void CRTDebugRenderer::renderMode(CRTImage& image) const
+{
+	const int width = image.getWidth();
+	const int height = image.getHeight();
+
+	std::atomic<int> nextRow{ 0 };
+
+	auto renderRows = [&]()
+		{
+			for (int y = nextRow++; y < height; y = nextRow++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					const CRTRay ray = generateCameraRay(x, y, width, height);
+
+					CRTIntersection intersection;
+					if (!accelerationStructure.intersect(ray, intersection))
+					{
+						image.setPixel(x, y, CRTDebugShading::missColor);
+						continue;
+					}
+
+					CRTDebugHit hit;
+					hit.position = ray.getOrigin() + ray.getDirection() * intersection.t;
+					hit.distance = intersection.t;
+					hit.primitiveID = static_cast<uint32_t>(intersection.triangleIndex);
+					hit.instanceID = static_cast<uint32_t>(intersection.objectIndex);
+					hit.u = intersection.u;
+					hit.v = intersection.v;
+
+					image.setPixel(x, y, shadeDebugHit<Mode>(hit));
+				}
+			}
+		};
+
+	const int threadCount = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+	std::vector<std::thread> threads;
+
+	for (int i = 1; i < threadCount; i++)
+		threads.emplace_back(renderRows);
+
+	renderRows();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+CRTRay CRTDebugRenderer::generateCameraRay(int rasterX, int rasterY, int width, int height) const
+{
+	// Same mapping as the rayGen shader, through the pixel center
+	float x = (rasterX + 0.5f) / width;
+	float y = (rasterY + 0.5f) / height;
+
+	x = (2.f * x) - 1.f;
+	y = 1.f - (2.f * y);
+
+	x *= static_cast<float>(width) / height;
+
+	CRTVector dirCamera(x, y, -1.f);
+	dirCamera.normalise();
+
+	const CRTMatrix& r = scene.getCamera().getRotationMatrix();
+	CRTVector dirWorld(
+		r.get(0, 0) * dirCamera.getX() + r.get(0, 1) * dirCamera.getY() + r.get(0, 2) * dirCamera.getZ(),
+		r.get(1, 0) * dirCamera.getX() + r.get(1, 1) * dirCamera.getY() + r.get(1, 2) * dirCamera.getZ(),
+		r.get(2, 0) * dirCamera.getX() + r.get(2, 1) * dirCamera.getY() + r.get(2, 2) * dirCamera.getZ()
+	);
+	dirWorld.normalise();
+
+	return CRTRay(scene.getCamera().getPosition(), dirWorld);
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include "CRTAccelerationStructure.h"
+#include "CRTImage.h"
+
+// Debug views of the editor, in the order of the shading mode selector and of
+// the hit groups of the GPU pipeline
+enum class CRTShadingMode
+{
+	TRIANGLE_COLORS,
+	OBJECT_SPATIAL,
+	OBJECT_TRIANGLE_SHADES,
+	BARYCENTRICS,
+	HEIGHT_GRADIENT,
+	CAMERA_DISTANCE,
+	CHECKER,
+	COUNT
+};
+
+// What the debug views read from a camera ray hit, the same values the closest hit shaders see
+struct CRTDebugHit
+{
+	CRTVector position;
+	float distance;
+	uint32_t primitiveID;
+	uint32_t instanceID;  // Mesh index, like InstanceID() on the GPU
+	float u;              // Barycentric of vertex 1
+	float v;              // Barycentric of vertex 2
+};
+
+namespace CRTDebugShading
+{
+	inline float frac(float x)
+	{
+		return x - std::floor(x);
+	}
+
+	inline float saturate(float x)
+	{
+		return x < 0.f ? 0.f : (x > 1.f ? 1.f : x);
+	}
+
+	inline CRTVector lerp(const CRTVector& a, const CRTVector& b, float t)
+	{
+		return a * (1.f - t) + b * t;
+	}
+
+	inline CRTVector randomObjectColor(uint32_t objID)
+	{
+		return CRTVector(
+			frac(std::sin(objID * 12.9898f) * 43758.5453f),
+			frac(std::sin(objID * 78.233f) * 12345.6789f),
+			frac(std::sin(objID * 39.425f) * 34567.8901f));
+	}
+
+	const CRTVector missColor(0.f, 1.f, 1.f);
+
+	// Short names of the modes for the command line, like "barycentrics"
+	const char* getModeName(CRTShadingMode mode);
+	bool parseMode(const std::string& name, CRTShadingMode& mode);
+}
+
+// One kernel per mode, resolved at compile time so the per-pixel loop has no
+// branch on the mode. Each one mirrors the closest hit shader of its hit group.
+template<CRTShadingMode Mode>
+CRTVector shadeDebugHit(const CRTDebugHit& hit);
+
+template<>
+inline CRTVector shadeDebugHit<CRTShadingMode::TRIANGLE_COLORS>(const CRTDebugHit& hit)
+{
+	using namespace CRTDebugShading;
+	return CRTVector(
+		frac(std::sin(hit.primitiveID * 12.9898f) * 43758.5453f),
+		frac(std::sin(hit.primitiveID * 78.233f) * 43758.5453f),
+		frac(std::sin(hit.primitiveID * 45.164f) * 43758.5453f));
+}
+
+template<>
+inline CRTVector shadeDebugHit<CRTShadingMode::OBJECT_SPATIAL>(const CRTDebugHit& hit)
+{
+	using namespace CRTDebugShading;
+	const CRTVector baseColor = randomObjectColor(hit.instanceID);
+
+	const float cellSize = 2.f;
+	const uint32_t cellX = static_cast<uint32_t>(static_cast<int>(std::floor(hit.position.getX() / cellSize)));
+	const uint32_t cellY = static_cast<uint32_t>(static_cast<int>(std::floor(hit.position.getY() / cellSize)));
+	const uint32_t cellZ = static_cast<uint32_t>(static_cast<int>(std::floor(hit.position.getZ() / cellSize)));
+
+	// Unsigned, so the products wrap like the 32-bit integers of the shader
+	const uint32_t hash = (cellX * 73856093u) ^ (cellY * 19349663u) ^ (cellZ * 83492791u);
+	const float variation = frac(std::sin(hash * 12.9898f) * 43758.5453f);
+
+	return lerp(baseColor * 0.7f, baseColor * 1.3f, variation);
+}
+
+template<>
+inline CRTVector shadeDebugHit<CRTShadingMode::OBJECT_TRIANGLE_SHADES>(const CRTDebugHit& hit)
+{
+	using namespace CRTDebugShading;
+	const float shade = frac(std::sin(hit.primitiveID * 12.9898f) * 43758.5453f);
+	return randomObjectColor(hit.instanceID) * (0.6f + 0.4f * shade);
+}
+
+template<>
+inline CRTVector shadeDebugHit<CRTShadingMode::BARYCENTRICS>(const CRTDebugHit& hit)
+{
+	return CRTVector(1.f - hit.u - hit.v, hit.u, hit.v);
+}
+
+template<>
+inline CRTVector shadeDebugHit<CRTShadingMode::HEIGHT_GRADIENT>(const CRTDebugHit& hit)
+{
+	using namespace CRTDebugShading;
+	const float h = saturate((hit.position.getY() + 10.f) / 20.f);
+	return lerp(CRTVector(0.1f, 0.2f, 0.6f), CRTVector(0.9f, 0.9f, 0.9f), h);
+}
+
+template<>
+inline CRTVector shadeDebugHit<CRTShadingMode::CAMERA_DISTANCE>(const CRTDebugHit& hit)
+{
+	using namespace CRTDebugShading;
+	const float c = saturate(hit.distance * 0.05f);
+	return CRTVector(c, c, c);
+}
+
+template<>
+inline CRTVector shadeDebugHit<CRTShadingMode::CHECKER>(const CRTDebugHit& hit)
+{
+	const int checker = (static_cast<int>(std::floor(hit.position.getX())) ^
+		static_cast<int>(std::floor(hit.position.getZ()))) & 1;
+
+	const float c = checker ? 0.9f : 0.2f;
+	return CRTVector(c, c, c);
+}
+
+// CPU version of the GPU debug views, one primary ray per pixel
+class CRTDebugRenderer
+{
+public:
+	explicit CRTDebugRenderer(const CRTScene& scene);
+
+	// Renders at the image size of the scene settings
+	void render(CRTShadingMode mode, CRTImage& image);
+
+private:
+	template<CRTShadingMode Mode>
+	void renderMode(CRTImage& image) const;
+
+	CRTRay generateCameraRay(int x, int y, int width, int height) const;
+
+	const CRTScene& scene;
+	CRTAccelerationStructure accelerationStructure;
+};
@@ -0,0 +1,363 @@
+#include "CRTDenoiser.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRT_DENOISER_SSE2
+#include <emmintrin.h>
+#endif
+
+// Binomial taps of every wavelet level. 3x3 instead of the 5x5 B3 spline, the
+// footprint still grows fast enough and each level costs 9 taps instead of 25.
+static const float kernel[3] = { 1.f / 4.f, 1.f / 2.f, 1.f / 4.f };
+
+// Keeps the demodulation invertible where the albedo has a zero channel
+static const float albedoEpsilon = 1e-3f;
+
+// Depth differences of pixels closer than this are measured against it instead
+static const float minDepth = 1e-3f;
+
+// Weights below exp(-30) are lost next to the center tap anyway. Clamping there
+// keeps the products with them out of the slow denormal range.
+static const float minExponent = -30.f;
+
+// exp(x) as 2^i * 2^f with a polynomial for 2^f. The SIMD path evaluates the
+// same steps, so both paths give the same weights.
+static float fastExp(float x)
+{
+	const float t = std::max(x, minExponent) * 1.44269504f;
+	const float i = floorf(t);
+	const float f = t - i;
+	const float p = 1.f + f * (0.693147f + f * (0.240227f + f * (0.0555041f + f * (0.00961813f + f * 0.00133336f))));
+
+	const int32_t bits = (static_cast<int32_t>(i) + 127) << 23;
+	float scale;
+	memcpy(&scale, &bits, sizeof(scale));
+
+	return p * scale;
+}
+
+#ifdef CRT_DENOISER_SSE2
+static __m128 fastExp4(__m128 x)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 t = _mm_mul_ps(_mm_max_ps(x, _mm_set1_ps(minExponent)), _mm_set1_ps(1.44269504f));
+
+	// Truncation rounds negative values up, step those back down to the floor
+	__m128i i = _mm_cvttps_epi32(t);
+	__m128 fi = _mm_cvtepi32_ps(i);
+	const __m128 roundedUp = _mm_cmpgt_ps(fi, t);
+	i = _mm_add_epi32(i, _mm_castps_si128(roundedUp));
+	fi = _mm_sub_ps(fi, _mm_and_ps(roundedUp, one));
+
+	const __m128 f = _mm_sub_ps(t, fi);
+	__m128 p = _mm_set1_ps(0.00133336f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.00961813f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.0555041f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.240227f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.693147f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), one);
+
+	const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23));
+	return _mm_mul_ps(p, scale);
+}
+#endif
+
+CRTDenoiser::CRTDenoiser(const CRTDenoiseSettings& settings) : settings(settings)
+{
+}
+
+bool CRTDenoiser::denoise(const CRTImage& color, const CRTAOVBuffers& aovs, CRTImage& output) const
+{
+	const int width = color.getWidth();
+	const int height = color.getHeight();
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+
+	// The aovMask of the render settings can leave the guides out
+	if (!aovs.has(CRTAOVMask::denoiserGuides) || aovs.width != width || aovs.height != height ||
+		aovs.depth.size() != pixelCount || aovs.normal.getPixels().size() != pixelCount || aovs.albedo.getPixels().size() != pixelCount)
+	{
+		output = color;
+		return false;
+	}
+
+	Guides guides;
+	guides.width = width;
+	guides.height = height;
+
+	for (std::vector<float>& channel : guides.channels)
+		channel.resize(pixelCount);
+
+	ColorPlanes planes[2];
+	for (ColorPlanes& colorPlanes : planes)
+	{
+		for (std::vector<float>& channel : colorPlanes.channels)
+			channel.resize(pixelCount);
+	}
+
+	const std::vector<CRTVector>& colors = color.getPixels();
+	const std::vector<CRTVector>& albedos = aovs.albedo.getPixels();
+	const std::vector<CRTVector>& normals = aovs.normal.getPixels();
+
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (int channel = 0; channel < 3; channel++)
+		{
+			const float albedo = albedos[i].getByIndex(channel);
+
+			guides.channels[NORMAL_X + channel][i] = normals[i].getByIndex(channel);
+			guides.channels[ALBEDO_X + channel][i] = albedo;
+			planes[0].channels[channel][i] = colors[i].getByIndex(channel) / (albedo + albedoEpsilon);
+		}
+
+		guides.channels[DEPTH][i] = aovs.depth[i];
+	}
+
+	std::vector<Tile> tiles;
+	const int tileSize = std::max(settings.tileSize, 4);
+
+	for (int y = 0; y < height; y += tileSize)
+	{
+		for (int x = 0; x < width; x += tileSize)
+		{
+			tiles.push_back({ x, y, std::min(tileSize, width - x), std::min(tileSize, height - y) });
+		}
+	}
+
+	int threadCount = settings.threadCount > 0 ? settings.threadCount : static_cast<int>(std::thread::hardware_concurrency());
+	threadCount = std::clamp(threadCount, 1, std::max(static_cast<int>(tiles.size()), 1));
+
+	int current = 0;
+	float colorSigma = settings.colorSigma;
+
+	for (int iteration = 0; iteration < settings.iterations; iteration++)
+	{
+		const int step = 1 << iteration;
+		const ColorPlanes& source = planes[current];
+		ColorPlanes& target = planes[1 - current];
+
+		std::atomic<int> nextTile{ 0 };
+
+		auto worker = [&]()
+			{
+				for (;;)
+				{
+					const int tileIndex = nextTile++;
+					if (tileIndex >= static_cast<int>(tiles.size()))
+						break;
+
+					filterTile(tiles[tileIndex], step, colorSigma, guides, source, target);
+				}
+			};
+
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.emplace_back(worker);
+		}
+
+		worker();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		current = 1 - current;
+		colorSigma *= 0.5f;
+	}
+
+	output.resize(width, height);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const size_t i = static_cast<size_t>(y) * width + x;
+
+			output.setPixel(x, y, CRTVector(
+				planes[current].channels[0][i] * (guides.channels[ALBEDO_X][i] + albedoEpsilon),
+				planes[current].channels[1][i] * (guides.channels[ALBEDO_Y][i] + albedoEpsilon),
+				planes[current].channels[2][i] * (guides.channels[ALBEDO_Z][i] + albedoEpsilon)));
+		}
+	}
+
+	return true;
+}
+
+void CRTDenoiser::filterTile(const Tile& tile, int step, float colorSigma, const Guides& guides,
+	const ColorPlanes& source, ColorPlanes& target) const
+{
+	const int radius = step;
+	const int endX = tile.x + tile.width;
+
+	for (int y = tile.y; y < tile.y + tile.height; y++)
+	{
+		int x = tile.x;
+
+#ifdef CRT_DENOISER_SSE2
+		// Left border, where the taps have to be clamped
+		for (; x < endX && x < radius; x++)
+		{
+			filterPixel(x, y, step, colorSigma, guides, source, target);
+		}
+
+		const int simdEndX = std::min(endX, guides.width - radius);
+		for (; x + 4 <= simdEndX; x += 4)
+		{
+			filterPixels4(x, y, step, colorSigma, guides, source, target);
+		}
+#endif
+
+		for (; x < endX; x++)
+		{
+			filterPixel(x, y, step, colorSigma, guides, source, target);
+		}
+	}
+}
+
+void CRTDenoiser::filterPixel(int x, int y, int step, float colorSigma, const Guides& guides,
+	const ColorPlanes& source, ColorPlanes& target) const
+{
+	const int width = guides.width;
+	const size_t center = static_cast<size_t>(y) * width + x;
+
+	const float invColor = 1.f / (colorSigma * colorSigma);
+	const float invNormal = 1.f / (settings.normalSigma * settings.normalSigma);
+	const float invAlbedo = 1.f / (settings.albedoSigma * settings.albedoSigma);
+	const float invDepth = 1.f / (settings.depthSigma * std::max(guides.channels[DEPTH][center], minDepth));
+
+	float centerColor[3];
+	float centerGuide[GUIDE_CHANNEL_COUNT];
+
+	for (int channel = 0; channel < 3; channel++)
+		centerColor[channel] = source.channels[channel][center];
+
+	for (int channel = 0; channel < GUIDE_CHANNEL_COUNT; channel++)
+		centerGuide[channel] = guides.channels[channel][center];
+
+	float sum[3] = { 0.f, 0.f, 0.f };
+	float weightSum = 0.f;
+
+	for (int ky = 0; ky < 3; ky++)
+	{
+		const int tapY = std::clamp(y + (ky - 1) * step, 0, guides.height - 1);
+
+		for (int kx = 0; kx < 3; kx++)
+		{
+			const int tapX = std::clamp(x + (kx - 1) * step, 0, width - 1);
+			const size_t tap = static_cast<size_t>(tapY) * width + tapX;
+
+			float colorDistance = 0.f;
+			float normalDistance = 0.f;
+			float albedoDistance = 0.f;
+
+			for (int channel = 0; channel < 3; channel++)
+			{
+				const float colorDelta = source.channels[channel][tap] - centerColor[channel];
+				const float normalDelta = guides.channels[NORMAL_X + channel][tap] - centerGuide[NORMAL_X + channel];
+				const float albedoDelta = guides.channels[ALBEDO_X + channel][tap] - centerGuide[ALBEDO_X + channel];
+
+				colorDistance += colorDelta * colorDelta;
+				normalDistance += normalDelta * normalDelta;
+				albedoDistance += albedoDelta * albedoDelta;
+			}
+
+			const float depthDistance = fabsf(guides.channels[DEPTH][tap] - centerGuide[DEPTH]);
+
+			const float weight = kernel[kx] * kernel[ky] * fastExp(-(colorDistance * invColor +
+				normalDistance * invNormal + albedoDistance * invAlbedo + depthDistance * invDepth));
+
+			for (int channel = 0; channel < 3; channel++)
+				sum[channel] += weight * source.channels[channel][tap];
+
+			weightSum += weight;
+		}
+	}
+
+	// The center tap always has a positive weight
+	for (int channel = 0; channel < 3; channel++)
+		target.channels[channel][center] = sum[channel] / weightSum;
+}
+
+void CRTDenoiser::filterPixels4(int x, int y, int step, float colorSigma, const Guides& guides,
+	const ColorPlanes& source, ColorPlanes& target) const
+{
+#ifdef CRT_DENOISER_SSE2
+	const int width = guides.width;
+	const size_t center = static_cast<size_t>(y) * width + x;
+
+	const __m128 invColor = _mm_set1_ps(1.f / (colorSigma * colorSigma));
+	const __m128 invNormal = _mm_set1_ps(1.f / (settings.normalSigma * settings.normalSigma));
+	const __m128 invAlbedo = _mm_set1_ps(1.f / (settings.albedoSigma * settings.albedoSigma));
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+	__m128 centerColor[3];
+	__m128 centerGuide[GUIDE_CHANNEL_COUNT];
+
+	for (int channel = 0; channel < 3; channel++)
+		centerColor[channel] = _mm_loadu_ps(&source.channels[channel][center]);
+
+	for (int channel = 0; channel < GUIDE_CHANNEL_COUNT; channel++)
+		centerGuide[channel] = _mm_loadu_ps(&guides.channels[channel][center]);
+
+	const __m128 invDepth = _mm_div_ps(_mm_set1_ps(1.f),
+		_mm_mul_ps(_mm_set1_ps(settings.depthSigma), _mm_max_ps(centerGuide[DEPTH], _mm_set1_ps(minDepth))));
+
+	__m128 sum[3] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+	__m128 weightSum = _mm_setzero_ps();
+
+	for (int ky = 0; ky < 3; ky++)
+	{
+		const int tapY = std::clamp(y + (ky - 1) * step, 0, guides.height - 1);
+
+		for (int kx = 0; kx < 3; kx++)
+		{
+			const size_t tap = static_cast<size_t>(tapY) * width + x + (kx - 1) * step;
+
+			__m128 colorDistance = _mm_setzero_ps();
+			__m128 normalDistance = _mm_setzero_ps();
+			__m128 albedoDistance = _mm_setzero_ps();
+			__m128 tapColor[3];
+
+			for (int channel = 0; channel < 3; channel++)
+			{
+				tapColor[channel] = _mm_loadu_ps(&source.channels[channel][tap]);
+
+				const __m128 colorDelta = _mm_sub_ps(tapColor[channel], centerColor[channel]);
+				const __m128 normalDelta = _mm_sub_ps(_mm_loadu_ps(&guides.channels[NORMAL_X + channel][tap]), centerGuide[NORMAL_X + channel]);
+				const __m128 albedoDelta = _mm_sub_ps(_mm_loadu_ps(&guides.channels[ALBEDO_X + channel][tap]), centerGuide[ALBEDO_X + channel]);
+
+				colorDistance = _mm_add_ps(colorDistance, _mm_mul_ps(colorDelta, colorDelta));
+				normalDistance = _mm_add_ps(normalDistance, _mm_mul_ps(normalDelta, normalDelta));
+				albedoDistance = _mm_add_ps(albedoDistance, _mm_mul_ps(albedoDelta, albedoDelta));
+			}
+
+			const __m128 depthDistance = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&guides.channels[DEPTH][tap]), centerGuide[DEPTH]), signMask);
+
+			__m128 distance = _mm_mul_ps(colorDistance, invColor);
+			distance = _mm_add_ps(distance, _mm_mul_ps(normalDistance, invNormal));
+			distance = _mm_add_ps(distance, _mm_mul_ps(albedoDistance, invAlbedo));
+			distance = _mm_add_ps(distance, _mm_mul_ps(depthDistance, invDepth));
+
+			const __m128 weight = _mm_mul_ps(_mm_set1_ps(kernel[kx] * kernel[ky]),
+				fastExp4(_mm_sub_ps(_mm_setzero_ps(), distance)));
+
+			for (int channel = 0; channel < 3; channel++)
+				sum[channel] = _mm_add_ps(sum[channel], _mm_mul_ps(weight, tapColor[channel]));
+
+			weightSum = _mm_add_ps(weightSum, weight);
+		}
+	}
+
+	for (int channel = 0; channel < 3; channel++)
+		_mm_storeu_ps(&target.channels[channel][center], _mm_div_ps(sum[channel], weightSum));
+#else
+	for (int i = 0; i < 4; i++)
+		filterPixel(x + i, y, step, colorSigma, guides, source, target);
+#endif
+}
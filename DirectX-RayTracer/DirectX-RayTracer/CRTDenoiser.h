@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include "CRTImage.h"
+#include "CRTAOVBuffers.h"
+
+struct CRTDenoiseSettings
+{
+	int iterations = 5; // The filter footprint doubles every iteration, 5 cover 63x63 pixels
+	int threadCount = 0; // 0 means one thread per hardware thread
+	int tileSize = 64;
+
+	// Edge-stopping widths, a larger value lets more of the neighbour through
+	float colorSigma = 0.5f; // Halved every iteration
+	float normalSigma = 0.3f;
+	float albedoSigma = 0.1f;
+	float depthSigma = 0.05f; // Relative to the depth of the filtered pixel
+};
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al., 2010) for low sample
+// renders. The color is divided by the albedo first, so only the lighting is
+// blurred and texture detail survives, then the albedo, normal and depth of
+// the primary hits stop the filter at edges.
+class CRTDenoiser
+{
+public:
+	explicit CRTDenoiser(const CRTDenoiseSettings& settings = CRTDenoiseSettings());
+
+	// Returns false, and copies the color unchanged, when the AOVs lack the
+	// guides or were rendered at another size than the color
+	bool denoise(const CRTImage& color, const CRTAOVBuffers& aovs, CRTImage& output) const;
+
+private:
+	// Channel layout of Guides
+	enum GuideChannel
+	{
+		NORMAL_X, NORMAL_Y, NORMAL_Z,
+		ALBEDO_X, ALBEDO_Y, ALBEDO_Z,
+		DEPTH,
+		GUIDE_CHANNEL_COUNT
+	};
+
+	// Images split into one float array per channel, so the SIMD path loads 4 neighbours at once
+	struct Guides
+	{
+		int width = 0;
+		int height = 0;
+		std::vector<float> channels[GUIDE_CHANNEL_COUNT];
+	};
+
+	struct ColorPlanes
+	{
+		std::vector<float> channels[3];
+	};
+
+	struct Tile
+	{
+		int x, y, width, height;
+	};
+
+	// One wavelet level with taps step pixels apart
+	void filterTile(const Tile& tile, int step, float colorSigma, const Guides& guides,
+		const ColorPlanes& source, ColorPlanes& target) const;
+	void filterPixel(int x, int y, int step, float colorSigma, const Guides& guides,
+		const ColorPlanes& source, ColorPlanes& target) const;
+
+	// Pixels x to x + 3, all taps have to be inside the row
+	void filterPixels4(int x, int y, int step, float colorSigma, const Guides& guides,
+		const ColorPlanes& source, ColorPlanes& target) const;
+
+private:
+	CRTDenoiseSettings settings;
+};
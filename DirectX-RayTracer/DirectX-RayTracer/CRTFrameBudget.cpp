@@ -0,0 +1,101 @@
+#include "CRTFrameBudget.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+CRTFrameBudget::CRTFrameBudget(float targetFrameSeconds, float minScale)
+	: targetFrameSeconds(targetFrameSeconds), minScale(minScale)
+{
+	assert(targetFrameSeconds > 0.f);
+	assert(minScale > 0.f && minScale <= 1.f);
+}
+
+void CRTFrameBudget::setTargetFrameSeconds(float seconds)
+{
+	assert(seconds > 0.f);
+	targetFrameSeconds = seconds;
+	framesSinceChange = settleFrames;
+}
+
+float CRTFrameBudget::getTargetFrameSeconds() const
+{
+	return targetFrameSeconds;
+}
+
+void CRTFrameBudget::reset()
+{
+	scale = 1.f;
+	framesSinceChange = 0;
+	changeCount = 0;
+	frameTimes.clear();
+	fullScaleTimes.clear();
+	nextFrame = 0;
+}
+
+float CRTFrameBudget::addFrame(float frameSeconds, float frameScale)
+{
+	assert(frameScale > 0.f);
+
+	// The traced pixels, and with them most of the frame time, grow with the square of the scale
+	const float fullScaleSeconds = frameSeconds / (frameScale * frameScale);
+
+	if (static_cast<int>(frameTimes.size()) < historySize)
+	{
+		frameTimes.push_back(frameSeconds);
+		fullScaleTimes.push_back(fullScaleSeconds);
+	}
+	else
+	{
+		frameTimes[nextFrame] = frameSeconds;
+		fullScaleTimes[nextFrame] = fullScaleSeconds;
+	}
+	nextFrame = (nextFrame + 1) % historySize;
+	framesSinceChange++;
+
+	if (static_cast<int>(frameTimes.size()) < historySize || framesSinceChange < settleFrames)
+		return scale;
+
+	// Medians ignore the odd long frame, like a resize or a CPU render
+	const float frameTime = median(frameTimes);
+	const bool overBudget = frameTime > targetFrameSeconds * (1.f + overBudgetTolerance);
+	const bool underBudget = frameTime < targetFrameSeconds * (1.f - underBudgetHeadroom);
+
+	if (!overBudget && !(underBudget && scale < 1.f))
+		return scale;
+
+	float newScale = std::sqrt(targetFrameSeconds / median(fullScaleTimes));
+	newScale = std::min(newScale, scale * maxScaleIncrease);
+	newScale = std::floor(newScale / scaleStep) * scaleStep;
+	newScale = std::clamp(newScale, minScale, 1.f);
+
+	if (newScale != scale)
+	{
+		scale = newScale;
+		framesSinceChange = 0;
+		changeCount++;
+	}
+
+	return scale;
+}
+
+float CRTFrameBudget::getScale() const
+{
+	return scale;
+}
+
+float CRTFrameBudget::getFrameSeconds() const
+{
+	return frameTimes.empty() ? 0.f : median(frameTimes);
+}
+
+int CRTFrameBudget::getChangeCount() const
+{
+	return changeCount;
+}
+
+float CRTFrameBudget::median(std::vector<float> values) const
+{
+	const size_t middle = values.size() / 2;
+	std::nth_element(values.begin(), values.begin() + middle, values.end());
+	return values[middle];
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+
+// Picks the render scale which keeps the frame time under a target. It is fed
+// the measured duration of every frame with the scale the frame was rendered at,
+// so the frame times can come from a timer as well as from a synthetic trace.
+class CRTFrameBudget
+{
+public:
+	static constexpr int historySize = 9;       // Frames the decisions are based on
+	static constexpr int settleFrames = 4;      // Frames after a change before the next one, covers the frames in flight
+	static constexpr float overBudgetTolerance = 0.05f;  // Lower the scale above target * (1 + tolerance)
+	static constexpr float underBudgetHeadroom = 0.15f;  // Raise the scale below target * (1 - headroom)
+	static constexpr float maxScaleIncrease = 1.25f;     // Raising is gradual, lowering is immediate
+	static constexpr float scaleStep = 1.f / 32.f;
+
+	explicit CRTFrameBudget(float targetFrameSeconds = 1.f / 60.f, float minScale = 0.25f);
+
+	void setTargetFrameSeconds(float seconds);
+	float getTargetFrameSeconds() const;
+
+	// Forget the measurements and go back to full scale
+	void reset();
+
+	// Returns the scale for the next frames
+	float addFrame(float frameSeconds, float frameScale);
+
+	float getScale() const;
+
+	// Median of the recent frame times, 0 until the first frame
+	float getFrameSeconds() const;
+
+	// Number of times the scale changed since the last reset
+	int getChangeCount() const;
+
+private:
+	float median(std::vector<float> values) const;
+
+	float targetFrameSeconds;
+	float minScale;
+	float scale = 1.f;
+	int framesSinceChange = 0;
+	int changeCount = 0;
+
+	// Ring of the recent frame times and of the times scaled to a full resolution frame
+	std::vector<float> frameTimes;
+	std::vector<float> fullScaleTimes;
+	int nextFrame = 0;
+};
@@ -0,0 +1,95 @@
+#include "CRTFramePacer.h"
+#include "CRTTrace.h"
+#include <cassert>
+
+CRTFramePacer::CRTFramePacer(int framesInFlight) :
+	framesInFlight(framesInFlight),
+	frameFenceValues(framesInFlight, 0)
+{
+	assert(framesInFlight > 0);
+}
+
+int CRTFramePacer::beginFrame(CRTFenceQueue& queue)
+{
+	frameIndex = static_cast<int>(frameCount % framesInFlight);
+
+	const uint64_t fenceValue = frameFenceValues[frameIndex];
+	if (queue.getCompletedValue() < fenceValue)
+	{
+		CRT_TRACE_ZONE("Wait for frame fence");
+		queue.waitForValue(fenceValue);
+		stallCount++;
+	}
+
+	return frameIndex;
+}
+
+uint64_t CRTFramePacer::endFrame()
+{
+	lastFenceValue = nextFenceValue++;
+	frameFenceValues[frameIndex] = lastFenceValue;
+	frameCount++;
+
+	return lastFenceValue;
+}
+
+void CRTFramePacer::waitForIdle(CRTFenceQueue& queue)
+{
+	if (queue.getCompletedValue() < lastFenceValue)
+	{
+		CRT_TRACE_ZONE("Wait for idle");
+		queue.waitForValue(lastFenceValue);
+	}
+}
+
+int CRTFramePacer::getFramesInFlight() const
+{
+	return framesInFlight;
+}
+
+int CRTFramePacer::getFrameIndex() const
+{
+	return frameIndex;
+}
+
+uint64_t CRTFramePacer::getFrameCount() const
+{
+	return frameCount;
+}
+
+uint64_t CRTFramePacer::getStallCount() const
+{
+	return stallCount;
+}
+
+CRTConstantRing::CRTConstantRing(int frameCount, uint64_t sliceSize, uint64_t alignment) :
+	frameCount(frameCount),
+	sliceSize((sliceSize + alignment - 1) / alignment * alignment),
+	alignment(alignment)
+{
+	assert(frameCount > 0 && alignment > 0);
+}
+
+void CRTConstantRing::beginFrame(int frameIndex)
+{
+	assert(frameIndex >= 0 && frameIndex < frameCount);
+
+	sliceStart = frameIndex * sliceSize;
+	sliceOffset = 0;
+}
+
+uint64_t CRTConstantRing::allocate(uint64_t size)
+{
+	const uint64_t offset = sliceOffset;
+	sliceOffset += (size + alignment - 1) / alignment * alignment;
+
+	// The slice size is fixed up front, it has to hold all constants of a frame
+	assert(sliceOffset <= sliceSize);
+
+	return sliceStart + offset;
+}
+
+uint64_t CRTConstantRing::getSize() const
+{
+	return frameCount * sliceSize;
+}
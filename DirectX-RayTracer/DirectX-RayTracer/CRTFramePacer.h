@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Fence of the queue the frames are submitted to. DXRTFrameFence implements it
+// on an ID3D12Fence, a simulated queue can complete the values on its own schedule.
+class CRTFenceQueue
+{
+public:
+	virtual ~CRTFenceQueue() = default;
+
+	virtual uint64_t getCompletedValue() const = 0;
+
+	// Blocks until the value is completed
+	virtual void waitForValue(uint64_t value) = 0;
+};
+
+// Lets the CPU record up to framesInFlight frames ahead of the GPU. Every frame
+// slot owns its per-frame resources, before a slot is reused the CPU waits only
+// for the frame that used it last.
+class CRTFramePacer
+{
+public:
+	explicit CRTFramePacer(int framesInFlight);
+
+	// Returns the slot of the new frame, after its previous frame has completed
+	int beginFrame(CRTFenceQueue& queue);
+
+	// Returns the fence value the caller has to signal after submitting the frame
+	uint64_t endFrame();
+
+	// Waits for every submitted frame, before resources shared by the frames are changed
+	void waitForIdle(CRTFenceQueue& queue);
+
+	int getFramesInFlight() const;
+	int getFrameIndex() const;
+	uint64_t getFrameCount() const;
+
+	// Number of beginFrame calls that had to block on the GPU
+	uint64_t getStallCount() const;
+
+private:
+	int framesInFlight;
+	int frameIndex = 0;
+	uint64_t frameCount = 0;
+	uint64_t nextFenceValue = 1;
+	uint64_t lastFenceValue = 0;
+	uint64_t stallCount = 0;
+	std::vector<uint64_t> frameFenceValues; // Fence value of the last frame recorded in each slot
+};
+
+// Per-frame slices of one persistently mapped constant buffer. Constants are
+// written to the slice of the current frame, so frames still on the GPU keep theirs.
+class CRTConstantRing
+{
+public:
+	CRTConstantRing(int frameCount, uint64_t sliceSize, uint64_t alignment = 256);
+
+	// Starts allocating from the beginning of the slice of the frame
+	void beginFrame(int frameIndex);
+
+	// Returns the offset from the start of the whole buffer
+	uint64_t allocate(uint64_t size);
+
+	uint64_t getSize() const;
+
+private:
+	int frameCount;
+	uint64_t sliceSize;
+	uint64_t alignment;
+	uint64_t sliceStart = 0;
+	uint64_t sliceOffset = 0;
+};
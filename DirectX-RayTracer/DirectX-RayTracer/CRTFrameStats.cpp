@@ -0,0 +1,253 @@
+#include "CRTFrameStats.h"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include "rapidjson/ostreamwrapper.h"
+#include "rapidjson/prettywriter.h"
+
+CRTFrameStats::CRTFrameStats(size_t capacity) :
+	capacity(capacity)
+{
+	assert(capacity > 0);
+	frames.reserve(capacity);
+}
+
+void CRTFrameStats::clear()
+{
+	frames.clear();
+	nextFrame = 0;
+	totalHitchCount = 0;
+}
+
+bool CRTFrameStats::addFrame(const CRTFrameSample& sample)
+{
+	CRTFrameSample frame = sample;
+	frame.hitch = false;
+
+	// Against the frames before it, so a long stall does not raise its own bar
+	if (frames.size() >= minHitchHistory)
+	{
+		const double median = getPercentile(CRTFrameMetric::FRAME, 50.0);
+		frame.hitch = frame.frameSeconds > hitchFactor * median;
+	}
+
+	if (frames.size() < capacity)
+	{
+		frames.push_back(frame);
+	}
+	else
+	{
+		frames[nextFrame] = frame;
+	}
+	nextFrame = (nextFrame + 1) % capacity;
+
+	if (frame.hitch)
+		totalHitchCount++;
+
+	return frame.hitch;
+}
+
+size_t CRTFrameStats::getCapacity() const
+{
+	return capacity;
+}
+
+size_t CRTFrameStats::getFrameCount() const
+{
+	return frames.size();
+}
+
+const CRTFrameSample& CRTFrameStats::getFrame(size_t index) const
+{
+	assert(index < frames.size());
+
+	// Until the ring is full the oldest frame is at 0, afterwards at nextFrame
+	const size_t oldest = frames.size() < capacity ? 0 : nextFrame;
+	return frames[(oldest + index) % frames.size()];
+}
+
+const char* CRTFrameStats::getMetricName(CRTFrameMetric metric)
+{
+	switch (metric)
+	{
+	case CRTFrameMetric::FRAME: return "frameSeconds";
+	case CRTFrameMetric::CPU: return "cpuSeconds";
+	case CRTFrameMetric::GPU_WAIT: return "gpuWaitSeconds";
+	case CRTFrameMetric::PRESENT: return "presentSeconds";
+	case CRTFrameMetric::RAYS: return "raysTraced";
+	default: return "unknown";
+	}
+}
+
+double CRTFrameStats::getMetric(const CRTFrameSample& sample, CRTFrameMetric metric)
+{
+	switch (metric)
+	{
+	case CRTFrameMetric::FRAME: return sample.frameSeconds;
+	case CRTFrameMetric::CPU: return sample.cpuSeconds;
+	case CRTFrameMetric::GPU_WAIT: return sample.gpuWaitSeconds;
+	case CRTFrameMetric::PRESENT: return sample.presentSeconds;
+	case CRTFrameMetric::RAYS: return static_cast<double>(sample.raysTraced);
+	default: return 0.0;
+	}
+}
+
+std::vector<double> CRTFrameStats::getValues(CRTFrameMetric metric) const
+{
+	std::vector<double> values;
+	values.reserve(frames.size());
+
+	for (const CRTFrameSample& frame : frames)
+		values.push_back(getMetric(frame, metric));
+
+	return values;
+}
+
+double CRTFrameStats::getPercentile(CRTFrameMetric metric, double percentile) const
+{
+	if (frames.empty())
+		return 0.0;
+
+	std::vector<double> values = getValues(metric);
+
+	const double position = std::clamp(percentile, 0.0, 100.0) / 100.0 * (values.size() - 1);
+	const size_t below = static_cast<size_t>(position);
+	const size_t above = std::min(below + 1, values.size() - 1);
+
+	std::nth_element(values.begin(), values.begin() + below, values.end());
+	const double low = values[below];
+
+	// The next larger value is the smallest of the ones after the partition point
+	const double high = above == below ? low : *std::min_element(values.begin() + above, values.end());
+
+	return low + (high - low) * (position - below);
+}
+
+double CRTFrameStats::getMean(CRTFrameMetric metric) const
+{
+	if (frames.empty())
+		return 0.0;
+
+	double sum = 0.0;
+	for (const CRTFrameSample& frame : frames)
+		sum += getMetric(frame, metric);
+
+	return sum / frames.size();
+}
+
+double CRTFrameStats::getMax(CRTFrameMetric metric) const
+{
+	double maxValue = 0.0;
+	for (const CRTFrameSample& frame : frames)
+		maxValue = std::max(maxValue, getMetric(frame, metric));
+
+	return maxValue;
+}
+
+float CRTFrameStats::getFramesPerSecond(float windowSeconds) const
+{
+	float seconds = 0.f;
+	size_t count = 0;
+
+	for (size_t i = frames.size(); i > 0 && seconds < windowSeconds; i--)
+	{
+		seconds += getFrame(i - 1).frameSeconds;
+		count++;
+	}
+
+	return seconds > 0.f ? count / seconds : 0.f;
+}
+
+size_t CRTFrameStats::getHitchCount() const
+{
+	return std::count_if(frames.begin(), frames.end(), [](const CRTFrameSample& frame) { return frame.hitch; });
+}
+
+size_t CRTFrameStats::getTotalHitchCount() const
+{
+	return totalHitchCount;
+}
+
+bool CRTFrameStats::writeCSV(const std::string& fileName) const
+{
+	std::ofstream file(fileName);
+	if (!file)
+		return false;
+
+	file << "frame,frameSeconds,cpuSeconds,gpuWaitSeconds,presentSeconds,raysTraced,hitch\n";
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const CRTFrameSample& frame = getFrame(i);
+		file << i << ',' << frame.frameSeconds << ',' << frame.cpuSeconds << ',' << frame.gpuWaitSeconds << ','
+			<< frame.presentSeconds << ',' << frame.raysTraced << ',' << (frame.hitch ? 1 : 0) << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool CRTFrameStats::writeJSON(const std::string& fileName) const
+{
+	std::ofstream file(fileName);
+	if (!file)
+		return false;
+
+	rapidjson::OStreamWrapper stream(file);
+	rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(stream);
+
+	writer.StartObject();
+	writer.Key("frameCount");
+	writer.Uint64(frames.size());
+	writer.Key("framesPerSecond");
+	writer.Double(getFramesPerSecond());
+	writer.Key("hitchCount");
+	writer.Uint64(getHitchCount());
+
+	writer.Key("metrics");
+	writer.StartObject();
+	for (int i = 0; i < static_cast<int>(CRTFrameMetric::COUNT); i++)
+	{
+		const CRTFrameMetric metric = static_cast<CRTFrameMetric>(i);
+
+		writer.Key(getMetricName(metric));
+		writer.StartObject();
+		writer.Key("mean");
+		writer.Double(getMean(metric));
+		writer.Key("p50");
+		writer.Double(getPercentile(metric, 50.0));
+		writer.Key("p95");
+		writer.Double(getPercentile(metric, 95.0));
+		writer.Key("p99");
+		writer.Double(getPercentile(metric, 99.0));
+		writer.Key("max");
+		writer.Double(getMax(metric));
+		writer.EndObject();
+	}
+	writer.EndObject();
+
+	writer.Key("frames");
+	writer.StartArray();
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const CRTFrameSample& frame = getFrame(i);
+
+		writer.StartObject();
+		for (int m = 0; m < static_cast<int>(CRTFrameMetric::COUNT); m++)
+		{
+			const CRTFrameMetric metric = static_cast<CRTFrameMetric>(m);
+			writer.Key(getMetricName(metric));
+			if (metric == CRTFrameMetric::RAYS)
+				writer.Int64(frame.raysTraced);
+			else
+				writer.Double(getMetric(frame, metric));
+		}
+		writer.Key("hitch");
+		writer.Bool(frame.hitch);
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	writer.EndObject();
+	file << std::endl;
+
+	return static_cast<bool>(file);
+}
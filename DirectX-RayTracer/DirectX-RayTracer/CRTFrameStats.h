@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// What one frame of the render loop cost
+struct CRTFrameSample
+{
+	float frameSeconds = 0.f;   // From the start of this frame to the start of the next
+	float cpuSeconds = 0.f;     // Spent recording and submitting, without the waits below
+	float gpuWaitSeconds = 0.f; // Blocked on the fence of an earlier frame
+	float presentSeconds = 0.f; // Blocked in Present
+	long long raysTraced = 0;   // Only known on the CPU path
+	bool hitch = false;         // Set by CRTFrameStats::addFrame
+};
+
+enum class CRTFrameMetric
+{
+	FRAME,
+	CPU,
+	GPU_WAIT,
+	PRESENT,
+	RAYS,
+	COUNT
+};
+
+// Rolling history of the recent frames with percentiles and hitch detection.
+// It only stores numbers, so the application and the headless tools share it.
+class CRTFrameStats
+{
+public:
+	// A frame is a hitch when it takes hitchFactor times the median of the history
+	static constexpr float hitchFactor = 2.f;
+	static constexpr size_t minHitchHistory = 8; // Frames needed before anything counts as a hitch
+
+	explicit CRTFrameStats(size_t capacity = 1024);
+
+	void clear();
+
+	// Returns whether the frame is a hitch
+	bool addFrame(const CRTFrameSample& sample);
+
+	size_t getCapacity() const;
+	size_t getFrameCount() const;
+
+	// 0 is the oldest frame in the history
+	const CRTFrameSample& getFrame(size_t index) const;
+
+	static const char* getMetricName(CRTFrameMetric metric);
+	static double getMetric(const CRTFrameSample& sample, CRTFrameMetric metric);
+
+	// Percentile in [0, 100] over the history, linearly interpolated. 0 without frames.
+	double getPercentile(CRTFrameMetric metric, double percentile) const;
+	double getMean(CRTFrameMetric metric) const;
+	double getMax(CRTFrameMetric metric) const;
+
+	// Frames of the most recent windowSeconds, divided by the time they took
+	float getFramesPerSecond(float windowSeconds = 1.f) const;
+
+	// Hitches currently in the history and since the last clear
+	size_t getHitchCount() const;
+	size_t getTotalHitchCount() const;
+
+	// One row per frame, oldest first
+	bool writeCSV(const std::string& fileName) const;
+
+	// The percentiles of every metric and the frames
+	bool writeJSON(const std::string& fileName) const;
+
+private:
+	std::vector<double> getValues(CRTFrameMetric metric) const;
+
+	size_t capacity;
+	std::vector<CRTFrameSample> frames; // Ring, full once it reaches the capacity
+	size_t nextFrame = 0;
+	size_t totalHitchCount = 0;
+};
@@ -0,0 +1,168 @@
+#include "CRTImage.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+CRTImage::CRTImage(int width, int height)
+{
+	resize(width, height);
+}
+
+void CRTImage::resize(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	pixels.assign(static_cast<size_t>(width) * height, CRTVector());
+}
+
+int CRTImage::getWidth() const
+{
+	return width;
+}
+
+int CRTImage::getHeight() const
+{
+	return height;
+}
+
+const CRTVector& CRTImage::getPixel(int x, int y) const
+{
+	return pixels[static_cast<size_t>(y) * width + x];
+}
+
+void CRTImage::setPixel(int x, int y, const CRTVector& color)
+{
+	pixels[static_cast<size_t>(y) * width + x] = color;
+}
+
+const std::vector<CRTVector>& CRTImage::getPixels() const
+{
+	return pixels;
+}
+
+bool CRTImage::writePPM(const std::string& fileName) const
+{
+	std::ofstream ofs(fileName, std::ios::binary);
+	if (!ofs.is_open())
+		return false;
+
+	ofs << "P6\n" << width << ' ' << height << "\n255\n";
+
+	const std::vector<unsigned char> bytes = toBytes();
+	ofs.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+	return ofs.good();
+}
+
+bool CRTImage::writePFM(const std::string& fileName) const
+{
+	std::ofstream ofs(fileName, std::ios::binary);
+	if (!ofs.is_open())
+		return false;
+
+	// The negative scale marks little-endian data, the byte order of every target platform
+	ofs << "PF\n" << width << ' ' << height << "\n-1.0\n";
+
+	// PFM stores the rows bottom to top
+	std::vector<float> row(static_cast<size_t>(width) * 3);
+	for (int y = height - 1; y >= 0; y--)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const CRTVector& pixel = getPixel(x, y);
+			row[3 * x] = pixel.getX();
+			row[3 * x + 1] = pixel.getY();
+			row[3 * x + 2] = pixel.getZ();
+		}
+
+		ofs.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+	}
+
+	return ofs.good();
+}
+
+bool CRTImage::readPPM(const std::string& fileName)
+{
+	std::ifstream ifs(fileName, std::ios::binary);
+	if (!ifs.is_open())
+		return false;
+
+	std::string magic;
+	int fileWidth = 0, fileHeight = 0, maxValue = 0;
+	ifs >> magic >> fileWidth >> fileHeight >> maxValue;
+
+	if (magic != "P6" || fileWidth <= 0 || fileHeight <= 0 || maxValue != 255)
+		return false;
+
+	ifs.get(); // The single whitespace before the data
+
+	std::vector<unsigned char> bytes(static_cast<size_t>(fileWidth) * fileHeight * 3);
+	ifs.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+	if (!ifs)
+		return false;
+
+	resize(fileWidth, fileHeight);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = CRTVector(bytes[3 * i] / 255.f, bytes[3 * i + 1] / 255.f, bytes[3 * i + 2] / 255.f);
+
+	return true;
+}
+
+uint64_t CRTImage::getHash() const
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	auto mix = [&hash](uint64_t value)
+		{
+			hash ^= value;
+			hash *= 1099511628211ull;
+		};
+
+	mix(static_cast<uint64_t>(width));
+	mix(static_cast<uint64_t>(height));
+
+	for (unsigned char byte : toBytes())
+		mix(byte);
+
+	return hash;
+}
+
+double CRTImage::getPSNR(const CRTImage& image, const CRTImage& reference)
+{
+	if (image.width != reference.width || image.height != reference.height || image.pixels.empty())
+		return 0.0;
+
+	const std::vector<unsigned char> lhs = image.toBytes();
+	const std::vector<unsigned char> rhs = reference.toBytes();
+
+	double squaredError = 0.0;
+	for (size_t i = 0; i < lhs.size(); i++)
+	{
+		const double difference = static_cast<double>(lhs[i]) - rhs[i];
+		squaredError += difference * difference;
+	}
+
+	if (squaredError == 0.0)
+		return std::numeric_limits<double>::infinity();
+
+	const double meanSquaredError = squaredError / lhs.size();
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+std::vector<unsigned char> CRTImage::toBytes() const
+{
+	std::vector<unsigned char> bytes;
+	bytes.reserve(pixels.size() * 3);
+
+	for (const CRTVector& pixel : pixels)
+	{
+		for (int channel = 0; channel < 3; channel++)
+		{
+			float value = std::clamp(pixel.getByIndex(channel), 0.f, 1.f);
+			bytes.push_back(static_cast<unsigned char>(value * 255.f + 0.5f));
+		}
+	}
+
+	return bytes;
+}
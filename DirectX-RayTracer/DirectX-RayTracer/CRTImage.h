@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CRTVector.h"
+
+// Linear RGB image produced by the CPU renderer
+class CRTImage
+{
+public:
+	CRTImage() = default;
+	CRTImage(int width, int height);
+
+	void resize(int width, int height);
+
+	int getWidth() const;
+	int getHeight() const;
+
+	const CRTVector& getPixel(int x, int y) const;
+	void setPixel(int x, int y, const CRTVector& color);
+
+	const std::vector<CRTVector>& getPixels() const;
+
+	// Binary PPM (P6), colors are clamped to [0, 1]
+	bool writePPM(const std::string& fileName) const;
+
+	// Little-endian PFM with the linear float colors, not clamped
+	bool writePFM(const std::string& fileName) const;
+
+	// Reads a binary PPM with 8-bit channels, like the ones writePPM writes
+	bool readPPM(const std::string& fileName);
+
+	// FNV-1a of the 8-bit values writePPM stores. Tiny float differences which
+	// round the same way do not change it.
+	uint64_t getHash() const;
+
+	// Peak signal-to-noise ratio in dB over the 8-bit values. Infinity for
+	// identical images, 0 when the sizes differ.
+	static double getPSNR(const CRTImage& image, const CRTImage& reference);
+
+private:
+	// Clamped and quantized like the PPM output, three bytes per pixel
+	std::vector<unsigned char> toBytes() const;
+
+	int width = 0;
+	int height = 0;
+	std::vector<CRTVector> pixels;
+};
@@ -0,0 +1,193 @@
+#include "CRTInstances.h"
+#include <cassert>
+#include <cmath>
+
+CRTVector CRTTransform::transformPoint(const CRTVector& point) const
+{
+	return point * rotation + translation;
+}
+
+CRTVector CRTTransform::transformDirection(const CRTVector& direction) const
+{
+	return direction * rotation;
+}
+
+CRTVector CRTTransform::inverseTransformPoint(const CRTVector& point) const
+{
+	return inverseTransformDirection(point - translation);
+}
+
+CRTVector CRTTransform::inverseTransformDirection(const CRTVector& direction) const
+{
+	float result[3];
+
+	for (int i = 0; i < 3; i++)
+	{
+		result[i] = direction.getX() * rotation.get(i, 0) + direction.getY() * rotation.get(i, 1) + direction.getZ() * rotation.get(i, 2);
+	}
+
+	return CRTVector(result[0], result[1], result[2]);
+}
+
+CRTBoundingBox CRTTransform::transformBounds(const CRTBoundingBox& bounds) const
+{
+	if (bounds.isEmpty())
+		return bounds;
+
+	CRTBoundingBox result;
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		const CRTVector point(
+			(corner & 1) ? bounds.getMax().getX() : bounds.getMin().getX(),
+			(corner & 2) ? bounds.getMax().getY() : bounds.getMin().getY(),
+			(corner & 4) ? bounds.getMax().getZ() : bounds.getMin().getZ());
+
+		result.expand(transformPoint(point));
+	}
+
+	return result;
+}
+
+bool CRTTransform::isIdentity() const
+{
+	for (int row = 0; row < 3; row++)
+	{
+		for (int col = 0; col < 3; col++)
+		{
+			if (rotation.get(row, col) != (row == col ? 1.f : 0.f))
+				return false;
+		}
+	}
+
+	return translation.getX() == 0.f && translation.getY() == 0.f && translation.getZ() == 0.f;
+}
+
+bool CRTTransform::orthonormalize(float tolerance)
+{
+	CRTVector rows[3];
+	for (int row = 0; row < 3; row++)
+		rows[row] = CRTVector(rotation.get(row, 0), rotation.get(row, 1), rotation.get(row, 2));
+
+	for (int row = 0; row < 3; row++)
+	{
+		if (!(std::fabs(rows[row].length() - 1.f) <= tolerance))
+			return false;
+
+		if (!(std::fabs(dot(rows[row], rows[(row + 1) % 3])) <= tolerance))
+			return false;
+	}
+
+	// Gram-Schmidt keeps the handedness of the matrix
+	rows[0].normalise();
+	rows[1] = rows[1] - rows[0] * dot(rows[1], rows[0]);
+	rows[1].normalise();
+	rows[2] = rows[2] - rows[0] * dot(rows[2], rows[0]) - rows[1] * dot(rows[2], rows[1]);
+	rows[2].normalise();
+
+	rotation = CRTMatrix(
+		rows[0].getX(), rows[0].getY(), rows[0].getZ(),
+		rows[1].getX(), rows[1].getY(), rows[1].getZ(),
+		rows[2].getX(), rows[2].getY(), rows[2].getZ());
+
+	return true;
+}
+
+void CRTInstanceSet::reset(int meshCount)
+{
+	instances.clear();
+	handleToIndex.clear();
+	indexToHandle.clear();
+
+	// Even with no mesh to add, clearing the instances needs a rebuild and not a refit
+	topologyVersion++;
+
+	for (int i = 0; i < meshCount; i++)
+	{
+		addInstance(i);
+	}
+}
+
+int CRTInstanceSet::addInstance(int meshIndex, const CRTTransform& transform)
+{
+	const int handle = static_cast<int>(handleToIndex.size());
+
+	handleToIndex.push_back(static_cast<int>(instances.size()));
+	indexToHandle.push_back(handle);
+	instances.push_back({ meshIndex, transform });
+
+	topologyVersion++;
+	return handle;
+}
+
+void CRTInstanceSet::removeInstance(int handle)
+{
+	const int index = getInstanceIndex(handle);
+	assert(index >= 0);
+
+	// Keep the order of the remaining instances
+	instances.erase(instances.begin() + index);
+	indexToHandle.erase(indexToHandle.begin() + index);
+	handleToIndex[handle] = -1;
+
+	for (size_t i = index; i < indexToHandle.size(); i++)
+	{
+		handleToIndex[indexToHandle[i]] = static_cast<int>(i);
+	}
+
+	topologyVersion++;
+}
+
+void CRTInstanceSet::setTransform(int handle, const CRTTransform& transform)
+{
+	const int index = getInstanceIndex(handle);
+	assert(index >= 0);
+
+	instances[index].transform = transform;
+	transformVersion++;
+}
+
+const CRTTransform& CRTInstanceSet::getTransform(int handle) const
+{
+	const int index = getInstanceIndex(handle);
+	assert(index >= 0);
+
+	return instances[index].transform;
+}
+
+const std::vector<CRTInstance>& CRTInstanceSet::getInstances() const
+{
+	return instances;
+}
+
+int CRTInstanceSet::getInstanceIndex(int handle) const
+{
+	assert(handle >= 0 && handle < static_cast<int>(handleToIndex.size()));
+	return handleToIndex[handle];
+}
+
+uint64_t CRTInstanceSet::getTopologyVersion() const
+{
+	return topologyVersion;
+}
+
+uint64_t CRTInstanceSet::getTransformVersion() const
+{
+	return transformVersion;
+}
+
+CRTTopLevelUpdate CRTInstanceTracker::update(const CRTInstanceSet& instances)
+{
+	CRTTopLevelUpdate result = CRTTopLevelUpdate::NONE;
+
+	if (!isBuilt || instances.getTopologyVersion() != topologyVersion)
+		result = CRTTopLevelUpdate::REBUILD;
+	else if (instances.getTransformVersion() != transformVersion)
+		result = CRTTopLevelUpdate::REFIT;
+
+	isBuilt = true;
+	topologyVersion = instances.getTopologyVersion();
+	transformVersion = instances.getTransformVersion();
+
+	return result;
+}
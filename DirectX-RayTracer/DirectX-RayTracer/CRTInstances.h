@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CRTMatrix.h"
+#include "CRTBoundingBox.h"
+
+// Rigid placement of a mesh, with row vectors like the rest of the math:
+// world = object * rotation + translation
+struct CRTTransform
+{
+	CRTMatrix rotation;
+	CRTVector translation;
+
+	CRTVector transformPoint(const CRTVector& point) const;
+	CRTVector transformDirection(const CRTVector& direction) const;
+
+	// The rotation is orthonormal, so its inverse is the transpose
+	CRTVector inverseTransformPoint(const CRTVector& point) const;
+	CRTVector inverseTransformDirection(const CRTVector& direction) const;
+
+	// World space box around the transformed corners of the object space box
+	CRTBoundingBox transformBounds(const CRTBoundingBox& bounds) const;
+
+	bool isIdentity() const;
+
+	// Removes the rounding of a rotation read from a file. Returns false, and
+	// leaves the rotation alone, when its rows are not unit length and
+	// perpendicular within the tolerance: a scale, a shear or a degenerate matrix.
+	bool orthonormalize(float tolerance);
+};
+
+struct CRTInstance
+{
+	int meshIndex = 0;
+	CRTTransform transform;
+};
+
+enum class CRTTopLevelUpdate
+{
+	NONE,
+	REFIT,
+	REBUILD
+};
+
+// Instances of the scene meshes, shared by the GPU TLAS and the CPU top-level
+// BVH. Moving instances only bumps the transform version and lets both refit
+// their top level, adding or removing one bumps the topology version and
+// makes them rebuild it.
+class CRTInstanceSet
+{
+public:
+	// One instance with the identity transform per mesh, in mesh order
+	void reset(int meshCount);
+
+	// Returns a handle which stays valid until the instance is removed
+	int addInstance(int meshIndex, const CRTTransform& transform = CRTTransform());
+
+	void removeInstance(int handle);
+
+	void setTransform(int handle, const CRTTransform& transform);
+	const CRTTransform& getTransform(int handle) const;
+
+	// Instances in the order of the acceleration structures
+	const std::vector<CRTInstance>& getInstances() const;
+
+	// Position of the instance in getInstances()
+	int getInstanceIndex(int handle) const;
+
+	uint64_t getTopologyVersion() const;
+	uint64_t getTransformVersion() const;
+
+private:
+	std::vector<CRTInstance> instances;
+	std::vector<int> handleToIndex; // -1 for removed instances
+	std::vector<int> indexToHandle;
+
+	uint64_t topologyVersion = 0;
+	uint64_t transformVersion = 0;
+};
+
+// Versions of a CRTInstanceSet one top-level structure was last built from
+class CRTInstanceTracker
+{
+public:
+	// Returns how the top level has to change and marks the current versions as seen
+	CRTTopLevelUpdate update(const CRTInstanceSet& instances);
+
+private:
+	bool isBuilt = false;
+	uint64_t topologyVersion = 0;
+	uint64_t transformVersion = 0;
+};
@@ -0,0 +1,151 @@
+#include "CRTLoadProfile.h"
+#include <cstdio>
+
+CRTLoadProfile::AllocationCounter CRTLoadProfile::allocationCounter = nullptr;
+
+void CRTLoadProfile::setAllocationCounter(AllocationCounter counter)
+{
+	allocationCounter = counter;
+}
+
+bool CRTLoadProfile::hasAllocationCounter()
+{
+	return allocationCounter != nullptr;
+}
+
+uint64_t CRTLoadProfile::getAllocatedBytes()
+{
+	return allocationCounter ? allocationCounter() : 0;
+}
+
+const char* CRTLoadProfile::getPhaseName(CRTLoadPhase phase)
+{
+	switch (phase)
+	{
+	case CRTLoadPhase::FILE_READ:
+		return "file read";
+	case CRTLoadPhase::JSON_PARSE:
+		return "json parse";
+	case CRTLoadPhase::SETTINGS:
+		return "settings";
+	case CRTLoadPhase::MESH_CONVERT:
+		return "mesh convert";
+	case CRTLoadPhase::VERTEX_NORMALS:
+		return "vertex normals";
+	case CRTLoadPhase::MESH_STORE:
+		return "mesh store";
+	case CRTLoadPhase::LIGHTS:
+		return "lights";
+	case CRTLoadPhase::MATERIALS:
+		return "materials";
+	case CRTLoadPhase::TEXTURES:
+		return "textures";
+	case CRTLoadPhase::LOGGING:
+		return "logging";
+	default:
+		return "unknown";
+	}
+}
+
+void CRTLoadProfile::add(CRTLoadPhase phase, double wallSeconds, double cpuSeconds, uint64_t allocatedBytes)
+{
+	CRTLoadPhaseStats& stats = phases[static_cast<int>(phase)];
+
+	stats.wallSeconds += wallSeconds;
+	stats.cpuSeconds += cpuSeconds;
+	stats.allocatedBytes += allocatedBytes;
+	stats.calls++;
+}
+
+void CRTLoadProfile::addAllocatedBytes(CRTLoadPhase phase, uint64_t allocatedBytes)
+{
+	phases[static_cast<int>(phase)].allocatedBytes += allocatedBytes;
+}
+
+const CRTLoadPhaseStats& CRTLoadProfile::getPhase(CRTLoadPhase phase) const
+{
+	return phases[static_cast<int>(phase)];
+}
+
+CRTLoadPhaseStats CRTLoadProfile::getTotal() const
+{
+	CRTLoadPhaseStats total;
+
+	for (const CRTLoadPhaseStats& stats : phases)
+	{
+		total.wallSeconds += stats.wallSeconds;
+		total.cpuSeconds += stats.cpuSeconds;
+		total.allocatedBytes += stats.allocatedBytes;
+		total.calls += stats.calls;
+	}
+
+	return total;
+}
+
+void CRTLoadProfile::setFileBytes(uint64_t bytes)
+{
+	fileBytes = bytes;
+}
+
+uint64_t CRTLoadProfile::getFileBytes() const
+{
+	return fileBytes;
+}
+
+void CRTLoadProfile::print(std::ostream& os) const
+{
+	const CRTLoadPhaseStats total = getTotal();
+	char line[128];
+
+	snprintf(line, sizeof(line), "%-16s %10s %10s %12s %7s\n", "phase", "wall ms", "cpu ms", "alloc MB", "wall %");
+	os << line;
+
+	for (int i = 0; i < static_cast<int>(CRTLoadPhase::COUNT); i++)
+	{
+		const CRTLoadPhaseStats& stats = phases[i];
+
+		snprintf(line, sizeof(line), "%-16s %10.2f %10.2f %12.2f %7.1f\n", getPhaseName(static_cast<CRTLoadPhase>(i)),
+			stats.wallSeconds * 1e3, stats.cpuSeconds * 1e3, stats.allocatedBytes / 1048576.0,
+			total.wallSeconds > 0.0 ? 100.0 * stats.wallSeconds / total.wallSeconds : 0.0);
+		os << line;
+	}
+
+	snprintf(line, sizeof(line), "%-16s %10.2f %10.2f %12.2f\n", "total",
+		total.wallSeconds * 1e3, total.cpuSeconds * 1e3, total.allocatedBytes / 1048576.0);
+	os << line;
+}
+
+CRTLoadPhaseScope::CRTLoadPhaseScope(CRTLoadProfile* profile, CRTLoadPhase phase)
+	: profile(profile), phase(phase)
+{
+	if (!profile)
+		return;
+
+	parent = profile->currentScope;
+	profile->currentScope = this;
+
+	bytesStart = CRTLoadProfile::getAllocatedBytes();
+	cpuStart = std::clock();
+	wallStart = std::chrono::steady_clock::now();
+}
+
+CRTLoadPhaseScope::~CRTLoadPhaseScope()
+{
+	if (!profile)
+		return;
+
+	const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	const double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+	const uint64_t bytes = CRTLoadProfile::getAllocatedBytes() - bytesStart;
+
+	profile->add(phase, wallSeconds - childWallSeconds, cpuSeconds - childCpuSeconds, bytes - childBytes);
+
+	if (parent)
+	{
+		parent->childWallSeconds += wallSeconds;
+		parent->childCpuSeconds += cpuSeconds;
+		parent->childBytes += bytes;
+	}
+
+	profile->currentScope = parent;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+
+class CRTLoadPhaseScope;
+
+// Phases of CRTSceneParser::parseScene, in the order they run
+enum class CRTLoadPhase
+{
+	FILE_READ,
+	JSON_PARSE,
+	SETTINGS,
+	MESH_CONVERT, // Reading the vertex, uv and index arrays into the mesh
+	VERTEX_NORMALS,
+	MESH_STORE, // Copying the finished mesh into the scene
+	LIGHTS,
+	MATERIALS,
+	TEXTURES, // Including the decoding of bitmaps
+	LOGGING,
+	COUNT
+};
+
+struct CRTLoadPhaseStats
+{
+	double wallSeconds = 0.0;
+	double cpuSeconds = 0.0;
+	uint64_t allocatedBytes = 0; // Requested from operator new, not the net change
+	uint64_t calls = 0;
+};
+
+// Where the time and memory of one scene load went. Phases nest, the
+// time of a nested phase is not counted in the phase around it.
+class CRTLoadProfile
+{
+public:
+	// Returns the bytes allocated by the process so far. Counting needs a replaced
+	// operator new, so only the tools that have one set a counter.
+	using AllocationCounter = uint64_t(*)();
+
+	static void setAllocationCounter(AllocationCounter counter);
+	static bool hasAllocationCounter();
+	static uint64_t getAllocatedBytes();
+
+	static const char* getPhaseName(CRTLoadPhase phase);
+
+	void add(CRTLoadPhase phase, double wallSeconds, double cpuSeconds, uint64_t allocatedBytes);
+
+	// For memory that does not come from operator new, like the rapidjson pools
+	void addAllocatedBytes(CRTLoadPhase phase, uint64_t allocatedBytes);
+
+	const CRTLoadPhaseStats& getPhase(CRTLoadPhase phase) const;
+	CRTLoadPhaseStats getTotal() const;
+
+	void setFileBytes(uint64_t bytes);
+	uint64_t getFileBytes() const;
+
+	void print(std::ostream& os) const;
+
+private:
+	friend class CRTLoadPhaseScope;
+
+	static AllocationCounter allocationCounter;
+
+	CRTLoadPhaseStats phases[static_cast<int>(CRTLoadPhase::COUNT)];
+	uint64_t fileBytes = 0;
+	CRTLoadPhaseScope* currentScope = nullptr;
+};
+
+// Times its lifetime into a phase of the profile, does nothing without a profile
+class CRTLoadPhaseScope
+{
+public:
+	CRTLoadPhaseScope(CRTLoadProfile* profile, CRTLoadPhase phase);
+	~CRTLoadPhaseScope();
+
+	CRTLoadPhaseScope(const CRTLoadPhaseScope&) = delete;
+	CRTLoadPhaseScope& operator=(const CRTLoadPhaseScope&) = delete;
+
+private:
+	CRTLoadProfile* profile;
+	CRTLoadPhase phase;
+	CRTLoadPhaseScope* parent = nullptr;
+
+	std::chrono::steady_clock::time_point wallStart;
+	std::clock_t cpuStart = 0; // Process CPU time, the parser runs on one thread
+	uint64_t bytesStart = 0;
+
+	// Inclusive cost of the nested scopes, taken out of this one
+	double childWallSeconds = 0.0;
+	double childCpuSeconds = 0.0;
+	uint64_t childBytes = 0;
+};
@@ -0,0 +1,169 @@
+#include "CRTMemory.h"
+#include <atomic>
+#include <cassert>
+#include <iomanip>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+	constexpr int categoryCount = static_cast<int>(CRTMemoryCategory::COUNT);
+
+	std::atomic<uint64_t> currentBytes[categoryCount];
+	std::atomic<uint64_t> peakBytes[categoryCount];
+
+	// Index 0 for the CPU, 1 for the GPU
+	std::atomic<uint64_t> currentTotals[2];
+	std::atomic<uint64_t> peakTotals[2];
+
+	struct ResourceRegistry
+	{
+		std::mutex mutex;
+		std::unordered_map<const void*, std::pair<CRTMemoryCategory, uint64_t>> resources;
+	};
+
+	ResourceRegistry& getResourceRegistry()
+	{
+		// Never destroyed, static containers may give their memory back after it would be
+		static ResourceRegistry* registry = new ResourceRegistry();
+		return *registry;
+	}
+
+	void raisePeak(std::atomic<uint64_t>& peak, uint64_t value)
+	{
+		uint64_t previous = peak.load(std::memory_order_relaxed);
+		while (previous < value && !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void printBytes(std::ostream& stream, uint64_t bytes)
+	{
+		stream << std::setw(10) << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0) << " MB";
+	}
+}
+
+void CRTMemory::allocate(CRTMemoryCategory category, uint64_t bytes)
+{
+	const int index = static_cast<int>(category);
+	const int side = isGPU(category) ? 1 : 0;
+
+	raisePeak(peakBytes[index], currentBytes[index].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+	raisePeak(peakTotals[side], currentTotals[side].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void CRTMemory::free(CRTMemoryCategory category, uint64_t bytes)
+{
+	const int index = static_cast<int>(category);
+	const int side = isGPU(category) ? 1 : 0;
+
+	currentBytes[index].fetch_sub(bytes, std::memory_order_relaxed);
+	currentTotals[side].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void CRTMemory::setResource(const void* key, CRTMemoryCategory category, uint64_t bytes)
+{
+	ResourceRegistry& registry = getResourceRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	auto found = registry.resources.find(key);
+	if (found != registry.resources.end())
+	{
+		free(found->second.first, found->second.second);
+		registry.resources.erase(found);
+	}
+
+	if (bytes > 0)
+	{
+		allocate(category, bytes);
+		registry.resources[key] = { category, bytes };
+	}
+}
+
+const char* CRTMemory::getCategoryName(CRTMemoryCategory category)
+{
+	switch (category)
+	{
+	case CRTMemoryCategory::MESH_VERTICES: return "Mesh vertices";
+	case CRTMemoryCategory::MESH_INDICES: return "Mesh indices";
+	case CRTMemoryCategory::MESH_NORMALS: return "Mesh normals";
+	case CRTMemoryCategory::MESH_UVS: return "Mesh UVs";
+	case CRTMemoryCategory::TEXTURE_PIXELS: return "Texture pixels";
+	case CRTMemoryCategory::BVH_NODES: return "BVH nodes";
+	case CRTMemoryCategory::BVH_TRIANGLES: return "BVH triangles";
+	case CRTMemoryCategory::GPU_GEOMETRY: return "Geometry buffers";
+	case CRTMemoryCategory::GPU_ACCELERATION_STRUCTURES: return "Acceleration structures";
+	case CRTMemoryCategory::GPU_UPLOAD_BUFFERS: return "Upload buffers";
+	case CRTMemoryCategory::GPU_RESOURCES: return "Committed resources";
+	case CRTMemoryCategory::GPU_DESCRIPTOR_HEAPS: return "Descriptor heaps";
+	default: return "Unknown";
+	}
+}
+
+bool CRTMemory::isGPU(CRTMemoryCategory category)
+{
+	return category >= CRTMemoryCategory::GPU_GEOMETRY;
+}
+
+uint64_t CRTMemory::getCurrent(CRTMemoryCategory category)
+{
+	assert(category < CRTMemoryCategory::COUNT);
+	return currentBytes[static_cast<int>(category)].load(std::memory_order_relaxed);
+}
+
+uint64_t CRTMemory::getPeak(CRTMemoryCategory category)
+{
+	assert(category < CRTMemoryCategory::COUNT);
+	return peakBytes[static_cast<int>(category)].load(std::memory_order_relaxed);
+}
+
+uint64_t CRTMemory::getCurrentTotal(bool gpu)
+{
+	return currentTotals[gpu ? 1 : 0].load(std::memory_order_relaxed);
+}
+
+uint64_t CRTMemory::getPeakTotal(bool gpu)
+{
+	return peakTotals[gpu ? 1 : 0].load(std::memory_order_relaxed);
+}
+
+void CRTMemory::resetPeaks()
+{
+	for (int i = 0; i < categoryCount; i++)
+		peakBytes[i].store(currentBytes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+	for (int side = 0; side < 2; side++)
+		peakTotals[side].store(currentTotals[side].load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void CRTMemory::print(std::ostream& stream)
+{
+	const std::ios_base::fmtflags flags = stream.flags();
+	const std::streamsize precision = stream.precision();
+
+	stream << std::left << std::setw(28) << "Memory" << std::right << std::setw(13) << "current" << std::setw(13) << "peak" << std::endl;
+
+	for (int side = 0; side < 2; side++)
+	{
+		for (int i = 0; i < categoryCount; i++)
+		{
+			const CRTMemoryCategory category = static_cast<CRTMemoryCategory>(i);
+			if (isGPU(category) != (side == 1))
+				continue;
+
+			stream << "  " << std::left << std::setw(26) << getCategoryName(category) << std::right;
+			printBytes(stream, getCurrent(category));
+			printBytes(stream, getPeak(category));
+			stream << std::endl;
+		}
+
+		stream << "  " << std::left << std::setw(26) << (side == 1 ? "GPU total" : "CPU total") << std::right;
+		printBytes(stream, getCurrentTotal(side == 1));
+		printBytes(stream, getPeakTotal(side == 1));
+		stream << std::endl;
+	}
+
+	stream.flags(flags);
+	stream.precision(precision);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// What the memory is used for. The GPU_ ones are D3D12 resources, the sizes
+// the renderer reports for them, the rest is CPU memory.
+enum class CRTMemoryCategory
+{
+	MESH_VERTICES,
+	MESH_INDICES,
+	MESH_NORMALS,
+	MESH_UVS,
+	TEXTURE_PIXELS,
+	BVH_NODES, // Nodes and primitive references of the mesh and scene trees
+	BVH_TRIANGLES, // Triangle copies the CPU tracer intersects
+	GPU_GEOMETRY,
+	GPU_ACCELERATION_STRUCTURES,
+	GPU_UPLOAD_BUFFERS,
+	GPU_RESOURCES, // Committed resources, like the output and AOV targets
+	GPU_DESCRIPTOR_HEAPS,
+	COUNT
+};
+
+// Current and peak bytes per category, for the whole process. Containers
+// count through CRTTaggedAllocator, memory allocated elsewhere is reported
+// with allocate and free or as a resource with setResource.
+class CRTMemory
+{
+public:
+	static void allocate(CRTMemoryCategory category, uint64_t bytes);
+	static void free(CRTMemoryCategory category, uint64_t bytes);
+
+	// Size of something owned elsewhere, like the D3D12 resource in a member.
+	// Setting the key again replaces its previous size, 0 bytes removes it.
+	static void setResource(const void* key, CRTMemoryCategory category, uint64_t bytes);
+
+	static const char* getCategoryName(CRTMemoryCategory category);
+	static bool isGPU(CRTMemoryCategory category);
+
+	static uint64_t getCurrent(CRTMemoryCategory category);
+	static uint64_t getPeak(CRTMemoryCategory category);
+
+	// Over all categories of the CPU or of the GPU. The peak is the highest
+	// sum reached, not the sum of the peaks.
+	static uint64_t getCurrentTotal(bool gpu);
+	static uint64_t getPeakTotal(bool gpu);
+
+	// Start the peaks over from the current values
+	static void resetPeaks();
+
+	static void print(std::ostream& stream);
+};
+
+// std::allocator which counts its memory in a CRTMemory category
+template<class T, CRTMemoryCategory category>
+class CRTTaggedAllocator
+{
+public:
+	using value_type = T;
+
+	template<class U>
+	struct rebind
+	{
+		using other = CRTTaggedAllocator<U, category>;
+	};
+
+	CRTTaggedAllocator() = default;
+
+	template<class U>
+	CRTTaggedAllocator(const CRTTaggedAllocator<U, category>&)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		T* memory = std::allocator<T>().allocate(count);
+		CRTMemory::allocate(category, count * sizeof(T));
+		return memory;
+	}
+
+	void deallocate(T* memory, size_t count)
+	{
+		std::allocator<T>().deallocate(memory, count);
+		CRTMemory::free(category, count * sizeof(T));
+	}
+
+	template<class U>
+	bool operator==(const CRTTaggedAllocator<U, category>&) const
+	{
+		return true;
+	}
+
+	template<class U>
+	bool operator!=(const CRTTaggedAllocator<U, category>&) const
+	{
+		return false;
+	}
+};
+
+template<class T, CRTMemoryCategory category>
+using CRTTaggedVector = std::vector<T, CRTTaggedAllocator<T, category>>;
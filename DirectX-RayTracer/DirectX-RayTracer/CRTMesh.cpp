@@ -38,22 +38,22 @@ void CRTMesh::print() const
 	}
 }
 
-const std::vector<CRTVector>& CRTMesh::getVertices() const
+const CRTMesh::VertexArray& CRTMesh::getVertices() const
 {
 	return vertices;
 }
 
-const std::vector<int>& CRTMesh::getIndices() const
+const CRTMesh::IndexArray& CRTMesh::getIndices() const
 {
 	return indices;
 }
 
-const std::vector<CRTVector>& CRTMesh::getVertexNormals() const
+const CRTMesh::NormalArray& CRTMesh::getVertexNormals() const
 {
 	return vertexNormals;
 }
 
-const std::vector<CRTVector>& CRTMesh::getUV() const
+const CRTMesh::UVArray& CRTMesh::getUV() const
 {
 	return uvData;
 }
@@ -1,11 +1,17 @@
 #pragma once
 #include <vector>
 #include "CRTVector.h"
+#include "CRTMemory.h"
 
 
 class CRTMesh
 {
 public:
+	// The arrays count their memory in the categories of the mesh data
+	using VertexArray = CRTTaggedVector<CRTVector, CRTMemoryCategory::MESH_VERTICES>;
+	using IndexArray = CRTTaggedVector<int, CRTMemoryCategory::MESH_INDICES>;
+	using NormalArray = CRTTaggedVector<CRTVector, CRTMemoryCategory::MESH_NORMALS>;
+	using UVArray = CRTTaggedVector<CRTVector, CRTMemoryCategory::MESH_UVS>;
 
 	void addVertex(const CRTVector& vertex);
 	void addIndex(int index);
@@ -13,20 +19,20 @@ public:
 	void addUV(const CRTVector& uv);
 
 	void print() const;
-	const std::vector<CRTVector>& getVertices() const;
-	const std::vector<int>& getIndices() const;
-	const std::vector<CRTVector>& getVertexNormals() const;
-	const std::vector<CRTVector>& getUV() const;
+	const VertexArray& getVertices() const;
+	const IndexArray& getIndices() const;
+	const NormalArray& getVertexNormals() const;
+	const UVArray& getUV() const;
 	int getMaterialIndex() const;
 
 
 	void calculateVertexNormals();
 
 private:
-	std::vector<CRTVector> vertices;
-	std::vector<int> indices;
-	std::vector<CRTVector> vertexNormals;
-	std::vector<CRTVector> uvData;
+	VertexArray vertices;
+	IndexArray indices;
+	NormalArray vertexNormals;
+	UVArray uvData;
 	int materialIndex;
 };
 
@@ -0,0 +1,27 @@
+#include "CRTRay.h"
+
+CRTRay::CRTRay(const CRTVector& origin, const CRTVector& direction)
+	: origin(origin), direction(direction),
+	inverseDirection(1.f / direction.getX(), 1.f / direction.getY(), 1.f / direction.getZ())
+{
+}
+
+const CRTVector& CRTRay::getOrigin() const
+{
+	return origin;
+}
+
+const CRTVector& CRTRay::getDirection() const
+{
+	return direction;
+}
+
+const CRTVector& CRTRay::getInverseDirection() const
+{
+	return inverseDirection;
+}
+
+CRTVector CRTRay::at(float t) const
+{
+	return origin + direction * t;
+}
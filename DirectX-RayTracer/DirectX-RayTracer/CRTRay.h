@@ -0,0 +1,22 @@
+#pragma once
+#include "CRTVector.h"
+
+class CRTRay
+{
+public:
+	CRTRay() = default;
+	CRTRay(const CRTVector& origin, const CRTVector& direction);
+
+	const CRTVector& getOrigin() const;
+	const CRTVector& getDirection() const;
+
+	// 1 / direction, cached for the ray-box slab test
+	const CRTVector& getInverseDirection() const;
+
+	CRTVector at(float t) const;
+
+private:
+	CRTVector origin;
+	CRTVector direction;
+	CRTVector inverseDirection;
+};
@@ -0,0 +1,93 @@
+#include "CRTRenderResolution.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static int scaledSize(int size, float scale)
+{
+	return std::max(1, static_cast<int>(std::lround(size * scale)));
+}
+
+CRTRenderResolution::CRTRenderResolution(int width, int height) : outputWidth(width), outputHeight(height)
+{
+	assert(width > 0 && height > 0);
+}
+
+bool CRTRenderResolution::setOutputSize(int width, int height)
+{
+	// Minimized windows report an empty size, keep the last one
+	if (width <= 0 || height <= 0)
+		return false;
+
+	if (width == outputWidth && height == outputHeight)
+		return false;
+
+	outputWidth = width;
+	outputHeight = height;
+	return true;
+}
+
+void CRTRenderResolution::setScale(float scale)
+{
+	assert(scale > 0.f && scale <= 1.f);
+	this->scale = scale;
+}
+
+float CRTRenderResolution::getScale() const
+{
+	return scale;
+}
+
+int CRTRenderResolution::getOutputWidth() const
+{
+	return outputWidth;
+}
+
+int CRTRenderResolution::getOutputHeight() const
+{
+	return outputHeight;
+}
+
+int CRTRenderResolution::getRenderWidth() const
+{
+	return scaledSize(outputWidth, scale);
+}
+
+int CRTRenderResolution::getRenderHeight() const
+{
+	return scaledSize(outputHeight, scale);
+}
+
+void CRTDynamicResolution::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+}
+
+bool CRTDynamicResolution::isEnabled() const
+{
+	return enabled;
+}
+
+void CRTDynamicResolution::setMovingScale(float scale)
+{
+	assert(scale > 0.f && scale <= 1.f);
+	movingScale = scale;
+}
+
+float CRTDynamicResolution::getMovingScale() const
+{
+	return movingScale;
+}
+
+float CRTDynamicResolution::update(bool cameraMoving)
+{
+	if (cameraMoving)
+		stillFrames = 0;
+	else if (stillFrames < stillFramesForFullScale)
+		stillFrames++;
+
+	if (!enabled || stillFrames >= stillFramesForFullScale)
+		return 1.f;
+
+	return movingScale;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// Size of the renderer output and the size the rays are traced at. The traced
+// image covers the top-left part of the output and is stretched when presented.
+class CRTRenderResolution
+{
+public:
+	CRTRenderResolution(int width = 1920, int height = 1080);
+
+	// Returns true when the size changed and the size-dependent resources have to be recreated
+	bool setOutputSize(int width, int height);
+
+	// Fraction of the output width and height which is traced, in (0, 1]
+	void setScale(float scale);
+	float getScale() const;
+
+	int getOutputWidth() const;
+	int getOutputHeight() const;
+
+	int getRenderWidth() const;
+	int getRenderHeight() const;
+
+private:
+	int outputWidth;
+	int outputHeight;
+	float scale = 1.f;
+};
+
+// Traces at a reduced scale while the camera moves and at full scale once it
+// has been still for a few frames, so moving stays responsive.
+class CRTDynamicResolution
+{
+public:
+	static constexpr float defaultMovingScale = 0.5f;
+	static constexpr int stillFramesForFullScale = 3;
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+
+	void setMovingScale(float scale);
+	float getMovingScale() const;
+
+	// Returns the scale of the frame
+	float update(bool cameraMoving);
+
+private:
+	bool enabled = false;
+	float movingScale = defaultMovingScale;
+	int stillFrames = stillFramesForFullScale;
+};
@@ -0,0 +1,689 @@
+#define _USE_MATH_DEFINES
+
+#include "CRTRenderer.h"
+#include "CRTTrace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <thread>
+
+// Offset of secondary ray origins along the normal, avoids self-intersection
+static const float rayBias = 1e-3f;
+
+// Relative error of pixels darker than this is measured against it instead
+static const float minLuminance = 0.05f;
+
+// Origin cells per axis of the coherence key
+static const int mortonBits = 10;
+
+static float luminance(const CRTVector& color)
+{
+	return 0.2126f * color.getX() + 0.7152f * color.getY() + 0.0722f * color.getZ();
+}
+
+// Spreads the low 10 bits of x so there are two zero bits between each of them
+static uint32_t expandBits(uint32_t x)
+{
+	x = (x * 0x00010001u) & 0xFF0000FFu;
+	x = (x * 0x00000101u) & 0x0F00F00Fu;
+	x = (x * 0x00000011u) & 0xC30C30C3u;
+	x = (x * 0x00000005u) & 0x49249249u;
+	return x;
+}
+
+CRTRenderer::CRTRenderer(const CRTScene& scene)
+	: scene(scene),
+	ownedAccelerationStructure(std::make_unique<CRTAccelerationStructure>(scene)),
+	accelerationStructure(*ownedAccelerationStructure)
+{
+	resolveMaterialTextures();
+}
+
+CRTRenderer::CRTRenderer(const CRTScene& scene, const CRTAccelerationStructure& sharedAccelerationStructure)
+	: scene(scene), accelerationStructure(sharedAccelerationStructure)
+{
+	resolveMaterialTextures();
+}
+
+void CRTRenderer::resolveMaterialTextures()
+{
+	for (const CRTMaterial& material : scene.getMaterials())
+	{
+		materialTextures.push_back(material.isTexture() ? scene.getTextureByName(material.getTextureName()) : nullptr);
+	}
+}
+
+void CRTRenderer::render(const CRTRenderSettings& renderSettings)
+{
+	render(renderSettings, scene.getCamera());
+}
+
+void CRTRenderer::render(const CRTRenderSettings& renderSettings, const CRTCamera& renderCamera)
+{
+	CRT_TRACE_ZONE("CPU render");
+
+	settings = renderSettings;
+	camera = renderCamera;
+	settings.minSamples = std::max(settings.minSamples, 1);
+	settings.maxSamples = std::max(settings.maxSamples, settings.minSamples);
+	settings.samplesPerPass = std::max(settings.samplesPerPass, 1);
+	sampler = CRTSampler(settings.samplerType, settings.seed);
+
+	// Picks up instances moved, added or removed since the last render
+	if (ownedAccelerationStructure)
+		ownedAccelerationStructure->update(scene.getInstances());
+
+	image.resize(scene.getSettings().imageWidth, scene.getSettings().imageHeight);
+	aovs.resize(image.getWidth(), image.getHeight(), settings.aovMask);
+	estimates.assign(static_cast<size_t>(image.getWidth()) * image.getHeight(), PixelEstimate());
+	stats = CRTRenderStats();
+	createTiles();
+
+	renderStart = std::chrono::steady_clock::now();
+	deadline = renderStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<float>(settings.timeBudgetSeconds));
+
+	// The first pass always completes so every pixel has at least minSamples
+	renderPass(0, false);
+
+	for (int passIndex = 1;; passIndex++)
+	{
+		if (isOverBudget())
+			break;
+
+		bool allConverged = std::all_of(estimates.begin(), estimates.end(),
+			[](const PixelEstimate& estimate) { return estimate.converged; });
+
+		if (allConverged)
+			break;
+
+		renderPass(passIndex, true);
+	}
+
+	resolveImage();
+
+	stats.renderSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - renderStart).count();
+	stats.raysPerSecond = stats.renderSeconds > 0.f ? stats.raysTraced / stats.renderSeconds : 0.f;
+}
+
+const CRTImage& CRTRenderer::getImage() const
+{
+	return image;
+}
+
+const CRTAOVBuffers& CRTRenderer::getAOVs() const
+{
+	return aovs;
+}
+
+const CRTRenderStats& CRTRenderer::getStats() const
+{
+	return stats;
+}
+
+CRTImage CRTRenderer::getSampleHeatmap() const
+{
+	CRTImage heatmap(image.getWidth(), image.getHeight());
+
+	const CRTVector blue(0.f, 0.f, 1.f);
+	const CRTVector green(0.f, 1.f, 0.f);
+	const CRTVector red(1.f, 0.f, 0.f);
+	const float range = static_cast<float>(std::max(settings.maxSamples - settings.minSamples, 1));
+
+	for (int y = 0; y < image.getHeight(); y++)
+	{
+		for (int x = 0; x < image.getWidth(); x++)
+		{
+			const PixelEstimate& estimate = estimates[static_cast<size_t>(y) * image.getWidth() + x];
+			float t = std::clamp((estimate.sampleCount - settings.minSamples) / range, 0.f, 1.f);
+
+			CRTVector color = t < 0.5f
+				? blue * (1.f - 2.f * t) + green * (2.f * t)
+				: green * (2.f - 2.f * t) + red * (2.f * t - 1.f);
+
+			heatmap.setPixel(x, y, color);
+		}
+	}
+
+	return heatmap;
+}
+
+void CRTRenderer::createTiles()
+{
+	tiles.clear();
+
+	const int tileSize = std::max(settings.tileSize, 1);
+
+	for (int y = 0; y < image.getHeight(); y += tileSize)
+	{
+		for (int x = 0; x < image.getWidth(); x += tileSize)
+		{
+			tiles.push_back({ x, y, std::min(tileSize, image.getWidth() - x), std::min(tileSize, image.getHeight() - y) });
+		}
+	}
+}
+
+bool CRTRenderer::isOverBudget() const
+{
+	return settings.timeBudgetSeconds > 0.f && std::chrono::steady_clock::now() >= deadline;
+}
+
+void CRTRenderer::renderPass(int passIndex, bool canStop)
+{
+	CRT_TRACE_ZONE("Render pass");
+
+	std::atomic<int> nextTile{ 0 };
+	std::atomic<long long> passSamples{ 0 };
+	std::atomic<long long> passPrimaryRays{ 0 };
+	std::atomic<long long> passSecondaryRays{ 0 };
+	std::atomic<long long> passShadowRays{ 0 };
+	std::atomic<long long> passNodesVisited{ 0 };
+	std::atomic<long long> passNodeCacheHits{ 0 };
+	std::atomic<long long> passTrianglesTested{ 0 };
+
+	int threadCount = settings.threadCount > 0 ? settings.threadCount : static_cast<int>(std::thread::hardware_concurrency());
+	threadCount = std::clamp(threadCount, 1, std::max(static_cast<int>(tiles.size()), 1));
+
+	if (stats.threadBusySeconds.size() < static_cast<size_t>(threadCount))
+		stats.threadBusySeconds.resize(threadCount, 0.f);
+
+	// Each worker writes only its own slot
+	std::vector<float> busySeconds(threadCount, 0.f);
+
+	auto worker = [&](int threadIndex)
+		{
+			// Worker 0 is the calling thread, it keeps its own lane
+			if (threadIndex > 0)
+				CRT_TRACE_THREAD_NAME("CPU worker " + std::to_string(threadIndex));
+
+			TileContext context;
+			long long samples = 0;
+			const auto start = std::chrono::steady_clock::now();
+
+			while (!(canStop && isOverBudget()))
+			{
+				const int tileIndex = nextTile++;
+				if (tileIndex >= static_cast<int>(tiles.size()))
+					break;
+
+				samples += renderTile(tiles[tileIndex], passIndex, context);
+			}
+
+			busySeconds[threadIndex] = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+			passSamples += samples;
+			passPrimaryRays += context.primaryRays;
+			passSecondaryRays += context.secondaryRays;
+			passShadowRays += context.shadowRaysTraced;
+			passNodesVisited += context.traversalStats.nodesVisited;
+			passNodeCacheHits += context.traversalStats.nodeCacheHits;
+			passTrianglesTested += context.traversalStats.trianglesTested;
+		};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+	{
+		threads.emplace_back(worker, i);
+	}
+
+	worker(0);
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	stats.totalSamples += passSamples;
+	stats.primaryRays += passPrimaryRays;
+	stats.secondaryRays += passSecondaryRays;
+	stats.shadowRays += passShadowRays;
+	stats.raysTraced += passPrimaryRays + passSecondaryRays + passShadowRays;
+	stats.nodesVisited += passNodesVisited;
+	stats.nodeCacheHits += passNodeCacheHits;
+	stats.trianglesTested += passTrianglesTested;
+	stats.passes++;
+
+	for (int i = 0; i < threadCount; i++)
+		stats.threadBusySeconds[i] += busySeconds[i];
+}
+
+int CRTRenderer::renderTile(const Tile& tile, int passIndex, TileContext& context)
+{
+	CRT_TRACE_ZONE("Tile");
+
+	const int samplesThisPass = passIndex == 0 ? settings.minSamples : settings.samplesPerPass;
+
+	context.rays.clear();
+	context.samplePixels.clear();
+
+	for (int y = tile.y; y < tile.y + tile.height; y++)
+	{
+		for (int x = tile.x; x < tile.x + tile.width; x++)
+		{
+			const int pixelIndex = y * image.getWidth() + x;
+			const PixelEstimate& estimate = estimates[pixelIndex];
+
+			if (estimate.converged)
+				continue;
+
+			const int sampleCount = std::min(samplesThisPass, settings.maxSamples - estimate.sampleCount);
+
+			for (int i = 0; i < sampleCount; i++)
+			{
+				float jitterX, jitterY;
+				sampler.get2D(x, y, estimate.sampleCount + i, CRTSampleDimension::cameraJitter, jitterX, jitterY);
+
+				RayQuery query;
+				query.ray = generateCameraRay(x + jitterX, y + jitterY);
+				query.throughput = CRTVector(1.f, 1.f, 1.f);
+				query.sampleIndex = static_cast<int>(context.samplePixels.size());
+				query.depth = 0;
+
+				context.rays.push_back(query);
+				context.samplePixels.push_back(pixelIndex);
+			}
+		}
+	}
+
+	const int traced = static_cast<int>(context.samplePixels.size());
+
+	context.sampleRadiance.assign(traced, CRTVector());
+	context.sampleAOVs.assign(traced, SampleAOV());
+	traceBatch(context);
+
+	// Samples of a pixel are contiguous, fold them and re-evaluate the pixel once
+	for (int i = 0; i < traced; i++)
+	{
+		PixelEstimate& estimate = estimates[context.samplePixels[i]];
+		const CRTVector& radiance = context.sampleRadiance[i];
+		const float sampleLuminance = luminance(radiance);
+
+		estimate.sum += radiance;
+		estimate.luminanceSum += sampleLuminance;
+		estimate.luminanceSquaredSum += sampleLuminance * sampleLuminance;
+		estimate.sampleCount++;
+
+		const SampleAOV& sampleAOV = context.sampleAOVs[i];
+		estimate.albedoSum += sampleAOV.albedo;
+		estimate.normalSum += sampleAOV.normal;
+		estimate.depthSum += sampleAOV.depth;
+
+		if (estimate.sampleCount == 1)
+		{
+			estimate.firstBarycentrics = sampleAOV.barycentrics;
+			estimate.firstPrimitiveID = sampleAOV.primitiveID;
+			estimate.firstInstanceID = sampleAOV.instanceID;
+		}
+
+		if (i + 1 == traced || context.samplePixels[i + 1] != context.samplePixels[i])
+		{
+			updateConvergence(estimate);
+		}
+	}
+
+	return traced;
+}
+
+CRTRay CRTRenderer::generateCameraRay(float rasterX, float rasterY) const
+{
+	const float width = static_cast<float>(image.getWidth());
+	const float height = static_cast<float>(image.getHeight());
+
+	// Same mapping as the rayGen shader
+	float x = rasterX / width;
+	float y = rasterY / height;
+
+	x = (2.f * x) - 1.f;
+	y = 1.f - (2.f * y);
+
+	x *= width / height;
+
+	CRTVector dirCamera(x, y, -1.f);
+	dirCamera.normalise();
+
+	const CRTMatrix& r = camera.getRotationMatrix();
+	CRTVector dirWorld(
+		r.get(0, 0) * dirCamera.getX() + r.get(0, 1) * dirCamera.getY() + r.get(0, 2) * dirCamera.getZ(),
+		r.get(1, 0) * dirCamera.getX() + r.get(1, 1) * dirCamera.getY() + r.get(1, 2) * dirCamera.getZ(),
+		r.get(2, 0) * dirCamera.getX() + r.get(2, 1) * dirCamera.getY() + r.get(2, 2) * dirCamera.getZ()
+	);
+	dirWorld.normalise();
+
+	return CRTRay(camera.getPosition(), dirWorld);
+}
+
+void CRTRenderer::traceBatch(TileContext& context) const
+{
+	const CRTVector& backgroundColor = scene.getSettings().backgroundColor;
+	CRTTraversalStats* traversalStats = settings.collectTraversalStats ? &context.traversalStats : nullptr;
+
+	while (!context.rays.empty())
+	{
+		context.nextRays.clear();
+		context.shadowRays.clear();
+
+		const int rayCount = static_cast<int>(context.rays.size());
+
+		// Camera rays leave the tile in scanline order and are coherent already.
+		// All rays of a batch have the same depth.
+		getTraceOrder(context.rays, settings.sortSecondaryRays && context.rays.front().depth > 0, context, context.rayOrder);
+
+		context.hits.resize(rayCount);
+		context.hitFound.resize(rayCount);
+
+		for (int slot : context.rayOrder)
+		{
+			context.hits[slot] = CRTIntersection();
+			context.hitFound[slot] = accelerationStructure.intersect(context.rays[slot].ray, context.hits[slot], traversalStats);
+		}
+
+		// Shading goes back to the original order, so the sums and the spawned rays do not depend on the sorting
+		for (int slot = 0; slot < rayCount; slot++)
+		{
+			const RayQuery& query = context.rays[slot];
+			const CRTIntersection& intersection = context.hits[slot];
+
+			if (!context.hitFound[slot])
+			{
+				context.sampleRadiance[query.sampleIndex] += query.throughput * backgroundColor;
+
+				if (query.depth == 0)
+					context.sampleAOVs[query.sampleIndex].albedo = backgroundColor;
+
+				continue;
+			}
+
+			shade(query, intersection, context);
+		}
+
+		const int shadowCount = static_cast<int>(context.shadowRays.size());
+
+		getTraceOrder(context.shadowRays, settings.sortSecondaryRays, context, context.shadowOrder);
+		context.occluded.resize(shadowCount);
+
+		for (int slot : context.shadowOrder)
+		{
+			const ShadowQuery& shadowQuery = context.shadowRays[slot];
+			context.occluded[slot] = accelerationStructure.isOccluded(shadowQuery.ray, shadowQuery.maxDistance, traversalStats);
+		}
+
+		for (int slot = 0; slot < shadowCount; slot++)
+		{
+			if (!context.occluded[slot])
+			{
+				const ShadowQuery& shadowQuery = context.shadowRays[slot];
+				context.sampleRadiance[shadowQuery.sampleIndex] += shadowQuery.contribution;
+			}
+		}
+
+		(context.rays.front().depth == 0 ? context.primaryRays : context.secondaryRays) += rayCount;
+		context.shadowRaysTraced += shadowCount;
+
+		context.rays.swap(context.nextRays);
+	}
+}
+
+template<typename Query>
+void CRTRenderer::getTraceOrder(const std::vector<Query>& queries, bool sort, TileContext& context, std::vector<int>& order) const
+{
+	order.resize(queries.size());
+
+	if (!sort)
+	{
+		std::iota(order.begin(), order.end(), 0);
+		return;
+	}
+
+	context.sortKeys.resize(queries.size());
+
+	for (size_t i = 0; i < queries.size(); i++)
+	{
+		context.sortKeys[i] = { getCoherenceKey(queries[i].ray), static_cast<int>(i) };
+	}
+
+	// The slot breaks ties, so the order is the same on every run
+	std::sort(context.sortKeys.begin(), context.sortKeys.end());
+
+	for (size_t i = 0; i < queries.size(); i++)
+	{
+		order[i] = context.sortKeys[i].second;
+	}
+}
+
+uint64_t CRTRenderer::getCoherenceKey(const CRTRay& ray) const
+{
+	const CRTBoundingBox& bounds = accelerationStructure.getBounds();
+	const CRTVector& origin = ray.getOrigin();
+	const CRTVector& direction = ray.getDirection();
+
+	const int cellCount = 1 << mortonBits;
+	uint32_t morton = 0;
+	uint32_t octant = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float extent = bounds.getMax().getByIndex(axis) - bounds.getMin().getByIndex(axis);
+		const float relative = extent > 0.f ? (origin.getByIndex(axis) - bounds.getMin().getByIndex(axis)) / extent : 0.f;
+		const int cell = std::clamp(static_cast<int>(relative * cellCount), 0, cellCount - 1);
+
+		morton |= expandBits(static_cast<uint32_t>(cell)) << (2 - axis);
+
+		if (direction.getByIndex(axis) < 0.f)
+			octant |= 1u << axis;
+	}
+
+	return (static_cast<uint64_t>(octant) << (3 * mortonBits)) | morton;
+}
+
+void CRTRenderer::shade(const RayQuery& query, const CRTIntersection& intersection, TileContext& context) const
+{
+	const CRTMesh& mesh = scene.getObjects()[intersection.objectIndex];
+	const int materialIndex = mesh.getMaterialIndex();
+	const CRTMaterial& material = scene.getMaterials()[materialIndex];
+
+	const CRTVector& direction = query.ray.getDirection();
+	const CRTVector point = query.ray.at(intersection.t);
+
+	// The normals of the mesh are in object space
+	const CRTTransform& transform = accelerationStructure.getInstanceTransform(intersection.instanceIndex);
+
+	CRTVector geometricNormal = transform.transformDirection(
+		accelerationStructure.getTriangle(intersection.objectIndex, intersection.triangleIndex).getNormal());
+	CRTVector normal = material.isSmoothShading() ? transform.transformDirection(getShadingNormal(intersection)) : geometricNormal;
+
+	// Both normals face the side the ray comes from
+	const bool entering = dot(direction, geometricNormal) < 0.f;
+	if (!entering)
+		geometricNormal = geometricNormal * -1.f;
+
+	if (dot(direction, normal) > 0.f)
+		normal = normal * -1.f;
+
+	const CRTVector albedo = getAlbedo(materialIndex, intersection);
+
+	if (query.depth == 0)
+	{
+		const CRTVector barycentrics(1.f - intersection.u - intersection.v, intersection.u, intersection.v);
+		context.sampleAOVs[query.sampleIndex] = { albedo, normal, intersection.t, barycentrics,
+			intersection.triangleIndex, intersection.instanceIndex };
+	}
+
+	switch (material.getType())
+	{
+	case CRTMaterialType::DIFFUSE:
+	{
+		const CRTVector shadowOrigin = point + geometricNormal * rayBias;
+
+		for (const CRTLight& light : scene.getLights())
+		{
+			CRTVector toLight = light.getPosition() - shadowOrigin;
+			const float distance = toLight.length();
+			toLight = toLight * (1.f / distance);
+
+			const float cosTheta = dot(normal, toLight);
+			if (cosTheta <= 0.f)
+				continue;
+
+			const float sphereArea = 4.f * static_cast<float>(M_PI) * distance * distance;
+
+			ShadowQuery shadowQuery;
+			shadowQuery.ray = CRTRay(shadowOrigin, toLight);
+			shadowQuery.maxDistance = distance;
+			shadowQuery.contribution = query.throughput * albedo * (light.getIntensity() / sphereArea * cosTheta);
+			shadowQuery.sampleIndex = query.sampleIndex;
+
+			context.shadowRays.push_back(shadowQuery);
+		}
+		break;
+	}
+	case CRTMaterialType::REFLECTIVE:
+	{
+		if (query.depth >= settings.maxDepth)
+			break;
+
+		CRTVector reflected = direction - normal * (2.f * dot(direction, normal));
+		reflected.normalise();
+
+		context.nextRays.push_back({ CRTRay(point + geometricNormal * rayBias, reflected),
+			query.throughput * albedo, query.sampleIndex, query.depth + 1 });
+		break;
+	}
+	case CRTMaterialType::REFRACTIVE:
+	{
+		if (query.depth >= settings.maxDepth)
+			break;
+
+		const float ior = material.getIor();
+		const float eta = entering ? 1.f / ior : ior;
+		const float cosI = -dot(direction, normal);
+		const float sin2T = eta * eta * (1.f - cosI * cosI);
+
+		CRTVector reflected = direction + normal * (2.f * cosI);
+		reflected.normalise();
+
+		float reflectance = 1.f;
+
+		if (sin2T < 1.f)
+		{
+			const float cosT = sqrtf(1.f - sin2T);
+			CRTVector refracted = direction * eta + normal * (eta * cosI - cosT);
+			refracted.normalise();
+
+			// Schlick's approximation of the Fresnel term
+			const float r0 = ((1.f - ior) / (1.f + ior)) * ((1.f - ior) / (1.f + ior));
+			reflectance = r0 + (1.f - r0) * powf(1.f - cosI, 5.f);
+
+			context.nextRays.push_back({ CRTRay(point - geometricNormal * rayBias, refracted),
+				query.throughput * albedo * (1.f - reflectance), query.sampleIndex, query.depth + 1 });
+		}
+
+		context.nextRays.push_back({ CRTRay(point + geometricNormal * rayBias, reflected),
+			query.throughput * albedo * reflectance, query.sampleIndex, query.depth + 1 });
+		break;
+	}
+	case CRTMaterialType::CONSTANT:
+		context.sampleRadiance[query.sampleIndex] += query.throughput * albedo;
+		break;
+	default:
+		break;
+	}
+}
+
+CRTVector CRTRenderer::getShadingNormal(const CRTIntersection& intersection) const
+{
+	const CRTMesh& mesh = scene.getObjects()[intersection.objectIndex];
+	const auto& indices = mesh.getIndices();
+	const auto& normals = mesh.getVertexNormals();
+	const int base = intersection.triangleIndex * CRTTriangle::vertsInTriangle;
+
+	CRTVector normal =
+		normals[indices[base]] * (1.f - intersection.u - intersection.v) +
+		normals[indices[base + 1]] * intersection.u +
+		normals[indices[base + 2]] * intersection.v;
+	normal.normalise();
+
+	return normal;
+}
+
+CRTVector CRTRenderer::getAlbedo(int materialIndex, const CRTIntersection& intersection) const
+{
+	const CRTMaterial& material = scene.getMaterials()[materialIndex];
+	const CRTTexture* texture = materialTextures[materialIndex];
+
+	if (texture == nullptr)
+		return material.getAlbedo();
+
+	const CRTMesh& mesh = scene.getObjects()[intersection.objectIndex];
+	const auto& uvs = mesh.getUV();
+
+	// Procedural textures without UVs are defined over the triangle barycentrics
+	if (uvs.empty() || strcmp(texture->getType(), "other") == 0)
+		return texture->getColor(intersection.u, intersection.v);
+
+	const auto& indices = mesh.getIndices();
+	const int base = intersection.triangleIndex * CRTTriangle::vertsInTriangle;
+
+	CRTVector uv =
+		uvs[indices[base]] * (1.f - intersection.u - intersection.v) +
+		uvs[indices[base + 1]] * intersection.u +
+		uvs[indices[base + 2]] * intersection.v;
+
+	return texture->getColor(uv.getX(), uv.getY());
+}
+
+void CRTRenderer::updateConvergence(PixelEstimate& estimate) const
+{
+	if (estimate.sampleCount >= settings.maxSamples)
+	{
+		estimate.converged = true;
+		return;
+	}
+
+	if (estimate.sampleCount < 2)
+		return;
+
+	const float n = static_cast<float>(estimate.sampleCount);
+	const float mean = estimate.luminanceSum / n;
+	const float variance = std::max((estimate.luminanceSquaredSum - n * mean * mean) / (n - 1.f), 0.f);
+	const float standardError = sqrtf(variance / n);
+
+	estimate.converged = standardError <= settings.errorThreshold * std::max(mean, minLuminance);
+}
+
+void CRTRenderer::resolveImage()
+{
+	for (int y = 0; y < image.getHeight(); y++)
+	{
+		for (int x = 0; x < image.getWidth(); x++)
+		{
+			const PixelEstimate& estimate = estimates[static_cast<size_t>(y) * image.getWidth() + x];
+
+			if (estimate.sampleCount == 0)
+				continue;
+
+			const size_t pixelIndex = static_cast<size_t>(y) * image.getWidth() + x;
+			const float weight = 1.f / estimate.sampleCount;
+			image.setPixel(x, y, estimate.sum * weight);
+
+			if (aovs.has(CRTAOVMask::depth))
+				aovs.depth[pixelIndex] = estimate.depthSum * weight;
+
+			if (aovs.has(CRTAOVMask::normal))
+				aovs.normal.setPixel(x, y, estimate.normalSum * weight);
+
+			if (aovs.has(CRTAOVMask::barycentrics))
+				aovs.barycentrics.setPixel(x, y, estimate.firstBarycentrics);
+
+			if (aovs.has(CRTAOVMask::primitiveID))
+				aovs.primitiveID[pixelIndex] = estimate.firstPrimitiveID;
+
+			if (aovs.has(CRTAOVMask::instanceID))
+				aovs.instanceID[pixelIndex] = estimate.firstInstanceID;
+
+			if (aovs.has(CRTAOVMask::albedo))
+				aovs.albedo.setPixel(x, y, estimate.albedoSum * weight);
+		}
+	}
+}
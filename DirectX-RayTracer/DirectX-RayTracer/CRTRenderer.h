@@ -0,0 +1,209 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "CRTScene.h"
+#include "CRTAccelerationStructure.h"
+#include "CRTAOVBuffers.h"
+#include "CRTImage.h"
+#include "CRTSampler.h"
+
+struct CRTRenderSettings
+{
+	int threadCount = 0; // 0 means one thread per hardware thread
+	int tileSize = 32;
+	int maxDepth = 5; // Reflection/refraction bounces
+
+	// Adaptive sampling. Every pixel takes minSamples, after that each pass adds
+	// samplesPerPass to the pixels whose estimate is still too noisy
+	int minSamples = 4;
+	int maxSamples = 64;
+	int samplesPerPass = 4;
+	float errorThreshold = 0.02f; // Relative standard error of the pixel luminance
+	float timeBudgetSeconds = 0.f; // 0 means no limit, otherwise no pass starts after it
+
+	// Same type and seed give the same image, whatever the thread count and tile size
+	CRTSamplerType samplerType = CRTSamplerType::SOBOL;
+	uint32_t seed = 0;
+
+	// AOVs filled from the same primary hits as the color, see CRTAOVMask
+	uint32_t aovMask = CRTAOVMask::denoiserGuides;
+
+	// Trace secondary and shadow rays grouped by direction octant and origin, then
+	// shade them in the original order. The image is the same either way.
+	bool sortSecondaryRays = true;
+
+	// Count BVH node visits and simulated node cache hits, costs some speed
+	bool collectTraversalStats = false;
+};
+
+struct CRTRenderStats
+{
+	long long totalSamples = 0;
+	int passes = 0;
+	float renderSeconds = 0.f;
+
+	long long raysTraced = 0; // Camera, secondary and shadow rays
+	long long primaryRays = 0;
+	long long secondaryRays = 0; // Reflection and refraction
+	long long shadowRays = 0;
+	float raysPerSecond = 0.f;
+
+	// Only with collectTraversalStats
+	long long nodesVisited = 0;
+	long long nodeCacheHits = 0;
+	long long trianglesTested = 0;
+
+	// Time each worker spent on tiles, over all passes. Divided by renderSeconds
+	// it is the utilization of the thread, the rest went to waiting for the pass to end.
+	std::vector<float> threadBusySeconds;
+};
+
+// Multithreaded CPU ray tracer for a CRTScene. The image is split into tiles
+// which are rendered in passes until every pixel converges or the budget runs out.
+class CRTRenderer
+{
+public:
+	explicit CRTRenderer(const CRTScene& scene);
+
+	// Shares an acceleration structure built by the caller, so renderers of several
+	// frames on different threads trace the same BVH. The caller updates it when the
+	// instances change, render does not.
+	CRTRenderer(const CRTScene& scene, const CRTAccelerationStructure& sharedAccelerationStructure);
+
+	// Renders from the camera of the scene
+	void render(const CRTRenderSettings& settings);
+	void render(const CRTRenderSettings& settings, const CRTCamera& camera);
+
+	const CRTImage& getImage() const;
+
+	// Depth, normal and albedo are averaged over the samples of a pixel. Barycentrics
+	// and IDs come from its first sample, an average of those means nothing at edges.
+	const CRTAOVBuffers& getAOVs() const;
+	const CRTRenderStats& getStats() const;
+
+	// Debug view of the samples spent per pixel, blue for minSamples up to red for maxSamples
+	CRTImage getSampleHeatmap() const;
+
+private:
+	struct Tile
+	{
+		int x, y, width, height;
+	};
+
+	struct PixelEstimate
+	{
+		CRTVector sum;
+		float luminanceSum = 0.f;
+		float luminanceSquaredSum = 0.f;
+		int sampleCount = 0;
+		bool converged = false;
+
+		CRTVector albedoSum;
+		CRTVector normalSum;
+		float depthSum = 0.f;
+		CRTVector firstBarycentrics;
+		int firstPrimitiveID = -1;
+		int firstInstanceID = -1;
+	};
+
+	// What the camera ray of a sample hit first
+	struct SampleAOV
+	{
+		CRTVector albedo;
+		CRTVector normal;
+		float depth = 0.f;
+		CRTVector barycentrics;
+		int primitiveID = -1;
+		int instanceID = -1;
+	};
+
+	// A ray waiting to be traced and the pixel sample it contributes to
+	struct RayQuery
+	{
+		CRTRay ray;
+		CRTVector throughput;
+		int sampleIndex;
+		int depth;
+	};
+
+	struct ShadowQuery
+	{
+		CRTRay ray;
+		float maxDistance;
+		CRTVector contribution;
+		int sampleIndex;
+	};
+
+	// Per-thread scratch memory, reused between tiles
+	struct TileContext
+	{
+		std::vector<RayQuery> rays;
+		std::vector<RayQuery> nextRays;
+		std::vector<ShadowQuery> shadowRays;
+		std::vector<CRTVector> sampleRadiance;
+		std::vector<int> samplePixels;
+		std::vector<SampleAOV> sampleAOVs;
+
+		// Trace order of the current batch, results are stored by the original slot
+		std::vector<std::pair<uint64_t, int>> sortKeys;
+		std::vector<int> rayOrder;
+		std::vector<CRTIntersection> hits;
+		std::vector<char> hitFound;
+		std::vector<int> shadowOrder;
+		std::vector<char> occluded;
+
+		CRTTraversalStats traversalStats;
+		long long primaryRays = 0;
+		long long secondaryRays = 0;
+		long long shadowRaysTraced = 0;
+	};
+
+	void resolveMaterialTextures();
+	void createTiles();
+	bool isOverBudget() const;
+
+	// Renders all tiles in parallel. With canStop no new tile starts once the time budget is spent
+	void renderPass(int passIndex, bool canStop);
+
+	// Returns the number of samples taken
+	int renderTile(const Tile& tile, int passIndex, TileContext& context);
+
+	CRTRay generateCameraRay(float rasterX, float rasterY) const;
+
+	// Traces context.rays and all the rays they spawn, accumulating into context.sampleRadiance
+	void traceBatch(TileContext& context) const;
+
+	// Fills order with the trace order of the queries, sorted by getCoherenceKey when sort is set
+	template<typename Query>
+	void getTraceOrder(const std::vector<Query>& queries, bool sort, TileContext& context, std::vector<int>& order) const;
+
+	// Direction octant in the top bits, Morton code of the origin inside the scene bounds below
+	uint64_t getCoherenceKey(const CRTRay& ray) const;
+
+	void shade(const RayQuery& query, const CRTIntersection& intersection, TileContext& context) const;
+
+	CRTVector getShadingNormal(const CRTIntersection& intersection) const;
+	CRTVector getAlbedo(int materialIndex, const CRTIntersection& intersection) const;
+
+	void updateConvergence(PixelEstimate& estimate) const;
+	void resolveImage();
+
+private:
+	const CRTScene& scene;
+	std::unique_ptr<CRTAccelerationStructure> ownedAccelerationStructure; // Null when it is shared
+	const CRTAccelerationStructure& accelerationStructure;
+	std::vector<const CRTTexture*> materialTextures; // Resolved once instead of by name on every hit
+
+	CRTRenderSettings settings;
+	CRTCamera camera; // Of the current render
+	CRTSampler sampler;
+	CRTRenderStats stats;
+	CRTImage image;
+	CRTAOVBuffers aovs;
+	std::vector<Tile> tiles;
+	std::vector<PixelEstimate> estimates;
+
+	std::chrono::steady_clock::time_point renderStart;
+	std::chrono::steady_clock::time_point deadline;
+};
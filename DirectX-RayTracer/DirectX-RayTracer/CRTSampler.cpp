@@ -0,0 +1,262 @@
+#include "CRTSampler.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+static uint32_t hash(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+
+static uint32_t hashCombine(uint32_t seed, uint32_t value)
+{
+	return hash(seed ^ (value + 0x9E3779B9u + (seed << 6) + (seed >> 2)));
+}
+
+static float toUnitFloat(uint32_t x)
+{
+	// Top 24 bits, so the result is exactly representable and stays below 1
+	return (x >> 8) * (1.f / 16777216.f);
+}
+
+static uint32_t reverseBits(uint32_t x)
+{
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+	x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+	return (x >> 16) | (x << 16);
+}
+
+// Hash-based Owen scrambling (Burley, "Practical Hash-based Owen Scrambling", 2020)
+static uint32_t laineKarrasPermutation(uint32_t x, uint32_t seed)
+{
+	x += seed;
+	x ^= x * 0x6C50B47Cu;
+	x ^= x * 0xB82F1E52u;
+	x ^= x * 0xC7AFE638u;
+	x ^= x * 0x8D22F6E6u;
+	return x;
+}
+
+static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed)
+{
+	return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+}
+
+// First two Sobol dimensions: van der Corput and the x + 1 primitive polynomial
+static uint32_t sobol(uint32_t index, int dimension)
+{
+	static const std::array<std::array<uint32_t, 32>, 2> directions = []()
+		{
+			std::array<std::array<uint32_t, 32>, 2> result{};
+
+			for (int bit = 0; bit < 32; bit++)
+			{
+				result[0][bit] = 1u << (31 - bit);
+				result[1][bit] = bit == 0 ? 1u << 31 : result[1][bit - 1] ^ (result[1][bit - 1] >> 1);
+			}
+
+			return result;
+		}();
+
+	uint32_t value = 0;
+
+	for (int bit = 0; index != 0; bit++, index >>= 1)
+	{
+		if (index & 1u)
+			value ^= directions[dimension][bit];
+	}
+
+	return value;
+}
+
+CRTSampler::CRTSampler(CRTSamplerType type, uint32_t seed) : type(type), seed(seed)
+{
+}
+
+float CRTSampler::get1D(int pixelX, int pixelY, uint32_t sampleIndex, uint32_t dimension) const
+{
+	const uint32_t pixelSeed = getPixelSeed(pixelX, pixelY, dimension);
+
+	switch (type)
+	{
+	case CRTSamplerType::SOBOL:
+	{
+		const uint32_t index = nestedUniformScramble(sampleIndex, pixelSeed);
+		return toUnitFloat(nestedUniformScramble(sobol(index, 0), hashCombine(pixelSeed, 1)));
+	}
+	case CRTSamplerType::BLUE_NOISE:
+		return getBlueNoise(pixelX, pixelY, sampleIndex, dimension);
+	default:
+		return toUnitFloat(hashCombine(pixelSeed, sampleIndex));
+	}
+}
+
+void CRTSampler::get2D(int pixelX, int pixelY, uint32_t sampleIndex, uint32_t dimension, float& u, float& v) const
+{
+	if (type != CRTSamplerType::SOBOL)
+	{
+		u = get1D(pixelX, pixelY, sampleIndex, dimension);
+		v = get1D(pixelX, pixelY, sampleIndex, dimension + 1);
+		return;
+	}
+
+	// Both coordinates come from the same shuffled index so the pair keeps the
+	// (0, 2) stratification, padding between pairs is done by the pixel seed
+	const uint32_t pixelSeed = getPixelSeed(pixelX, pixelY, dimension);
+	const uint32_t index = nestedUniformScramble(sampleIndex, pixelSeed);
+
+	u = toUnitFloat(nestedUniformScramble(sobol(index, 0), hashCombine(pixelSeed, 1)));
+	v = toUnitFloat(nestedUniformScramble(sobol(index, 1), hashCombine(pixelSeed, 2)));
+}
+
+CRTSamplerType CRTSampler::getType() const
+{
+	return type;
+}
+
+uint32_t CRTSampler::getSeed() const
+{
+	return seed;
+}
+
+const std::vector<uint16_t>& CRTSampler::getBlueNoiseTile()
+{
+	static const std::vector<uint16_t> tile = []()
+		{
+			const int size = blueNoiseTileSize;
+			const int count = size * size;
+			const float sigma = 1.5f;
+
+			// Toroidal Gaussian energy kernel, indexed by the wrapped offset
+			std::vector<float> kernel(count);
+			for (int dy = 0; dy < size; dy++)
+			{
+				for (int dx = 0; dx < size; dx++)
+				{
+					const int wx = std::min(dx, size - dx);
+					const int wy = std::min(dy, size - dy);
+					kernel[dy * size + dx] = expf(-(wx * wx + wy * wy) / (2.f * sigma * sigma));
+				}
+			}
+
+			std::vector<uint8_t> pattern(count, 0);
+			std::vector<float> energy(count, 0.f);
+
+			auto splat = [&](int index, float sign)
+				{
+					const int px = index % size;
+					const int py = index / size;
+
+					for (int y = 0; y < size; y++)
+					{
+						const int dy = (y - py + size) % size;
+						for (int x = 0; x < size; x++)
+						{
+							energy[y * size + x] += sign * kernel[dy * size + (x - px + size) % size];
+						}
+					}
+				};
+
+			auto tightestCluster = [&]()
+				{
+					int best = -1;
+					for (int i = 0; i < count; i++)
+						if (pattern[i] && (best < 0 || energy[i] > energy[best]))
+							best = i;
+					return best;
+				};
+
+			auto largestVoid = [&]()
+				{
+					int best = -1;
+					for (int i = 0; i < count; i++)
+						if (!pattern[i] && (best < 0 || energy[i] < energy[best]))
+							best = i;
+					return best;
+				};
+
+			// Void-and-cluster (Ulichney 1993) from a fixed random initial pattern
+			const int initialOnes = count / 10;
+			for (uint32_t i = 0, placed = 0; placed < static_cast<uint32_t>(initialOnes); i++)
+			{
+				const int index = hash(i) % count;
+				if (!pattern[index])
+				{
+					pattern[index] = 1;
+					splat(index, 1.f);
+					placed++;
+				}
+			}
+
+			for (;;)
+			{
+				const int cluster = tightestCluster();
+				pattern[cluster] = 0;
+				splat(cluster, -1.f);
+
+				const int voidIndex = largestVoid();
+				pattern[voidIndex] = 1;
+				splat(voidIndex, 1.f);
+
+				if (voidIndex == cluster)
+					break;
+			}
+
+			const std::vector<uint8_t> prototype = pattern;
+			const std::vector<float> prototypeEnergy = energy;
+			std::vector<uint16_t> ranks(count, 0);
+
+			for (int rank = initialOnes - 1; rank >= 0; rank--)
+			{
+				const int cluster = tightestCluster();
+				pattern[cluster] = 0;
+				splat(cluster, -1.f);
+				ranks[cluster] = static_cast<uint16_t>(rank);
+			}
+
+			pattern = prototype;
+			energy = prototypeEnergy;
+
+			for (int rank = initialOnes; rank < count; rank++)
+			{
+				const int voidIndex = largestVoid();
+				pattern[voidIndex] = 1;
+				splat(voidIndex, 1.f);
+				ranks[voidIndex] = static_cast<uint16_t>(rank);
+			}
+
+			return ranks;
+		}();
+
+	return tile;
+}
+
+uint32_t CRTSampler::getPixelSeed(int pixelX, int pixelY, uint32_t dimension) const
+{
+	uint32_t pixelSeed = hashCombine(seed, static_cast<uint32_t>(pixelX));
+	pixelSeed = hashCombine(pixelSeed, static_cast<uint32_t>(pixelY));
+	return hashCombine(pixelSeed, dimension);
+}
+
+float CRTSampler::getBlueNoise(int pixelX, int pixelY, uint32_t sampleIndex, uint32_t dimension) const
+{
+	const int size = blueNoiseTileSize;
+	const std::vector<uint16_t>& tile = getBlueNoiseTile();
+
+	// Every dimension reads the tile at its own toroidal offset
+	const uint32_t offset = hashCombine(seed, dimension);
+	const int x = (pixelX + static_cast<int>(offset % size)) % size;
+	const int y = (pixelY + static_cast<int>((offset / size) % size)) % size;
+
+	// Golden ratio rotation in 32-bit fixed point keeps successive samples well spread
+	const uint32_t rank = tile[y * size + x];
+	const uint32_t base = (rank << 20) + (1u << 19);
+	return toUnitFloat(base + sampleIndex * 2654435769u);
+}
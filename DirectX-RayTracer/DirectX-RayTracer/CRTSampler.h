@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+enum class CRTSamplerType
+{
+	INDEPENDENT, // Hashed white noise, the reference to compare against
+	SOBOL, // Owen-scrambled and shuffled Sobol (0, 2) sequence
+	BLUE_NOISE // Precomputed blue-noise tile, rotated by the golden ratio per sample
+};
+
+// Sample dimensions. Each bounce gets its own block so the sequences used
+// for camera, light and BSDF sampling stay decorrelated.
+namespace CRTSampleDimension
+{
+	static constexpr uint32_t cameraJitter = 0; // 2D
+	static constexpr uint32_t lensAperture = 2; // 2D
+	static constexpr uint32_t firstBounce = 4;
+	static constexpr uint32_t perBounce = 4;
+	static constexpr uint32_t lightSample = 0; // 2D, relative to the bounce block
+	static constexpr uint32_t bsdfSample = 2; // 2D, relative to the bounce block
+
+	inline uint32_t forBounce(int bounce, uint32_t offset)
+	{
+		return firstBounce + static_cast<uint32_t>(bounce) * perBounce + offset;
+	}
+}
+
+// Stateless sample generator. A value depends only on the seed, the pixel,
+// the sample index and the dimension, never on tiles or threads, so any split
+// of the image reproduces the same render bit for bit.
+class CRTSampler
+{
+public:
+	static constexpr int blueNoiseTileSize = 64;
+
+	CRTSampler(CRTSamplerType type = CRTSamplerType::SOBOL, uint32_t seed = 0);
+
+	// Value in [0, 1)
+	float get1D(int pixelX, int pixelY, uint32_t sampleIndex, uint32_t dimension) const;
+
+	// Point in [0, 1)^2 from dimensions dimension and dimension + 1
+	void get2D(int pixelX, int pixelY, uint32_t sampleIndex, uint32_t dimension, float& u, float& v) const;
+
+	CRTSamplerType getType() const;
+	uint32_t getSeed() const;
+
+	// Ranks of the blue-noise tile in [0, blueNoiseTileSize^2), built once by void-and-cluster
+	static const std::vector<uint16_t>& getBlueNoiseTile();
+
+private:
+	uint32_t getPixelSeed(int pixelX, int pixelY, uint32_t dimension) const;
+	float getBlueNoise(int pixelX, int pixelY, uint32_t sampleIndex, uint32_t dimension) const;
+
+	CRTSamplerType type;
+	uint32_t seed;
+};
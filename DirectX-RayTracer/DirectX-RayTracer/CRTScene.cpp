@@ -4,14 +4,19 @@
 #include <assert.h>
 #include "CRTSceneParser.h"
 
-CRTScene::CRTScene(const std::string& sceneFileName)
+CRTScene::CRTScene(const std::string& sceneFileName, CRTLoadProfile* profile)
 {
-	parseSceneFile(sceneFileName);
+	parseSceneFile(sceneFileName, profile);
 }
 
-void CRTScene::parseSceneFile(const std::string& sceneFileName)
+void CRTScene::parseSceneFile(const std::string& sceneFileName, CRTLoadProfile* profile)
 {
-	CRTSceneParser::parseScene(sceneFileName, *this);
+	loaded = CRTSceneParser::parseScene(sceneFileName, *this, profile);
+}
+
+bool CRTScene::isLoaded() const
+{
+	return loaded;
 }
 
 const CRTSettings& CRTScene::getSettings() const
@@ -19,6 +24,11 @@ const CRTSettings& CRTScene::getSettings() const
 	return settings;
 }
 
+CRTSettings& CRTScene::getSettings()
+{
+	return settings;
+}
+
 const CRTCamera& CRTScene::getCamera() const
 {
 	return camera;
@@ -34,6 +44,16 @@ const std::vector<CRTMesh>& CRTScene::getObjects() const
 	return geometryObjects;
 }
 
+const CRTInstanceSet& CRTScene::getInstances() const
+{
+	return instances;
+}
+
+CRTInstanceSet& CRTScene::getInstances()
+{
+	return instances;
+}
+
 const std::vector<CRTLight>& CRTScene::getLights() const
 {
 	return lights;
@@ -5,12 +5,14 @@
 #include "CRTLight.h"
 #include "CRTMaterial.h"
 #include "CRTTexture.h"
+#include "CRTInstances.h"
+#include "CRTLoadProfile.h"
 
 struct CRTSettings
 {
 	CRTVector backgroundColor;
-	int imageWidth;
-	int imageHeight;
+	int imageWidth = 0; // 0 until a scene file sets them
+	int imageHeight = 0;
 };
 
 class CRTScene
@@ -18,10 +20,15 @@ class CRTScene
 public:
 	friend class CRTSceneParser;
 
-	CRTScene(const std::string& sceneFileName);
+	CRTScene(const std::string& sceneFileName, CRTLoadProfile* profile = nullptr);
+
+	void parseSceneFile(const std::string& sceneFileName, CRTLoadProfile* profile = nullptr);
+
+	// False when the scene file could not be read or parsed, the scene is then empty
+	bool isLoaded() const;
 
-	void parseSceneFile(const std::string& sceneFileName);
 	const CRTSettings& getSettings() const;
+	CRTSettings& getSettings();
 	const CRTCamera& getCamera() const;
 	CRTCamera& getCamera();
 	const std::vector<CRTMesh>& getObjects() const;
@@ -29,6 +36,11 @@ public:
 	const std::vector<CRTMaterial>& getMaterials() const;
 	const std::vector<CRTTexture*>& getTextures() const;
 
+	// Placements of the meshes, one identity instance per mesh after loading
+	// followed by the extra ones of the "instances" array of the scene file
+	const CRTInstanceSet& getInstances() const;
+	CRTInstanceSet& getInstances();
+
 	const CRTTexture* getTextureByName(const std::string& name) const;
 
 private:
@@ -38,6 +50,8 @@ private:
 	std::vector<CRTLight> lights;
 	std::vector<CRTMaterial> materials;
 	std::vector<CRTTexture*> textures;
+	CRTInstanceSet instances;
+	bool loaded = false;
 
 };
 
@@ -0,0 +1,429 @@
+#include "CRTSceneGenerator.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "CRTMatrix.h"
+
+namespace
+{
+	const float slotSize = 12.f; // Room for one object, objects span about 10 units
+	const float pi = 3.14159265f;
+	const int tubeSides = 6;
+
+	// SplitMix64. The standard distributions differ between library
+	// implementations, so the random floats are made by hand.
+	class Random
+	{
+	public:
+		explicit Random(uint64_t seed) : state(seed)
+		{
+		}
+
+		uint64_t next()
+		{
+			uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		// In [0, 1)
+		float uniform()
+		{
+			return static_cast<float>(next() >> 40) * (1.f / 16777216.f);
+		}
+
+		float range(float min, float max)
+		{
+			return min + (max - min) * uniform();
+		}
+
+		// Components drawn one statement at a time, argument evaluation order is unspecified
+		CRTVector inRange(float min, float max)
+		{
+			const float x = range(min, max);
+			const float y = range(min, max);
+			const float z = range(min, max);
+			return CRTVector(x, y, z);
+		}
+
+		CRTVector inBox(float halfSize)
+		{
+			return inRange(-halfSize, halfSize);
+		}
+
+	private:
+		uint64_t state;
+	};
+
+	struct GeneratedMesh
+	{
+		std::vector<CRTVector> vertices;
+		std::vector<CRTVector> uvs;
+		std::vector<int> indices;
+	};
+
+	int gridSizeFor(int triangles)
+	{
+		const int size = static_cast<int>(std::lround(std::sqrt(triangles / 2.0)));
+		return size > 1 ? size : 1;
+	}
+
+	int tubeSegmentsFor(int triangles)
+	{
+		const int segments = triangles / (2 * tubeSides);
+		return segments > 1 ? segments : 1;
+	}
+
+	// Object space, centered on the origin
+	GeneratedMesh generateGrid(int triangles, Random& random)
+	{
+		GeneratedMesh mesh;
+		const int size = gridSizeFor(triangles);
+		const float step = 10.f / size;
+		const float phaseX = random.range(0.f, 2.f * pi);
+		const float phaseZ = random.range(0.f, 2.f * pi);
+
+		for (int z = 0; z <= size; z++)
+		{
+			for (int x = 0; x <= size; x++)
+			{
+				const float height = 0.5f * std::sin(x * step + phaseX) * std::cos(z * step + phaseZ);
+				mesh.vertices.push_back(CRTVector(x * step - 5.f, height, z * step - 5.f));
+				mesh.uvs.push_back(CRTVector(static_cast<float>(x) / size, static_cast<float>(z) / size, 0.f));
+			}
+		}
+
+		const int row = size + 1;
+		for (int z = 0; z < size; z++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const int i = z * row + x;
+				const int quad[6] = { i, i + row, i + 1, i + 1, i + row, i + row + 1 };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+
+		return mesh;
+	}
+
+	GeneratedMesh generateSoup(int triangles, Random& random)
+	{
+		GeneratedMesh mesh;
+		const float triangleSize = 2.f * 10.f / std::cbrt(static_cast<float>(triangles));
+
+		for (int i = 0; i < triangles; i++)
+		{
+			const CRTVector center = random.inBox(5.f);
+
+			for (int v = 0; v < 3; v++)
+			{
+				mesh.vertices.push_back(center + random.inBox(0.5f * triangleSize));
+				mesh.indices.push_back(3 * i + v);
+			}
+
+			mesh.uvs.push_back(CRTVector(0.f, 0.f, 0.f));
+			mesh.uvs.push_back(CRTVector(1.f, 0.f, 0.f));
+			mesh.uvs.push_back(CRTVector(0.f, 1.f, 0.f));
+		}
+
+		return mesh;
+	}
+
+	GeneratedMesh generateLongThin(int triangles, Random& random)
+	{
+		GeneratedMesh mesh;
+		const int segments = tubeSegmentsFor(triangles);
+		const float length = 4.f * slotSize;
+		const float radius = 0.05f;
+
+		// Axis away from the coordinate axes, so the boxes stay large
+		CRTVector axis = random.inRange(0.5f, 1.f);
+		axis.normalise();
+
+		CRTVector side = cross(axis, CRTVector(0.f, 1.f, 0.f));
+		side.normalise();
+		const CRTVector up = cross(side, axis);
+
+		for (int s = 0; s <= segments; s++)
+		{
+			const CRTVector center = axis * (length * (static_cast<float>(s) / segments - 0.5f));
+
+			for (int k = 0; k < tubeSides; k++)
+			{
+				const float angle = 2.f * pi * k / tubeSides;
+				mesh.vertices.push_back(center + side * (radius * std::cos(angle)) + up * (radius * std::sin(angle)));
+				mesh.uvs.push_back(CRTVector(static_cast<float>(k) / tubeSides, static_cast<float>(s) / segments, 0.f));
+			}
+		}
+
+		for (int s = 0; s < segments; s++)
+		{
+			for (int k = 0; k < tubeSides; k++)
+			{
+				const int a = s * tubeSides + k;
+				const int b = s * tubeSides + (k + 1) % tubeSides;
+				const int quad[6] = { a, a + tubeSides, b, b, a + tubeSides, b + tubeSides };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+
+		return mesh;
+	}
+
+	CRTMatrix rotationY(float angle)
+	{
+		const float c = std::cos(angle);
+		const float s = std::sin(angle);
+
+		return CRTMatrix(c, 0.f, -s,
+			0.f, 1.f, 0.f,
+			s, 0.f, c);
+	}
+
+	void writeVector(FILE* file, const CRTVector& vec)
+	{
+		fprintf(file, "%.7g, %.7g, %.7g", vec.getX(), vec.getY(), vec.getZ());
+	}
+
+	void writeVectorArray(FILE* file, const char* name, const std::vector<CRTVector>& vectors)
+	{
+		fprintf(file, "\"%s\": [", name);
+		for (size_t i = 0; i < vectors.size(); i++)
+		{
+			fputs(i ? ", " : "", file);
+			writeVector(file, vectors[i]);
+		}
+		fputs("]", file);
+	}
+}
+
+CRTSceneGenerator::CRTSceneGenerator(const CRTSceneGeneratorSettings& settings) : settings(settings)
+{
+	const int objectCount = settings.objectCount > 1 ? settings.objectCount : 1;
+	const float ratio = settings.instancingRatio > 1.f ? settings.instancingRatio : 1.f;
+
+	meshCount = static_cast<int>(std::ceil(objectCount / ratio));
+	this->settings.objectCount = objectCount;
+	this->settings.materialCount = settings.materialCount > 1 ? settings.materialCount : 1;
+
+	const int requested = settings.trianglesPerObject > 1 ? settings.trianglesPerObject : 1;
+	switch (settings.layout)
+	{
+	case CRTSceneLayout::GRID:
+		trianglesPerMesh = 2 * gridSizeFor(requested) * gridSizeFor(requested);
+		break;
+	case CRTSceneLayout::LONG_THIN:
+		trianglesPerMesh = 2 * tubeSides * tubeSegmentsFor(requested);
+		break;
+	default:
+		trianglesPerMesh = requested;
+		break;
+	}
+}
+
+int CRTSceneGenerator::getMeshCount() const
+{
+	return meshCount;
+}
+
+uint64_t CRTSceneGenerator::getTriangleCount() const
+{
+	return static_cast<uint64_t>(trianglesPerMesh) * settings.objectCount;
+}
+
+const char* CRTSceneGenerator::getLayoutName(CRTSceneLayout layout)
+{
+	switch (layout)
+	{
+	case CRTSceneLayout::GRID:
+		return "grid";
+	case CRTSceneLayout::SOUP:
+		return "soup";
+	case CRTSceneLayout::LONG_THIN:
+		return "long-thin";
+	default:
+		return "unknown";
+	}
+}
+
+bool CRTSceneGenerator::parseLayout(const std::string& name, CRTSceneLayout& layout)
+{
+	for (CRTSceneLayout candidate : { CRTSceneLayout::GRID, CRTSceneLayout::SOUP, CRTSceneLayout::LONG_THIN })
+	{
+		if (name == getLayoutName(candidate))
+		{
+			layout = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool CRTSceneGenerator::write(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	Random random(settings.seed);
+	const int objectCount = settings.objectCount;
+
+	// Where every placement goes. The grid fills a square, the other layouts scatter over a cube.
+	const int gridColumns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(objectCount))));
+	const float extent = settings.layout == CRTSceneLayout::GRID ?
+		gridColumns * slotSize : slotSize * std::ceil(std::cbrt(static_cast<float>(objectCount)));
+
+	std::vector<CRTVector> slots(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		if (settings.layout == CRTSceneLayout::GRID)
+			slots[i] = CRTVector(((i % gridColumns) + 0.5f) * slotSize - 0.5f * extent, 0.f, ((i / gridColumns) + 0.5f) * slotSize - 0.5f * extent);
+		else
+			slots[i] = random.inBox(0.5f * extent);
+	}
+
+	// Looking down at the middle of the scene from 30 degrees above the horizon
+	const float pitch = -pi / 6.f;
+	const float distance = 0.9f * extent + 10.f;
+	const CRTMatrix cameraMatrix(1.f, 0.f, 0.f,
+		0.f, std::cos(pitch), -std::sin(pitch),
+		0.f, std::sin(pitch), std::cos(pitch));
+
+	fprintf(file, "{\n\t\"settings\": {\n\t\t\"background_color\": [0.1, 0.1, 0.1],\n");
+	fprintf(file, "\t\t\"image_settings\": {\"width\": %d, \"height\": %d}\n\t},\n\n", settings.imageWidth, settings.imageHeight);
+
+	fprintf(file, "\t\"camera\": {\n\t\t\"matrix\": [1, 0, 0, 0, %.7g, %.7g, 0, %.7g, %.7g],\n",
+		cameraMatrix.get(1, 1), cameraMatrix.get(1, 2), cameraMatrix.get(2, 1), cameraMatrix.get(2, 2));
+	fprintf(file, "\t\t\"position\": [0, %.7g, %.7g]\n\t},\n\n", -std::sin(pitch) * distance, std::cos(pitch) * distance);
+
+	// Above the scene, as bright at the ground as the Dragon lights are at the dragon
+	const float lightHeight = 0.5f * extent + 10.f;
+
+	fprintf(file, "\t\"lights\": [");
+	for (int i = 0; i < settings.lightCount; i++)
+	{
+		const float x = random.range(-0.5f, 0.5f) * extent;
+		const float z = random.range(-0.5f, 0.5f) * extent;
+		const CRTVector position(x, lightHeight, z);
+
+		fprintf(file, "%s\n\t\t{\"intensity\": %.7g, \"position\": [", i ? "," : "", 20.f * lightHeight * lightHeight);
+		writeVector(file, position);
+		fprintf(file, "]}");
+	}
+	fprintf(file, "\n\t],\n\n");
+
+	const char* textureTypes[] = { "checker", "edges", "albedo" };
+
+	fprintf(file, "\t\"textures\": [");
+	for (int i = 0; i < settings.textureCount; i++)
+	{
+		const CRTVector colorA = random.inRange(0.f, 1.f);
+		const CRTVector colorB = random.inRange(0.f, 1.f);
+
+		fprintf(file, "%s\n\t\t{\"name\": \"texture_%d\", \"type\": \"%s\", ", i ? "," : "", i, textureTypes[i % 3]);
+		switch (i % 3)
+		{
+		case 0:
+			fprintf(file, "\"color_A\": [");
+			writeVector(file, colorA);
+			fprintf(file, "], \"color_B\": [");
+			writeVector(file, colorB);
+			fprintf(file, "], \"square_size\": 0.125}");
+			break;
+		case 1:
+			fprintf(file, "\"edge_color\": [");
+			writeVector(file, colorA);
+			fprintf(file, "], \"inner_color\": [");
+			writeVector(file, colorB);
+			fprintf(file, "], \"edge_width\": 0.05}");
+			break;
+		default:
+			fprintf(file, "\"albedo\": [");
+			writeVector(file, colorA);
+			fprintf(file, "]}");
+			break;
+		}
+	}
+	fprintf(file, "\n\t],\n\n");
+
+	// The first materials use the textures, every fourth of the rest is reflective
+	fprintf(file, "\t\"materials\": [");
+	for (int i = 0; i < settings.materialCount; i++)
+	{
+		const bool reflective = i >= settings.textureCount && i % 4 == 3;
+
+		fprintf(file, "%s\n\t\t{\"type\": \"%s\", \"albedo\": ", i ? "," : "", reflective ? "reflective" : "diffuse");
+		if (i < settings.textureCount)
+			fprintf(file, "\"texture_%d\"", i);
+		else
+		{
+			fputs("[", file);
+			writeVector(file, random.inRange(0.2f, 0.9f));
+			fputs("]", file);
+		}
+		fprintf(file, ", \"smooth_shading\": %s}", settings.layout == CRTSceneLayout::GRID ? "true" : "false");
+	}
+	fprintf(file, "\n\t],\n\n");
+
+	// The unique meshes sit in the first slots, in world space
+	fprintf(file, "\t\"objects\": [");
+	for (int m = 0; m < meshCount; m++)
+	{
+		GeneratedMesh mesh;
+		switch (settings.layout)
+		{
+		case CRTSceneLayout::GRID:
+			mesh = generateGrid(trianglesPerMesh, random);
+			break;
+		case CRTSceneLayout::SOUP:
+			mesh = generateSoup(trianglesPerMesh, random);
+			break;
+		default:
+			mesh = generateLongThin(trianglesPerMesh, random);
+			break;
+		}
+
+		for (CRTVector& vertex : mesh.vertices)
+			vertex = vertex + slots[m];
+
+		const int materialIndex = m % settings.materialCount;
+
+		fprintf(file, "%s\n\t\t{\"material_index\": %d,\n\t\t", m ? "," : "", materialIndex);
+		writeVectorArray(file, "vertices", mesh.vertices);
+
+		if (materialIndex < settings.textureCount)
+		{
+			fputs(",\n\t\t", file);
+			writeVectorArray(file, "uvs", mesh.uvs);
+		}
+
+		fputs(",\n\t\t\"triangles\": [", file);
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+			fprintf(file, i ? ", %d" : "%d", mesh.indices[i]);
+		fputs("]}", file);
+	}
+	fprintf(file, "\n\t],\n\n");
+
+	// The other placements reuse a mesh, turned about its own center and moved to their slot
+	fprintf(file, "\t\"instances\": [");
+	for (int p = meshCount; p < objectCount; p++)
+	{
+		const int m = p % meshCount;
+		const CRTMatrix rotation = rotationY(random.range(0.f, 2.f * pi));
+		const CRTVector translation = slots[p] - slots[m] * rotation;
+
+		fprintf(file, "%s\n\t\t{\"object_index\": %d, \"matrix\": [", p > meshCount ? "," : "", m);
+		for (int row = 0; row < 3; row++)
+			fprintf(file, "%s%.7g, %.7g, %.7g", row ? ", " : "", rotation.get(row, 0), rotation.get(row, 1), rotation.get(row, 2));
+		fprintf(file, "], \"position\": [");
+		writeVector(file, translation);
+		fprintf(file, "]}");
+	}
+	fprintf(file, "\n\t]\n}\n");
+
+	const bool ok = ferror(file) == 0;
+	return fclose(file) == 0 && ok;
+}
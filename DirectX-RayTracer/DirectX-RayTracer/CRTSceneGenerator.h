@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+enum class CRTSceneLayout
+{
+	GRID, // Height field patches side by side, the friendly case
+	SOUP, // Random unconnected triangles in overlapping boxes
+	LONG_THIN // Thin tubes along random diagonals, with huge bounding boxes
+};
+
+struct CRTSceneGeneratorSettings
+{
+	uint32_t seed = 1;
+	CRTSceneLayout layout = CRTSceneLayout::GRID;
+	int objectCount = 16;
+	int trianglesPerObject = 10000;
+
+	// Placements per unique mesh. Above 1 the extra placements are written as
+	// instances of the meshes instead of copies of their geometry.
+	float instancingRatio = 1.f;
+
+	int lightCount = 2;
+	int materialCount = 4;
+	int textureCount = 0; // Procedural textures, used by the first materials
+
+	int imageWidth = 1920;
+	int imageHeight = 1080;
+};
+
+// Writes .crtscene files for scaling tests. With one build the output depends
+// only on the settings. The random numbers do not come from the standard
+// library distributions, so they match everywhere, but the geometry goes
+// through std::sin, std::cos and std::cbrt, whose last bit can differ between
+// C runtimes. Files written on different platforms may differ in a few digits.
+class CRTSceneGenerator
+{
+public:
+	explicit CRTSceneGenerator(const CRTSceneGeneratorSettings& settings);
+
+	bool write(const std::string& path) const;
+
+	int getMeshCount() const;
+
+	// Of all placements, instances included
+	uint64_t getTriangleCount() const;
+
+	static const char* getLayoutName(CRTSceneLayout layout);
+	static bool parseLayout(const std::string& name, CRTSceneLayout& layout);
+
+private:
+	CRTSceneGeneratorSettings settings;
+	int meshCount;
+	int trianglesPerMesh; // After rounding to what the layout can build
+};
@@ -38,6 +38,20 @@ CRTVector CRTSceneParser::loadVector(const Value::ConstArray& arr, int startInde
 	return vec;
 }
 
+bool CRTSceneParser::isNumberArray(const Value& val, SizeType size)
+{
+	if (!val.IsArray() || val.Size() != size)
+		return false;
+
+	for (const Value& element : val.GetArray())
+	{
+		if (!element.IsNumber())
+			return false;
+	}
+
+	return true;
+}
+
 void CRTSceneParser::parseSettings(const Document& doc, CRTScene& scene)
 {
 	const Value& settingsVal = doc.FindMember("settings")->value;
@@ -80,9 +94,10 @@ void CRTSceneParser::parseCamera(const rapidjson::Document& doc, CRTScene& scene
 	//scene.camera.getRotationMatrix().print();
 }
 
-void CRTSceneParser::parseMesh(const rapidjson::Value& val, CRTScene& scene)
+void CRTSceneParser::parseMesh(const rapidjson::Value& val, CRTScene& scene, CRTLoadProfile* profile)
 {
 	CRTMesh mesh;
+	CRTLoadPhaseScope convertPhase(profile, CRTLoadPhase::MESH_CONVERT);
 
 	const Value& uvsVal = val.FindMember("uvs")->value;
 	if (!uvsVal.IsNull() && uvsVal.IsArray())
@@ -128,12 +143,17 @@ void CRTSceneParser::parseMesh(const rapidjson::Value& val, CRTScene& scene)
 	}
 
 	mesh.setMaterialIndex(materialIndex);
-	mesh.calculateVertexNormals();
 
+	{
+		CRTLoadPhaseScope normalsPhase(profile, CRTLoadPhase::VERTEX_NORMALS);
+		mesh.calculateVertexNormals();
+	}
+
+	CRTLoadPhaseScope storePhase(profile, CRTLoadPhase::MESH_STORE);
 	scene.geometryObjects.push_back(mesh); //possible std::move
 }
 
-void CRTSceneParser::parseObjects(const rapidjson::Document& doc, CRTScene& scene)
+void CRTSceneParser::parseObjects(const rapidjson::Document& doc, CRTScene& scene, CRTLoadProfile* profile)
 {
 	const Value& objectsVal = doc.FindMember("objects")->value;
 	if (!objectsVal.IsNull() && objectsVal.IsArray())
@@ -143,7 +163,7 @@ void CRTSceneParser::parseObjects(const rapidjson::Document& doc, CRTScene& scen
 		for (int i = 0; i < objectsCount; i++)
 		{
 			const Value& mesh = objectsVal.GetArray()[i];
-			parseMesh(mesh, scene);
+			parseMesh(mesh, scene, profile);
 		}
 	}
 }
@@ -191,8 +211,83 @@ void CRTSceneParser::parseLight(const rapidjson::Value& val, CRTScene& scene)
 	scene.lights.push_back(light);
 }
 
-void CRTSceneParser::parseTextures(const rapidjson::Document& doc, CRTScene& scene)
+void CRTSceneParser::parseInstances(const rapidjson::Document& doc, CRTScene& scene)
 {
+	scene.instances.reset(static_cast<int>(scene.geometryObjects.size()));
+
+	const auto instancesMember = doc.FindMember("instances");
+	if (instancesMember == doc.MemberEnd() || !instancesMember->value.IsArray())
+		return;
+
+	// Bad instances are skipped, the rest of the scene still loads. The traversal
+	// inverts the transforms by transposing, only rigid ones are accepted.
+	const float rotationTolerance = 1e-3f;
+	const int meshCount = static_cast<int>(scene.geometryObjects.size());
+
+	int instanceIndex = 0;
+	for (const Value& instanceVal : instancesMember->value.GetArray())
+	{
+		const int index = instanceIndex++;
+
+		if (!instanceVal.IsObject())
+		{
+			std::cerr << "Skipping instance " << index << ": not an object" << std::endl;
+			continue;
+		}
+
+		const auto objectIndexMember = instanceVal.FindMember("object_index");
+		if (objectIndexMember == instanceVal.MemberEnd() || !objectIndexMember->value.IsInt())
+		{
+			std::cerr << "Skipping instance " << index << ": missing object_index" << std::endl;
+			continue;
+		}
+
+		const int objectIndex = objectIndexMember->value.GetInt();
+		if (objectIndex < 0 || objectIndex >= meshCount)
+		{
+			std::cerr << "Skipping instance " << index << ": object_index " << objectIndex << " is not one of the " << meshCount << " objects" << std::endl;
+			continue;
+		}
+
+		CRTTransform transform;
+
+		const auto matrixMember = instanceVal.FindMember("matrix");
+		if (matrixMember != instanceVal.MemberEnd())
+		{
+			if (!isNumberArray(matrixMember->value, 9))
+			{
+				std::cerr << "Skipping instance " << index << ": matrix is not 9 numbers" << std::endl;
+				continue;
+			}
+
+			transform.rotation = loadMatrix(matrixMember->value.GetArray());
+			if (!transform.orthonormalize(rotationTolerance))
+			{
+				std::cerr << "Skipping instance " << index << ": matrix is not a rotation" << std::endl;
+				continue;
+			}
+		}
+
+		const auto positionMember = instanceVal.FindMember("position");
+		if (positionMember != instanceVal.MemberEnd())
+		{
+			if (!isNumberArray(positionMember->value, 3))
+			{
+				std::cerr << "Skipping instance " << index << ": position is not 3 numbers" << std::endl;
+				continue;
+			}
+
+			transform.translation = loadVector(positionMember->value.GetArray(), 0);
+		}
+
+		scene.instances.addInstance(objectIndex, transform);
+	}
+}
+
+void CRTSceneParser::parseTextures(const rapidjson::Document& doc, CRTScene& scene, CRTLoadProfile* profile)
+{
+	CRTLoadPhaseScope texturesPhase(profile, CRTLoadPhase::TEXTURES);
+
 	const Value& texturesVal = doc.FindMember("textures")->value;
 
 	if (!texturesVal.IsNull() && texturesVal.IsArray())
@@ -202,12 +297,12 @@ void CRTSceneParser::parseTextures(const rapidjson::Document& doc, CRTScene& sce
 		for (int i = 0; i < texturesCount; i++)
 		{
 			const Value& texture = texturesVal.GetArray()[i];
-			parseTexture(texture, scene);
+			parseTexture(texture, scene, profile);
 		}
 	}
 }
 
-void CRTSceneParser::parseTexture(const rapidjson::Value& val, CRTScene& scene)
+void CRTSceneParser::parseTexture(const rapidjson::Value& val, CRTScene& scene, CRTLoadProfile* profile)
 {
 	CRTTexture* textureToAdd = nullptr;
 	std::string name;
@@ -217,7 +312,11 @@ void CRTSceneParser::parseTexture(const rapidjson::Value& val, CRTScene& scene)
 	{
 		name = nameVal.GetString();
 	}
-	std::cout << "name: " << name << std::endl;
+
+	{
+		CRTLoadPhaseScope loggingPhase(profile, CRTLoadPhase::LOGGING);
+		std::cout << "name: " << name << std::endl;
+	}
 
 	std::string type;
 
@@ -305,8 +404,10 @@ void CRTSceneParser::parseTexture(const rapidjson::Value& val, CRTScene& scene)
 	scene.textures.push_back(textureToAdd);
 }
 
-void CRTSceneParser::parseMaterials(const rapidjson::Document& doc, CRTScene& scene)
+void CRTSceneParser::parseMaterials(const rapidjson::Document& doc, CRTScene& scene, CRTLoadProfile* profile)
 {
+	CRTLoadPhaseScope materialsPhase(profile, CRTLoadPhase::MATERIALS);
+
 	const Value& materialsVal = doc.FindMember("materials")->value;
 
 	if (!materialsVal.IsNull() && materialsVal.IsArray())
@@ -317,7 +418,7 @@ void CRTSceneParser::parseMaterials(const rapidjson::Document& doc, CRTScene& sc
 		for (int i = 0; i < materialsCount; i++)
 		{
 			const Value& material = materialsVal.GetArray()[i];
-			parseMaterial(material, scene);
+			parseMaterial(material, scene, profile);
 		}
 	}
 }
@@ -342,7 +443,7 @@ static CRTMaterialType getMaterialTypeFromString(const std::string& str)
 	return CRTMaterialType::REFRACTIVE;
 }
 
-void CRTSceneParser::parseMaterial(const rapidjson::Value& val, CRTScene& scene)
+void CRTSceneParser::parseMaterial(const rapidjson::Value& val, CRTScene& scene, CRTLoadProfile* profile)
 {
 	CRTMaterialType type;
 	CRTVector albedo;
@@ -392,6 +493,7 @@ void CRTSceneParser::parseMaterial(const rapidjson::Value& val, CRTScene& scene)
 
 	scene.materials.push_back(material);
 
+	CRTLoadPhaseScope loggingPhase(profile, CRTLoadPhase::LOGGING);
 	std::cout << "textureName:\n";
 	std::cout << material.getTextureName() << std::endl;
 	std::cout << "albedo:\n ";
@@ -404,24 +506,75 @@ void CRTSceneParser::parseMaterial(const rapidjson::Value& val, CRTScene& scene)
 	//std::cout << ior << std::endl;
 }
 
-void CRTSceneParser::parseScene(const std::string& sceneFileName, CRTScene& scene)
+bool CRTSceneParser::parseScene(const std::string& sceneFileName, CRTScene& scene, CRTLoadProfile* profile)
 {
-	std::ifstream ifs(sceneFileName);
-	assert(ifs.is_open());
-
-	rapidjson::IStreamWrapper isw(ifs);
 	rapidjson::Document doc;
-	doc.ParseStream(isw);
 
-	parseSettings(doc, scene);
-	parseCamera(doc, scene);
-	parseObjects(doc, scene);
-	parseLights(doc, scene);
-	parseMaterials(doc, scene);
-	parseTextures(doc, scene);
+	{
+		// Read the whole file first, so the I/O and the parse are timed apart
+		std::string json;
+		{
+			CRTLoadPhaseScope readPhase(profile, CRTLoadPhase::FILE_READ);
+
+			std::ifstream ifs(sceneFileName, std::ios::binary | std::ios::ate);
+			const std::streamoff fileSize = ifs.is_open() ? static_cast<std::streamoff>(ifs.tellg()) : -1;
+			if (fileSize < 0)
+			{
+				std::cerr << "Cannot open scene file " << sceneFileName << std::endl;
+				return false;
+			}
+
+			json.resize(static_cast<size_t>(fileSize));
+			ifs.seekg(0);
+			ifs.read(&json[0], json.size());
+			if (!ifs)
+			{
+				std::cerr << "Cannot read scene file " << sceneFileName << std::endl;
+				return false;
+			}
+		}
+
+		if (profile)
+			profile->setFileBytes(json.size());
+
+		CRTLoadPhaseScope parsePhase(profile, CRTLoadPhase::JSON_PARSE);
+		doc.Parse(json.c_str(), json.size());
+		if (doc.HasParseError() || !doc.IsObject())
+		{
+			std::cerr << "Cannot parse scene file " << sceneFileName << " at offset " << doc.GetErrorOffset() << std::endl;
+			return false;
+		}
+	}
+
+	// The document allocates its values from its own pool with malloc
+	if (profile)
+		profile->addAllocatedBytes(CRTLoadPhase::JSON_PARSE, doc.GetAllocator().Capacity());
+
+	{
+		CRTLoadPhaseScope settingsPhase(profile, CRTLoadPhase::SETTINGS);
+		parseSettings(doc, scene);
+		parseCamera(doc, scene);
+	}
+
+	parseObjects(doc, scene, profile);
+
+	{
+		CRTLoadPhaseScope settingsPhase(profile, CRTLoadPhase::SETTINGS);
+		parseInstances(doc, scene);
+	}
+
+	{
+		CRTLoadPhaseScope lightsPhase(profile, CRTLoadPhase::LIGHTS);
+		parseLights(doc, scene);
+	}
+
+	parseMaterials(doc, scene, profile);
+	parseTextures(doc, scene, profile);
 
 	/*for (auto& obj : scene.geometryObjects)
 	{
 		obj.print();
 	}*/
+
+	return true;
 }
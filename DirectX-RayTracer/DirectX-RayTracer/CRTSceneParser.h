@@ -1,5 +1,6 @@
 #pragma once
 #include "CRTScene.h"
+#include "CRTLoadProfile.h"
 #include "rapidjson/istreamwrapper.h"
 #include "rapidjson/document.h"
 
@@ -8,20 +9,26 @@ class CRTSceneParser
 private:
 	static CRTMatrix loadMatrix(const rapidjson::Value::ConstArray& arr);
 	static CRTVector loadVector(const rapidjson::Value::ConstArray& arr, int startIndex);
+	static bool isNumberArray(const rapidjson::Value& val, rapidjson::SizeType size);
 	static void parseSettings(const rapidjson::Document& doc, CRTScene& scene);
 	static void parseCamera(const rapidjson::Document& doc, CRTScene& scene);
-	static void parseMesh(const rapidjson::Value& val, CRTScene& scene);
-	static void parseObjects(const rapidjson::Document& doc, CRTScene& scene);
+	static void parseMesh(const rapidjson::Value& val, CRTScene& scene, CRTLoadProfile* profile);
+	static void parseObjects(const rapidjson::Document& doc, CRTScene& scene, CRTLoadProfile* profile);
 	static void parseLights(const rapidjson::Document& doc, CRTScene& scene);
 	static void parseLight(const rapidjson::Value& val, CRTScene& scene);
 
-	static void parseTextures(const rapidjson::Document& doc, CRTScene& scene);
-	static void parseTexture(const rapidjson::Value& val, CRTScene& scene);
+	// Optional extra placements of the meshes, after the identity instance of every mesh
+	static void parseInstances(const rapidjson::Document& doc, CRTScene& scene);
 
-	static void parseMaterials(const rapidjson::Document& doc, CRTScene& scene);
-	static void parseMaterial(const rapidjson::Value& val, CRTScene& scene);
+	static void parseTextures(const rapidjson::Document& doc, CRTScene& scene, CRTLoadProfile* profile);
+	static void parseTexture(const rapidjson::Value& val, CRTScene& scene, CRTLoadProfile* profile);
+
+	static void parseMaterials(const rapidjson::Document& doc, CRTScene& scene, CRTLoadProfile* profile);
+	static void parseMaterial(const rapidjson::Value& val, CRTScene& scene, CRTLoadProfile* profile);
 
 public:
-	static void parseScene(const std::string& sceneFileName, CRTScene& scene);
+	// With a profile, records the time and allocations of every phase of the load.
+	// Returns false, and leaves the scene empty, when the file cannot be read or parsed.
+	static bool parseScene(const std::string& sceneFileName, CRTScene& scene, CRTLoadProfile* profile = nullptr);
 };
 
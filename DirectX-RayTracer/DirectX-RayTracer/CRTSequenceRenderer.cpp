@@ -0,0 +1,178 @@
+#include "CRTSequenceRenderer.h"
+#include "CRTTrace.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <string>
+
+CRTFrameWriter::CRTFrameWriter(WriteFunction write, int firstFrame, int maxQueuedFrames)
+	: write(std::move(write)), maxQueuedFrames(maxQueuedFrames > 1 ? maxQueuedFrames : 1), nextFrame(firstFrame)
+{
+	thread = std::thread(&CRTFrameWriter::run, this);
+}
+
+CRTFrameWriter::~CRTFrameWriter()
+{
+	finish();
+}
+
+void CRTFrameWriter::push(int frame, CRTImage image)
+{
+	CRT_TRACE_ZONE("Queue frame");
+
+	std::unique_lock<std::mutex> lock(mutex);
+	assert(frame >= nextFrame && pending.find(frame) == pending.end());
+
+	const auto start = std::chrono::steady_clock::now();
+	frameWritten.wait(lock, [&]() { return frame == nextFrame || static_cast<int>(pending.size()) < maxQueuedFrames || failed; });
+	waitSeconds += std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	pending.emplace(frame, std::move(image));
+	frameAdded.notify_one();
+}
+
+bool CRTFrameWriter::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finishing = true;
+	}
+	frameAdded.notify_one();
+
+	if (thread.joinable())
+		thread.join();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return !failed && pending.empty();
+}
+
+float CRTFrameWriter::getWaitSeconds() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return waitSeconds;
+}
+
+int CRTFrameWriter::getWrittenFrames() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return writtenFrames;
+}
+
+void CRTFrameWriter::run()
+{
+	CRT_TRACE_THREAD_NAME("Frame writer");
+
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		frameAdded.wait(lock, [this]() { return pending.count(nextFrame) || finishing; });
+
+		auto found = pending.find(nextFrame);
+		if (found == pending.end())
+			return; // Finishing, whatever is left waits for a frame which never came
+
+		const CRTImage image = std::move(found->second);
+		pending.erase(found);
+
+		// Writing happens outside the lock, the renderers keep pushing meanwhile
+		lock.unlock();
+		bool written;
+		{
+			CRT_TRACE_ZONE("Write frame");
+			written = write(nextFrame, image);
+		}
+		lock.lock();
+
+		nextFrame++;
+		writtenFrames += written;
+		failed = failed || !written;
+		frameWritten.notify_all();
+	}
+}
+
+float CRTSequenceStats::getFramesPerSecond() const
+{
+	return totalSeconds > 0.f ? frames / totalSeconds : 0.f;
+}
+
+CRTSequenceRenderer::CRTSequenceRenderer(const CRTScene& scene)
+	: scene(scene)
+{
+	const auto start = std::chrono::steady_clock::now();
+	accelerationStructure = std::make_unique<CRTAccelerationStructure>(scene);
+	accelerationStructure->update(scene.getInstances());
+	buildSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool CRTSequenceRenderer::render(const CRTCameraPath& path, int firstFrame, int lastFrame, const CRTSequenceSettings& settings,
+	const CRTFrameWriter::WriteFunction& write)
+{
+	CRT_TRACE_ZONE("Render sequence");
+	assert(firstFrame >= 0 && firstFrame <= lastFrame);
+
+	const int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency()) > 0 ? static_cast<int>(std::thread::hardware_concurrency()) : 1;
+	const int frameCount = lastFrame - firstFrame;
+
+	int parallelFrames = settings.parallelFrames > 0 ? settings.parallelFrames : (hardwareThreads < 4 ? hardwareThreads : 4);
+	parallelFrames = parallelFrames < frameCount ? parallelFrames : (frameCount > 0 ? frameCount : 1);
+
+	// Splitting the threads instead of oversubscribing keeps every frame's tiles on their own cores
+	CRTRenderSettings renderSettings = settings.renderSettings;
+	if (renderSettings.threadCount <= 0)
+		renderSettings.threadCount = hardwareThreads / parallelFrames > 1 ? hardwareThreads / parallelFrames : 1;
+
+	stats = CRTSequenceStats();
+	stats.frames = frameCount;
+	stats.parallelFrames = parallelFrames;
+	stats.buildSeconds = buildSeconds;
+	stats.frameSeconds.assign(frameCount, 0.f);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	CRTFrameWriter writer(write, firstFrame, settings.maxQueuedFrames);
+	std::atomic<int> nextFrame{ firstFrame };
+	std::atomic<long long> raysTraced{ 0 };
+
+	// One renderer per parallel frame, reused for the frames it takes, all tracing the shared BVH
+	auto renderFrames = [&](int workerIndex)
+		{
+			CRT_TRACE_THREAD_NAME("Frame worker " + std::to_string(workerIndex));
+
+			CRTRenderer renderer(scene, *accelerationStructure);
+			for (int frame = nextFrame++; frame < lastFrame; frame = nextFrame++)
+			{
+				renderer.render(renderSettings, path.getFrameCamera(frame));
+
+				stats.frameSeconds[frame - firstFrame] = renderer.getStats().renderSeconds;
+				raysTraced += renderer.getStats().raysTraced;
+				writer.push(frame, renderer.getImage());
+			}
+		};
+
+	std::vector<std::thread> workers;
+	for (int i = 1; i < parallelFrames; i++)
+		workers.emplace_back(renderFrames, i);
+
+	renderFrames(0);
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	const bool written = writer.finish();
+
+	stats.totalSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	stats.writerWaitSeconds = writer.getWaitSeconds();
+	stats.raysTraced = raysTraced;
+
+	return written;
+}
+
+const CRTSequenceStats& CRTSequenceRenderer::getStats() const
+{
+	return stats;
+}
+
+const CRTBoundingBox& CRTSequenceRenderer::getSceneBounds() const
+{
+	return accelerationStructure->getBounds();
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CRTCameraPath.h"
+#include "CRTRenderer.h"
+
+// Writes the frames of a sequence on its own thread, in frame order. Frames may
+// be pushed in any order, the ones which arrive early wait for those before them.
+class CRTFrameWriter
+{
+public:
+	// Returns false when the frame could not be written
+	using WriteFunction = std::function<bool(int frame, const CRTImage& image)>;
+
+	// At most maxQueuedFrames wait for writing, after that push blocks, except for
+	// the frame the writer waits for, so the renderers cannot get too far ahead
+	CRTFrameWriter(WriteFunction write, int firstFrame = 0, int maxQueuedFrames = 8);
+	~CRTFrameWriter();
+
+	CRTFrameWriter(const CRTFrameWriter&) = delete;
+	CRTFrameWriter& operator=(const CRTFrameWriter&) = delete;
+
+	void push(int frame, CRTImage image);
+
+	// Writes the frames pushed so far and stops the thread. Returns false when
+	// a write failed or a frame before the last pushed one is missing.
+	bool finish();
+
+	// Time push spent blocked on the full queue
+	float getWaitSeconds() const;
+	int getWrittenFrames() const;
+
+private:
+	void run();
+
+	WriteFunction write;
+	int maxQueuedFrames;
+
+	mutable std::mutex mutex;
+	std::condition_variable frameAdded;
+	std::condition_variable frameWritten;
+	std::map<int, CRTImage> pending;
+	int nextFrame;
+	int writtenFrames = 0;
+	float waitSeconds = 0.f;
+	bool finishing = false;
+	bool failed = false;
+	std::thread thread;
+};
+
+struct CRTSequenceSettings
+{
+	// threadCount is per frame. With 0 the hardware threads are split between the parallel frames.
+	CRTRenderSettings renderSettings;
+
+	// Frames rendered at the same time, 0 for one per hardware thread up to 4
+	int parallelFrames = 0;
+
+	int maxQueuedFrames = 8;
+};
+
+struct CRTSequenceStats
+{
+	int frames = 0;
+	int parallelFrames = 0;
+	float buildSeconds = 0.f; // BVH build, once for the sequence
+	float totalSeconds = 0.f; // Rendering and writing every frame
+	float writerWaitSeconds = 0.f;
+	long long raysTraced = 0;
+	std::vector<float> frameSeconds; // Render time of each frame
+
+	float getFramesPerSecond() const;
+};
+
+// Renders the frames of a camera path. The scene is loaded and its BVH built once,
+// then several frames are rendered at the same time, each by its own CRTRenderer
+// tracing the shared BVH, and handed to a CRTFrameWriter.
+class CRTSequenceRenderer
+{
+public:
+	explicit CRTSequenceRenderer(const CRTScene& scene);
+
+	// Renders frames [firstFrame, lastFrame) of the path, returns false when writing failed
+	bool render(const CRTCameraPath& path, int firstFrame, int lastFrame, const CRTSequenceSettings& settings,
+		const CRTFrameWriter::WriteFunction& write);
+
+	const CRTSequenceStats& getStats() const;
+
+	// Bounds of the whole scene, for placing a turntable around it
+	const CRTBoundingBox& getSceneBounds() const;
+
+private:
+	const CRTScene& scene;
+	std::unique_ptr<CRTAccelerationStructure> accelerationStructure;
+	float buildSeconds = 0.f;
+	CRTSequenceStats stats;
+};
@@ -0,0 +1,111 @@
+#include "CRTShaderCache.h"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// Entry layout: header, then the blob
+struct CRTShaderCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint64_t size;
+	uint64_t blobHash; // Catches truncated or partially written entries
+};
+
+static const uint32_t shaderCacheMagic = 0x48534443; // "CDSH"
+static const uint32_t shaderCacheVersion = 1;
+
+CRTShaderCache::CRTShaderCache(const std::string& directory) : directory(directory)
+{
+}
+
+uint64_t CRTShaderCache::hash(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t result = seed;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		result ^= bytes[i];
+		result *= 1099511628211ull;
+	}
+
+	return result;
+}
+
+uint64_t CRTShaderCache::makeKey(const std::vector<uint8_t>& source, const std::string& flags, const std::string& compilerVersion)
+{
+	const uint64_t sourceHash = hash(source.data(), source.size());
+	const uint64_t flagsHash = hash(flags.data(), flags.size(), sourceHash);
+
+	// A separator keeps the end of the flags apart from the start of the version
+	const char separator = '\0';
+	return hash(compilerVersion.data(), compilerVersion.size(), hash(&separator, 1, flagsHash));
+}
+
+bool CRTShaderCache::load(uint64_t key, std::vector<uint8_t>& blob)
+{
+	std::ifstream file(getPath(key), std::ios::binary);
+
+	CRTShaderCacheHeader header = {};
+	if (file && file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+		header.magic == shaderCacheMagic && header.version == shaderCacheVersion && header.key == key)
+	{
+		blob.resize(header.size);
+		if (file.read(reinterpret_cast<char*>(blob.data()), blob.size()) &&
+			hash(blob.data(), blob.size()) == header.blobHash)
+		{
+			hitCount++;
+			return true;
+		}
+	}
+
+	blob.clear();
+	missCount++;
+	return false;
+}
+
+bool CRTShaderCache::store(uint64_t key, const void* data, size_t size)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	// Written under a temporary name, so a crash never leaves a half entry behind
+	const std::string path = getPath(key);
+	const std::string tempPath = path + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		const CRTShaderCacheHeader header = { shaderCacheMagic, shaderCacheVersion, key, size, hash(data, size) };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(static_cast<const char*>(data), size);
+
+		if (!file)
+			return false;
+	}
+
+	std::filesystem::rename(tempPath, path, error);
+	return !error;
+}
+
+std::string CRTShaderCache::getPath(uint64_t key) const
+{
+	std::ostringstream path;
+	path << directory << '/' << std::hex << std::setw(16) << std::setfill('0') << key << ".dxil";
+	return path.str();
+}
+
+int CRTShaderCache::getHitCount() const
+{
+	return hitCount;
+}
+
+int CRTShaderCache::getMissCount() const
+{
+	return missCount;
+}
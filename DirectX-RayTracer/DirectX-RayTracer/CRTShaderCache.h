@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk cache of compiled shader libraries. An entry is keyed by a hash of
+// the source, the compiler flags and the compiler version, so a change of any
+// of them misses the cache and the stale file is simply never read again.
+class CRTShaderCache
+{
+public:
+	explicit CRTShaderCache(const std::string& directory = "ShaderCache");
+
+	// 64-bit FNV-1a, continued from seed
+	static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+	static uint64_t makeKey(const std::vector<uint8_t>& source, const std::string& flags, const std::string& compilerVersion);
+
+	// Returns false if there is no valid entry for the key
+	bool load(uint64_t key, std::vector<uint8_t>& blob);
+
+	bool store(uint64_t key, const void* data, size_t size);
+
+	std::string getPath(uint64_t key) const;
+
+	int getHitCount() const;
+	int getMissCount() const;
+
+private:
+	std::string directory;
+	int hitCount = 0;
+	int missCount = 0;
+};
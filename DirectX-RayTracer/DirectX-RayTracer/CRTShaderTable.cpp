@@ -0,0 +1,41 @@
+#include "CRTShaderTable.h"
+#include <cassert>
+
+uint64_t CRTShaderTableLayout::alignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+int CRTShaderTableLayout::addTable(uint32_t recordCount, uint64_t localArgumentsSize)
+{
+	CRTShaderTableRange table;
+	table.offset = alignUp(size, tableAlignment);
+	table.recordStride = alignUp(identifierSize + localArgumentsSize, recordAlignment);
+	table.recordCount = recordCount;
+
+	tables.push_back(table);
+	size = table.offset + table.getSize();
+
+	return static_cast<int>(tables.size()) - 1;
+}
+
+const CRTShaderTableRange& CRTShaderTableLayout::getTable(int table) const
+{
+	return tables[table];
+}
+
+int CRTShaderTableLayout::getTableCount() const
+{
+	return static_cast<int>(tables.size());
+}
+
+uint64_t CRTShaderTableLayout::getRecordOffset(int table, uint32_t record) const
+{
+	assert(record < tables[table].recordCount);
+	return tables[table].offset + record * tables[table].recordStride;
+}
+
+uint64_t CRTShaderTableLayout::getSize() const
+{
+	return size;
+}
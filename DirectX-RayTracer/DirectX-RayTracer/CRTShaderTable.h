@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Where the records of one shader table live inside the shader binding table
+struct CRTShaderTableRange
+{
+	uint64_t offset = 0;       // From the start of the shader binding table, table aligned
+	uint64_t recordStride = 0; // Identifier plus local root arguments, record aligned
+	uint32_t recordCount = 0;
+
+	uint64_t getSize() const { return recordStride * recordCount; }
+};
+
+// Layout of a shader binding table made of consecutive tables. The D3D12
+// alignment rules are constants here, so the layout is plain arithmetic.
+class CRTShaderTableLayout
+{
+public:
+	static constexpr uint64_t identifierSize = 32;   // D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES
+	static constexpr uint64_t recordAlignment = 32;  // D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT
+	static constexpr uint64_t tableAlignment = 64;   // D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT
+
+	static uint64_t alignUp(uint64_t value, uint64_t alignment);
+
+	// Returns the table index. Every record of the table has localArgumentsSize bytes after its identifier.
+	int addTable(uint32_t recordCount, uint64_t localArgumentsSize);
+
+	const CRTShaderTableRange& getTable(int table) const;
+	int getTableCount() const;
+
+	uint64_t getRecordOffset(int table, uint32_t record) const;
+
+	// Of the whole shader binding table
+	uint64_t getSize() const;
+
+private:
+	std::vector<CRTShaderTableRange> tables;
+	uint64_t size = 0;
+};
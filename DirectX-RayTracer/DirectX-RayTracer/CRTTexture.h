@@ -1,5 +1,6 @@
 #pragma once
-#include "CRTVector.h";
+#include <string>
+#include "CRTVector.h"
 
 class CRTTexture
 {
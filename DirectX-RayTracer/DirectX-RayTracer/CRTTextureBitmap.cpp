@@ -2,12 +2,17 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image/stb_image.h"
 #include <iostream>
+#include <cmath>
+#include "CRTMemory.h"
 
 CRTTextureBitmap::CRTTextureBitmap(const std::string& filepath, const std::string& name)
     : CRTTexture(name)
 {
 
     buffer = stbi_load(filepath.c_str(), &width, &height, &channels, 0);
+
+    if (buffer)
+        CRTMemory::allocate(CRTMemoryCategory::TEXTURE_PIXELS, getPixelBytes());
 }
 
 CRTVector CRTTextureBitmap::getColor(float u, float v) const
@@ -42,5 +47,13 @@ const char* CRTTextureBitmap::getType() const
 
 CRTTextureBitmap::~CRTTextureBitmap()
 {
+    if (buffer)
+        CRTMemory::free(CRTMemoryCategory::TEXTURE_PIXELS, getPixelBytes());
+
     stbi_image_free(buffer);
 }
+
+uint64_t CRTTextureBitmap::getPixelBytes() const
+{
+    return static_cast<uint64_t>(width) * height * channels;
+}
@@ -10,6 +10,8 @@ public:
 
 	~CRTTextureBitmap();
 private:
+	uint64_t getPixelBytes() const;
+
 	int width, height, channels;
 	unsigned char* buffer = nullptr;
 };
@@ -1,4 +1,5 @@
 #include "CRTTextureChecker.h"
+#include <cmath>
 
 CRTTextureChecker::CRTTextureChecker(const CRTVector& colorA, const CRTVector& colorB,
     float squareSize, const std::string& name)
@@ -0,0 +1,202 @@
+#include "CRTTrace.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "rapidjson/ostreamwrapper.h"
+#include "rapidjson/writer.h"
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* name;
+		int64_t startNs;
+		int64_t durationNs;
+	};
+
+	// One lane of the timeline. It belongs to one thread at a time, a thread
+	// which exits gives it back for the next thread of the same name.
+	struct ThreadBuffer
+	{
+		std::string name;
+		bool inUse = true;
+		std::vector<TraceEvent> events = std::vector<TraceEvent>(CRTTrace::eventsPerThread);
+		std::atomic<uint64_t> written{ 0 };
+	};
+
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	};
+
+	Registry& getRegistry()
+	{
+		// Never destroyed, threads may still give their buffers back during exit
+		static Registry* registry = new Registry();
+		return *registry;
+	}
+
+	ThreadBuffer* acquireBuffer(const std::string& name)
+	{
+		Registry& registry = getRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		for (std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+		{
+			if (!buffer->inUse && buffer->name == name)
+			{
+				buffer->inUse = true;
+				return buffer.get();
+			}
+		}
+
+		registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+		registry.buffers.back()->name = name;
+		return registry.buffers.back().get();
+	}
+
+	void releaseBuffer(ThreadBuffer* buffer)
+	{
+		Registry& registry = getRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		buffer->inUse = false;
+	}
+
+	struct ThreadSlot
+	{
+		ThreadBuffer* buffer = nullptr;
+		std::string name;
+
+		~ThreadSlot()
+		{
+			if (buffer)
+				releaseBuffer(buffer);
+		}
+	};
+
+	thread_local ThreadSlot threadSlot;
+
+	const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+}
+
+std::atomic<bool> CRTTrace::enabled{ true };
+
+void CRTTrace::setEnabled(bool value)
+{
+	enabled.store(value, std::memory_order_relaxed);
+}
+
+void CRTTrace::setThreadName(const std::string& name)
+{
+	if (threadSlot.buffer && threadSlot.name == name)
+		return;
+
+	if (threadSlot.buffer)
+		releaseBuffer(threadSlot.buffer);
+
+	threadSlot.name = name;
+	threadSlot.buffer = acquireBuffer(name);
+}
+
+int64_t CRTTrace::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - processStart).count();
+}
+
+void CRTTrace::record(const char* name, int64_t startNs, int64_t endNs)
+{
+	if (!threadSlot.buffer)
+		threadSlot.buffer = acquireBuffer(threadSlot.name);
+
+	ThreadBuffer& buffer = *threadSlot.buffer;
+	const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+
+	buffer.events[index % eventsPerThread] = { name, startNs, endNs - startNs };
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+bool CRTTrace::writeChromeJSON(const std::string& fileName)
+{
+	std::ofstream file(fileName);
+	if (!file)
+		return false;
+
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	rapidjson::OStreamWrapper stream(file);
+	rapidjson::Writer<rapidjson::OStreamWrapper> writer(stream);
+
+	writer.StartObject();
+	writer.Key("displayTimeUnit");
+	writer.String("ms");
+	writer.Key("traceEvents");
+	writer.StartArray();
+
+	for (size_t lane = 0; lane < registry.buffers.size(); lane++)
+	{
+		const ThreadBuffer& buffer = *registry.buffers[lane];
+		const int tid = static_cast<int>(lane) + 1;
+
+		if (!buffer.name.empty())
+		{
+			writer.StartObject();
+			writer.Key("name");
+			writer.String("thread_name");
+			writer.Key("ph");
+			writer.String("M");
+			writer.Key("pid");
+			writer.Int(1);
+			writer.Key("tid");
+			writer.Int(tid);
+			writer.Key("args");
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(buffer.name.c_str());
+			writer.EndObject();
+			writer.EndObject();
+		}
+
+		const uint64_t written = buffer.written.load(std::memory_order_acquire);
+		const uint64_t first = written > eventsPerThread ? written - eventsPerThread : 0;
+
+		for (uint64_t i = first; i < written; i++)
+		{
+			const TraceEvent& event = buffer.events[i % eventsPerThread];
+
+			// Chrome traces are in microseconds
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(event.name);
+			writer.Key("ph");
+			writer.String("X");
+			writer.Key("pid");
+			writer.Int(1);
+			writer.Key("tid");
+			writer.Int(tid);
+			writer.Key("ts");
+			writer.Double(event.startNs / 1000.0);
+			writer.Key("dur");
+			writer.Double(event.durationNs / 1000.0);
+			writer.EndObject();
+		}
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+	file << std::endl;
+
+	return static_cast<bool>(file);
+}
+
+void CRTTrace::clear()
+{
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	for (std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+		buffer->written.store(0, std::memory_order_relaxed);
+}
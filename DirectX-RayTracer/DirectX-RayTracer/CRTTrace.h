@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Timeline of scoped zones for chrome://tracing and ui.perfetto.dev. Each thread
+// records into its own ring buffer without locking, the oldest zones are
+// overwritten once it is full. The CRT_TRACE_* macros compile to nothing
+// unless CRT_ENABLE_TRACING is defined.
+class CRTTrace
+{
+public:
+	// Zones kept per thread before the oldest are overwritten
+	static constexpr uint32_t eventsPerThread = 1 << 16;
+
+	// Pauses or resumes the recording, it is on from the start
+	static void setEnabled(bool enabled);
+	static bool isEnabled()
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	// Names the lane of the calling thread. Threads which take the name of a
+	// thread that has exited continue its lane, like the workers of every pass.
+	static void setThreadName(const std::string& name);
+
+	// Nanoseconds since the start of the process
+	static int64_t now();
+
+	// The name has to outlive the trace, zones keep only the pointer
+	static void record(const char* name, int64_t startNs, int64_t endNs);
+
+	// Chrome trace event JSON of the zones recorded so far. Zones recorded by
+	// other threads while it runs may be incomplete, dump between frames.
+	static bool writeChromeJSON(const std::string& fileName);
+
+	static void clear();
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+// Records the time from its construction to its destruction
+class CRTTraceZone
+{
+public:
+	explicit CRTTraceZone(const char* name) :
+		name(name),
+		startNs(CRTTrace::isEnabled() ? CRTTrace::now() : -1)
+	{
+	}
+
+	~CRTTraceZone()
+	{
+		if (startNs >= 0)
+			CRTTrace::record(name, startNs, CRTTrace::now());
+	}
+
+	CRTTraceZone(const CRTTraceZone&) = delete;
+	CRTTraceZone& operator=(const CRTTraceZone&) = delete;
+
+private:
+	const char* name;
+	int64_t startNs;
+};
+
+#ifdef CRT_ENABLE_TRACING
+#define CRT_TRACE_CONCAT_INNER(a, b) a##b
+#define CRT_TRACE_CONCAT(a, b) CRT_TRACE_CONCAT_INNER(a, b)
+#define CRT_TRACE_ZONE(name) CRTTraceZone CRT_TRACE_CONCAT(traceZone, __LINE__)(name)
+#define CRT_TRACE_THREAD_NAME(name) CRTTrace::setThreadName(name)
+#else
+// sizeof keeps the argument type-checked and its variables used, without evaluating it
+#define CRT_TRACE_ZONE(name) ((void)sizeof(name))
+#define CRT_TRACE_THREAD_NAME(name) ((void)sizeof(name))
+#endif
@@ -1,4 +1,5 @@
 #include "CRTTriangle.h"
+#include <cmath>
 
 CRTTriangle::CRTTriangle(const CRTVector& v0, const CRTVector& v1, const CRTVector& v2)
 {
@@ -19,6 +20,42 @@ const CRTVector& CRTTriangle::getVertex(int index) const
 	return verts[index];
 }
 
+bool CRTTriangle::intersect(const CRTRay& ray, float maxT, float& t, float& u, float& v) const
+{
+	const float epsilon = 1e-8f;
+
+	CRTVector E0 = verts[1] - verts[0];
+	CRTVector E1 = verts[2] - verts[0];
+
+	CRTVector p = cross(ray.getDirection(), E1);
+	float det = dot(E0, p);
+
+	if (std::fabs(det) < epsilon)
+		return false;
+
+	float invDet = 1.f / det;
+	CRTVector toOrigin = ray.getOrigin() - verts[0];
+
+	float hitU = dot(toOrigin, p) * invDet;
+	if (hitU < 0.f || hitU > 1.f)
+		return false;
+
+	CRTVector q = cross(toOrigin, E0);
+	float hitV = dot(ray.getDirection(), q) * invDet;
+	if (hitV < 0.f || hitU + hitV > 1.f)
+		return false;
+
+	float hitT = dot(E1, q) * invDet;
+	if (hitT <= 0.f || hitT >= maxT)
+		return false;
+
+	t = hitT;
+	u = hitU;
+	v = hitV;
+
+	return true;
+}
+
 void CRTTriangle::calculateNormal()
 {
 	CRTVector E0 = verts[1] - verts[0];
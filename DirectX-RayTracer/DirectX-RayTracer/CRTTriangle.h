@@ -1,5 +1,6 @@
 #pragma once
 #include "CRTVector.h"
+#include "CRTRay.h"
 
 class CRTTriangle
 {
@@ -14,6 +15,10 @@ public:
 
 	const CRTVector& getVertex(int index) const;
 
+	// Moller-Trumbore test, two-sided. On a hit closer than maxT fills the
+	// distance and the barycentrics of vertices 1 and 2.
+	bool intersect(const CRTRay& ray, float maxT, float& t, float& u, float& v) const;
+
 	friend bool operator==(const CRTTriangle& lhs, const CRTTriangle& rhs);
 
 private:
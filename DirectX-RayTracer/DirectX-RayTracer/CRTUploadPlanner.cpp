@@ -0,0 +1,87 @@
+#include "CRTUploadPlanner.h"
+#include <cassert>
+#include <cstring>
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+CRTUploadPlanner::CRTUploadPlanner(uint64_t stagingCapacity) : stagingCapacity(stagingCapacity)
+{
+}
+
+int CRTUploadPlanner::add(const void* data, uint64_t size, uint64_t alignment)
+{
+	assert(alignment > 0);
+
+	requests.push_back({ data, size, alignment });
+	return static_cast<int>(requests.size()) - 1;
+}
+
+std::vector<CRTUploadBatch> CRTUploadPlanner::plan() const
+{
+	std::vector<CRTUploadBatch> batches;
+	CRTUploadBatch batch;
+
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		const Request& request = requests[i];
+		if (request.size == 0)
+			continue;
+
+		uint64_t offset = alignUp(batch.stagingSize, request.alignment);
+
+		if (!batch.copies.empty() && offset + request.size > stagingCapacity)
+		{
+			batches.push_back(std::move(batch));
+			batch = CRTUploadBatch();
+			offset = 0;
+		}
+
+		batch.copies.push_back({ static_cast<int>(i), offset, request.size });
+		batch.stagingSize = offset + request.size;
+	}
+
+	if (!batch.copies.empty())
+		batches.push_back(std::move(batch));
+
+	return batches;
+}
+
+int CRTUploadPlanner::execute(CRTUploadDevice& device) const
+{
+	const std::vector<CRTUploadBatch> batches = plan();
+
+	for (const CRTUploadBatch& batch : batches)
+	{
+		uint8_t* staging = static_cast<uint8_t*>(device.mapStaging(batch.stagingSize));
+
+		for (const CRTUploadCopy& copy : batch.copies)
+		{
+			memcpy(staging + copy.stagingOffset, requests[copy.requestIndex].data, copy.size);
+			device.recordCopy(copy.requestIndex, copy.stagingOffset, copy.size);
+		}
+
+		device.submitAndWait();
+	}
+
+	return static_cast<int>(batches.size());
+}
+
+int CRTUploadPlanner::getRequestCount() const
+{
+	return static_cast<int>(requests.size());
+}
+
+uint64_t CRTUploadPlanner::getTotalSize() const
+{
+	uint64_t total = 0;
+
+	for (const Request& request : requests)
+	{
+		total += request.size;
+	}
+
+	return total;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Operations an upload needs from the graphics API. DXRTUploadDevice implements
+// them on D3D12, a mock can record the calls instead.
+class CRTUploadDevice
+{
+public:
+	virtual ~CRTUploadDevice() = default;
+
+	// CPU-writable staging memory of at least size bytes. Only called after the previous batch completed.
+	virtual void* mapStaging(uint64_t size) = 0;
+
+	// Records a copy from the staging memory to the destination of the request
+	virtual void recordCopy(int requestIndex, uint64_t stagingOffset, uint64_t size) = 0;
+
+	// Submits the recorded copies followed by one batch of barriers, then waits for the GPU
+	virtual void submitAndWait() = 0;
+};
+
+struct CRTUploadCopy
+{
+	int requestIndex;
+	uint64_t stagingOffset;
+	uint64_t size;
+};
+
+// Copies sharing one staging buffer and one submission
+struct CRTUploadBatch
+{
+	uint64_t stagingSize = 0;
+	std::vector<CRTUploadCopy> copies;
+};
+
+// Packs many buffer uploads into as few submissions as possible. The data is
+// laid out back to back in one staging buffer which is reused between batches.
+class CRTUploadPlanner
+{
+public:
+	static constexpr uint64_t defaultStagingCapacity = 64ull << 20;
+
+	explicit CRTUploadPlanner(uint64_t stagingCapacity = defaultStagingCapacity);
+
+	// Returns the request index passed to CRTUploadDevice::recordCopy.
+	// The data has to stay valid until execute returns.
+	int add(const void* data, uint64_t size, uint64_t alignment = 16);
+
+	// Requests in the order they were added. A batch ends when the next request
+	// does not fit the staging capacity, a bigger request gets a batch of its own.
+	std::vector<CRTUploadBatch> plan() const;
+
+	// Returns the number of submissions
+	int execute(CRTUploadDevice& device) const;
+
+	int getRequestCount() const;
+	uint64_t getTotalSize() const;
+
+private:
+	struct Request
+	{
+		const void* data;
+		uint64_t size;
+		uint64_t alignment;
+	};
+
+	uint64_t stagingCapacity;
+	std::vector<Request> requests;
+};
@@ -99,6 +99,20 @@ CRTVector operator*(float scalar, const CRTVector& vec)
 	);
 }
 
+CRTVector operator*(const CRTVector& lhs, const CRTVector& rhs)
+{
+	return CRTVector(lhs.x * rhs.x, lhs.y * rhs.y, lhs.z * rhs.z);
+}
+
+CRTVector& CRTVector::operator+=(const CRTVector& rhs)
+{
+	x += rhs.x;
+	y += rhs.y;
+	z += rhs.z;
+
+	return *this;
+}
+
 void CRTVector::print(std::ostream& os) const
 {
 	os << "( " << x << ", " << y << ", " << z << " )" << std::endl;
@@ -23,6 +23,11 @@ public:
 	friend CRTVector operator*(const CRTVector& vec, float scalar);
 	friend CRTVector operator*(float scalar, const CRTVector& vec);
 
+	// Component-wise product, used for colors
+	friend CRTVector operator*(const CRTVector& lhs, const CRTVector& rhs);
+
+	CRTVector& operator+=(const CRTVector& rhs);
+
 	friend CRTVector cross(const CRTVector& lhs, const CRTVector& rhs);
 	friend float dot(const CRTVector& lhs, const CRTVector& rhs);
 	friend bool operator==(const CRTVector& lhs, const CRTVector& rhs);
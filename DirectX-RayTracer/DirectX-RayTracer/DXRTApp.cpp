@@ -1,8 +1,15 @@
 #include "DXRTApp.h"
+#include "CRTDenoiser.h"
+#include "CRTRenderer.h"
+#include "CRTDebugShading.h"
+#include "CRTTrace.h"
+#include "CRTMemory.h"
 #include <iostream>
 
 bool DXRTApp::init()
 {
+	CRT_TRACE_THREAD_NAME("Main");
+
 	if (false == initWindow())
 	{
 		return false;
@@ -13,13 +20,18 @@ bool DXRTApp::init()
 
 	mainWnd->show();
 
+	// The output follows the viewport from now on, instead of the scene settings
+	const DXRTViewportWidget* viewport = mainWnd->getViewport();
+	const qreal pixelRatio = viewport->devicePixelRatioF();
+	resizeViewport(qRound(viewport->width() * pixelRatio), qRound(viewport->height() * pixelRatio));
+
 	idleTimer = new QTimer(mainWnd);
 	connect(idleTimer, &QTimer::timeout, this, &DXRTApp::onIdleTick);
 	idleTimer->start(0);
 
 	fpsTimer = new QTimer(mainWnd);
 	connect(fpsTimer, &QTimer::timeout, this, &DXRTApp::updateRenderStats);
-	fpsTimer->start(1'000);
+	fpsTimer->start(250);
 
 	frameTimer.start();
 
@@ -55,6 +67,84 @@ void DXRTApp::setShadingMode(uint32_t value)
 	renderer.changeShadingMode(value);
 }
 
+void DXRTApp::resizeViewport(int width, int height)
+{
+	renderer.resize(width, height);
+}
+
+void DXRTApp::setDynamicResolution(bool enabled)
+{
+	renderer.setDynamicResolution(enabled);
+}
+
+void DXRTApp::setTargetFPS(int fps)
+{
+	frameBudgetEnabled = fps > 0;
+	frameBudget.reset();
+
+	if (frameBudgetEnabled)
+		frameBudget.setTargetFrameSeconds(1.f / fps);
+
+	renderer.setBudgetScale(frameBudget.getScale());
+}
+
+void DXRTApp::renderOnCPU()
+{
+	CRTRenderer cpuRenderer(renderer.getScene());
+	cpuRenderer.render(CRTRenderSettings());
+
+	const CRTRenderStats& stats = cpuRenderer.getStats();
+	std::cout << "CPU render: " << stats.renderSeconds << " s, " << stats.passes << " passes, "
+		<< stats.totalSamples << " samples" << std::endl;
+
+	cpuRenderer.getImage().writePPM("cpu_render.ppm");
+	cpuRenderer.getSampleHeatmap().writePPM("cpu_render_samples.ppm");
+
+	CRTImage denoised;
+	if (!CRTDenoiser().denoise(cpuRenderer.getImage(), cpuRenderer.getAOVs(), denoised))
+		std::cout << "No denoiser guides in the CPU render, the denoised image is the color" << std::endl;
+	denoised.writePPM("cpu_render_denoised.ppm");
+
+	// The shading mode of the viewport, through the CPU kernel of the same mode
+	CRTImage debugView;
+	CRTDebugRenderer(renderer.getScene()).render(static_cast<CRTShadingMode>(renderer.getShadingMode()), debugView);
+	debugView.writePPM("cpu_debug_view.ppm");
+}
+
+void DXRTApp::exportTrace()
+{
+	if (CRTTrace::writeChromeJSON("trace.json"))
+		std::cout << "Trace written to trace.json, open it in chrome://tracing or ui.perfetto.dev" << std::endl;
+}
+
+void DXRTApp::exportFrameStats()
+{
+	if (frameStats.writeCSV("frame_stats.csv") && frameStats.writeJSON("frame_stats.json"))
+		std::cout << "Frame stats of " << frameStats.getFrameCount() << " frames written to frame_stats.csv and frame_stats.json" << std::endl;
+}
+
+void DXRTApp::printMemoryReport()
+{
+	CRTMemory::print(std::cout);
+}
+
+void DXRTApp::exportAOVs()
+{
+	renderer.changeAOVMask(CRTAOVMask::all);
+	renderer.renderFrame();
+
+	CRTAOVBuffers aovs;
+	renderer.readbackAOVs(aovs);
+	renderer.changeAOVMask(0);
+
+	aovs.visualise(CRTAOVMask::depth).writePPM("aov_depth.ppm");
+	aovs.visualise(CRTAOVMask::normal).writePPM("aov_normal.ppm");
+	aovs.visualise(CRTAOVMask::barycentrics).writePPM("aov_barycentrics.ppm");
+	aovs.visualise(CRTAOVMask::primitiveID).writePPM("aov_primitive_id.ppm");
+	aovs.visualise(CRTAOVMask::instanceID).writePPM("aov_instance_id.ppm");
+	aovs.visualise(CRTAOVMask::albedo).writePPM("aov_albedo.ppm");
+}
+
 float DXRTApp::getCameraMoveSpeed() const
 {
 	return cameraMoveSpeed;
@@ -76,21 +166,18 @@ bool DXRTApp::initWindow()
 void DXRTApp::renderFrame()
 {
 	renderer.renderFrame();
-	frameIdxAtLastFPSCalc++;
 }
 
 void DXRTApp::updateRenderStats()
 {
-	static int previousFrame = 0;
-	int current = frameIdxAtLastFPSCalc;
-	int fps = current - previousFrame;
-	previousFrame = current;
-
-	mainWnd->setFPS(fps);
+	mainWnd->setFrameStats(frameStats);
+	mainWnd->setRenderScale(renderer.getRenderScale());
 }
 
 void DXRTApp::updateCameraMovement(const QSet<int>& keys, float dt)
 {
+	CRT_TRACE_ZONE("updateCameraMovement");
+
 	auto& cam = renderer.getScene().getCamera();
 
 	if (keys.contains(Qt::Key_W))
@@ -108,13 +195,35 @@ void DXRTApp::updateCameraMovement(const QSet<int>& keys, float dt)
 
 void DXRTApp::onIdleTick()
 {
+	CRT_TRACE_ZONE("onIdleTick");
+
 	// Compute deltaTime in seconds
-	deltaTime = frameTimer.elapsed() / 1000.f; // milliseconds -> seconds
+	deltaTime = frameTimer.nsecsElapsed() / 1e9f; // nanoseconds -> seconds
 	frameTimer.restart();
+
+	// The previous tick ran until now
+	if (hasLastFrame)
+	{
+		lastFrame.frameSeconds = deltaTime;
+		frameStats.addFrame(lastFrame);
+	}
+
+	// The frames in flight keep the loop at the GPU frame rate, so the tick interval is the frame time
+	if (frameBudgetEnabled)
+		renderer.setBudgetScale(frameBudget.addFrame(deltaTime, renderer.getRenderScale()));
 	
 	const QSet<int>& keys = mainWnd->getViewport()->getPressedKeys();
 
 	updateCameraMovement(keys, deltaTime);
 
 	renderFrame();
+
+	// The waits are not CPU work, they are reported separately
+	lastFrame = CRTFrameSample();
+	lastFrame.gpuWaitSeconds = renderer.getLastGPUWaitSeconds();
+	lastFrame.presentSeconds = renderer.getLastPresentSeconds();
+	const float tickSeconds = frameTimer.nsecsElapsed() / 1e9f;
+	const float workSeconds = tickSeconds - lastFrame.gpuWaitSeconds - lastFrame.presentSeconds;
+	lastFrame.cpuSeconds = workSeconds > 0.f ? workSeconds : 0.f;
+	hasLastFrame = true;
 }
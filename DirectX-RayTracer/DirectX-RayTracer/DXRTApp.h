@@ -4,6 +4,8 @@
 #include "DXRTMainWindow.h"
 #include <QTimer>
 #include <QElapsedTimer>
+#include "CRTFrameBudget.h"
+#include "CRTFrameStats.h"
 
 class DXRTApp : public QObject
 {
@@ -34,6 +36,29 @@ public:
 
 	void setShadingMode(uint32_t value);
 
+	// The viewport was resized, in physical pixels
+	void resizeViewport(int width, int height);
+
+	void setDynamicResolution(bool enabled);
+
+	// Lower the render resolution to keep the frame rate, 0 disables it
+	void setTargetFPS(int fps);
+
+	// Render the current view with the CPU ray tracer and save it next to the executable
+	void renderOnCPU();
+
+	// Render one GPU frame with every AOV enabled and save them next to the executable
+	void exportAOVs();
+
+	// Write the recorded trace zones next to the executable, as Chrome trace JSON
+	void exportTrace();
+
+	// Write the frame history next to the executable, as CSV and JSON
+	void exportFrameStats();
+
+	// Print the current and peak memory of every category
+	void printMemoryReport();
+
 	float getMouseScrollSpeed() { return mouseScrollSpeed; }
 	float getCameraMoveSpeed() const;
 	float getCameraMouseSensitivity() const;
@@ -44,19 +69,25 @@ private:
 	// Initiate frame rendering and consume the result
 	void renderFrame();
 
-	// Update the rendering stats based on the FPS timer
+	// Show the frame stats in the main window, on the stats timer
 	void updateRenderStats();
 
 private:
 	DXRTRenderer renderer; // The actual GPU DX 12 renderer
 	DXRTMainWindow* mainWnd = nullptr; // The main window for the editor
 	QTimer* idleTimer = nullptr; // The timer for implementing the rendering loop 
-	QTimer* fpsTimer = nullptr; // The timer to track the FPS value
-	int frameIdxAtLastFPSCalc = 0;
+	QTimer* fpsTimer = nullptr; // The timer to refresh the frame stats in the window
 
 	QElapsedTimer frameTimer; // tracks time between frames
 	float deltaTime = 0.f;
 
+	CRTFrameStats frameStats; // History of the recent frames
+	CRTFrameSample lastFrame; // Completed once the next tick knows its frame time
+	bool hasLastFrame = false;
+
+	CRTFrameBudget frameBudget; // Render scale which keeps the frame time on target
+	bool frameBudgetEnabled = false;
+
 	// Camera control
 	float cameraMoveSpeed = 10.f;      // units per second
 	float cameraMouseSensitivity = 0.1f; // degrees per pixel
@@ -0,0 +1,39 @@
+#include "DXRTFrameFence.h"
+#include <cassert>
+
+DXRTFrameFence::DXRTFrameFence(ID3D12Device* device)
+{
+	HRESULT hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
+	assert(SUCCEEDED(hr));
+
+	eventHandle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	assert(eventHandle);
+}
+
+DXRTFrameFence::~DXRTFrameFence()
+{
+	if (eventHandle)
+		CloseHandle(eventHandle);
+}
+
+void DXRTFrameFence::signal(ID3D12CommandQueue* commandQueue, uint64_t value)
+{
+	HRESULT hr = commandQueue->Signal(fence, value);
+	assert(SUCCEEDED(hr));
+}
+
+uint64_t DXRTFrameFence::getCompletedValue() const
+{
+	return fence->GetCompletedValue();
+}
+
+void DXRTFrameFence::waitForValue(uint64_t value)
+{
+	if (fence->GetCompletedValue() >= value)
+		return;
+
+	HRESULT hr = fence->SetEventOnCompletion(value, eventHandle);
+	assert(SUCCEEDED(hr));
+
+	WaitForSingleObject(eventHandle, INFINITE);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "DXRTRenderer.h"
+#include "CRTFramePacer.h"
+
+// Fence the frames in flight are paced with
+class DXRTFrameFence : public CRTFenceQueue
+{
+public:
+	explicit DXRTFrameFence(ID3D12Device* device);
+
+	~DXRTFrameFence();
+
+	DXRTFrameFence(const DXRTFrameFence&) = delete;
+	DXRTFrameFence& operator=(const DXRTFrameFence&) = delete;
+
+	void signal(ID3D12CommandQueue* commandQueue, uint64_t value);
+
+	uint64_t getCompletedValue() const override;
+	void waitForValue(uint64_t value) override;
+
+private:
+	ID3D12FencePtr fence;
+	HANDLE eventHandle = nullptr;
+};
@@ -0,0 +1,60 @@
+#include "DXRTFrameGraphWidget.h"
+#include <QPainter>
+#include "CRTFrameStats.h"
+
+static const int barWidth = 2;
+
+DXRTFrameGraphWidget::DXRTFrameGraphWidget(QWidget* parent)
+	: QWidget(parent)
+{
+	setMinimumHeight(80);
+	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+void DXRTFrameGraphWidget::setFrameStats(const CRTFrameStats* frameStats)
+{
+	stats = frameStats;
+	update();
+}
+
+void DXRTFrameGraphWidget::paintEvent(QPaintEvent*)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), QColor(24, 24, 24));
+
+	if (!stats || stats->getFrameCount() == 0)
+		return;
+
+	// Keeps the 30 FPS line in view, spikes above the scale are clipped
+	const double p99 = stats->getPercentile(CRTFrameMetric::FRAME, 99.0);
+	const double scaleSeconds = p99 * 1.2 > 1.0 / 30.0 ? p99 * 1.2 : 1.0 / 30.0;
+	const int graphHeight = height();
+
+	auto toY = [&](double seconds)
+		{
+			const double y = graphHeight - seconds / scaleSeconds * graphHeight;
+			return y < 0.0 ? 0 : static_cast<int>(y);
+		};
+
+	const size_t frameCount = stats->getFrameCount();
+	const size_t visibleFrames = static_cast<size_t>(width() / barWidth);
+	const size_t first = frameCount > visibleFrames ? frameCount - visibleFrames : 0;
+
+	for (size_t i = first; i < frameCount; i++)
+	{
+		const CRTFrameSample& frame = stats->getFrame(i);
+		const int x = width() - static_cast<int>(frameCount - i) * barWidth;
+		const int y = toY(frame.frameSeconds);
+
+		painter.fillRect(x, y, barWidth, graphHeight - y, frame.hitch ? QColor(220, 60, 60) : QColor(80, 170, 90));
+	}
+
+	painter.setPen(QPen(QColor(200, 200, 200, 120), 1, Qt::DashLine));
+	painter.drawLine(0, toY(1.0 / 60.0), width(), toY(1.0 / 60.0));
+	painter.drawLine(0, toY(1.0 / 30.0), width(), toY(1.0 / 30.0));
+
+	const int p95Y = toY(stats->getPercentile(CRTFrameMetric::FRAME, 95.0));
+	painter.setPen(QPen(QColor(230, 180, 60), 1));
+	painter.drawLine(0, p95Y, width(), p95Y);
+	painter.drawText(4, p95Y - 2, "p95");
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <QWidget>
+
+class CRTFrameStats;
+
+// Bar graph of the recent frame times, newest on the right. Hitches are drawn
+// in red, the 60 and 30 FPS budgets and the 95th percentile as lines.
+class DXRTFrameGraphWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit DXRTFrameGraphWidget(QWidget* parent = nullptr);
+
+    // The graph reads the stats when it repaints, they have to outlive it
+    void setFrameStats(const CRTFrameStats* stats);
+
+protected:
+    void paintEvent(QPaintEvent*) override;
+
+private:
+    const CRTFrameStats* stats = nullptr;
+};
@@ -31,11 +31,16 @@ DXRTMainWindow::DXRTMainWindow(DXRTApp* app, QWidget* parent)
     statusLayout->setSpacing(10);
     statusFPS = new QLabel("FPS: 0", statusBar);
     statusLayout->addWidget(statusFPS);
+    statusScale = new QLabel("Scale: 100%", statusBar);
+    statusLayout->addWidget(statusScale);
+    statusHitches = new QLabel("Hitches: 0", statusBar);
+    statusLayout->addWidget(statusHitches);
     statusLayout->addStretch();
     mainLayout->addWidget(statusBar, 0);
 
     createMenusAndToolbars();
     createCameraControlsDock(); // <-- create sliders dock
+    createFrameStatsDock();
 }
 
 void DXRTMainWindow::createCameraControlsDock()
@@ -119,11 +124,51 @@ void DXRTMainWindow::createCameraControlsDock()
             int mode = shadingModeComboBox->itemData(index).toInt();
             app->setShadingMode(mode);
         });
+
+    // --- Dynamic Resolution ---
+    dynamicResolutionCheckBox = new QCheckBox("Reduce while moving");
+    layout->addRow("Dynamic Resolution:", dynamicResolutionCheckBox);
+
+    connect(dynamicResolutionCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        app->setDynamicResolution(checked);
+        });
+
+    // --- Frame Budget ---
+    targetFPSSpinBox = new QSpinBox();
+    targetFPSSpinBox->setRange(0, 240);
+    targetFPSSpinBox->setValue(0);
+    targetFPSSpinBox->setSpecialValueText("Off");
+    layout->addRow("Target FPS:", targetFPSSpinBox);
+
+    connect(targetFPSSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int val) {
+        app->setTargetFPS(val);
+        });
 }
 
 
 
 
+void DXRTMainWindow::createFrameStatsDock()
+{
+    QDockWidget* dock = new QDockWidget("Frame Stats", this);
+    QWidget* dockWidget = new QWidget(dock);
+
+    QVBoxLayout* layout = new QVBoxLayout(dockWidget);
+    layout->setContentsMargins(6, 6, 6, 6);
+    layout->setSpacing(4);
+
+    frameGraph = new DXRTFrameGraphWidget(dockWidget);
+    layout->addWidget(frameGraph);
+
+    frameTimesLabel = new QLabel(dockWidget);
+    layout->addWidget(frameTimesLabel);
+    frameWaitsLabel = new QLabel(dockWidget);
+    layout->addWidget(frameWaitsLabel);
+
+    dock->setWidget(dockWidget);
+    addDockWidget(Qt::RightDockWidgetArea, dock);
+}
+
 HWND DXRTMainWindow::getNativeWindowHandle()
 {
     return viewport->getNativeWindowHandle();
@@ -134,9 +179,26 @@ DXRTViewportWidget* DXRTMainWindow::getViewport()
     return viewport;
 }
 
-void DXRTMainWindow::setFPS(const int fps)
+void DXRTMainWindow::setFrameStats(const CRTFrameStats& stats)
+{
+    statusFPS->setText(QString("FPS: %1").arg(qRound(stats.getFramesPerSecond())));
+    statusHitches->setText(QString("Hitches: %1").arg(stats.getTotalHitchCount()));
+
+    auto ms = [&](CRTFrameMetric metric, double percentile) {
+        return QString::number(stats.getPercentile(metric, percentile) * 1000.0, 'f', 2);
+        };
+
+    frameTimesLabel->setText(QString("Frame ms  p50 %1  p95 %2  p99 %3")
+        .arg(ms(CRTFrameMetric::FRAME, 50.0), ms(CRTFrameMetric::FRAME, 95.0), ms(CRTFrameMetric::FRAME, 99.0)));
+    frameWaitsLabel->setText(QString("p95 ms  CPU %1  GPU wait %2  Present %3")
+        .arg(ms(CRTFrameMetric::CPU, 95.0), ms(CRTFrameMetric::GPU_WAIT, 95.0), ms(CRTFrameMetric::PRESENT, 95.0)));
+
+    frameGraph->setFrameStats(&stats);
+}
+
+void DXRTMainWindow::setRenderScale(const float scale)
 {
-    statusFPS->setText(QString("FPS: %1").arg(fps));
+    statusScale->setText(QString("Scale: %1%").arg(qRound(scale * 100.0f)));
 }
 
 void DXRTMainWindow::updateViewport(const QImage& image)
@@ -162,6 +224,25 @@ void DXRTMainWindow::createMenusAndToolbars()
     viewMenu->addAction("Reset View");
 
     QToolBar* toolbar = addToolBar("Main Toolbar");
-    toolbar->addAction("Render");
+    QAction* renderAction = toolbar->addAction("Render");
+    connect(renderAction, &QAction::triggered, this, [this]() {
+        app->renderOnCPU();
+        });
+    QAction* aovAction = toolbar->addAction("AOVs");
+    connect(aovAction, &QAction::triggered, this, [this]() {
+        app->exportAOVs();
+        });
+    QAction* frameStatsAction = toolbar->addAction("Frame Stats");
+    connect(frameStatsAction, &QAction::triggered, this, [this]() {
+        app->exportFrameStats();
+        });
+    QAction* memoryAction = toolbar->addAction("Memory");
+    connect(memoryAction, &QAction::triggered, this, [this]() {
+        app->printMemoryReport();
+        });
+    QAction* traceAction = toolbar->addAction("Trace");
+    connect(traceAction, &QAction::triggered, this, [this]() {
+        app->exportTrace();
+        });
     toolbar->addAction("Settings");
 }
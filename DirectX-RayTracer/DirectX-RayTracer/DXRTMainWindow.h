@@ -7,6 +7,9 @@
 #include "DXRTViewportWidget.h"
 #include <QSpinBox>
 #include <QComboBox>
+#include <QCheckBox>
+#include "DXRTFrameGraphWidget.h"
+#include "CRTFrameStats.h"
 
 class DXRTApp;
 
@@ -17,7 +20,8 @@ class DXRTMainWindow : public QMainWindow
 public:
     DXRTMainWindow(DXRTApp* app, QWidget* parent = nullptr);
 
-    void setFPS(const int fps);
+    void setFrameStats(const CRTFrameStats& stats);
+    void setRenderScale(const float scale);
     void updateViewport(const QImage& image);
     HWND getNativeWindowHandle();
     DXRTViewportWidget* getViewport();
@@ -26,12 +30,15 @@ public:
 private:
     void createMenusAndToolbars();
     void createCameraControlsDock(); // <-- new
+    void createFrameStatsDock();
 
 private:
     QGridLayout* mainLayout = nullptr;
     DXRTViewportWidget* viewport = nullptr;
     QWidget* statusBar = nullptr;
     QLabel* statusFPS = nullptr;
+    QLabel* statusScale = nullptr;
+    QLabel* statusHitches = nullptr;
     DXRTApp* app = nullptr;
 
     // Camera controls
@@ -43,5 +50,12 @@ private:
     QSpinBox* mouseScrollSpeedSpinBox = nullptr;
 
     QComboBox* shadingModeComboBox = nullptr;
+    QCheckBox* dynamicResolutionCheckBox = nullptr;
+    QSpinBox* targetFPSSpinBox = nullptr;
+
+    // Frame stats
+    DXRTFrameGraphWidget* frameGraph = nullptr;
+    QLabel* frameTimesLabel = nullptr;
+    QLabel* frameWaitsLabel = nullptr;
 
 };
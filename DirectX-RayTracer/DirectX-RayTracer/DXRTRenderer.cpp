@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <DXGItype.h>
 #include <fstream>
+#include <chrono>
 #include <directx/d3dx12_core.h> // Helper structs, like CD3DX12_HEAP_PROPERTIES
 #include <directx/d3dx12.h>
 
@@ -18,6 +19,44 @@
 using Microsoft::WRL::ComPtr;
 
 #include "CRTMesh.h"
+#include "DXRTUploadDevice.h"
+#include "DXRTFrameFence.h"
+#include "CRTTrace.h"
+
+// Closest hit shaders and hit groups of the shading modes, in CRTShadingMode order
+static const LPCWSTR shadingModeClosestHits[] =
+{
+	L"closestHitTriangleColors",
+	L"closestHitObjectSpatial",
+	L"closestHitObjectTriangleShades",
+	L"closestHitBarycentrics",
+	L"closestHitHeightGradient",
+	L"closestHitCameraDistance",
+	L"closestHitChecker"
+};
+
+static const LPCWSTR shadingModeHitGroups[] =
+{
+	L"HitGroupTriangleColors",
+	L"HitGroupObjectSpatial",
+	L"HitGroupObjectTriangleShades",
+	L"HitGroupBarycentrics",
+	L"HitGroupHeightGradient",
+	L"HitGroupCameraDistance",
+	L"HitGroupChecker"
+};
+
+// Formats of the AOV targets, in CRTAOVMask bit order. All of them are
+// 32-bit per channel, so the readback copies values without conversion.
+static const DXGI_FORMAT aovFormats[] =
+{
+	DXGI_FORMAT_R32_FLOAT,			// Depth
+	DXGI_FORMAT_R32G32B32A32_FLOAT, // Normal
+	DXGI_FORMAT_R32G32B32A32_FLOAT, // Barycentrics
+	DXGI_FORMAT_R32_UINT,			// Primitive ID
+	DXGI_FORMAT_R32_UINT,			// Instance ID
+	DXGI_FORMAT_R32G32B32A32_FLOAT	// Albedo
+};
 
 DXRTRenderer::DXRTRenderer()
 {
@@ -32,6 +71,13 @@ DXRTRenderer::DXRTRenderer()
 #endif // _DEBUG
 }
 
+DXRTRenderer::~DXRTRenderer()
+{
+	// The frames in flight still use the resources released with the renderer
+	if (frameFence)
+		framePacer.waitForIdle(*frameFence);
+}
+
 void DXRTRenderer::render()
 {
 	//prepareForRendering();
@@ -43,28 +89,38 @@ void DXRTRenderer::render()
 
 void DXRTRenderer::prepareForRendering(HWND hwnd)
 {
+	const auto startupStart = std::chrono::steady_clock::now();
+
 	createDevice();
 	createCommandsManagers();
 	createFence();
+
+	createScene();
+	resolution.setOutputSize(scene->getSettings().imageWidth, scene->getSettings().imageHeight);
+
 	createSwapChain(hwnd);
 	createDescriptorHeapForSwapChain();
 	createRenderTargetViewsFromSwapChain();
+	createFrameResources();
 
-	createScene();
-	createCameraBuffer();
-	createDebugCB();
-
-	createVertexBuffers();
-	createIndexBuffers();
+	createGeometryBuffers();
 	createAccelerationStructures();
 
 	prepareForRayTracing();
+
+	std::cout << "Startup: " << std::chrono::duration<float, std::milli>(
+		std::chrono::steady_clock::now() - startupStart).count() << " ms" << std::endl;
+
+	CRTMemory::print(std::cout);
 }
 
 void DXRTRenderer::prepareForRayTracing()
 {
 	createGlobalRootSignature();
+	createLocalRootSignature();
 	createRayTracingPipelineState();
+	createAOVTextures();
+	createMaterialAlbedoBuffer();
 	createRayTracingShaderTexture();
 	createShaderBindingTable();
 }
@@ -178,8 +234,8 @@ void DXRTRenderer::createFence()
 void DXRTRenderer::createSwapChain(HWND hwnd)
 {
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc{};
-	swapChainDesc.Width = 1920;
-	swapChainDesc.Height = 1080;
+	swapChainDesc.Width = resolution.getOutputWidth();
+	swapChainDesc.Height = resolution.getOutputHeight();
 	swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 	swapChainDesc.BufferCount = 2;
 	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
@@ -213,6 +269,7 @@ void DXRTRenderer::createRenderTargetViewsFromSwapChain()
 		rtvHandles[scBuffIdx] = swapChainRTVHeap->GetCPUDescriptorHandleForHeapStart();
 		rtvHandles[scBuffIdx].ptr += scBuffIdx * rtvDescriptorSize;
 		d3d12Device->CreateRenderTargetView(renderTargets[scBuffIdx], nullptr, rtvHandles[scBuffIdx]);
+		trackResource(&renderTargets[scBuffIdx], renderTargets[scBuffIdx], CRTMemoryCategory::GPU_RESOURCES);
 	}
 }
 
@@ -223,13 +280,17 @@ void DXRTRenderer::createDescriptorHeapForSwapChain()
 	rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
 	rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 
-	assert(SUCCEEDED(d3d12Device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&swapChainRTVHeap))));
+	const HRESULT hr = d3d12Device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&swapChainRTVHeap));
+	assert(SUCCEEDED(hr));
+	trackDescriptorHeap(&swapChainRTVHeap, swapChainRTVHeap);
 
 	rtvDescriptorSize = d3d12Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 }
 
 void DXRTRenderer::waitForGPURenderFrame()
 {
+	CRT_TRACE_ZONE("waitForGPURenderFrame");
+
 	if (renderFramefence->GetCompletedValue() < renderFramefenceValue)
 	{
 		HRESULT hr = renderFramefence->SetEventOnCompletion(renderFramefenceValue, renderFrameEventHandle);
@@ -242,7 +303,11 @@ void DXRTRenderer::waitForGPURenderFrame()
 
 void DXRTRenderer::createScene()
 {
-	scene = std::make_unique<CRTScene>("Scenes/Dragon.crtscene");
+	CRTLoadProfile loadProfile;
+	scene = std::make_unique<CRTScene>("Scenes/Dragon.crtscene", &loadProfile);
+
+	std::cout << "Scene load:" << std::endl;
+	loadProfile.print(std::cout);
 }
 
 void DXRTRenderer::updateCameraCB()
@@ -263,18 +328,34 @@ void DXRTRenderer::updateCameraCB()
 		0.0f, 0.0f, 0.0f, 1.0f
 	);
 
-	void* mapped = nullptr;
-	cameraCB->Map(0, nullptr, &mapped);
-	memcpy(mapped, &cbData, sizeof(CameraCB));
-	cameraCB->Unmap(0, nullptr);
+	// The render scale of the frame follows the camera movement and the frame budget
+	const bool cameraMoving =
+		memcmp(&cbData.cameraPosition, &lastCameraCB.cameraPosition, sizeof(cbData.cameraPosition)) != 0 ||
+		memcmp(&cbData.cameraRotation, &lastCameraCB.cameraRotation, sizeof(cbData.cameraRotation)) != 0;
+	lastCameraCB = cbData;
+
+	const float movementScale = dynamicResolution.update(cameraMoving);
+	resolution.setScale(movementScale < budgetScale ? movementScale : budgetScale);
+	cbData.renderWidth = resolution.getRenderWidth();
+	cbData.renderHeight = resolution.getRenderHeight();
+
+	const uint64_t offset = constantRing.allocate(sizeof(CameraCB));
+	memcpy(frameConstantsData + offset, &cbData, sizeof(CameraCB));
+	cameraCBAddress = frameConstants->GetGPUVirtualAddress() + offset;
 }
 
-void DXRTRenderer::createDebugCB()
+void DXRTRenderer::createFrameResources()
 {
+	for (int i = 0; i < FramesInFlight; i++)
+	{
+		HRESULT hr = d3d12Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&frameAllocators[i]));
+		assert(SUCCEEDED(hr));
+	}
+
+	frameFence = std::make_unique<DXRTFrameFence>(d3d12Device);
+
 	auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	auto desc = CD3DX12_RESOURCE_DESC::Buffer(
-		(sizeof(DebugCB) + 255) & ~255
-	);
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(constantRing.getSize());
 
 	HRESULT hr = d3d12Device->CreateCommittedResource(
 		&heapProps,
@@ -282,190 +363,172 @@ void DXRTRenderer::createDebugCB()
 		&desc,
 		D3D12_RESOURCE_STATE_GENERIC_READ,
 		nullptr,
-		IID_PPV_ARGS(&debugCB)
+		IID_PPV_ARGS(&frameConstants)
 	);
+	assert(SUCCEEDED(hr));
+	trackResource(&frameConstants, frameConstants, CRTMemoryCategory::GPU_UPLOAD_BUFFERS);
 
+	// Stays mapped, the frames only write their own slice
+	CD3DX12_RANGE readRange(0, 0);
+	hr = frameConstants->Map(0, &readRange, reinterpret_cast<void**>(&frameConstantsData));
 	assert(SUCCEEDED(hr));
 }
 
 void DXRTRenderer::updateDebugCB()
 {
 	DebugCB cbData = {};
-	cbData.shadingMode = currentShadingMode;
+	cbData.aovMask = currentAOVMask;
 
-	void* mapped = nullptr;
-	debugCB->Map(0, nullptr, &mapped);
-	memcpy(mapped, &cbData, sizeof(DebugCB));
-	debugCB->Unmap(0, nullptr);
+	const uint64_t offset = constantRing.allocate(sizeof(DebugCB));
+	memcpy(frameConstantsData + offset, &cbData, sizeof(DebugCB));
+	debugCBAddress = frameConstants->GetGPUVirtualAddress() + offset;
 }
 
-void DXRTRenderer::createIndexBuffers()
+void DXRTRenderer::createGeometryBuffers()
 {
 	const auto& objects = scene->getObjects();
 
-	indexBuffers.resize(objects.size());
-	uploadIndexBuffers.resize(objects.size());
-
-	auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	auto defaultHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	vertexRanges.resize(objects.size());
+	indexRanges.resize(objects.size());
 
+	// The parser accepts objects without triangles. They get no ranges, a null
+	// view and an empty BLAS, so the per-mesh indexing of the rest stays the same.
 	for (size_t i = 0; i < objects.size(); ++i)
 	{
-		const auto& indices = objects[i].getIndices();
-		UINT size = UINT(indices.size() * sizeof(uint32_t));
+		vertexRanges[i] = CRTSuballocation();
+		indexRanges[i] = CRTSuballocation();
 
-		std::cout << "objectNumber: " << i << " number of Indices: " << indices.size() << std::endl;
-		auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+		if (isEmptyMesh(objects[i]))
+			continue;
 
-		// ---------------------------------------------------------
-		// Upload buffer
-		// ---------------------------------------------------------
-		d3d12Device->CreateCommittedResource(
-			&uploadHeap,
-			D3D12_HEAP_FLAG_NONE,
-			&desc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&uploadIndexBuffers[i])
-		);
+		vertexRanges[i] = geometryAllocator.allocate(objects[i].getVertices().size() * sizeof(CRTVector), geometryAlignment);
+		indexRanges[i] = geometryAllocator.allocate(objects[i].getIndices().size() * sizeof(uint32_t), geometryAlignment);
+	}
 
-		void* data = nullptr;
-		uploadIndexBuffers[i]->Map(0, nullptr, &data);
-		memcpy(data, indices.data(), size);
-		uploadIndexBuffers[i]->Unmap(0, nullptr);
+	createBufferBlocks(geometryAllocator, geometryHeaps, geometryBuffers,
+		D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, CRTMemoryCategory::GPU_GEOMETRY);
 
-		// ---------------------------------------------------------
-		// GPU buffer
-		// ---------------------------------------------------------
-		d3d12Device->CreateCommittedResource(
-			&defaultHeap,
-			D3D12_HEAP_FLAG_NONE,
-			&desc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS(&indexBuffers[i])
-		);
+	// All copies are recorded into as few command lists as the staging capacity
+	// allows, instead of one submission and CPU wait per buffer
+	CRTUploadPlanner planner;
+	DXRTUploadDevice uploadDevice(d3d12Device, commandQueue, commandAllocator, commandList,
+		[this]()
+		{
+			commandQueue->Signal(renderFramefence, renderFramefenceValue);
+			waitForGPURenderFrame();
+		});
 
-		// ---------------------------------------------------------
-		// Copy + transition
-		// ---------------------------------------------------------
-		commandAllocator->Reset();
-		commandList->Reset(commandAllocator, nullptr);
+	auto addRange = [&](const CRTSuballocation& range, const void* data)
+		{
+			if (!range.isValid())
+				return;
 
-		commandList->CopyBufferRegion(
-			indexBuffers[i], 0,
-			uploadIndexBuffers[i], 0,
-			size
-		);
+			planner.add(data, range.size);
+			uploadDevice.addDestination(geometryBuffers[range.block], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, range.offset);
+		};
 
-		D3D12_RESOURCE_BARRIER barrier =
-			CD3DX12_RESOURCE_BARRIER::Transition(
-				indexBuffers[i],
-				D3D12_RESOURCE_STATE_COPY_DEST,
-				D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE 
-			);
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		addRange(vertexRanges[i], objects[i].getVertices().data());
+		addRange(indexRanges[i], objects[i].getIndices().data());
+	}
 
-		commandList->ResourceBarrier(1, &barrier);
-		commandList->Close();
+	const int submissionCount = planner.execute(uploadDevice);
+	uploadDevice.releaseStaging();
 
-		ID3D12CommandList* lists[] = { commandList };
-		commandQueue->ExecuteCommandLists(1, lists);
-		commandQueue->Signal(renderFramefence, renderFramefenceValue);
-		waitForGPURenderFrame();
-	}
+	std::cout << "Uploaded " << planner.getRequestCount() << " geometry buffers, "
+		<< planner.getTotalSize() << " bytes in " << submissionCount << " submission(s)" << std::endl;
+	std::cout << "Geometry heaps: " << geometryHeaps.size() << ", "
+		<< geometryAllocator.getUsedSize() << " of " << geometryAllocator.getReservedSize() << " bytes used" << std::endl;
 }
 
-
-void DXRTRenderer::createVertexBuffers()
+void DXRTRenderer::createBufferBlocks(const CRTBufferSuballocator& allocator, std::vector<ID3D12HeapPtr>& heaps,
+	std::vector<ID3D12ResourcePtr>& buffers, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initialState,
+	CRTMemoryCategory category)
 {
-	const auto& objects = scene->getObjects();
-
-	vertexBuffers.resize(objects.size());
-	uploadVertexBuffers.resize(objects.size());
-
-	auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	auto defaultHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
-	for (size_t i = 0; i < objects.size(); ++i)
+	for (int block = int(heaps.size()); block < allocator.getBlockCount(); block++)
 	{
-		const auto& vertices = objects[i].getVertices();
-		UINT size = UINT(vertices.size() * sizeof(CRTVector));
+		const UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		const UINT64 size = (allocator.getBlockSize(block) + alignment - 1) / alignment * alignment;
 
-		std::cout << "objectNumber: " << i << " number of Vertices: " << vertices.size() << std::endl;
-		auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+		CD3DX12_HEAP_DESC heapDesc(size, D3D12_HEAP_TYPE_DEFAULT, alignment, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
 
-		// ---------------------------------------------------------
-		// Upload buffer
-		// ---------------------------------------------------------
-		d3d12Device->CreateCommittedResource(
-			&uploadHeap,
-			D3D12_HEAP_FLAG_NONE,
-			&desc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&uploadVertexBuffers[i])
-		);
+		ID3D12HeapPtr heap;
+		HRESULT hr = d3d12Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap));
+		assert(SUCCEEDED(hr));
 
-		void* data = nullptr;
-		uploadVertexBuffers[i]->Map(0, nullptr, &data);
-		memcpy(data, vertices.data(), size);
-		uploadVertexBuffers[i]->Unmap(0, nullptr);
+		// One buffer over the whole heap, the allocations are ranges inside it
+		auto desc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
 
-		// ---------------------------------------------------------
-		// GPU buffer
-		// ---------------------------------------------------------
-		d3d12Device->CreateCommittedResource(
-			&defaultHeap,
-			D3D12_HEAP_FLAG_NONE,
+		ID3D12ResourcePtr buffer;
+		hr = d3d12Device->CreatePlacedResource(
+			heap,
+			0,
 			&desc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
+			initialState,
 			nullptr,
-			IID_PPV_ARGS(&vertexBuffers[i])
+			IID_PPV_ARGS(&buffer)
 		);
+		assert(SUCCEEDED(hr));
 
-		// ---------------------------------------------------------
-		// Copy + transition
-		// ---------------------------------------------------------
-		commandAllocator->Reset();
-		commandList->Reset(commandAllocator, nullptr);
+		// The heaps live as long as the renderer, the heap itself is the key
+		CRTMemory::setResource(heap.GetInterfacePtr(), category, size);
 
-		commandList->CopyBufferRegion(
-			vertexBuffers[i], 0,
-			uploadVertexBuffers[i], 0,
-			size
-		);
+		heaps.push_back(heap);
+		buffers.push_back(buffer);
+	}
+}
 
-		D3D12_RESOURCE_BARRIER barrier =
-			CD3DX12_RESOURCE_BARRIER::Transition(
-				vertexBuffers[i],
-				D3D12_RESOURCE_STATE_COPY_DEST,
-				D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
-			);
+void DXRTRenderer::trackResource(const void* slot, ID3D12Resource* resource, CRTMemoryCategory category)
+{
+	UINT64 bytes = 0;
+	if (resource)
+	{
+		const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+		bytes = d3d12Device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+	}
 
-		commandList->ResourceBarrier(1, &barrier);
-		commandList->Close();
+	CRTMemory::setResource(slot, category, bytes);
+}
 
-		ID3D12CommandList* lists[] = { commandList };
-		commandQueue->ExecuteCommandLists(1, lists);
-		commandQueue->Signal(renderFramefence, renderFramefenceValue);
-		waitForGPURenderFrame();
-	}
+void DXRTRenderer::trackDescriptorHeap(const void* slot, ID3D12DescriptorHeap* heap)
+{
+	const D3D12_DESCRIPTOR_HEAP_DESC desc = heap->GetDesc();
+	CRTMemory::setResource(slot, CRTMemoryCategory::GPU_DESCRIPTOR_HEAPS,
+		static_cast<UINT64>(desc.NumDescriptors) * d3d12Device->GetDescriptorHandleIncrementSize(desc.Type));
 }
 
+D3D12_GPU_VIRTUAL_ADDRESS DXRTRenderer::getGeometryAddress(const CRTSuballocation& range) const
+{
+	return geometryBuffers[range.block]->GetGPUVirtualAddress() + range.offset;
+}
 
+bool DXRTRenderer::isEmptyMesh(const CRTMesh& mesh)
+{
+	return mesh.getVertices().empty() || mesh.getIndices().size() < 3;
+}
 
 void DXRTRenderer::frameBegin()
 {
-	if (isChangedShadingMode)
-	{
-		updateDebugCB();
-		isChangedShadingMode = false;
-	}
+	CRT_TRACE_ZONE("frameBegin");
 
+	// Waits only if the GPU is still on the frame that used this slot before
+	const auto waitStart = std::chrono::steady_clock::now();
+	const int frameIndex = framePacer.beginFrame(*frameFence);
+	lastGPUWaitSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - waitStart).count();
+	constantRing.beginFrame(frameIndex);
+
+	updateDebugCB();
 	updateCameraCB();
 
-	assert(SUCCEEDED(commandAllocator->Reset()));
-	assert(SUCCEEDED(dxrCmdList->Reset(commandAllocator, nullptr)));
+	HRESULT hr = frameAllocators[frameIndex]->Reset();
+	assert(SUCCEEDED(hr));
+
+	hr = dxrCmdList->Reset(frameAllocators[frameIndex], nullptr);
+	assert(SUCCEEDED(hr));
+
+	// Moved instances are refitted, added or removed ones rebuild the TLAS
+	updateTopLevelAS(frameIndex);
 
 	D3D12_RESOURCE_BARRIER barrier{};
 	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -492,6 +555,8 @@ void DXRTRenderer::frameBegin()
 
 void DXRTRenderer::frameEnd()
 {
+	CRT_TRACE_ZONE("frameEnd");
+
 	D3D12_RESOURCE_BARRIER barrier{};
 	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
 	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
@@ -502,7 +567,11 @@ void DXRTRenderer::frameEnd()
 	dxrCmdList->ResourceBarrier(1, &barrier);
 	raytracingOutputState = D3D12_RESOURCE_STATE_COPY_SOURCE;
 
-	dxrCmdList->CopyResource(renderTargets[swapChainFrameIdx], raytracingOutput);
+	// Only the traced part of the output, the swap chain stretches it over the window
+	const D3D12_BOX renderBox = { 0, 0, 0, raysDesc.Width, raysDesc.Height, 1 };
+	CD3DX12_TEXTURE_COPY_LOCATION dst(renderTargets[swapChainFrameIdx], 0);
+	CD3DX12_TEXTURE_COPY_LOCATION src(raytracingOutput, 0);
+	dxrCmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, &renderBox);
 
 	barrier.Transition.pResource = raytracingOutput;
 	barrier.Transition.StateBefore = raytracingOutputState;
@@ -516,104 +585,111 @@ void DXRTRenderer::frameEnd()
 	dxrCmdList->ResourceBarrier(1, &barrier);
 	backBufferState = D3D12_RESOURCE_STATE_PRESENT;
 
-	assert(SUCCEEDED(dxrCmdList->Close()));
-	ID3D12CommandList* lists[] = { dxrCmdList };
-	commandQueue->ExecuteCommandLists(1, lists);
-	assert(SUCCEEDED(commandQueue->Signal(renderFramefence, renderFramefenceValue)));
-	assert(SUCCEEDED(swapChain->Present(0, 0)));
+	HRESULT hr = dxrCmdList->Close();
+	assert(SUCCEEDED(hr));
+	{
+		CRT_TRACE_ZONE("ExecuteCommandLists");
+		ID3D12CommandList* lists[] = { dxrCmdList };
+		commandQueue->ExecuteCommandLists(1, lists);
+	}
+	hr = swapChain->SetSourceSize(raysDesc.Width, raysDesc.Height);
+	assert(SUCCEEDED(hr));
+	{
+		CRT_TRACE_ZONE("Present");
+		// Outside the assert, so release builds present as well
+		const auto presentStart = std::chrono::steady_clock::now();
+		hr = swapChain->Present(0, 0);
+		assert(SUCCEEDED(hr));
+		lastPresentSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - presentStart).count();
+	}
 
-	waitForGPURenderFrame();
+	// The CPU moves on to the next frame without waiting for this one
+	frameFence->signal(commandQueue, framePacer.endFrame());
 
 	swapChainFrameIdx = swapChain->GetCurrentBackBufferIndex();
 }
 
-void DXRTRenderer::createCameraBuffer()
-{
-	D3D12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(
-		(sizeof(CameraCB) + 255) & ~255
-	);
-
-	HRESULT hr = d3d12Device->CreateCommittedResource(
-		&heapProps,
-		D3D12_HEAP_FLAG_NONE,
-		&desc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&cameraCB)
-	);
-	assert(SUCCEEDED(hr));
-}
-
 void DXRTRenderer::createAccelerationStructures()
 {
 	const auto& objects = scene->getObjects();
 	blasList.resize(objects.size());
 
-	// Default heap for AS + scratch buffers
-	auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	// ---------------------------------------------------------------------
-	// Reset command list (MANDATORY)
-	// ---------------------------------------------------------------------
-	commandAllocator->Reset();
-	dxrCmdList->Reset(commandAllocator, nullptr);
+	// Default heap for AS + scratch buffers, readback for the compacted sizes
+	auto createBuffer = [&](ID3D12ResourcePtr& buffer, UINT64 size, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES state)
+		{
+			auto heap = CD3DX12_HEAP_PROPERTIES(heapType);
+			auto desc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
+
+			HRESULT hr = dxrDevice->CreateCommittedResource(
+				&heap,
+				D3D12_HEAP_FLAG_NONE,
+				&desc,
+				state,
+				nullptr,
+				IID_PPV_ARGS(&buffer)
+			);
+			assert(SUCCEEDED(hr));
+			trackResource(&buffer, buffer, CRTMemoryCategory::GPU_ACCELERATION_STRUCTURES);
+		};
+
+	auto alignAS = [](UINT64 size)
+		{
+			const UINT64 alignment = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT;
+			return (size + alignment - 1) / alignment * alignment;
+		};
 
 	// =====================================================================
-	// Build BLASes
+	// Query the BLAS sizes
 	// =====================================================================
+	// Every BLAS is first built at its worst case size into one temporary
+	// buffer, then compacted into a range of the AS heaps
+	std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geoms(objects.size());
+	std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS> blasInputs(objects.size());
+	std::vector<UINT64> buildOffsets(objects.size());
+	UINT64 buildSize = 0;
+	UINT64 scratchSize = 0;
+	UINT64 scratchSizeSum = 0;
+
 	for (size_t i = 0; i < objects.size(); ++i)
 	{
-		// -------------------------------------------------------------
-		// Transition vertex & index buffers for DXR
-		// -------------------------------------------------------------
-		D3D12_RESOURCE_BARRIER barriers[2];
-
-		barriers[0] = CD3DX12_RESOURCE_BARRIER::Transition(
-			vertexBuffers[i],
-			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
-			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
-		);
-
-		barriers[1] = CD3DX12_RESOURCE_BARRIER::Transition(
-			indexBuffers[i],
-			D3D12_RESOURCE_STATE_INDEX_BUFFER,
-			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
-		);
-
-		dxrCmdList->ResourceBarrier(2, barriers);
-
 		// -------------------------------------------------------------
 		// Geometry description
 		// -------------------------------------------------------------
-		D3D12_RAYTRACING_GEOMETRY_DESC geom{};
+		D3D12_RAYTRACING_GEOMETRY_DESC& geom = geoms[i];
 		geom.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
 		geom.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
-
-		geom.Triangles.VertexBuffer.StartAddress =
-			vertexBuffers[i]->GetGPUVirtualAddress();
 		geom.Triangles.VertexBuffer.StrideInBytes = sizeof(CRTVector);
-		geom.Triangles.VertexCount =
-			static_cast<UINT>(objects[i].getVertices().size());
 		geom.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-
-		geom.Triangles.IndexBuffer =
-			indexBuffers[i]->GetGPUVirtualAddress();
-		geom.Triangles.IndexCount =
-			static_cast<UINT>(objects[i].getIndices().size());
 		geom.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
 
+		// Empty meshes have no ranges, their BLAS gets no geometry below
+		if (!isEmptyMesh(objects[i]))
+		{
+			geom.Triangles.VertexBuffer.StartAddress =
+				getGeometryAddress(vertexRanges[i]);
+			geom.Triangles.VertexCount =
+				static_cast<UINT>(objects[i].getVertices().size());
+
+			geom.Triangles.IndexBuffer =
+				getGeometryAddress(indexRanges[i]);
+			geom.Triangles.IndexCount =
+				static_cast<UINT>(objects[i].getIndices().size());
+		}
+
 		// -------------------------------------------------------------
 		// BLAS inputs
 		// -------------------------------------------------------------
-		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs{};
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& inputs = blasInputs[i];
 		inputs.Type =
 			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
 		inputs.DescsLayout =
 			D3D12_ELEMENTS_LAYOUT_ARRAY;
-		inputs.NumDescs = 1;
+		// An empty BLAS is valid, instances of it are never hit
+		inputs.NumDescs = isEmptyMesh(objects[i]) ? 0 : 1;
 		inputs.pGeometryDescs = &geom;
 		inputs.Flags =
-			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE |
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION;
 
 		// -------------------------------------------------------------
 		// Query sizes
@@ -623,136 +699,214 @@ void DXRTRenderer::createAccelerationStructures()
 			&inputs, &info
 		);
 
-		// -------------------------------------------------------------
-		// Allocate BLAS buffer
-		// -------------------------------------------------------------
-		auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		buildOffsets[i] = buildSize;
+		buildSize += alignAS(info.ResultDataMaxSizeInBytes);
 
-		auto blasDesc = CD3DX12_RESOURCE_DESC::Buffer(
-			info.ResultDataMaxSizeInBytes,
-			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
-		);
+		if (alignAS(info.ScratchDataSizeInBytes) > scratchSize)
+			scratchSize = alignAS(info.ScratchDataSizeInBytes);
+		scratchSizeSum += info.ScratchDataSizeInBytes;
+	}
 
-		dxrDevice->CreateCommittedResource(
-			&heapProps,
-			D3D12_HEAP_FLAG_NONE,
-			&blasDesc,
-			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
-			nullptr,
-			IID_PPV_ARGS(&blasList[i].buffer)
-		);
+	// -------------------------------------------------------------
+	// The TLAS builds and updates use the same scratch
+	// -------------------------------------------------------------
+	instanceCapacity = getInstanceCapacity(scene->getInstances().getInstances().size());
 
-		// -------------------------------------------------------------
-		// Allocate scratch buffer
-		// -------------------------------------------------------------
-		auto scratchDesc = CD3DX12_RESOURCE_DESC::Buffer(
-			info.ScratchDataSizeInBytes,
-			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
-		);
+	const UINT64 tlasScratchSize = alignAS(getTopLevelScratchSize(instanceCapacity));
+	if (tlasScratchSize > scratchSize)
+		scratchSize = tlasScratchSize;
 
-		dxrDevice->CreateCommittedResource(
-			&heapProps,
-			D3D12_HEAP_FLAG_NONE,
-			&scratchDesc,
-			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-			nullptr,
-			IID_PPV_ARGS(&blasList[i].scratch)
-		);
+	// -------------------------------------------------------------
+	// One scratch buffer for all builds, they run one after another
+	// -------------------------------------------------------------
+	createBuffer(scratchPool, scratchSize, D3D12_HEAP_TYPE_DEFAULT,
+		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-		// -------------------------------------------------------------
-		// Build BLAS
-		// -------------------------------------------------------------
+	ID3D12ResourcePtr buildBuffer;
+	createBuffer(buildBuffer, buildSize, D3D12_HEAP_TYPE_DEFAULT,
+		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+
+	// The compacted sizes are written by the GPU and read back by the CPU
+	typedef D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC CompactedSizeDesc;
+	const UINT64 postbuildSize = sizeof(CompactedSizeDesc) * objects.size();
+
+	ID3D12ResourcePtr postbuildBuffer;
+	createBuffer(postbuildBuffer, postbuildSize, D3D12_HEAP_TYPE_DEFAULT,
+		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	ID3D12ResourcePtr postbuildReadback;
+	createBuffer(postbuildReadback, postbuildSize, D3D12_HEAP_TYPE_READBACK,
+		D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+
+	// =====================================================================
+	// Build BLASes
+	// =====================================================================
+	commandAllocator->Reset();
+	dxrCmdList->Reset(commandAllocator, nullptr);
+
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
 		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC build{};
-		build.Inputs = inputs;
+		build.Inputs = blasInputs[i];
 		build.DestAccelerationStructureData =
-			blasList[i].buffer->GetGPUVirtualAddress();
+			buildBuffer->GetGPUVirtualAddress() + buildOffsets[i];
 		build.ScratchAccelerationStructureData =
-			blasList[i].scratch->GetGPUVirtualAddress();
+			scratchPool->GetGPUVirtualAddress();
 
-		dxrCmdList->BuildRaytracingAccelerationStructure(&build, 0, nullptr);
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuild{};
+		postbuild.InfoType =
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+		postbuild.DestBuffer =
+			postbuildBuffer->GetGPUVirtualAddress() + i * sizeof(CompactedSizeDesc);
 
-		// UAV barrier REQUIRED after AS build
+		dxrCmdList->BuildRaytracingAccelerationStructure(&build, 1, &postbuild);
+
+		// UAV barrier REQUIRED after AS build, the next build reuses the scratch
 		D3D12_RESOURCE_BARRIER uavBarrier =
 			CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
 		dxrCmdList->ResourceBarrier(1, &uavBarrier);
-
-		blasList[i].gpuAddress =
-			blasList[i].buffer->GetGPUVirtualAddress();
 	}
 
+	D3D12_RESOURCE_BARRIER postbuildBarrier =
+		CD3DX12_RESOURCE_BARRIER::Transition(
+			postbuildBuffer,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_COPY_SOURCE
+		);
+	dxrCmdList->ResourceBarrier(1, &postbuildBarrier);
+	dxrCmdList->CopyBufferRegion(postbuildReadback, 0, postbuildBuffer, 0, postbuildSize);
+
+	dxrCmdList->Close();
+	ID3D12CommandList* buildLists[] = { dxrCmdList };
+	commandQueue->ExecuteCommandLists(1, buildLists);
+	commandQueue->Signal(renderFramefence, renderFramefenceValue);
+	waitForGPURenderFrame();
+
 	// =====================================================================
-	// Build TLAS
+	// Compact BLASes
 	// =====================================================================
+	CompactedSizeDesc* compactedSizes = nullptr;
+	postbuildReadback->Map(0, nullptr, reinterpret_cast<void**>(&compactedSizes));
 
-	// -------------------------------------------------------------
-	// Instance buffer (CPU-> GPU)
-	// -------------------------------------------------------------
-	std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instances(blasList.size());
+	UINT64 compactedSizeSum = 0;
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		blasList[i].size = compactedSizes[i].CompactedSizeInBytes;
+		blasList[i].range = accelerationStructureAllocator.allocate(
+			blasList[i].size, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+
+		compactedSizeSum += blasList[i].size;
+	}
+
+	CD3DX12_RANGE noWrite(0, 0);
+	postbuildReadback->Unmap(0, &noWrite);
+
+	createBufferBlocks(accelerationStructureAllocator, accelerationStructureHeaps, accelerationStructureBuffers,
+		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
+		CRTMemoryCategory::GPU_ACCELERATION_STRUCTURES);
+
+	commandAllocator->Reset();
+	dxrCmdList->Reset(commandAllocator, nullptr);
 
-	for (UINT i = 0; i < instances.size(); ++i)
+	for (size_t i = 0; i < objects.size(); ++i)
 	{
-		instances[i].AccelerationStructure =
-			blasList[i].gpuAddress;
-		instances[i].InstanceID = i;
-		instances[i].InstanceMask = 0xFF;
-		instances[i].InstanceContributionToHitGroupIndex = 0;
-		instances[i].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-
-		instances[i].Transform[0][0] = 1.0f;
-		instances[i].Transform[1][1] = 1.0f;
-		instances[i].Transform[2][2] = 1.0f;
+		const CRTSuballocation& range = blasList[i].range;
+		blasList[i].gpuAddress =
+			accelerationStructureBuffers[range.block]->GetGPUVirtualAddress() + range.offset;
+
+		dxrCmdList->CopyRaytracingAccelerationStructure(
+			blasList[i].gpuAddress,
+			buildBuffer->GetGPUVirtualAddress() + buildOffsets[i],
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT
+		);
 	}
 
-	auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	auto instDesc = CD3DX12_RESOURCE_DESC::Buffer(
-		sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * instances.size()
-	);
+	// The TLAS build reads the compacted BLASes
+	D3D12_RESOURCE_BARRIER compactBarrier =
+		CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+	dxrCmdList->ResourceBarrier(1, &compactBarrier);
 
-	dxrDevice->CreateCommittedResource(
-		&uploadHeap,
-		D3D12_HEAP_FLAG_NONE,
-		&instDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&instanceBuffer)
-	);
+	std::cout << "BLAS memory: " << buildSize << " bytes built, " << compactedSizeSum << " bytes after compaction, "
+		<< buildSize - compactedSizeSum << " bytes saved" << std::endl;
+	std::cout << "Scratch memory: " << scratchSize << " bytes shared instead of "
+		<< scratchSizeSum + tlasScratchSize << " bytes" << std::endl;
 
-	void* mapped = nullptr;
-	instanceBuffer->Map(0, nullptr, &mapped);
-	memcpy(mapped, instances.data(), instDesc.Width);
-	instanceBuffer->Unmap(0, nullptr);
+	// =====================================================================
+	// Build TLAS
+	// =====================================================================
+	createTopLevelAS();
+	tlasTracker.update(scene->getInstances());
+	buildTopLevelAS(CRTTopLevelUpdate::REBUILD, 0);
 
-	// -------------------------------------------------------------
-	// TLAS inputs
-	// -------------------------------------------------------------
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS tlasInputs{};
-	tlasInputs.Type =
+	// ---------------------------------------------------------------------
+	// Execute, the uncompacted BLASes are released when this returns
+	// ---------------------------------------------------------------------
+	dxrCmdList->Close();
+	ID3D12CommandList* lists[] = { dxrCmdList };
+	commandQueue->ExecuteCommandLists(1, lists);
+	commandQueue->Signal(renderFramefence, renderFramefenceValue);
+	waitForGPURenderFrame();
+
+	// Only in the peak from now on
+	trackResource(&buildBuffer, nullptr, CRTMemoryCategory::GPU_ACCELERATION_STRUCTURES);
+	trackResource(&postbuildBuffer, nullptr, CRTMemoryCategory::GPU_ACCELERATION_STRUCTURES);
+	trackResource(&postbuildReadback, nullptr, CRTMemoryCategory::GPU_ACCELERATION_STRUCTURES);
+}
+
+
+D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS DXRTRenderer::getTopLevelInputs(UINT instanceCount) const
+{
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs{};
+	inputs.Type =
 		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
-	tlasInputs.DescsLayout =
+	inputs.DescsLayout =
 		D3D12_ELEMENTS_LAYOUT_ARRAY;
-	tlasInputs.NumDescs = (UINT)instances.size();
-	tlasInputs.InstanceDescs =
-		instanceBuffer->GetGPUVirtualAddress();
-	tlasInputs.Flags =
-		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+	inputs.NumDescs = instanceCount;
+	inputs.Flags =
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE |
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+
+	return inputs;
+}
+
+UINT64 DXRTRenderer::getTopLevelScratchSize(UINT instanceCount) const
+{
+	const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = getTopLevelInputs(instanceCount);
+
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info{};
+	dxrDevice->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
+
+	return info.ScratchDataSizeInBytes > info.UpdateScratchDataSizeInBytes ?
+		info.ScratchDataSizeInBytes : info.UpdateScratchDataSizeInBytes;
+}
+
+UINT DXRTRenderer::getInstanceCapacity(size_t instanceCount)
+{
+	// Room for instances added later without reallocating the TLAS
+	const size_t capacity = instanceCount * 2;
+	return static_cast<UINT>(capacity > 16 ? capacity : 16);
+}
+
+void DXRTRenderer::createTopLevelAS()
+{
+	auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 
 	// -------------------------------------------------------------
-	// Query TLAS sizes
+	// Allocate TLAS buffer for the full capacity
 	// -------------------------------------------------------------
+	const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = getTopLevelInputs(instanceCapacity);
+
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO tlasInfo{};
 	dxrDevice->GetRaytracingAccelerationStructurePrebuildInfo(
-		&tlasInputs, &tlasInfo
+		&inputs, &tlasInfo
 	);
 
-	// -------------------------------------------------------------
-	// Allocate TLAS buffer
-	// -------------------------------------------------------------
 	auto tlasDesc = CD3DX12_RESOURCE_DESC::Buffer(
 		tlasInfo.ResultDataMaxSizeInBytes,
 		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
 	);
 
-	dxrDevice->CreateCommittedResource(
+	HRESULT hr = dxrDevice->CreateCommittedResource(
 		&heapProps,
 		D3D12_HEAP_FLAG_NONE,
 		&tlasDesc,
@@ -760,33 +914,119 @@ void DXRTRenderer::createAccelerationStructures()
 		nullptr,
 		IID_PPV_ARGS(&tlasBuffer)
 	);
+	assert(SUCCEEDED(hr));
+	trackResource(&tlasBuffer, tlasBuffer, CRTMemoryCategory::GPU_ACCELERATION_STRUCTURES);
 
 	// -------------------------------------------------------------
-	// Allocate TLAS scratch
+	// Instance buffer (CPU-> GPU), one slice per frame in flight
 	// -------------------------------------------------------------
-	auto tlasScratchDesc = CD3DX12_RESOURCE_DESC::Buffer(
-		tlasInfo.ScratchDataSizeInBytes,
-		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
+	auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto instDesc = CD3DX12_RESOURCE_DESC::Buffer(
+		sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * instanceCapacity * FramesInFlight
 	);
 
-	dxrDevice->CreateCommittedResource(
-		&heapProps,
+	hr = dxrDevice->CreateCommittedResource(
+		&uploadHeap,
 		D3D12_HEAP_FLAG_NONE,
-		&tlasScratchDesc,
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		&instDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
 		nullptr,
-		IID_PPV_ARGS(&tlasScratch)
+		IID_PPV_ARGS(&instanceBuffer)
 	);
+	assert(SUCCEEDED(hr));
+	trackResource(&instanceBuffer, instanceBuffer, CRTMemoryCategory::GPU_UPLOAD_BUFFERS);
+
+	CD3DX12_RANGE readRange(0, 0);
+	hr = instanceBuffer->Map(0, &readRange, reinterpret_cast<void**>(&instanceDescs));
+	assert(SUCCEEDED(hr));
 
 	// -------------------------------------------------------------
-	// Build TLAS
+	// Grow the shared scratch if the bigger TLAS needs it
+	// -------------------------------------------------------------
+	const UINT64 scratchSize = getTopLevelScratchSize(instanceCapacity);
+
+	if (scratchPool->GetDesc().Width < scratchSize)
+	{
+		auto scratchDesc = CD3DX12_RESOURCE_DESC::Buffer(
+			scratchSize,
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
+		);
+
+		hr = dxrDevice->CreateCommittedResource(
+			&heapProps,
+			D3D12_HEAP_FLAG_NONE,
+			&scratchDesc,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			nullptr,
+			IID_PPV_ARGS(&scratchPool)
+		);
+		assert(SUCCEEDED(hr));
+		trackResource(&scratchPool, scratchPool, CRTMemoryCategory::GPU_ACCELERATION_STRUCTURES);
+	}
+
+	// The descriptor heap does not exist yet during the first build
+	if (uavHeap)
+		writeTopLevelASView();
+}
+
+void DXRTRenderer::buildTopLevelAS(CRTTopLevelUpdate update, int frameIndex)
+{
+	const auto& instances = scene->getInstances().getInstances();
+	const auto& objects = scene->getObjects();
+	assert(instances.size() <= instanceCapacity);
+
+	// -------------------------------------------------------------
+	// Instance descs of this frame, InstanceID() selects the mesh data
+	// -------------------------------------------------------------
+	D3D12_RAYTRACING_INSTANCE_DESC* descs = instanceDescs + frameIndex * instanceCapacity;
+
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		const CRTInstance& instance = instances[i];
+		D3D12_RAYTRACING_INSTANCE_DESC desc{};
+
+		desc.AccelerationStructure =
+			blasList[instance.meshIndex].gpuAddress;
+		desc.InstanceID = instance.meshIndex;
+		desc.InstanceMask = 0xFF;
+		// Selects the record of the mesh material inside the hit group table of the shading mode
+		desc.InstanceContributionToHitGroupIndex = objects[instance.meshIndex].getMaterialIndex();
+		desc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+
+		// Row vectors on the CPU, a 3x4 column vector matrix for DXR
+		for (int row = 0; row < 3; row++)
+		{
+			for (int col = 0; col < 3; col++)
+			{
+				desc.Transform[row][col] = instance.transform.rotation.get(col, row);
+			}
+		}
+
+		desc.Transform[0][3] = instance.transform.translation.getX();
+		desc.Transform[1][3] = instance.transform.translation.getY();
+		desc.Transform[2][3] = instance.transform.translation.getZ();
+
+		descs[i] = desc;
+	}
+
+	// -------------------------------------------------------------
+	// Build TLAS, or refit it in place when only transforms changed
 	// -------------------------------------------------------------
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC tlasBuild{};
-	tlasBuild.Inputs = tlasInputs;
+	tlasBuild.Inputs = getTopLevelInputs(static_cast<UINT>(instances.size()));
+	tlasBuild.Inputs.InstanceDescs =
+		instanceBuffer->GetGPUVirtualAddress() + frameIndex * instanceCapacity * sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
 	tlasBuild.DestAccelerationStructureData =
 		tlasBuffer->GetGPUVirtualAddress();
 	tlasBuild.ScratchAccelerationStructureData =
-		tlasScratch->GetGPUVirtualAddress();
+		scratchPool->GetGPUVirtualAddress();
+
+	if (update == CRTTopLevelUpdate::REFIT)
+	{
+		tlasBuild.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+		tlasBuild.SourceAccelerationStructureData =
+			tlasBuffer->GetGPUVirtualAddress();
+	}
 
 	dxrCmdList->BuildRaytracingAccelerationStructure(&tlasBuild, 0, nullptr);
 
@@ -794,21 +1034,50 @@ void DXRTRenderer::createAccelerationStructures()
 	D3D12_RESOURCE_BARRIER tlasUav =
 		CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
 	dxrCmdList->ResourceBarrier(1, &tlasUav);
+}
 
-	// ---------------------------------------------------------------------
-	// Execute
-	// ---------------------------------------------------------------------
-	dxrCmdList->Close();
-	ID3D12CommandList* lists[] = { dxrCmdList };
-	commandQueue->ExecuteCommandLists(1, lists);
-	commandQueue->Signal(renderFramefence, renderFramefenceValue);
-	waitForGPURenderFrame();
+void DXRTRenderer::updateTopLevelAS(int frameIndex)
+{
+	const CRTTopLevelUpdate update = tlasTracker.update(scene->getInstances());
+
+	if (update == CRTTopLevelUpdate::NONE)
+		return;
+
+	const size_t instanceCount = scene->getInstances().getInstances().size();
+
+	if (instanceCount > instanceCapacity)
+	{
+		// The frames in flight still trace against the current TLAS
+		framePacer.waitForIdle(*frameFence);
+
+		instanceCapacity = getInstanceCapacity(instanceCount);
+		createTopLevelAS();
+	}
+
+	buildTopLevelAS(update, frameIndex);
 }
 
+void DXRTRenderer::writeTopLevelASView()
+{
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.RaytracingAccelerationStructure.Location =
+		tlasBuffer->GetGPUVirtualAddress();
+
+	d3d12Device->CreateShaderResourceView(
+		nullptr,
+		&srvDesc,
+		uavHeap->GetCPUDescriptorHandleForHeapStart()
+	);
+}
 
 void DXRTRenderer::createGlobalRootSignature()
 {
-	D3D12_DESCRIPTOR_RANGE ranges[2] = {};
+	const UINT objectCount = static_cast<UINT>(scene->getObjects().size());
+
+	// Same order as the descriptors in uavHeap
+	D3D12_DESCRIPTOR_RANGE ranges[5] = {};
 
 	ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 	ranges[0].NumDescriptors = 1;
@@ -816,17 +1085,38 @@ void DXRTRenderer::createGlobalRootSignature()
 	ranges[0].RegisterSpace = 0;
 	ranges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
+	// Frame output and the AOV targets
 	ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
-	ranges[1].NumDescriptors = 1;
+	ranges[1].NumDescriptors = 1 + AOVCount;
 	ranges[1].BaseShaderRegister = 0;
 	ranges[1].RegisterSpace = 0;
 	ranges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
+	// Material albedos
+	ranges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	ranges[2].NumDescriptors = 1;
+	ranges[2].BaseShaderRegister = 1;
+	ranges[2].RegisterSpace = 0;
+	ranges[2].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+	// Vertex and index buffers of every instance
+	ranges[3].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	ranges[3].NumDescriptors = objectCount;
+	ranges[3].BaseShaderRegister = 0;
+	ranges[3].RegisterSpace = 1;
+	ranges[3].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+	ranges[4].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	ranges[4].NumDescriptors = objectCount;
+	ranges[4].BaseShaderRegister = 0;
+	ranges[4].RegisterSpace = 2;
+	ranges[4].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
 	D3D12_ROOT_PARAMETER rootParams[3] = {};
 
 	rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
 	rootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-	rootParams[0].DescriptorTable.NumDescriptorRanges = 2;
+	rootParams[0].DescriptorTable.NumDescriptorRanges = _countof(ranges);
 	rootParams[0].DescriptorTable.pDescriptorRanges = ranges;
 
 	rootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
@@ -862,35 +1152,81 @@ void DXRTRenderer::createGlobalRootSignature()
 	);
 }
 
+void DXRTRenderer::createLocalRootSignature()
+{
+	// The MaterialRecord after the identifier of every hit group record, as root constants at b2
+	D3D12_ROOT_PARAMETER rootParams[1] = {};
+
+	rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	rootParams[0].Constants.ShaderRegister = 2;
+	rootParams[0].Constants.RegisterSpace = 0;
+	rootParams[0].Constants.Num32BitValues = sizeof(MaterialRecord) / sizeof(uint32_t);
+
+	D3D12_ROOT_SIGNATURE_DESC rootSigDesc = {};
+	rootSigDesc.NumParameters = 1;
+	rootSigDesc.pParameters = rootParams;
+	rootSigDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE;
+
+	ID3DBlobPtr sigBlob;
+	ID3DBlobPtr errorBlob;
+
+	HRESULT hr = D3D12SerializeRootSignature(
+		&rootSigDesc,
+		D3D_ROOT_SIGNATURE_VERSION_1,
+		&sigBlob,
+		&errorBlob
+	);
+	assert(SUCCEEDED(hr));
+
+	hr = d3d12Device->CreateRootSignature(
+		0,
+		sigBlob->GetBufferPointer(),
+		sigBlob->GetBufferSize(),
+		IID_PPV_ARGS(&hitGroupRootSignature)
+	);
+	assert(SUCCEEDED(hr));
+}
+
 void DXRTRenderer::createRayTracingPipelineState()
 {
-	D3D12_STATE_SUBOBJECT rayGenLibSubobject = createRayGenSubObject();
-	D3D12_STATE_SUBOBJECT closestHitSubobject = createClosestHitSubObject();
-	D3D12_STATE_SUBOBJECT missLibSubobject = createMissLibSubObject();
+	const auto libraryStart = std::chrono::steady_clock::now();
+	D3D12_STATE_SUBOBJECT libSubobject = createShaderLibrarySubObject();
+	const auto libraryEnd = std::chrono::steady_clock::now();
+
 	D3D12_STATE_SUBOBJECT shaderConfigSubobject = createShaderConfigSubObject();
 	D3D12_STATE_SUBOBJECT pipelineConfigSubObject = createPipelineConfigSubObject();
 	D3D12_STATE_SUBOBJECT rootSigSubobject = createGlobalRootSignatureSubObject();
-	D3D12_STATE_SUBOBJECT hitGroupSubobject = createHitGroupSubObject();
-
-	std::vector<D3D12_STATE_SUBOBJECT> subobjects = {
-		rayGenLibSubobject,
-		closestHitSubobject,
-		missLibSubobject,
-		shaderConfigSubobject,
-		pipelineConfigSubObject,
-		rootSigSubobject,
-		hitGroupSubobject
-	};
+
+	// The association points at the local root signature subobject, so the vector must not reallocate
+	std::vector<D3D12_STATE_SUBOBJECT> subobjects;
+	subobjects.reserve(6 + ShadingModeCount);
+	subobjects.push_back(libSubobject);
+	subobjects.push_back(shaderConfigSubobject);
+	subobjects.push_back(pipelineConfigSubObject);
+	subobjects.push_back(rootSigSubobject);
+
+	for (UINT mode = 0; mode < ShadingModeCount; mode++)
+		subobjects.push_back(createHitGroupSubObject(mode));
+
+	subobjects.push_back(createLocalRootSignatureSubObject());
+	subobjects.push_back(createLocalRootSignatureAssociationSubObject(&subobjects.back()));
 
 	D3D12_STATE_OBJECT_DESC rtpsoDesc = {};
 	rtpsoDesc.Type = D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE;
 	rtpsoDesc.NumSubobjects = (UINT)subobjects.size();
 	rtpsoDesc.pSubobjects = subobjects.data();
 
+	// The driver keeps its own cache of compiled state objects, keyed by the DXIL which is now the same between runs
 	HRESULT hr = dxrDevice->CreateStateObject(&rtpsoDesc, IID_PPV_ARGS(&rtStateObject));
+	const auto stateObjectEnd = std::chrono::steady_clock::now();
 
 	assert(SUCCEEDED(hr));
 
+	std::cout << "Shader library: " << (shaderCache.getHitCount() > 0 ? "cache hit" : "compiled") << ", "
+		<< std::chrono::duration<float, std::milli>(libraryEnd - libraryStart).count() << " ms, state object: "
+		<< std::chrono::duration<float, std::milli>(stateObjectEnd - libraryEnd).count() << " ms" << std::endl;
+
 	if (FAILED(hr))
 	{
 #if defined(_DEBUG)
@@ -919,11 +1255,86 @@ void DXRTRenderer::createRayTracingPipelineState()
 }
 
 void DXRTRenderer::createRayTracingShaderTexture()
+{
+	createRayTracingOutput();
+
+	const auto& objects = scene->getObjects();
+
+	// TLAS, frame output, AOV targets, instance albedos, vertex and index buffers
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = 3 + AOVCount + 2 * static_cast<UINT>(objects.size());
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+	d3d12Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&uavHeap));
+	trackDescriptorHeap(&uavHeap, uavHeap);
+
+	// CPU-only heap for ClearUAV
+	D3D12_DESCRIPTOR_HEAP_DESC cpuHeapDesc = {};
+	cpuHeapDesc.NumDescriptors = 1;
+	cpuHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	cpuHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // CPU only
+	d3d12Device->CreateDescriptorHeap(&cpuHeapDesc, IID_PPV_ARGS(&clearHeap));
+	trackDescriptorHeap(&clearHeap, clearHeap);
+
+	UINT inc = d3d12Device->GetDescriptorHandleIncrementSize(
+		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
+	);
+
+	writeTopLevelASView();
+	writeOutputViews();
+
+	// Material albedos follow the TLAS, the frame output and the AOV targets
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = uavHeap->GetCPUDescriptorHandleForHeapStart();
+	handle.ptr += (2 + AOVCount) * inc;
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC albedoSrvDesc = {};
+	albedoSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+	albedoSrvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	albedoSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	albedoSrvDesc.Buffer.NumElements = static_cast<UINT>(scene->getMaterials().size());
+	albedoSrvDesc.Buffer.StructureByteStride = sizeof(DirectX::XMFLOAT4);
+
+	d3d12Device->CreateShaderResourceView(materialAlbedoBuffer, &albedoSrvDesc, handle);
+
+	// Geometry is read as raw ByteAddressBuffers, all vertex buffers first, then all index buffers
+	auto createRawBufferView = [&](const CRTSuballocation& range)
+		{
+			handle.ptr += inc;
+
+			D3D12_SHADER_RESOURCE_VIEW_DESC rawSrvDesc = {};
+			rawSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+			rawSrvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+			rawSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			rawSrvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+
+			// Null view for the ranges of empty meshes, it reads as zero
+			if (!range.isValid())
+			{
+				rawSrvDesc.Buffer.NumElements = 1;
+				d3d12Device->CreateShaderResourceView(nullptr, &rawSrvDesc, handle);
+				return;
+			}
+
+			rawSrvDesc.Buffer.FirstElement = range.offset / 4;
+			rawSrvDesc.Buffer.NumElements = UINT(range.size / 4);
+
+			d3d12Device->CreateShaderResourceView(geometryBuffers[range.block], &rawSrvDesc, handle);
+		};
+
+	for (size_t i = 0; i < objects.size(); ++i)
+		createRawBufferView(vertexRanges[i]);
+
+	for (size_t i = 0; i < objects.size(); ++i)
+		createRawBufferView(indexRanges[i]);
+}
+
+void DXRTRenderer::createRayTracingOutput()
 {
 	D3D12_RESOURCE_DESC texDesc = {};
 	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	texDesc.Width = 1920;
-	texDesc.Height = 1080;
+	texDesc.Width = resolution.getOutputWidth();
+	texDesc.Height = resolution.getOutputHeight();
 	texDesc.DepthOrArraySize = 1;
 	texDesc.MipLevels = 1;
 	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -942,35 +1353,21 @@ void DXRTRenderer::createRayTracingShaderTexture()
 		nullptr,
 		IID_PPV_ARGS(&raytracingOutput)
 	);
+	trackResource(&raytracingOutput, raytracingOutput, CRTMemoryCategory::GPU_RESOURCES);
 
 	raytracingOutputState = D3D12_RESOURCE_STATE_COMMON;
+}
 
-	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-	heapDesc.NumDescriptors = 2;
-	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-
-	d3d12Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&uavHeap));
-
+void DXRTRenderer::writeOutputViews()
+{
 	UINT inc = d3d12Device->GetDescriptorHandleIncrementSize(
 		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
 	);
 
+	// The frame output is descriptor #1, right after the TLAS
 	D3D12_CPU_DESCRIPTOR_HANDLE handle =
 		uavHeap->GetCPUDescriptorHandleForHeapStart();
 
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.RaytracingAccelerationStructure.Location =
-		tlasBuffer->GetGPUVirtualAddress();
-
-	d3d12Device->CreateShaderResourceView(
-		nullptr,
-		&srvDesc,
-		handle
-	);
-
 	handle.ptr += inc;
 
 	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
@@ -984,17 +1381,18 @@ void DXRTRenderer::createRayTracingShaderTexture()
 		handle
 	);
 
-	// CPU-only heap for ClearUAV
-	D3D12_DESCRIPTOR_HEAP_DESC cpuHeapDesc = {};
-	cpuHeapDesc.NumDescriptors = 1;
-	cpuHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	cpuHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // CPU only
-	d3d12Device->CreateDescriptorHeap(&cpuHeapDesc, IID_PPV_ARGS(&clearHeap));
+	for (UINT aov = 0; aov < AOVCount; aov++)
+	{
+		handle.ptr += inc;
 
-	// Create a UAV descriptor in this CPU-only heap
-	uavDesc = {};
-	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
-	uavDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		D3D12_UNORDERED_ACCESS_VIEW_DESC aovUavDesc = {};
+		aovUavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		aovUavDesc.Format = aovFormats[aov];
+
+		d3d12Device->CreateUnorderedAccessView(aovOutputs[aov], nullptr, &aovUavDesc, handle);
+	}
+
+	// Create a UAV descriptor in the CPU-only heap for ClearUAV
 	d3d12Device->CreateUnorderedAccessView(
 		raytracingOutput,
 		nullptr,
@@ -1003,10 +1401,68 @@ void DXRTRenderer::createRayTracingShaderTexture()
 	);
 }
 
+void DXRTRenderer::createAOVTextures()
+{
+	D3D12_HEAP_PROPERTIES heapProps = {};
+	heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
 
-inline UINT alignedSize(UINT size, UINT alignBytes)
+	for (UINT aov = 0; aov < AOVCount; aov++)
+	{
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Width = resolution.getOutputWidth();
+		texDesc.Height = resolution.getOutputHeight();
+		texDesc.DepthOrArraySize = 1;
+		texDesc.MipLevels = 1;
+		texDesc.Format = aovFormats[aov];
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+		// The targets stay in the UAV state, only the readback moves them out of it
+		HRESULT hr = d3d12Device->CreateCommittedResource(
+			&heapProps,
+			D3D12_HEAP_FLAG_NONE,
+			&texDesc,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			nullptr,
+			IID_PPV_ARGS(&aovOutputs[aov])
+		);
+		assert(SUCCEEDED(hr));
+		trackResource(&aovOutputs[aov], aovOutputs[aov], CRTMemoryCategory::GPU_RESOURCES);
+	}
+}
+
+void DXRTRenderer::createMaterialAlbedoBuffer()
 {
-	return alignBytes * (size / alignBytes + (size % alignBytes ? 1 : 0));
+	const auto& materials = scene->getMaterials();
+
+	// Textures are not sampled on the GPU, their materials contribute the plain albedo
+	std::vector<DirectX::XMFLOAT4> albedos(materials.size());
+	for (size_t i = 0; i < materials.size(); ++i)
+	{
+		const CRTVector& albedo = materials[i].getAlbedo();
+		albedos[i] = DirectX::XMFLOAT4(albedo.getX(), albedo.getY(), albedo.getZ(), 1.0f);
+	}
+
+	auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(DirectX::XMFLOAT4) * albedos.size());
+
+	HRESULT hr = d3d12Device->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&materialAlbedoBuffer)
+	);
+	assert(SUCCEEDED(hr));
+	trackResource(&materialAlbedoBuffer, materialAlbedoBuffer, CRTMemoryCategory::GPU_UPLOAD_BUFFERS);
+
+	void* mapped = nullptr;
+	materialAlbedoBuffer->Map(0, nullptr, &mapped);
+	memcpy(mapped, albedos.data(), desc.Width);
+	materialAlbedoBuffer->Unmap(0, nullptr);
 }
 
 void DXRTRenderer::createShaderBindingTable()
@@ -1016,63 +1472,123 @@ void DXRTRenderer::createShaderBindingTable()
 
 	void* rayGenID = rtStateObjectProps->GetShaderIdentifier(L"rayGen");
 	void* missID = rtStateObjectProps->GetShaderIdentifier(L"miss");
-	void* hitGroupID = rtStateObjectProps->GetShaderIdentifier(L"HitGroup");
+	void* hitGroupIDs[ShadingModeCount];
+	for (UINT mode = 0; mode < ShadingModeCount; mode++)
+		hitGroupIDs[mode] = rtStateObjectProps->GetShaderIdentifier(shadingModeHitGroups[mode]);
 
-	const UINT shaderIDSize = D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
-	const UINT recordSize = alignedSize(shaderIDSize, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+	// A hit group table per shading mode, each with a record per material. Only the
+	// hit group records have local root arguments, the MaterialRecord of their material.
+	const UINT materialCount = static_cast<UINT>(scene->getMaterials().size());
 
-	UINT rayGenOffset = 0;
-	UINT missOffset = alignedSize(rayGenOffset + recordSize, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
-	UINT hitGroupOffset = alignedSize(missOffset + recordSize, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+	sbtLayout = CRTShaderTableLayout();
+	rayGenTable = sbtLayout.addTable(1, 0);
+	missTable = sbtLayout.addTable(1, 0);
+	for (UINT mode = 0; mode < ShadingModeCount; mode++)
+		hitGroupTables[mode] = sbtLayout.addTable(materialCount, sizeof(MaterialRecord));
 
-	const UINT sbtSize = hitGroupOffset + recordSize;
+	const UINT sbtSize = static_cast<UINT>(sbtLayout.getSize());
 
-	// Allocate GPU upload + default heap as before
 	createSBTUploadHeap(sbtSize);
 	createSBTDefaultHeap(sbtSize);
 
-	// Copy shader IDs only, no descriptor handle for now
-	copySBTDataToUploadHeap(rayGenOffset, missOffset, hitGroupOffset, rayGenID, missID, hitGroupID);
+	copySBTDataToUploadHeap(rayGenID, missID, hitGroupIDs);
 	copySBTDataToDefaultHeap();
 
-	// Prepare DispatchRaysDesc with correct offsets
-	prepareDispatchRaysDesc(recordSize, rayGenOffset, missOffset, hitGroupOffset);
+	prepareDispatchRaysDesc();
+}
+
+bool DXRTRenderer::loadShaderLibrary(const std::wstring& fileName, const std::wstring& target,
+	std::vector<uint8_t>& dxil)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file)
+		return false;
 
+	const std::vector<uint8_t> source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	std::vector<LPCWSTR> args = { L"-T", target.c_str() };
+#ifdef _DEBUG
+	args.insert(args.end(), { L"-Zi", L"-Qembed_debug", L"-Od" });
+#else
+	args.push_back(L"-O3");
+#endif
+
+	// The flags are part of the key, so debug and release builds keep separate entries
+	std::string flags;
+	for (LPCWSTR arg : args)
+	{
+		for (const wchar_t* c = arg; *c; c++)
+			flags += static_cast<char>(*c);
+		flags += ' ';
+	}
+
+	// A new dxcompiler.dll can emit different DXIL for the same source, so its
+	// version is part of the key. Without a version the cache is not used at all.
+	const std::string compilerVersion = getCompilerVersion();
+	const uint64_t key = CRTShaderCache::makeKey(source, flags, compilerVersion);
+	if (!compilerVersion.empty() && shaderCache.load(key, dxil))
+		return true;
+
+	IDxcBlobPtr blob = compileShader(source, args);
+	if (!blob)
+		return false;
+
+	const uint8_t* code = static_cast<const uint8_t*>(blob->GetBufferPointer());
+	dxil.assign(code, code + blob->GetBufferSize());
+
+	if (!compilerVersion.empty() && !shaderCache.store(key, dxil.data(), dxil.size()))
+		std::cout << "Could not write the shader cache entry " << shaderCache.getPath(key) << std::endl;
+
+	return true;
 }
 
-IDxcBlobPtr DXRTRenderer::compileShader(
-	const std::wstring& fileName,
-	const std::wstring& /*entryPoint*/,
-	const std::wstring& target)
+std::string DXRTRenderer::getCompilerVersion()
 {
-	IDxcUtilsPtr utils;
-	IDxcCompiler3Ptr compiler;
+	IDxcVersionInfoPtr versionInfo;
+	HRESULT hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&versionInfo));
+	if (FAILED(hr)) return std::string();
 
-	HRESULT hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils));
-	if (FAILED(hr)) return nullptr;
+	UINT32 major = 0, minor = 0, flags = 0;
+	if (FAILED(versionInfo->GetVersion(&major, &minor)) || FAILED(versionInfo->GetFlags(&flags)))
+		return std::string();
 
-	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-	if (FAILED(hr)) return nullptr;
+	std::string version = std::to_string(major) + "." + std::to_string(minor) + " flags " + std::to_string(flags);
+
+	// Builds of the same release differ in their commit
+	IDxcVersionInfo2Ptr versionInfo2;
+	if (SUCCEEDED(versionInfo->QueryInterface(IID_PPV_ARGS(&versionInfo2))))
+	{
+		UINT32 commitCount = 0;
+		char* commitHash = nullptr;
+		if (SUCCEEDED(versionInfo2->GetCommitInfo(&commitCount, &commitHash)))
+		{
+			version += " commit " + std::to_string(commitCount);
+			if (commitHash)
+			{
+				version += std::string(" ") + commitHash;
+				CoTaskMemFree(commitHash);
+			}
+		}
+	}
+
+	return version;
+}
+
+IDxcBlobPtr DXRTRenderer::compileShader(const std::vector<uint8_t>& sourceCode, const std::vector<LPCWSTR>& args)
+{
+	IDxcCompiler3Ptr compiler;
 
-	IDxcBlobEncodingPtr sourceBlob;
-	hr = utils->LoadFile(fileName.c_str(), nullptr, &sourceBlob);
+	HRESULT hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
 	if (FAILED(hr)) return nullptr;
 
 	DxcBuffer source{};
-	source.Ptr = sourceBlob->GetBufferPointer();
-	source.Size = sourceBlob->GetBufferSize();
+	source.Ptr = sourceCode.data();
+	source.Size = sourceCode.size();
 	source.Encoding = DXC_CP_UTF8;
 
-	LPCWSTR args[] =
-	{
-		L"-T", target.c_str(),   // lib_6_5
-		L"-Zi",
-		L"-Qembed_debug",
-		L"-Od"
-	};
-
 	IDxcResultPtr result;
-	hr = compiler->Compile(&source, args, _countof(args), nullptr, IID_PPV_ARGS(&result));
+	hr = compiler->Compile(&source, const_cast<LPCWSTR*>(args.data()), static_cast<UINT32>(args.size()),
+		nullptr, IID_PPV_ARGS(&result));
 	if (FAILED(hr)) return nullptr;
 
 	// Print errors
@@ -1091,72 +1607,38 @@ IDxcBlobPtr DXRTRenderer::compileShader(
 	return blob;
 }
 
-
-
-D3D12_STATE_SUBOBJECT DXRTRenderer::createRayGenSubObject()
-{
-	rayGenBlob = compileShader(L"HLSL/ray_tracing_shaders.hlsl", L"rayGen", L"lib_6_5");
-
-	rayGenExportDesc = D3D12_EXPORT_DESC{};
-	rayGenExportDesc.Name = L"rayGen";
-	rayGenExportDesc.Flags = D3D12_EXPORT_FLAG_NONE;
-	
-	rayGenLib.DXILLibrary.pShaderBytecode = rayGenBlob->GetBufferPointer();
-	rayGenLib.DXILLibrary.BytecodeLength = rayGenBlob->GetBufferSize();
-	rayGenLib.NumExports = 1;
-	rayGenLib.pExports = &rayGenExportDesc;
-	
-	D3D12_STATE_SUBOBJECT rayGenLibSubobject = {};
-	rayGenLibSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY;
-	rayGenLibSubobject.pDesc = &rayGenLib;
-
-	return rayGenLibSubobject;
-}
-
-D3D12_STATE_SUBOBJECT DXRTRenderer::createClosestHitSubObject()
+D3D12_STATE_SUBOBJECT DXRTRenderer::createShaderLibrarySubObject()
 {
-	closestHitBlob = compileShader(L"HLSL/ray_tracing_shaders.hlsl", L"closestHit", L"lib_6_5");
-
-	closestHitExportDesc = D3D12_EXPORT_DESC{};
-	closestHitExportDesc.Name = L"closestHit";
-	closestHitExportDesc.Flags = D3D12_EXPORT_FLAG_NONE;
+	const bool loaded = loadShaderLibrary(L"HLSL/ray_tracing_shaders.hlsl", L"lib_6_5", shaderLibrary);
+	assert(loaded);
 
-	closestHitLib.DXILLibrary.pShaderBytecode = closestHitBlob->GetBufferPointer();
-	closestHitLib.DXILLibrary.BytecodeLength = closestHitBlob->GetBufferSize();
-	closestHitLib.NumExports = 1;
-	closestHitLib.pExports = &closestHitExportDesc;
-
-	D3D12_STATE_SUBOBJECT closestHitLibSubobject = {};
-	closestHitLibSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY;
-	closestHitLibSubobject.pDesc = &closestHitLib;
-
-	return closestHitLibSubobject;
-}
-
-D3D12_STATE_SUBOBJECT DXRTRenderer::createMissLibSubObject()
-{
-	missBlob = compileShader(L"HLSL/ray_tracing_shaders.hlsl", L"miss", L"lib_6_5");
+	for (UINT i = 0; i < ShaderExportCount; i++)
+	{
+		shaderExports[i] = D3D12_EXPORT_DESC{};
+		shaderExports[i].Flags = D3D12_EXPORT_FLAG_NONE;
+	}
 
-	missExportDesc = D3D12_EXPORT_DESC{};
-	missExportDesc.Name = L"miss";
-	missExportDesc.Flags = D3D12_EXPORT_FLAG_NONE;
+	shaderExports[0].Name = L"rayGen";
+	shaderExports[1].Name = L"miss";
+	for (UINT mode = 0; mode < ShadingModeCount; mode++)
+		shaderExports[2 + mode].Name = shadingModeClosestHits[mode];
 
-	missLib.DXILLibrary.pShaderBytecode = missBlob->GetBufferPointer();
-	missLib.DXILLibrary.BytecodeLength = missBlob->GetBufferSize();
-	missLib.NumExports = 1;
-	missLib.pExports = &missExportDesc;
+	shaderLibraryDesc.DXILLibrary.pShaderBytecode = shaderLibrary.data();
+	shaderLibraryDesc.DXILLibrary.BytecodeLength = shaderLibrary.size();
+	shaderLibraryDesc.NumExports = ShaderExportCount;
+	shaderLibraryDesc.pExports = shaderExports;
 
-	D3D12_STATE_SUBOBJECT missLibSubobject = {};
-	missLibSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY;
-	missLibSubobject.pDesc = &missLib;
+	D3D12_STATE_SUBOBJECT libSubobject = {};
+	libSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY;
+	libSubobject.pDesc = &shaderLibraryDesc;
 
-	return missLibSubobject;
+	return libSubobject;
 }
 
 D3D12_STATE_SUBOBJECT DXRTRenderer::createShaderConfigSubObject()
 {
 	shaderConfig = D3D12_RAYTRACING_SHADER_CONFIG{};
-	shaderConfig.MaxPayloadSizeInBytes = 4 * sizeof(float);
+	shaderConfig.MaxPayloadSizeInBytes = 3 * sizeof(float); // RayPayload color
 	shaderConfig.MaxAttributeSizeInBytes = 2 * sizeof(float);
 
 	D3D12_STATE_SUBOBJECT shaderConfigSubobject = {};
@@ -1189,12 +1671,38 @@ D3D12_STATE_SUBOBJECT DXRTRenderer::createGlobalRootSignatureSubObject()
 	return rootSigSubobject;
 }
 
-D3D12_STATE_SUBOBJECT DXRTRenderer::createHitGroupSubObject()
+D3D12_STATE_SUBOBJECT DXRTRenderer::createLocalRootSignatureSubObject()
+{
+	localRootSigDesc = D3D12_LOCAL_ROOT_SIGNATURE{ hitGroupRootSignature };
+
+	D3D12_STATE_SUBOBJECT localRootSigSubobject = {};
+	localRootSigSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_LOCAL_ROOT_SIGNATURE;
+	localRootSigSubobject.pDesc = &localRootSigDesc;
+
+	return localRootSigSubobject;
+}
+
+D3D12_STATE_SUBOBJECT DXRTRenderer::createLocalRootSignatureAssociationSubObject(const D3D12_STATE_SUBOBJECT* localRootSigSubobject)
+{
+	localRootSigAssociation = D3D12_SUBOBJECT_TO_EXPORTS_ASSOCIATION{};
+	localRootSigAssociation.pSubobjectToAssociate = localRootSigSubobject;
+	localRootSigAssociation.NumExports = ShadingModeCount;
+	localRootSigAssociation.pExports = const_cast<LPCWSTR*>(shadingModeHitGroups);
+
+	D3D12_STATE_SUBOBJECT associationSubobject = {};
+	associationSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_SUBOBJECT_TO_EXPORTS_ASSOCIATION;
+	associationSubobject.pDesc = &localRootSigAssociation;
+
+	return associationSubobject;
+}
+
+D3D12_STATE_SUBOBJECT DXRTRenderer::createHitGroupSubObject(UINT mode)
 {
+	D3D12_HIT_GROUP_DESC& hitGroupDesc = hitGroupDescs[mode];
 	hitGroupDesc = D3D12_HIT_GROUP_DESC{};
-	hitGroupDesc.HitGroupExport = L"HitGroup";
+	hitGroupDesc.HitGroupExport = shadingModeHitGroups[mode];
 	hitGroupDesc.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
-	hitGroupDesc.ClosestHitShaderImport = L"closestHit";
+	hitGroupDesc.ClosestHitShaderImport = shadingModeClosestHits[mode];
 
 	D3D12_STATE_SUBOBJECT hitGroupSubobject = {};
 	hitGroupSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_HIT_GROUP;
@@ -1233,6 +1741,7 @@ void DXRTRenderer::createSBTUploadHeap(const UINT sbtSize)
 		nullptr,
 		IID_PPV_ARGS(&sbtUploadBuff)
 	);
+	trackResource(&sbtUploadBuff, sbtUploadBuff, CRTMemoryCategory::GPU_UPLOAD_BUFFERS);
 }
 
 void DXRTRenderer::createSBTDefaultHeap(const UINT sbtSize)
@@ -1265,32 +1774,31 @@ void DXRTRenderer::createSBTDefaultHeap(const UINT sbtSize)
 		nullptr,
 		IID_PPV_ARGS(&sbtDefaultBuff)
 	);
+	trackResource(&sbtDefaultBuff, sbtDefaultBuff, CRTMemoryCategory::GPU_RESOURCES);
 }
 
-void DXRTRenderer::copySBTDataToUploadHeap(
-	const UINT rayGenOffset, const UINT missOffset, const UINT hitGroupOffset,
-	void* rayGenID, void* missID, void* hitGroupID)
+void DXRTRenderer::copySBTDataToUploadHeap(void* rayGenID, void* missID, void* const* hitGroupIDs)
 {
 	uint8_t* pData = nullptr;
 	sbtUploadBuff->Map(0, nullptr, reinterpret_cast<void**>(&pData));
 
-	auto writeRecord = [&](UINT offset, void* shaderID)
-		{
-			memcpy(pData + offset, shaderID, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	memcpy(pData + sbtLayout.getRecordOffset(rayGenTable, 0), rayGenID, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	memcpy(pData + sbtLayout.getRecordOffset(missTable, 0), missID, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
 
-			D3D12_GPU_DESCRIPTOR_HANDLE handle =
-				uavHeap->GetGPUDescriptorHandleForHeapStart();
+	const auto& materials = scene->getMaterials();
 
-			memcpy(
-				pData + offset + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES,
-				&handle,
-				sizeof(handle)
-			);
-		};
+	for (UINT materialIndex = 0; materialIndex < materials.size(); materialIndex++)
+	{
+		MaterialRecord record = {};
+		record.materialIndex = materialIndex;
 
-	writeRecord(rayGenOffset, rayGenID);
-	writeRecord(missOffset, missID);
-	writeRecord(hitGroupOffset, hitGroupID);
+		for (UINT mode = 0; mode < ShadingModeCount; mode++)
+		{
+			uint8_t* recordData = pData + sbtLayout.getRecordOffset(hitGroupTables[mode], materialIndex);
+			memcpy(recordData, hitGroupIDs[mode], D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+			memcpy(recordData + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, &record, sizeof(record));
+		}
+	}
 
 	sbtUploadBuff->Unmap(0, nullptr);
 }
@@ -1320,46 +1828,233 @@ void DXRTRenderer::copySBTDataToDefaultHeap()
 	waitForGPURenderFrame();
 }
 
-void DXRTRenderer::prepareDispatchRaysDesc(
-	const UINT recordSize,
-	const UINT rayGenOffset,
-	const UINT missOffset,
-	const UINT hitGroupOffset)
+void DXRTRenderer::prepareDispatchRaysDesc()
 {
+	const D3D12_GPU_VIRTUAL_ADDRESS sbtStart = sbtDefaultBuff->GetGPUVirtualAddress();
+
+	const CRTShaderTableRange& rayGen = sbtLayout.getTable(rayGenTable);
 	raysDesc.RayGenerationShaderRecord.StartAddress =
-		sbtDefaultBuff->GetGPUVirtualAddress() + rayGenOffset;
+		sbtStart + rayGen.offset;
 	raysDesc.RayGenerationShaderRecord.SizeInBytes =
-		recordSize;
+		rayGen.recordStride;
 
+	const CRTShaderTableRange& miss = sbtLayout.getTable(missTable);
 	raysDesc.MissShaderTable.StartAddress =
-		sbtDefaultBuff->GetGPUVirtualAddress() + missOffset;
+		sbtStart + miss.offset;
 	raysDesc.MissShaderTable.SizeInBytes =
-		recordSize;
+		miss.getSize();
 	raysDesc.MissShaderTable.StrideInBytes =
-		recordSize;
+		miss.recordStride;
 
-	raysDesc.HitGroupTable.StartAddress =
-		sbtDefaultBuff->GetGPUVirtualAddress() + hitGroupOffset;
-	raysDesc.HitGroupTable.SizeInBytes =
-		recordSize;
-	raysDesc.HitGroupTable.StrideInBytes =
-		recordSize;
+	selectHitGroupTable();
 
-	raysDesc.Width = 1920;
-	raysDesc.Height = 1080;
+	raysDesc.Width = resolution.getRenderWidth();
+	raysDesc.Height = resolution.getRenderHeight();
 	raysDesc.Depth = 1;
 	raysDesc.CallableShaderTable = {};
 }
 
+void DXRTRenderer::selectHitGroupTable()
+{
+	const CRTShaderTableRange& hitGroups = sbtLayout.getTable(hitGroupTables[currentShadingMode]);
+
+	raysDesc.HitGroupTable.StartAddress =
+		sbtDefaultBuff->GetGPUVirtualAddress() + hitGroups.offset;
+	raysDesc.HitGroupTable.SizeInBytes =
+		hitGroups.getSize();
+	raysDesc.HitGroupTable.StrideInBytes =
+		hitGroups.recordStride;
+}
+
 void DXRTRenderer::stopRendering()
 {
-	//waitForGPURenderFrame(); //Bug arises
+	framePacer.waitForIdle(*frameFence);
+}
+
+void DXRTRenderer::resize(int width, int height)
+{
+	// The window reports its size before the renderer is prepared too
+	if (!swapChain || !resolution.setOutputSize(width, height))
+		return;
+
+	framePacer.waitForIdle(*frameFence);
+
+	for (UINT scBuffIdx = 0; scBuffIdx < FrameCount; scBuffIdx++)
+		renderTargets[scBuffIdx] = nullptr;
+
+	HRESULT hr = swapChain->ResizeBuffers(FrameCount, resolution.getOutputWidth(), resolution.getOutputHeight(),
+		DXGI_FORMAT_UNKNOWN, 0);
+	assert(SUCCEEDED(hr));
+
+	createRenderTargetViewsFromSwapChain();
+	swapChainFrameIdx = swapChain->GetCurrentBackBufferIndex();
+	backBufferState = D3D12_RESOURCE_STATE_PRESENT;
+
+	// Geometry, acceleration structures and the pipeline do not depend on the size
+	createRayTracingOutput();
+	createAOVTextures();
+	writeOutputViews();
+
+	std::cout << "Output resized to " << width << "x" << height << std::endl;
+}
+
+void DXRTRenderer::setDynamicResolution(bool enabled)
+{
+	dynamicResolution.setEnabled(enabled);
+}
+
+void DXRTRenderer::setBudgetScale(float scale)
+{
+	budgetScale = scale;
+}
+
+float DXRTRenderer::getRenderScale() const
+{
+	return resolution.getScale();
 }
 
 void DXRTRenderer::changeShadingMode(uint32_t value)
 {
+	assert(value < ShadingModeCount);
 	currentShadingMode = value;
-	isChangedShadingMode = true;
+}
+
+uint32_t DXRTRenderer::getShadingMode() const
+{
+	return currentShadingMode;
+}
+
+void DXRTRenderer::changeAOVMask(uint32_t mask)
+{
+	currentAOVMask = mask;
+}
+
+void DXRTRenderer::readbackAOVs(CRTAOVBuffers& aovs)
+{
+	// Only the traced part of the targets holds the last frame
+	const int width = static_cast<int>(raysDesc.Width);
+	const int height = static_cast<int>(raysDesc.Height);
+
+	aovs.resize(width, height, currentAOVMask);
+
+	ID3D12ResourcePtr readbackBuffers[AOVCount];
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprints[AOVCount] = {};
+
+	HRESULT hr = commandAllocator->Reset();
+	assert(SUCCEEDED(hr));
+	hr = commandList->Reset(commandAllocator, nullptr);
+	assert(SUCCEEDED(hr));
+
+	auto readbackHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+
+	for (UINT aov = 0; aov < AOVCount; aov++)
+	{
+		if (!aovs.has(1u << aov))
+			continue;
+
+		const D3D12_RESOURCE_DESC aovDesc = aovOutputs[aov]->GetDesc();
+		UINT64 totalBytes = 0;
+		d3d12Device->GetCopyableFootprints(&aovDesc, 0, 1, 0, &footprints[aov], nullptr, nullptr, &totalBytes);
+
+		auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(totalBytes);
+		hr = d3d12Device->CreateCommittedResource(
+			&readbackHeap,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&readbackBuffers[aov])
+		);
+		assert(SUCCEEDED(hr));
+
+		D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+			aovOutputs[aov],
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_COPY_SOURCE
+		);
+		commandList->ResourceBarrier(1, &barrier);
+
+		CD3DX12_TEXTURE_COPY_LOCATION dst(readbackBuffers[aov], footprints[aov]);
+		CD3DX12_TEXTURE_COPY_LOCATION src(aovOutputs[aov], 0);
+		commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+		barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+			aovOutputs[aov],
+			D3D12_RESOURCE_STATE_COPY_SOURCE,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS
+		);
+		commandList->ResourceBarrier(1, &barrier);
+	}
+
+	hr = commandList->Close();
+	assert(SUCCEEDED(hr));
+
+	ID3D12CommandList* lists[] = { commandList };
+	commandQueue->ExecuteCommandLists(1, lists);
+	hr = commandQueue->Signal(renderFramefence, renderFramefenceValue);
+	assert(SUCCEEDED(hr));
+	waitForGPURenderFrame();
+
+	for (UINT aov = 0; aov < AOVCount; aov++)
+	{
+		if (!readbackBuffers[aov])
+			continue;
+
+		uint8_t* data = nullptr;
+		hr = readbackBuffers[aov]->Map(0, nullptr, reinterpret_cast<void**>(&data));
+		assert(SUCCEEDED(hr));
+
+		const UINT rowPitch = footprints[aov].Footprint.RowPitch;
+
+		for (int y = 0; y < height; y++)
+		{
+			const uint8_t* row = data + footprints[aov].Offset + static_cast<size_t>(y) * rowPitch;
+			const float* floats = reinterpret_cast<const float*>(row);
+			const uint32_t* uints = reinterpret_cast<const uint32_t*>(row);
+
+			for (int x = 0; x < width; x++)
+			{
+				const size_t pixelIndex = static_cast<size_t>(y) * width + x;
+
+				switch (1u << aov)
+				{
+				case CRTAOVMask::depth:
+					aovs.depth[pixelIndex] = floats[x];
+					break;
+				case CRTAOVMask::normal:
+					aovs.normal.setPixel(x, y, CRTVector(floats[4 * x], floats[4 * x + 1], floats[4 * x + 2]));
+					break;
+				case CRTAOVMask::barycentrics:
+					aovs.barycentrics.setPixel(x, y, CRTVector(floats[4 * x], floats[4 * x + 1], floats[4 * x + 2]));
+					break;
+				case CRTAOVMask::primitiveID:
+					aovs.primitiveID[pixelIndex] = static_cast<int>(uints[x]); // Misses are written as ~0, so -1
+					break;
+				case CRTAOVMask::instanceID:
+					aovs.instanceID[pixelIndex] = static_cast<int>(uints[x]);
+					break;
+				case CRTAOVMask::albedo:
+					aovs.albedo.setPixel(x, y, CRTVector(floats[4 * x], floats[4 * x + 1], floats[4 * x + 2]));
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		D3D12_RANGE writtenRange = { 0, 0 };
+		readbackBuffers[aov]->Unmap(0, &writtenRange);
+	}
+}
+
+float DXRTRenderer::getLastGPUWaitSeconds() const
+{
+	return lastGPUWaitSeconds;
+}
+
+float DXRTRenderer::getLastPresentSeconds() const
+{
+	return lastPresentSeconds;
 }
 
 CRTScene& DXRTRenderer::getScene()
@@ -1369,17 +2064,16 @@ CRTScene& DXRTRenderer::getScene()
 
 void DXRTRenderer::renderFrame()
 {
+	CRT_TRACE_ZONE("renderFrame");
+
 	frameBegin();
 
 	ID3D12DescriptorHeap* heaps[] = { uavHeap };
 	dxrCmdList->SetDescriptorHeaps(_countof(heaps), heaps);
 	dxrCmdList->SetComputeRootSignature(globalRootSignature);
 	dxrCmdList->SetComputeRootDescriptorTable(0, uavHeap->GetGPUDescriptorHandleForHeapStart());
-	dxrCmdList->SetComputeRootConstantBufferView(1, cameraCB->GetGPUVirtualAddress());
-	dxrCmdList->SetComputeRootConstantBufferView(
-		2,
-		debugCB->GetGPUVirtualAddress()
-	);
+	dxrCmdList->SetComputeRootConstantBufferView(1, cameraCBAddress);
+	dxrCmdList->SetComputeRootConstantBufferView(2, debugCBAddress);
 	dxrCmdList->SetPipelineState1(rtStateObject);
 	FLOAT clearColor[4] = { 0.f, 0.f, 1.f, 1.f };
 
@@ -1402,7 +2096,13 @@ void DXRTRenderer::renderFrame()
 		nullptr
 	);
 
-	dxrCmdList->DispatchRays(&raysDesc);
+	raysDesc.Width = resolution.getRenderWidth();
+	raysDesc.Height = resolution.getRenderHeight();
+	selectHitGroupTable();
+	{
+		CRT_TRACE_ZONE("DispatchRays");
+		dxrCmdList->DispatchRays(&raysDesc);
+	}
 
 	frameEnd();
 }
@@ -9,6 +9,14 @@
 #include <DirectXMath.h>
 
 #include "CRTScene.h"
+#include "CRTAOVBuffers.h"
+#include "CRTBufferSuballocator.h"
+#include "CRTFramePacer.h"
+#include "CRTRenderResolution.h"
+#include "CRTShaderCache.h"
+#include "CRTDebugShading.h"
+#include "CRTShaderTable.h"
+#include "CRTMemory.h"
 
 #define CDXC_MAKE_SMART_COM_POINTER(_a) _COM_SMARTPTR_TYPEDEF(_a, __uuidof(_a))
 
@@ -19,6 +27,7 @@ CDXC_MAKE_SMART_COM_POINTER(ID3D12CommandQueue);
 CDXC_MAKE_SMART_COM_POINTER(ID3D12CommandAllocator);
 CDXC_MAKE_SMART_COM_POINTER(ID3D12GraphicsCommandList);
 CDXC_MAKE_SMART_COM_POINTER(ID3D12Resource);
+CDXC_MAKE_SMART_COM_POINTER(ID3D12Heap);
 CDXC_MAKE_SMART_COM_POINTER(ID3D12DescriptorHeap);
 CDXC_MAKE_SMART_COM_POINTER(ID3D12Fence);
 CDXC_MAKE_SMART_COM_POINTER(IDXGISwapChain1);
@@ -36,6 +45,8 @@ CDXC_MAKE_SMART_COM_POINTER(IDxcCompiler3);
 CDXC_MAKE_SMART_COM_POINTER(IDxcResult);
 CDXC_MAKE_SMART_COM_POINTER(IDxcBlobEncoding);
 CDXC_MAKE_SMART_COM_POINTER(IDxcBlobUtf8);
+CDXC_MAKE_SMART_COM_POINTER(IDxcVersionInfo);
+CDXC_MAKE_SMART_COM_POINTER(IDxcVersionInfo2);
 CDXC_MAKE_SMART_COM_POINTER(ID3D12Device5);
 CDXC_MAKE_SMART_COM_POINTER(ID3D12StateObject);
 CDXC_MAKE_SMART_COM_POINTER(ID3D12StateObjectProperties);
@@ -56,27 +67,34 @@ struct CameraCB
 	DirectX::XMFLOAT3 cameraPosition;
 	float pad0;
 	DirectX::XMFLOAT4X4 cameraRotation;
+	uint32_t renderWidth; // Size of the traced part of the output
+	uint32_t renderHeight;
+	float pad1[2];
 };
 
 struct BLAS
 {
-	ID3D12ResourcePtr buffer;
-	ID3D12ResourcePtr scratch;
+	CRTSuballocation range; // Compacted BLAS inside the acceleration structure heaps
+	UINT64 size = 0;
 	D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
 };
 
 struct DebugCB
 {
-	uint32_t shadingMode;
+	uint32_t aovMask;
 	float pad[3];
 };
 
+class DXRTFrameFence;
+
 class DXRTRenderer
 {
 public:
 
 	DXRTRenderer();
 
+	~DXRTRenderer();
+
 	// Initiate the actual rendering
 	void render();
 
@@ -89,7 +107,31 @@ public:
 
 	void stopRendering();
 
+	// Select the hit group of a CRTShadingMode, nothing changes for the shaders
 	void changeShadingMode(uint32_t value);
+	uint32_t getShadingMode() const;
+
+	// Select the AOVs written by the next frames, see CRTAOVMask. 0 disables them
+	void changeAOVMask(uint32_t mask);
+
+	// Copy the AOVs of the last rendered frame to the CPU, only the ones in the current mask
+	void readbackAOVs(CRTAOVBuffers& aovs);
+
+	// Resize the swap chain and recreate the size-dependent targets, after the frames in flight completed
+	void resize(int width, int height);
+
+	// Trace at a reduced resolution while the camera moves
+	void setDynamicResolution(bool enabled);
+
+	// Upper limit of the render scale, set by the frame budget of the application
+	void setBudgetScale(float scale);
+
+	// Scale the last frame was traced at
+	float getRenderScale() const;
+
+	// Time the last frame blocked on the fence of an earlier frame and in Present
+	float getLastGPUWaitSeconds() const;
+	float getLastPresentSeconds() const;
 
 	CRTScene& getScene();
 private:
@@ -111,14 +153,29 @@ private:
 	// Stall the CPU untill the GPU finishes with the frame rendering
 	void waitForGPURenderFrame();
 
-	// Create the vertices that will be rendered by the pipeline for the frame
-	// Use an upload heap to store the vertices on the CPU memory, the GPU will access them using the PCIe
-	void createVertexBuffers();
+	// Create the vertex and index buffers of all meshes in the default heap
+	// The data is copied through one staging buffer, with a single submission for the whole scene
+	void createGeometryBuffers();
 
-	void createIndexBuffers();
+	// Create a heap, with a buffer placed over all of it, for each new block of the allocator
+	void createBufferBlocks(const CRTBufferSuballocator& allocator, std::vector<ID3D12HeapPtr>& heaps,
+		std::vector<ID3D12ResourcePtr>& buffers, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initialState,
+		CRTMemoryCategory category);
 
-	void createDebugCB();
+	// Report the size of the resource or heap held in slot to CRTMemory, replacing
+	// what was reported for the slot before. A null resource removes it.
+	void trackResource(const void* slot, ID3D12Resource* resource, CRTMemoryCategory category);
+	void trackDescriptorHeap(const void* slot, ID3D12DescriptorHeap* heap);
 
+	D3D12_GPU_VIRTUAL_ADDRESS getGeometryAddress(const CRTSuballocation& range) const;
+
+	// Objects without a triangle, which get no geometry ranges
+	static bool isEmptyMesh(const CRTMesh& mesh);
+
+	// Create the command allocator of every frame in flight, the frame fence and the constant ring
+	void createFrameResources();
+
+	// Write the constants of the current frame into its slice of the constant ring
 	void updateDebugCB();
 
 	void createScene();
@@ -129,36 +186,74 @@ private:
 
 	void frameEnd();
 
-	void createCameraBuffer();
-
 	void createAccelerationStructures();
 
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS getTopLevelInputs(UINT instanceCount) const;
+
+	// Scratch needed by both a full build and an update of the TLAS
+	UINT64 getTopLevelScratchSize(UINT instanceCount) const;
+
+	static UINT getInstanceCapacity(size_t instanceCount);
+
+	// Create the TLAS and instance buffers for instanceCapacity instances
+	void createTopLevelAS();
+
+	// Record the TLAS build into dxrCmdList, from the instance descs of the frame
+	void buildTopLevelAS(CRTTopLevelUpdate update, int frameIndex);
+
+	// Bring the TLAS up to date with the instances of the scene
+	void updateTopLevelAS(int frameIndex);
+
+	void writeTopLevelASView();
+
 	void createGlobalRootSignature();
 
+	// Root signature of the hit groups, their MaterialRecord comes from the shader record
+	void createLocalRootSignature();
+
 	void createRayTracingPipelineState();
 
 	void createRayTracingShaderTexture();
 
+	// Create the frame output texture, with the size of the output
+	void createRayTracingOutput();
+
+	// Write the UAVs of the frame output and the AOV targets, after they were recreated
+	void writeOutputViews();
+
+	// Create the UAV textures the shaders write the AOVs to
+	void createAOVTextures();
+
+	// Upload the albedo of every material, read by the albedo AOV
+	void createMaterialAlbedoBuffer();
+
 	void createShaderBindingTable();
 
-	IDxcBlobPtr compileShader(const std::wstring& fileName, const std::wstring& entryPoint,
-							  const std::wstring& target);
+	// Compile the whole library in one go, or take it from the shader cache when neither the source, the flags nor the compiler changed
+	bool loadShaderLibrary(const std::wstring& fileName, const std::wstring& target, std::vector<uint8_t>& dxil);
+
+	// Version and commit of the loaded dxcompiler.dll, empty when it cannot be queried
+	std::string getCompilerVersion();
+
+	IDxcBlobPtr compileShader(const std::vector<uint8_t>& sourceCode, const std::vector<LPCWSTR>& args);
 
-	D3D12_STATE_SUBOBJECT createRayGenSubObject();
-	D3D12_STATE_SUBOBJECT createClosestHitSubObject();
-	D3D12_STATE_SUBOBJECT createMissLibSubObject();
+	// One DXIL library exporting rayGen, miss and the closest hit shader of every shading mode
+	D3D12_STATE_SUBOBJECT createShaderLibrarySubObject();
 	D3D12_STATE_SUBOBJECT createShaderConfigSubObject();
 	D3D12_STATE_SUBOBJECT createPipelineConfigSubObject();
 	D3D12_STATE_SUBOBJECT createGlobalRootSignatureSubObject();
-	D3D12_STATE_SUBOBJECT createHitGroupSubObject();
+	D3D12_STATE_SUBOBJECT createHitGroupSubObject(UINT mode);
+	D3D12_STATE_SUBOBJECT createLocalRootSignatureSubObject();
+	D3D12_STATE_SUBOBJECT createLocalRootSignatureAssociationSubObject(const D3D12_STATE_SUBOBJECT* localRootSigSubobject);
 
 	void createSBTUploadHeap(const UINT sbtSize);
 	void createSBTDefaultHeap(const UINT sbtSize);
-	void copySBTDataToUploadHeap(const UINT rayGenOffset, const UINT missOffset, const UINT hitGroupOffset,
-		void* rayGenID, void* missId, void* hitGroupID);
+	void copySBTDataToUploadHeap(void* rayGenID, void* missID, void* const* hitGroupIDs);
 	void copySBTDataToDefaultHeap();
-	void prepareDispatchRaysDesc(const UINT sbtSize, const UINT rayGenOffset,
-		const UINT missOffset, const UINT hitGroupOffset);
+	void prepareDispatchRaysDesc();
+
+	// Point the dispatch at the hit group table of the current shading mode
+	void selectHitGroupTable();
 
 private:
 	
@@ -174,26 +269,37 @@ private:
 	ID3D12ResourcePtr raytracingOutput;
 	ID3D12DescriptorHeapPtr uavHeap;
 	ID3D12RootSignaturePtr globalRootSignature;
+	ID3D12RootSignaturePtr hitGroupRootSignature;
 
-	D3D12_EXPORT_DESC rayGenExportDesc;
-	D3D12_DXIL_LIBRARY_DESC rayGenLib;
-	IDxcBlobPtr rayGenBlob;
-
-	D3D12_EXPORT_DESC closestHitExportDesc;
-	D3D12_DXIL_LIBRARY_DESC closestHitLib;
-	IDxcBlobPtr closestHitBlob;
-
-	D3D12_EXPORT_DESC missExportDesc;
-	D3D12_DXIL_LIBRARY_DESC missLib;
-	IDxcBlobPtr missBlob;
+	// A hit group for each CRTShadingMode, in that order
+	static const UINT ShadingModeCount = static_cast<UINT>(CRTShadingMode::COUNT);
+	static const UINT ShaderExportCount = 2 + ShadingModeCount;
+	D3D12_EXPORT_DESC shaderExports[ShaderExportCount];
+	D3D12_DXIL_LIBRARY_DESC shaderLibraryDesc;
+	std::vector<uint8_t> shaderLibrary; // DXIL of ray_tracing_shaders.hlsl
+	CRTShaderCache shaderCache;
 
-	D3D12_HIT_GROUP_DESC hitGroupDesc;
+	D3D12_HIT_GROUP_DESC hitGroupDescs[ShadingModeCount];
 
 	D3D12_RAYTRACING_SHADER_CONFIG shaderConfig;
 	D3D12_RAYTRACING_PIPELINE_CONFIG pipelineConfig;
 	D3D12_GLOBAL_ROOT_SIGNATURE rootSigDesc;
+	D3D12_LOCAL_ROOT_SIGNATURE localRootSigDesc;
+	D3D12_SUBOBJECT_TO_EXPORTS_ASSOCIATION localRootSigAssociation;
 	D3D12_DISPATCH_RAYS_DESC raysDesc;
 
+	// Local root arguments of a hit group record, the HLSL MaterialRecord
+	struct MaterialRecord
+	{
+		uint32_t materialIndex;
+	};
+
+	// Ray generation, miss, then a hit group table per shading mode with a record per material
+	CRTShaderTableLayout sbtLayout;
+	int rayGenTable = 0;
+	int missTable = 0;
+	int hitGroupTables[ShadingModeCount] = {};
+
 	ID3D12StateObjectPtr rtStateObject;
 
 	ID3D12ResourcePtr sbtUploadBuff;
@@ -225,32 +331,64 @@ private:
 	D3D12_RESOURCE_STATES raytracingOutputState = D3D12_RESOURCE_STATE_COMMON;
 	D3D12_RESOURCE_STATES backBufferState = D3D12_RESOURCE_STATE_PRESENT;
 
-	// Bottom-Level Acceleration Structure (BLAS)
-	ID3D12ResourcePtr blasBuffer;      // GPU buffer storing BLAS
-	ID3D12ResourcePtr blasScratch;     // Scratch buffer for building BLAS
+	// Bottom-Level Acceleration Structures (BLAS), compacted and suballocated
+	static const UINT64 accelerationStructureBlockSize = 16ull << 20;
+	CRTBufferSuballocator accelerationStructureAllocator{ accelerationStructureBlockSize };
+	std::vector<ID3D12HeapPtr> accelerationStructureHeaps;
+	std::vector<ID3D12ResourcePtr> accelerationStructureBuffers;
+	std::vector<BLAS> blasList;
 
-	// Top-Level Acceleration Structure (TLAS)
+	// Top-Level Acceleration Structure (TLAS), refitted in place while only transforms change
 	ID3D12ResourcePtr tlasBuffer;      // GPU buffer storing TLAS
-	ID3D12ResourcePtr tlasScratch;     // Scratch buffer for building TLAS
-	ID3D12ResourcePtr instanceBuffer;  // Instance description buffer
-	std::vector<BLAS> blasList;
+	ID3D12ResourcePtr instanceBuffer;  // Instance descs of every frame in flight, persistently mapped
+	D3D12_RAYTRACING_INSTANCE_DESC* instanceDescs = nullptr;
+	UINT instanceCapacity = 0;
+	CRTInstanceTracker tlasTracker;
+
+	ID3D12ResourcePtr scratchPool;     // Scratch of all AS builds, sized to the largest one
 
 	// GPU pointers
 	D3D12_GPU_VIRTUAL_ADDRESS blasBufferAddress;
 	D3D12_GPU_VIRTUAL_ADDRESS tlasBufferAddress;
 
 	std::unique_ptr<CRTScene> scene;
-	ID3D12ResourcePtr cameraCB;
 
-	ID3D12ResourcePtr debugCB;
+	// Frames recorded ahead of the GPU, each one with its own allocator and constants
+	static const int FramesInFlight = 2;
+	static const UINT64 frameConstantsSize = 512; // CameraCB and DebugCB, 256 byte aligned
+	CRTFramePacer framePacer{ FramesInFlight };
+	std::unique_ptr<DXRTFrameFence> frameFence;
+	ID3D12CommandAllocatorPtr frameAllocators[FramesInFlight];
+	CRTConstantRing constantRing{ FramesInFlight, frameConstantsSize };
+	ID3D12ResourcePtr frameConstants; // Persistently mapped upload buffer behind the constant ring
+	uint8_t* frameConstantsData = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS cameraCBAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS debugCBAddress = 0;
+	float lastGPUWaitSeconds = 0.f;
+	float lastPresentSeconds = 0.f;
+
 	uint32_t currentShadingMode = 0;
-	bool isChangedShadingMode = true;
 
-	// Geometry buffers (one per mesh)
-	std::vector<ID3D12ResourcePtr> vertexBuffers;
-	std::vector<ID3D12ResourcePtr> indexBuffers;
-	std::vector<ID3D12ResourcePtr> uploadVertexBuffers;
-	std::vector<ID3D12ResourcePtr> uploadIndexBuffers;
+	// Output size, from the scene settings until the window reports its own
+	CRTRenderResolution resolution;
+	CRTDynamicResolution dynamicResolution;
+	float budgetScale = 1.f;
+	CameraCB lastCameraCB = {}; // Camera of the previous frame, to tell whether it moves
+
+	// AOV targets u1..u6, in CRTAOVMask bit order
+	static const UINT AOVCount = 6;
+	ID3D12ResourcePtr aovOutputs[AOVCount];
+	ID3D12ResourcePtr materialAlbedoBuffer;
+	uint32_t currentAOVMask = 0;
+
+	// Geometry of all meshes, suballocated from a few large heaps
+	static const UINT64 geometryBlockSize = 32ull << 20;
+	static const UINT64 geometryAlignment = 16;
+	CRTBufferSuballocator geometryAllocator{ geometryBlockSize };
+	std::vector<ID3D12HeapPtr> geometryHeaps;
+	std::vector<ID3D12ResourcePtr> geometryBuffers; // One buffer placed over each heap
+	std::vector<CRTSuballocation> vertexRanges;
+	std::vector<CRTSuballocation> indexRanges;
 
 
 	ID3D12DescriptorHeapPtr clearHeap; // CPU-only heap for ClearUAV
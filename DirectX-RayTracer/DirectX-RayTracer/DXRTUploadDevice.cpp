@@ -0,0 +1,142 @@
+#include "DXRTUploadDevice.h"
+#include <algorithm>
+#include <cassert>
+#include <directx/d3dx12.h>
+#include "CRTMemory.h"
+
+DXRTUploadDevice::DXRTUploadDevice(
+	ID3D12Device* device,
+	ID3D12CommandQueue* commandQueue,
+	ID3D12CommandAllocator* commandAllocator,
+	ID3D12GraphicsCommandList* commandList,
+	std::function<void()> waitForGPU
+) :
+	device(device),
+	commandQueue(commandQueue),
+	commandAllocator(commandAllocator),
+	commandList(commandList),
+	waitForGPU(std::move(waitForGPU))
+{
+}
+
+DXRTUploadDevice::~DXRTUploadDevice()
+{
+	releaseStaging();
+}
+
+void DXRTUploadDevice::addDestination(ID3D12Resource* buffer, D3D12_RESOURCE_STATES finalState, UINT64 offset)
+{
+	destinations.push_back({ buffer, finalState, offset });
+}
+
+void* DXRTUploadDevice::mapStaging(uint64_t size)
+{
+	if (size <= stagingCapacity)
+		return stagingData;
+
+	releaseStaging();
+
+	auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	HRESULT hr = device->CreateCommittedResource(
+		&uploadHeap,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&staging)
+	);
+	assert(SUCCEEDED(hr));
+
+	// Upload heaps can stay mapped, the CPU only writes while the GPU is idle
+	CD3DX12_RANGE readRange(0, 0);
+	hr = staging->Map(0, &readRange, &stagingData);
+	assert(SUCCEEDED(hr));
+
+	stagingCapacity = size;
+	CRTMemory::setResource(this, CRTMemoryCategory::GPU_UPLOAD_BUFFERS, size);
+	return stagingData;
+}
+
+void DXRTUploadDevice::recordCopy(int requestIndex, uint64_t stagingOffset, uint64_t size)
+{
+	assert(requestIndex < static_cast<int>(destinations.size()));
+	const Destination& destination = destinations[requestIndex];
+
+	if (!isRecording)
+	{
+		commandAllocator->Reset();
+		commandList->Reset(commandAllocator, nullptr);
+		isRecording = true;
+	}
+
+	if (std::find(pendingBarriers.begin(), pendingBarriers.end(), destination.buffer) == pendingBarriers.end())
+	{
+		// A buffer shared with an earlier batch has to go back to COPY_DEST first
+		auto finished = std::find(finishedBuffers.begin(), finishedBuffers.end(), destination.buffer);
+		if (finished != finishedBuffers.end())
+		{
+			auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(destination.buffer, destination.finalState, D3D12_RESOURCE_STATE_COPY_DEST);
+			commandList->ResourceBarrier(1, &barrier);
+			finishedBuffers.erase(finished);
+		}
+
+		pendingBarriers.push_back(destination.buffer);
+	}
+
+	commandList->CopyBufferRegion(destination.buffer, destination.offset, staging, stagingOffset, size);
+}
+
+void DXRTUploadDevice::submitAndWait()
+{
+	if (!isRecording)
+		return;
+
+	// One barrier per buffer, even if several copies went into it
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+	barriers.reserve(pendingBarriers.size());
+
+	for (ID3D12Resource* buffer : pendingBarriers)
+	{
+		D3D12_RESOURCE_STATES finalState = D3D12_RESOURCE_STATE_COMMON;
+		for (const Destination& destination : destinations)
+		{
+			if (destination.buffer == buffer)
+			{
+				finalState = destination.finalState;
+				break;
+			}
+		}
+
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(buffer, D3D12_RESOURCE_STATE_COPY_DEST, finalState));
+	}
+
+	commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+	commandList->Close();
+
+	ID3D12CommandList* lists[] = { commandList };
+	commandQueue->ExecuteCommandLists(1, lists);
+	waitForGPU();
+
+	finishedBuffers.insert(finishedBuffers.end(), pendingBarriers.begin(), pendingBarriers.end());
+	pendingBarriers.clear();
+	isRecording = false;
+	submissionCount++;
+}
+
+void DXRTUploadDevice::releaseStaging()
+{
+	if (staging)
+		staging->Unmap(0, nullptr);
+
+	staging = nullptr;
+	stagingData = nullptr;
+	stagingCapacity = 0;
+	CRTMemory::setResource(this, CRTMemoryCategory::GPU_UPLOAD_BUFFERS, 0);
+}
+
+int DXRTUploadDevice::getSubmissionCount() const
+{
+	return submissionCount;
+}
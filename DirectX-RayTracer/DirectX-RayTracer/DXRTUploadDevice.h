@@ -0,0 +1,61 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+#include "DXRTRenderer.h"
+#include "CRTUploadPlanner.h"
+
+// Executes the batches of a CRTUploadPlanner on D3D12. The staging data goes
+// through one persistently mapped upload buffer, reused by all batches.
+class DXRTUploadDevice : public CRTUploadDevice
+{
+public:
+	DXRTUploadDevice(
+		ID3D12Device* device,
+		ID3D12CommandQueue* commandQueue,
+		ID3D12CommandAllocator* commandAllocator,
+		ID3D12GraphicsCommandList* commandList,
+		std::function<void()> waitForGPU
+	);
+
+	~DXRTUploadDevice();
+
+	// Has to be called in the order of CRTUploadPlanner::add. The destination
+	// has to be in COPY_DEST, it is left in finalState after the copy. Several
+	// destinations can share a buffer at different offsets.
+	void addDestination(ID3D12Resource* buffer, D3D12_RESOURCE_STATES finalState, UINT64 offset = 0);
+
+	void* mapStaging(uint64_t size) override;
+	void recordCopy(int requestIndex, uint64_t stagingOffset, uint64_t size) override;
+	void submitAndWait() override;
+
+	// Frees the upload memory once all batches are done
+	void releaseStaging();
+
+	int getSubmissionCount() const;
+
+private:
+	struct Destination
+	{
+		ID3D12Resource* buffer;
+		D3D12_RESOURCE_STATES finalState;
+		UINT64 offset;
+	};
+
+	ID3D12Device* device;
+	ID3D12CommandQueue* commandQueue;
+	ID3D12CommandAllocator* commandAllocator;
+	ID3D12GraphicsCommandList* commandList;
+	std::function<void()> waitForGPU;
+
+	std::vector<Destination> destinations;
+	std::vector<ID3D12Resource*> pendingBarriers; // Destinations written by the current batch
+	std::vector<ID3D12Resource*> finishedBuffers; // Destinations already moved to their final state
+
+	ID3D12ResourcePtr staging;
+	UINT64 stagingCapacity = 0;
+	void* stagingData = nullptr;
+
+	bool isRecording = false;
+	int submissionCount = 0;
+};
@@ -1,6 +1,7 @@
 #include "DXRTViewportWidget.h"
 #include <QKeyEvent>
 #include <QMouseEvent>
+#include <QResizeEvent>
 #include "DXRTApp.h"
 #include <iostream>
 
@@ -97,6 +98,15 @@ const QSet<int>& DXRTViewportWidget::getPressedKeys() const
 	return keysPressed;
 }
 
+void DXRTViewportWidget::resizeEvent(QResizeEvent* event)
+{
+	QWidget::resizeEvent(event);
+
+	// The swap chain works in physical pixels
+	const qreal pixelRatio = devicePixelRatioF();
+	app->resizeViewport(qRound(event->size().width() * pixelRatio), qRound(event->size().height() * pixelRatio));
+}
+
 void DXRTViewportWidget::paintEvent(QPaintEvent* event)
 {
 	QPainter painter(this);
@@ -1,28 +1,128 @@
 RaytracingAccelerationStructure sceneBVHAccStruct : register(t0);
 RWTexture2D<float4> frameTexture : register(u0);
 
+// AOV targets, written from the primary hit for the bits set in aovMask
+RWTexture2D<float> depthOutput : register(u1);
+RWTexture2D<float4> normalOutput : register(u2);
+RWTexture2D<float4> barycentricsOutput : register(u3);
+RWTexture2D<uint> primitiveIDOutput : register(u4);
+RWTexture2D<uint> instanceIDOutput : register(u5);
+RWTexture2D<float4> albedoOutput : register(u6);
+
+// Indexed by the material of the hit group record
+StructuredBuffer<float4> materialAlbedos : register(t1);
+
+// Mesh geometry, indexed by InstanceID()
+ByteAddressBuffer vertexBuffers[] : register(t0, space1);
+ByteAddressBuffer indexBuffers[] : register(t0, space2);
+
+// Same bits as CRTAOVMask
+#define AOV_DEPTH 0x1
+#define AOV_NORMAL 0x2
+#define AOV_BARYCENTRICS 0x4
+#define AOV_PRIMITIVE_ID 0x8
+#define AOV_INSTANCE_ID 0x10
+#define AOV_ALBEDO 0x20
+
+#define MISS_COLOR float3(0.0, 1.0, 1.0)
+
 cbuffer CameraCB : register(b0)
 {
     float3 cameraPosition;
     float _pad0;
     row_major float4x4 cameraRotation;
+    uint2 renderSize; // Traced part of the output, smaller while the resolution is reduced
 };
 
 struct RayPayload
 {
-    float4 pixelColor;
+    float3 color;
 };
 
 cbuffer DebugCB : register(b1)
 {
-    uint shadingMode;
+    uint aovMask;
+}
+
+// Local root arguments of the hit group record, one record per material.
+// Textures are not sampled on the GPU, so the material index is all it holds.
+struct MaterialRecord
+{
+    uint materialIndex;
+};
+
+ConstantBuffer<MaterialRecord> materialRecord : register(b2);
+
+float3 triangleNormal(uint mesh, uint primitive)
+{
+    uint3 tri = indexBuffers[NonUniformResourceIndex(mesh)].Load3(primitive * 12);
+
+    float3 v0 = asfloat(vertexBuffers[NonUniformResourceIndex(mesh)].Load3(tri.x * 12));
+    float3 v1 = asfloat(vertexBuffers[NonUniformResourceIndex(mesh)].Load3(tri.y * 12));
+    float3 v2 = asfloat(vertexBuffers[NonUniformResourceIndex(mesh)].Load3(tri.z * 12));
+
+    // Instance transforms are rigid, so the upper 3x3 also transforms normals
+    float3 normal = normalize(mul((float3x3) ObjectToWorld3x4(), cross(v1 - v0, v2 - v0)));
+
+    // Face the camera, like the CPU tracer
+    return dot(normal, WorldRayDirection()) > 0.0 ? -normal : normal;
+}
+
+// The hit record is evaluated once and fans out to every requested AOV
+void writeHitAOVs(BuiltInTriangleIntersectionAttributes attr)
+{
+    uint2 pixel = DispatchRaysIndex().xy;
+    // InstanceID() is the mesh, InstanceIndex() tells the copies of a mesh apart
+    uint mesh = InstanceID();
+    uint primitive = PrimitiveIndex();
+
+    if (aovMask & AOV_DEPTH)
+        depthOutput[pixel] = RayTCurrent();
+
+    if (aovMask & AOV_NORMAL)
+        normalOutput[pixel] = float4(triangleNormal(mesh, primitive), 0.0);
+
+    if (aovMask & AOV_BARYCENTRICS)
+        barycentricsOutput[pixel] = float4(1.0 - attr.barycentrics.x - attr.barycentrics.y, attr.barycentrics, 0.0);
+
+    if (aovMask & AOV_PRIMITIVE_ID)
+        primitiveIDOutput[pixel] = primitive;
+
+    if (aovMask & AOV_INSTANCE_ID)
+        instanceIDOutput[pixel] = InstanceIndex();
+
+    if (aovMask & AOV_ALBEDO)
+        albedoOutput[pixel] = materialAlbedos[materialRecord.materialIndex];
+}
+
+void writeMissAOVs()
+{
+    uint2 pixel = DispatchRaysIndex().xy;
+
+    if (aovMask & AOV_DEPTH)
+        depthOutput[pixel] = 0.0;
+
+    if (aovMask & AOV_NORMAL)
+        normalOutput[pixel] = float4(0.0, 0.0, 0.0, 0.0);
+
+    if (aovMask & AOV_BARYCENTRICS)
+        barycentricsOutput[pixel] = float4(0.0, 0.0, 0.0, 0.0);
+
+    if (aovMask & AOV_PRIMITIVE_ID)
+        primitiveIDOutput[pixel] = 0xFFFFFFFF;
+
+    if (aovMask & AOV_INSTANCE_ID)
+        instanceIDOutput[pixel] = 0xFFFFFFFF;
+
+    if (aovMask & AOV_ALBEDO)
+        albedoOutput[pixel] = float4(MISS_COLOR, 1.0);
 }
 
 [shader("raygeneration")]
 void rayGen()
 {
-    float width = 1920;
-    float height = 1080;
+    float width = renderSize.x;
+    float height = renderSize.y;
 
     RayDesc cameraRay;
     cameraRay.Origin = float3(0.f, 14.f, 26.f);
@@ -52,7 +152,7 @@ void rayGen()
     cameraRay.TMax = 10000.0;
     
     RayPayload rayPayload;
-    rayPayload.pixelColor = float4(0.f, 0.f, 0.f, 1.f);
+    rayPayload.color = float3(0.f, 0.f, 0.f);
 
     TraceRay(
         sceneBVHAccStruct,
@@ -65,107 +165,108 @@ void rayGen()
         rayPayload
     );
 
-    frameTexture[pixelRasterCoords] = rayPayload.pixelColor;
+    frameTexture[pixelRasterCoords] = float4(rayPayload.color, 1.0);
 
 }
 
 [shader("miss")]
 void miss(inout RayPayload payload)
 {
-    payload.pixelColor = float4(0.0, 1.0, 1.0, 1.0);
+    payload.color = MISS_COLOR;
+
+    if (aovMask != 0)
+        writeMissAOVs();
+}
+
+// Debug shading modes, in CRTShadingMode order. Every mode is a closest hit shader
+// of its own hit group, the CPU picks one through the start of the hit group table.
+float3 randomObjectColor(uint objID)
+{
+    float objR = frac(sin(objID * 12.9898) * 43758.5453);
+    float objG = frac(sin(objID * 78.233) * 12345.6789);
+    float objB = frac(sin(objID * 39.425) * 34567.8901);
+    return float3(objR, objG, objB);
+}
+
+float3 shadeTriangleColors(BuiltInTriangleIntersectionAttributes attr)
+{
+    uint tri = PrimitiveIndex();
+    float r = frac(sin(tri * 12.9898) * 43758.5453);
+    float g = frac(sin(tri * 78.233) * 43758.5453);
+    float b = frac(sin(tri * 45.164) * 43758.5453);
+    return float3(r, g, b);
+}
+
+float3 shadeObjectSpatial(BuiltInTriangleIntersectionAttributes attr)
+{
+    float3 worldPos = WorldRayOrigin() + WorldRayDirection() * RayTCurrent();
+    float3 objectBaseColor = randomObjectColor(InstanceID());
+
+    float cellSize = 2.0;
+
+    int3 cell = int3(floor(worldPos / cellSize));
+
+    uint hash = (uint) (cell.x * 73856093) ^ (uint) (cell.y * 19349663) ^ (uint) (cell.z * 83492791);
+    float variation = frac(sin(hash * 12.9898) * 43758.5453);
+
+    return lerp(objectBaseColor * 0.7, objectBaseColor * 1.3, variation);
+}
+
+float3 shadeObjectTriangleShades(BuiltInTriangleIntersectionAttributes attr)
+{
+    float3 baseColor = randomObjectColor(InstanceID());
+    float shade = frac(sin(PrimitiveIndex() * 12.9898) * 43758.5453);
+    return baseColor * lerp(0.6, 1.0, shade);
 }
 
-[shader("closesthit")]
-void closestHit(inout RayPayload payload,
-                in BuiltInTriangleIntersectionAttributes attr)
-{
-    float3 color = float3(0.f, 1.f, 0.f);
-
-    if (shadingMode == 0)
-    {
-        uint tri = PrimitiveIndex();
-        float r = frac(sin(tri * 12.9898) * 43758.5453);
-        float g = frac(sin(tri * 78.233) * 43758.5453);
-        float b = frac(sin(tri * 45.164) * 43758.5453);
-        color = float3(r, g, b);
-
-    }
-    else if (shadingMode == 1)
-    {
-        float3 worldPos = WorldRayOrigin() + WorldRayDirection() * RayTCurrent();
-
-        uint objID = InstanceID();
-        float objR = frac(sin(objID * 12.9898) * 43758.5453);
-        float objG = frac(sin(objID * 78.233) * 12345.6789);
-        float objB = frac(sin(objID * 39.425) * 34567.8901);
-        float3 objectBaseColor = float3(objR, objG, objB);
- 
-        float cellSize = 2.0;
-
-        int3 cell = int3(floor(worldPos / cellSize));
-
-        uint hash = (uint) (cell.x * 73856093) ^ (uint) (cell.y * 19349663) ^ (uint) (cell.z * 83492791);
-        float variation = frac(sin(hash * 12.9898) * 43758.5453);
-
-        float3 finalColor = lerp(objectBaseColor * 0.7, objectBaseColor * 1.3, variation);
-        color = finalColor;
-    }
-    else if (shadingMode == 2)
-    {
-        uint objID = InstanceID();
-        uint triID = PrimitiveIndex();
-        float objR = frac(sin(objID * 12.9898) * 43758.5453);
-        float objG = frac(sin(objID * 78.233) * 12345.6789);
-        float objB = frac(sin(objID * 39.425) * 34567.8901);
-        float3 baseColor = float3(objR, objG, objB);
-        float shade = frac(sin(triID * 12.9898) * 43758.5453);
-        float3 finalColor = baseColor * lerp(0.6, 1.0, shade);
-        color = finalColor;
-    }
-    else if (shadingMode == 3)
-    {
-        float3 bary = float3(
+float3 shadeBarycentrics(BuiltInTriangleIntersectionAttributes attr)
+{
+    return float3(
         1.0 - attr.barycentrics.x - attr.barycentrics.y,
         attr.barycentrics.x,
         attr.barycentrics.y
-        );
-
-        color = bary;
-    }
-    else if (shadingMode == 4)
-    {
-        float3 worldPos =
-        WorldRayOrigin() + WorldRayDirection() * RayTCurrent();
-
-        float h = saturate((worldPos.y + 10.0) / 20.0);
-
-        color = lerp(
-        float3(0.1, 0.2, 0.6),
-        float3(0.9, 0.9, 0.9),
-        h
-        );
-    }
-    else if (shadingMode == 5)
-    {
-        float dist = RayTCurrent() * 0.05;
-        float c = saturate(dist);
-
-        color = float3(c, c, c);
-    }
-    else
-    {
-        float3 p =
-        WorldRayOrigin() + WorldRayDirection() * RayTCurrent();
-
-        int checker =
-        (int(floor(p.x)) ^
-         int(floor(p.z))) & 1;
-
-        float c = checker ? 0.9 : 0.2;
-        color = float3(c, c, c);
-    }
-
-    payload.pixelColor = float4(color, 1.0);
+    );
+}
+
+float3 shadeHeightGradient(BuiltInTriangleIntersectionAttributes attr)
+{
+    float3 worldPos = WorldRayOrigin() + WorldRayDirection() * RayTCurrent();
+
+    float h = saturate((worldPos.y + 10.0) / 20.0);
+
+    return lerp(float3(0.1, 0.2, 0.6), float3(0.9, 0.9, 0.9), h);
+}
+
+float3 shadeCameraDistance(BuiltInTriangleIntersectionAttributes attr)
+{
+    float c = saturate(RayTCurrent() * 0.05);
+    return float3(c, c, c);
+}
+
+float3 shadeChecker(BuiltInTriangleIntersectionAttributes attr)
+{
+    float3 p = WorldRayOrigin() + WorldRayDirection() * RayTCurrent();
+
+    int checker = (int(floor(p.x)) ^ int(floor(p.z))) & 1;
+
+    float c = checker ? 0.9 : 0.2;
+    return float3(c, c, c);
 }
 
+#define SHADING_MODE_CLOSEST_HIT(name, shade)                                           \
+[shader("closesthit")]                                                                  \
+void name(inout RayPayload payload, in BuiltInTriangleIntersectionAttributes attr)     \
+{                                                                                       \
+    payload.color = shade(attr);                                                        \
+                                                                                        \
+    if (aovMask != 0)                                                                   \
+        writeHitAOVs(attr);                                                             \
+}
 
+SHADING_MODE_CLOSEST_HIT(closestHitTriangleColors, shadeTriangleColors)
+SHADING_MODE_CLOSEST_HIT(closestHitObjectSpatial, shadeObjectSpatial)
+SHADING_MODE_CLOSEST_HIT(closestHitObjectTriangleShades, shadeObjectTriangleShades)
+SHADING_MODE_CLOSEST_HIT(closestHitBarycentrics, shadeBarycentrics)
+SHADING_MODE_CLOSEST_HIT(closestHitHeightGradient, shadeHeightGradient)
+SHADING_MODE_CLOSEST_HIT(closestHitCameraDistance, shadeCameraDistance)
+SHADING_MODE_CLOSEST_HIT(closestHitChecker, shadeChecker)
@@ -0,0 +1,139 @@
+#include <cstdint>
+#include "CRTBufferSuballocator.h"
+#include "CRTTest.h"
+
+// First fit range allocator and the block list on top of it
+
+namespace
+{
+	void testAlignment()
+	{
+		CRTRangeAllocator allocator(1024);
+		uint64_t offset = 0;
+
+		CRT_CHECK(allocator.allocate(10, 1, offset));
+		CRT_CHECK_EQUAL(offset, 0u);
+
+		CRT_CHECK(allocator.allocate(16, 64, offset));
+		CRT_CHECK_EQUAL(offset, 64u);
+
+		// The padding in front of the aligned allocation stays free and is found first
+		CRT_CHECK_EQUAL(allocator.getFreeRangeCount(), 2);
+		CRT_CHECK(allocator.allocate(8, 8, offset));
+		CRT_CHECK_EQUAL(offset, 16u);
+
+		CRT_CHECK(allocator.allocate(256, 256, offset));
+		CRT_CHECK_EQUAL(offset, 256u);
+		CRT_CHECK_EQUAL(allocator.getUsedSize(), 10u + 16u + 8u + 256u);
+	}
+
+	void testCoalescing()
+	{
+		CRTRangeAllocator allocator(300);
+		uint64_t a = 0, b = 0, c = 0;
+		CRT_CHECK(allocator.allocate(100, 1, a));
+		CRT_CHECK(allocator.allocate(100, 1, b));
+		CRT_CHECK(allocator.allocate(100, 1, c));
+		CRT_CHECK_EQUAL(allocator.getFreeRangeCount(), 0);
+
+		// Not adjacent, two ranges
+		allocator.free(a, 100);
+		allocator.free(c, 100);
+		CRT_CHECK_EQUAL(allocator.getFreeRangeCount(), 2);
+		CRT_CHECK_EQUAL(allocator.getLargestFreeRange(), 100u);
+
+		// The middle one joins both neighbours
+		allocator.free(b, 100);
+		CRT_CHECK_EQUAL(allocator.getFreeRangeCount(), 1);
+		CRT_CHECK_EQUAL(allocator.getLargestFreeRange(), 300u);
+		CRT_CHECK_EQUAL(allocator.getUsedSize(), 0u);
+
+		// Merging with only the range before, then only the range after
+		CRT_CHECK(allocator.allocate(100, 1, a));
+		CRT_CHECK(allocator.allocate(100, 1, b));
+		CRT_CHECK(allocator.allocate(100, 1, c));
+		allocator.free(a, 100);
+		allocator.free(b, 100);
+		CRT_CHECK_EQUAL(allocator.getFreeRangeCount(), 1);
+		CRT_CHECK_EQUAL(allocator.getLargestFreeRange(), 200u);
+
+		allocator.free(c, 100);
+		CRT_CHECK(allocator.allocate(300, 1, a));
+		allocator.free(a, 300);
+		CRT_CHECK(allocator.allocate(50, 1, a));
+		CRT_CHECK(allocator.allocate(50, 1, b));
+		allocator.free(b, 50);
+		CRT_CHECK_EQUAL(allocator.getFreeRangeCount(), 1);
+		CRT_CHECK_EQUAL(allocator.getLargestFreeRange(), 250u);
+	}
+
+	void testExhaustion()
+	{
+		CRTRangeAllocator allocator(256);
+		uint64_t offset = 0;
+
+		CRT_CHECK(allocator.allocate(256, 1, offset));
+		CRT_CHECK(!allocator.allocate(1, 1, offset));
+
+		allocator.free(0, 256);
+		CRT_CHECK(allocator.allocate(1, 1, offset));
+
+		// 246 bytes are free, but not 60 at an offset aligned to 64 that fits before the end
+		CRTRangeAllocator aligned(100);
+		CRT_CHECK(aligned.allocate(10, 1, offset));
+		CRT_CHECK(!aligned.allocate(60, 64, offset));
+		CRT_CHECK(aligned.allocate(60, 1, offset));
+		CRT_CHECK_EQUAL(offset, 10u);
+
+		CRTRangeAllocator empty(0);
+		CRT_CHECK(!empty.allocate(1, 1, offset));
+	}
+
+	void testBlocks()
+	{
+		CRTBufferSuballocator allocator(1024);
+
+		const CRTSuballocation first = allocator.allocate(600, 256);
+		const CRTSuballocation second = allocator.allocate(600, 256);
+		CRT_CHECK(first.isValid() && second.isValid());
+		CRT_CHECK_EQUAL(first.block, 0);
+		CRT_CHECK_EQUAL(second.block, 1);
+		CRT_CHECK_EQUAL(second.offset % 256, 0u);
+
+		// Fits in the rest of the first block, at the next 256 byte boundary
+		const CRTSuballocation small = allocator.allocate(200, 256);
+		CRT_CHECK_EQUAL(small.block, 0);
+		CRT_CHECK_EQUAL(small.offset, 768u);
+
+		// Bigger than a block, gets its own
+		const CRTSuballocation large = allocator.allocate(5000, 256);
+		CRT_CHECK_EQUAL(large.block, 2);
+		CRT_CHECK_EQUAL(large.offset, 0u);
+		CRT_CHECK_EQUAL(allocator.getBlockSize(2), 5000u);
+		CRT_CHECK_EQUAL(allocator.getBlockCount(), 3);
+
+		CRT_CHECK_EQUAL(allocator.getUsedSize(), 600u + 600u + 200u + 5000u);
+		CRT_CHECK_EQUAL(allocator.getReservedSize(), 1024u + 1024u + 5000u);
+
+		allocator.free(first);
+		allocator.free(second);
+		allocator.free(small);
+		allocator.free(large);
+		CRT_CHECK_EQUAL(allocator.getUsedSize(), 0u);
+
+		// Freed space is reused before a new block is added
+		const CRTSuballocation reused = allocator.allocate(1024, 256);
+		CRT_CHECK_EQUAL(reused.block, 0);
+		CRT_CHECK_EQUAL(allocator.getBlockCount(), 3);
+	}
+}
+
+int main()
+{
+	testAlignment();
+	testCoalescing();
+	testExhaustion();
+	testBlocks();
+
+	return CRTTest::getResult();
+}
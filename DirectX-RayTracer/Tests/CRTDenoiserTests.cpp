@@ -0,0 +1,139 @@
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include "CRTDenoiser.h"
+#include "CRTRenderer.h"
+#include "CRTScene.h"
+#include "CRTSceneGenerator.h"
+#include "CRTTest.h"
+
+// Denoiser input checks, and the filter on images where the result is known
+
+namespace
+{
+	CRTImage makeGradient(int width, int height)
+	{
+		CRTImage image(width, height);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+				image.setPixel(x, y, CRTVector(x / float(width), y / float(height), 0.5f));
+		}
+
+		return image;
+	}
+
+	// Flat guides: one surface facing the camera, of one albedo, at one depth
+	CRTAOVBuffers makeFlatGuides(int width, int height, uint32_t mask)
+	{
+		CRTAOVBuffers aovs;
+		aovs.resize(width, height, mask);
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				if (aovs.has(CRTAOVMask::normal))
+					aovs.normal.setPixel(x, y, CRTVector(0.f, 0.f, 1.f));
+				if (aovs.has(CRTAOVMask::albedo))
+					aovs.albedo.setPixel(x, y, CRTVector(0.5f, 0.5f, 0.5f));
+			}
+		}
+
+		for (float& depth : aovs.depth)
+			depth = 2.f;
+
+		return aovs;
+	}
+
+	bool sameImage(const CRTImage& lhs, const CRTImage& rhs)
+	{
+		return lhs.getWidth() == rhs.getWidth() && lhs.getHeight() == rhs.getHeight() && lhs.getPixels() == rhs.getPixels();
+	}
+
+	void testMissingGuides()
+	{
+		const CRTImage color = makeGradient(20, 10);
+		const CRTDenoiser denoiser;
+
+		// Without AOVs, with some of the guides, and at another size the color is passed through
+		CRTImage output;
+		CRT_CHECK(!denoiser.denoise(color, CRTAOVBuffers(), output));
+		CRT_CHECK(sameImage(output, color));
+
+		CRTImage partial;
+		CRT_CHECK(!denoiser.denoise(color, makeFlatGuides(20, 10, CRTAOVMask::normal | CRTAOVMask::depth), partial));
+		CRT_CHECK(sameImage(partial, color));
+
+		CRTImage resized;
+		CRT_CHECK(!denoiser.denoise(color, makeFlatGuides(10, 20, CRTAOVMask::denoiserGuides), resized));
+		CRT_CHECK(sameImage(resized, color));
+	}
+
+	void testConstantImage()
+	{
+		// Filtering a constant color over flat guides keeps it
+		CRTImage color(33, 17);
+		for (int y = 0; y < color.getHeight(); y++)
+		{
+			for (int x = 0; x < color.getWidth(); x++)
+				color.setPixel(x, y, CRTVector(0.25f, 0.5f, 0.75f));
+		}
+
+		CRTImage output;
+		CRT_CHECK(CRTDenoiser().denoise(color, makeFlatGuides(33, 17, CRTAOVMask::denoiserGuides), output));
+		CRT_CHECK_EQUAL(output.getWidth(), 33);
+		CRT_CHECK_EQUAL(output.getHeight(), 17);
+
+		for (const CRTVector& pixel : output.getPixels())
+		{
+			CRT_CHECK(std::fabs(pixel.getX() - 0.25f) < 1e-4f);
+			CRT_CHECK(std::fabs(pixel.getY() - 0.5f) < 1e-4f);
+			CRT_CHECK(std::fabs(pixel.getZ() - 0.75f) < 1e-4f);
+		}
+	}
+
+	// A render without AOVs, denoised straight away, used to read through null buffers
+	void testRenderWithoutAOVs()
+	{
+		CRTSceneGeneratorSettings settings;
+		settings.objectCount = 2;
+		settings.trianglesPerObject = 100;
+		settings.imageWidth = 32;
+		settings.imageHeight = 18;
+
+		const std::string path = (std::filesystem::temp_directory_path() / "crt_denoiser_test.crtscene").string();
+		CRT_CHECK(CRTSceneGenerator(settings).write(path));
+
+		CRTScene scene(path);
+		std::filesystem::remove(path);
+		CRT_CHECK(scene.isLoaded());
+
+		CRTRenderSettings renderSettings;
+		renderSettings.minSamples = 1;
+		renderSettings.maxSamples = 1;
+		renderSettings.aovMask = 0;
+
+		CRTRenderer renderer(scene);
+		renderer.render(renderSettings);
+
+		CRTImage output;
+		CRT_CHECK(!CRTDenoiser().denoise(renderer.getImage(), renderer.getAOVs(), output));
+		CRT_CHECK(sameImage(output, renderer.getImage()));
+
+		renderSettings.aovMask = CRTAOVMask::denoiserGuides;
+		renderer.render(renderSettings);
+		CRT_CHECK(CRTDenoiser().denoise(renderer.getImage(), renderer.getAOVs(), output));
+		CRT_CHECK_EQUAL(output.getWidth(), 32);
+		CRT_CHECK_EQUAL(output.getHeight(), 18);
+	}
+}
+
+int main()
+{
+	testMissingGuides();
+	testConstantImage();
+	testRenderWithoutAOVs();
+
+	return CRTTest::getResult();
+}
@@ -0,0 +1,155 @@
+#include <cmath>
+#include <vector>
+#include "CRTTest.h"
+#include "CRTFrameBudget.h"
+
+// Render scale decisions on synthetic frame time traces, where a frame costs
+// its full resolution time times the square of the scale it was rendered at
+
+namespace
+{
+	const float target = 1.f / 60.f;
+
+	struct Change
+	{
+		int frame;
+		float oldScale;
+		float newScale;
+	};
+
+	// Feeds frames of the given full resolution cost and returns the scale changes
+	std::vector<Change> runTrace(CRTFrameBudget& budget, float fullScaleSeconds, int frames, int& frame)
+	{
+		std::vector<Change> changes;
+		for (int i = 0; i < frames; i++, frame++)
+		{
+			const float scale = budget.getScale();
+			const float newScale = budget.addFrame(fullScaleSeconds * scale * scale, scale);
+			if (newScale != scale)
+				changes.push_back({ frame, scale, newScale });
+		}
+
+		return changes;
+	}
+
+	void checkSettled(const std::vector<Change>& changes)
+	{
+		for (size_t i = 1; i < changes.size(); i++)
+			CRT_CHECK(changes[i].frame - changes[i - 1].frame >= CRTFrameBudget::settleFrames);
+	}
+
+	void testOverBudgetLowersScale()
+	{
+		CRTFrameBudget budget(target);
+		int frame = 0;
+
+		// Twice the budget, the first decision comes once the history is full
+		const std::vector<Change> changes = runTrace(budget, 2.f * target, CRTFrameBudget::historySize, frame);
+		CRT_CHECK_EQUAL(changes.size(), 1u);
+		CRT_CHECK(budget.getScale() <= 1.f - CRTFrameBudget::scaleStep);
+
+		// Lowering is immediate, straight to about sqrt(1 / 2)
+		CRT_CHECK(budget.getScale() <= std::sqrt(0.5f));
+		CRT_CHECK(budget.getScale() > std::sqrt(0.5f) - 2.f * CRTFrameBudget::scaleStep);
+
+		// At the new scale the frames fit the budget, it stays there
+		const std::vector<Change> later = runTrace(budget, 2.f * target, 50, frame);
+		CRT_CHECK(later.empty());
+		CRT_CHECK(budget.getFrameSeconds() <= target * (1.f + CRTFrameBudget::overBudgetTolerance));
+	}
+
+	void testSlightlyOverBudget()
+	{
+		// Just above the tolerance still lowers the scale by at least one step
+		CRTFrameBudget budget(target);
+		int frame = 0;
+
+		runTrace(budget, target * (1.f + 2.f * CRTFrameBudget::overBudgetTolerance), CRTFrameBudget::historySize, frame);
+		CRT_CHECK(budget.getScale() <= 1.f - CRTFrameBudget::scaleStep);
+
+		// Within the tolerance nothing changes
+		CRTFrameBudget tolerant(target);
+		frame = 0;
+		const std::vector<Change> changes = runTrace(tolerant, target * (1.f + 0.5f * CRTFrameBudget::overBudgetTolerance), 50, frame);
+		CRT_CHECK(changes.empty());
+		CRT_CHECK_EQUAL(tolerant.getScale(), 1.f);
+	}
+
+	void testUnderBudgetRaisesGradually()
+	{
+		CRTFrameBudget budget(target, 0.25f);
+		int frame = 0;
+
+		// A heavy scene drops the scale to about half
+		runTrace(budget, 4.f * target, 30, frame);
+		const float lowScale = budget.getScale();
+		CRT_CHECK(lowScale <= 0.5f);
+
+		// Then the scene gets cheap, the scale grows back in limited steps
+		const std::vector<Change> changes = runTrace(budget, 0.1f * target, 100, frame);
+		CRT_CHECK(changes.size() >= 2);
+		for (const Change& change : changes)
+		{
+			CRT_CHECK(change.newScale > change.oldScale);
+			CRT_CHECK(change.newScale <= change.oldScale * CRTFrameBudget::maxScaleIncrease + 1e-6f);
+		}
+
+		checkSettled(changes);
+		CRT_CHECK_EQUAL(budget.getScale(), 1.f);
+	}
+
+	void testNoChangesWhileSettling()
+	{
+		CRTFrameBudget budget(target, 0.25f);
+		int frame = 0;
+
+		// Alternating heavy and cheap phases make the budget change often
+		std::vector<Change> changes;
+		for (int phase = 0; phase < 6; phase++)
+		{
+			const std::vector<Change> phaseChanges = runTrace(budget, phase % 2 ? 0.2f * target : 3.f * target, 25, frame);
+			changes.insert(changes.end(), phaseChanges.begin(), phaseChanges.end());
+		}
+
+		CRT_CHECK(changes.size() >= 6);
+		checkSettled(changes);
+		CRT_CHECK_EQUAL(budget.getChangeCount(), static_cast<int>(changes.size()));
+	}
+
+	void testIgnoresSpikes()
+	{
+		CRTFrameBudget budget(target);
+
+		// A long frame now and then, like a resize, does not lower the scale
+		for (int i = 0; i < 100; i++)
+			budget.addFrame(i % 10 == 0 ? 10.f * target : 0.9f * target, 1.f);
+
+		CRT_CHECK_EQUAL(budget.getScale(), 1.f);
+		CRT_CHECK_EQUAL(budget.getChangeCount(), 0);
+	}
+
+	void testReset()
+	{
+		CRTFrameBudget budget(target);
+		int frame = 0;
+		runTrace(budget, 3.f * target, 20, frame);
+		CRT_CHECK(budget.getScale() < 1.f);
+
+		budget.reset();
+		CRT_CHECK_EQUAL(budget.getScale(), 1.f);
+		CRT_CHECK_EQUAL(budget.getChangeCount(), 0);
+		CRT_CHECK_EQUAL(budget.getFrameSeconds(), 0.f);
+	}
+}
+
+int main()
+{
+	testOverBudgetLowersScale();
+	testSlightlyOverBudget();
+	testUnderBudgetRaisesGradually();
+	testNoChangesWhileSettling();
+	testIgnoresSpikes();
+	testReset();
+
+	return CRTTest::getResult();
+}
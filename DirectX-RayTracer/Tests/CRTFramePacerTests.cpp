@@ -0,0 +1,154 @@
+#include <cstdint>
+#include <vector>
+#include "CRTTest.h"
+#include "CRTFramePacer.h"
+
+// Frame pacing against a simulated queue, which completes the signalled
+// values only when the test lets it or when the CPU waits for them
+
+namespace
+{
+	class SimulatedQueue : public CRTFenceQueue
+	{
+	public:
+		uint64_t getCompletedValue() const override
+		{
+			return completedValue;
+		}
+
+		void waitForValue(uint64_t value) override
+		{
+			CRT_CHECK(value <= signalledValue); // Waiting for a value never signalled would hang
+			waits.push_back(value);
+
+			if (completedValue < value)
+				completedValue = value;
+		}
+
+		void signal(uint64_t value)
+		{
+			CRT_CHECK(value > signalledValue);
+			signalledValue = value;
+		}
+
+		// The GPU finishes the frames up to the value
+		void complete(uint64_t value)
+		{
+			CRT_CHECK(value <= signalledValue);
+			completedValue = value;
+		}
+
+		uint64_t completedValue = 0;
+		uint64_t signalledValue = 0;
+		std::vector<uint64_t> waits;
+	};
+
+	void submitFrame(CRTFramePacer& pacer, SimulatedQueue& queue)
+	{
+		pacer.beginFrame(queue);
+		queue.signal(pacer.endFrame());
+	}
+
+	void testFillsSlotsWithoutWaiting()
+	{
+		SimulatedQueue queue;
+		CRTFramePacer pacer(3);
+
+		// A stalled GPU does not block the first framesInFlight frames
+		for (int i = 0; i < 3; i++)
+		{
+			CRT_CHECK_EQUAL(pacer.beginFrame(queue), i);
+			CRT_CHECK_EQUAL(pacer.endFrame(), static_cast<uint64_t>(i + 1));
+			queue.signal(i + 1);
+		}
+
+		CRT_CHECK(queue.waits.empty());
+		CRT_CHECK_EQUAL(pacer.getStallCount(), 0u);
+		CRT_CHECK_EQUAL(pacer.getFrameCount(), 3u);
+	}
+
+	void testWaitsOnlyForReusedSlot()
+	{
+		SimulatedQueue queue;
+		CRTFramePacer pacer(3);
+
+		for (int i = 0; i < 3; i++)
+			submitFrame(pacer, queue);
+
+		// Slot 0 is reused, it was last used by the frame signalling 1. The
+		// frames in the other slots are still running and must not be waited for.
+		CRT_CHECK_EQUAL(pacer.beginFrame(queue), 0);
+		CRT_CHECK_EQUAL(queue.waits.size(), 1u);
+		CRT_CHECK_EQUAL(queue.waits.back(), 1u);
+		CRT_CHECK_EQUAL(queue.completedValue, 1u);
+		CRT_CHECK_EQUAL(pacer.getStallCount(), 1u);
+		queue.signal(pacer.endFrame());
+
+		// The GPU has already finished the frame of slot 1, no wait
+		queue.complete(2);
+		CRT_CHECK_EQUAL(pacer.beginFrame(queue), 1);
+		CRT_CHECK_EQUAL(queue.waits.size(), 1u);
+		CRT_CHECK_EQUAL(pacer.getStallCount(), 1u);
+		queue.signal(pacer.endFrame());
+
+		// Slot 2 waits for 3, not for the newer 4 and 5
+		CRT_CHECK_EQUAL(pacer.beginFrame(queue), 2);
+		CRT_CHECK_EQUAL(queue.waits.size(), 2u);
+		CRT_CHECK_EQUAL(queue.waits.back(), 3u);
+		CRT_CHECK_EQUAL(queue.completedValue, 3u);
+		queue.signal(pacer.endFrame());
+	}
+
+	void testSteadyState()
+	{
+		SimulatedQueue queue;
+		CRTFramePacer pacer(2);
+
+		// Every wait is for the frame framesInFlight frames back
+		for (int i = 0; i < 20; i++)
+			submitFrame(pacer, queue);
+
+		CRT_CHECK_EQUAL(queue.waits.size(), 18u);
+		for (size_t i = 0; i < queue.waits.size(); i++)
+			CRT_CHECK_EQUAL(queue.waits[i], static_cast<uint64_t>(i + 1));
+
+		CRT_CHECK_EQUAL(pacer.getStallCount(), 18u);
+	}
+
+	void testWaitForIdle()
+	{
+		SimulatedQueue queue;
+		CRTFramePacer pacer(3);
+
+		// Nothing submitted, nothing to wait for
+		pacer.waitForIdle(queue);
+		CRT_CHECK(queue.waits.empty());
+
+		for (int i = 0; i < 5; i++)
+			submitFrame(pacer, queue);
+
+		const size_t waitsBefore = queue.waits.size();
+		pacer.waitForIdle(queue);
+		CRT_CHECK_EQUAL(queue.waits.size(), waitsBefore + 1);
+		CRT_CHECK_EQUAL(queue.waits.back(), 5u);
+		CRT_CHECK_EQUAL(queue.completedValue, 5u);
+
+		// Already idle
+		pacer.waitForIdle(queue);
+		CRT_CHECK_EQUAL(queue.waits.size(), waitsBefore + 1);
+
+		// The slots are free again after the idle wait
+		submitFrame(pacer, queue);
+		CRT_CHECK_EQUAL(queue.waits.size(), waitsBefore + 1);
+	}
+}
+
+int main()
+{
+	testFillsSlotsWithoutWaiting();
+	testWaitsOnlyForReusedSlot();
+	testSteadyState();
+	testWaitForIdle();
+
+	return CRTTest::getResult();
+}
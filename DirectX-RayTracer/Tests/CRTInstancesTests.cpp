@@ -0,0 +1,192 @@
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include "CRTInstances.h"
+#include "CRTRenderer.h"
+#include "CRTScene.h"
+#include "CRTSceneGenerator.h"
+#include "CRTTest.h"
+
+// Top-level update decisions of the instance set, and the instance IDs the CPU tracer reports
+
+namespace
+{
+	CRTTransform translation(float x)
+	{
+		CRTTransform transform;
+		transform.translation = CRTVector(x, 0.f, 0.f);
+		return transform;
+	}
+
+	void testTopLevelUpdates()
+	{
+		CRTInstanceSet instances;
+		CRTInstanceTracker tracker;
+
+		instances.reset(2);
+		CRT_CHECK(tracker.update(instances) == CRTTopLevelUpdate::REBUILD);
+		CRT_CHECK(tracker.update(instances) == CRTTopLevelUpdate::NONE);
+
+		instances.setTransform(0, translation(1.f));
+		CRT_CHECK(tracker.update(instances) == CRTTopLevelUpdate::REFIT);
+
+		const int handle = instances.addInstance(1, translation(2.f));
+		CRT_CHECK(tracker.update(instances) == CRTTopLevelUpdate::REBUILD);
+
+		instances.removeInstance(handle);
+		CRT_CHECK(tracker.update(instances) == CRTTopLevelUpdate::REBUILD);
+
+		// Clearing every instance changes the topology although nothing is added
+		instances.reset(0);
+		CRT_CHECK(instances.getInstances().empty());
+		CRT_CHECK(tracker.update(instances) == CRTTopLevelUpdate::REBUILD);
+
+		instances.reset(0);
+		CRT_CHECK(tracker.update(instances) == CRTTopLevelUpdate::REBUILD);
+	}
+
+	void testOrthonormalize()
+	{
+		// Rounded to the digits of a scene file
+		const float c = std::cos(0.5f), s = std::sin(0.5f);
+		CRTTransform rounded;
+		rounded.rotation = CRTMatrix(
+			std::round(c * 1e4f) / 1e4f, 0.f, -std::round(s * 1e4f) / 1e4f,
+			0.f, 1.f, 0.f,
+			std::round(s * 1e4f) / 1e4f, 0.f, std::round(c * 1e4f) / 1e4f);
+
+		CRT_CHECK(rounded.orthonormalize(1e-3f));
+		for (int row = 0; row < 3; row++)
+		{
+			const CRTVector rowVector(rounded.rotation.get(row, 0), rounded.rotation.get(row, 1), rounded.rotation.get(row, 2));
+			CRT_CHECK(std::fabs(rowVector.length() - 1.f) < 1e-6f);
+		}
+
+		// Scale, shear and degenerate matrices are rejected and left alone
+		CRTTransform scaled;
+		scaled.rotation = CRTMatrix(2.f, 0.f, 0.f, 0.f, 2.f, 0.f, 0.f, 0.f, 2.f);
+		CRT_CHECK(!scaled.orthonormalize(1e-3f));
+		CRT_CHECK_EQUAL(scaled.rotation.get(0, 0), 2.f);
+
+		CRTTransform sheared;
+		sheared.rotation = CRTMatrix(1.f, 0.f, 0.f, 0.5f, 1.f, 0.f, 0.f, 0.f, 1.f);
+		CRT_CHECK(!sheared.orthonormalize(1e-3f));
+
+		CRTTransform degenerate;
+		degenerate.rotation = CRTMatrix(0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
+		CRT_CHECK(!degenerate.orthonormalize(1e-3f));
+	}
+
+	// Instances the parser cannot place are skipped, the valid ones still load
+	void testParseInstances()
+	{
+		CRTSceneGeneratorSettings settings;
+		settings.objectCount = 2;
+		settings.trianglesPerObject = 50;
+		settings.imageWidth = 16;
+		settings.imageHeight = 16;
+
+		const std::string path = (std::filesystem::temp_directory_path() / "crt_instances_parse_test.crtscene").string();
+		CRT_CHECK(CRTSceneGenerator(settings).write(path));
+
+		std::string json;
+		{
+			std::ifstream ifs(path);
+			json.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+		}
+
+		const size_t instancesStart = json.find("\"instances\"");
+		CRT_CHECK(instancesStart != std::string::npos);
+		if (instancesStart == std::string::npos)
+			return;
+
+		json.resize(instancesStart);
+		json += "\"instances\": [\n"
+			"\t\t{\"object_index\": 1, \"matrix\": [0, 0, -1, 0, 1, 0, 1, 0, 0], \"position\": [5, 0, 0]},\n"
+			"\t\t{\"position\": [1, 2, 3]},\n"
+			"\t\t{\"object_index\": -1},\n"
+			"\t\t{\"object_index\": 2},\n"
+			"\t\t{\"object_index\": \"0\"},\n"
+			"\t\t{\"object_index\": 0, \"matrix\": [1, 0, 0, 0, 1, 0]},\n"
+			"\t\t{\"object_index\": 0, \"matrix\": [2, 0, 0, 0, 2, 0, 0, 0, 2]},\n"
+			"\t\t{\"object_index\": 0, \"position\": [1, 2]},\n"
+			"\t\t{\"object_index\": 0}\n"
+			"\t]\n}\n";
+
+		{
+			std::ofstream ofs(path, std::ios::trunc);
+			ofs << json;
+		}
+
+		CRTScene scene(path);
+		std::filesystem::remove(path);
+		CRT_CHECK(scene.isLoaded());
+
+		// The identity instance of each mesh, then the first and the last instance of the file
+		const std::vector<CRTInstance>& instances = scene.getInstances().getInstances();
+		CRT_CHECK_EQUAL(instances.size(), 4u);
+		if (instances.size() != 4)
+			return;
+
+		CRT_CHECK_EQUAL(instances[2].meshIndex, 1);
+		CRT_CHECK_EQUAL(instances[2].transform.translation.getX(), 5.f);
+		CRT_CHECK_EQUAL(instances[2].transform.rotation.get(0, 2), -1.f);
+		CRT_CHECK_EQUAL(instances[3].meshIndex, 0);
+		CRT_CHECK(instances[3].transform.isIdentity());
+	}
+
+	// Copies of one mesh have to report different IDs in the instance ID AOV
+	void testInstanceIDs()
+	{
+		CRTSceneGeneratorSettings settings;
+		settings.objectCount = 4;
+		settings.trianglesPerObject = 200;
+		settings.instancingRatio = 2.f;
+		settings.imageWidth = 96;
+		settings.imageHeight = 54;
+
+		const std::string path = (std::filesystem::temp_directory_path() / "crt_instances_test.crtscene").string();
+		const CRTSceneGenerator generator(settings);
+		CRT_CHECK(generator.write(path));
+
+		CRTScene scene(path);
+		std::filesystem::remove(path);
+		CRT_CHECK(scene.isLoaded());
+
+		const int meshCount = static_cast<int>(scene.getObjects().size());
+		const int instanceCount = static_cast<int>(scene.getInstances().getInstances().size());
+		CRT_CHECK(instanceCount > meshCount);
+
+		CRTRenderSettings renderSettings;
+		renderSettings.minSamples = 1;
+		renderSettings.maxSamples = 1;
+		renderSettings.aovMask = CRTAOVMask::instanceID;
+
+		CRTRenderer renderer(scene);
+		renderer.render(renderSettings);
+
+		std::set<int> ids;
+		for (int id : renderer.getAOVs().instanceID)
+		{
+			CRT_CHECK(id >= -1 && id < instanceCount);
+			if (id >= 0)
+				ids.insert(id);
+		}
+
+		// Mesh indices would stop at meshCount
+		CRT_CHECK(static_cast<int>(ids.size()) > meshCount);
+	}
+}
+
+int main()
+{
+	testTopLevelUpdates();
+	testOrthonormalize();
+	testParseInstances();
+	testInstanceIDs();
+
+	return CRTTest::getResult();
+}
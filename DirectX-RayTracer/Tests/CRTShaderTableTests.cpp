@@ -0,0 +1,122 @@
+#include <cstdint>
+#include "CRTShaderTable.h"
+#include "CRTTest.h"
+
+// Record layout of the shader binding table
+
+namespace
+{
+	// Alignment and packing rules every table of a layout has to follow
+	void checkLayoutRules(const CRTShaderTableLayout& layout, const uint64_t* localArgumentsSizes)
+	{
+		uint64_t end = 0;
+		for (int i = 0; i < layout.getTableCount(); i++)
+		{
+			const CRTShaderTableRange& table = layout.getTable(i);
+
+			CRT_CHECK_EQUAL(table.offset % CRTShaderTableLayout::tableAlignment, 0u);
+			CRT_CHECK_EQUAL(table.recordStride % CRTShaderTableLayout::recordAlignment, 0u);
+
+			// The record holds the identifier and the arguments, padded by less than one alignment step
+			const uint64_t recordSize = CRTShaderTableLayout::identifierSize + localArgumentsSizes[i];
+			CRT_CHECK(table.recordStride >= recordSize);
+			CRT_CHECK(table.recordStride < recordSize + CRTShaderTableLayout::recordAlignment);
+
+			// Right after the previous table, without a whole table alignment of padding
+			CRT_CHECK(table.offset >= end);
+			CRT_CHECK(table.offset < end + CRTShaderTableLayout::tableAlignment);
+
+			for (uint32_t record = 0; record < table.recordCount; record++)
+				CRT_CHECK_EQUAL(layout.getRecordOffset(i, record), table.offset + record * table.recordStride);
+
+			end = table.offset + table.getSize();
+		}
+
+		CRT_CHECK_EQUAL(layout.getSize(), end);
+	}
+
+	// Ray generation and miss without arguments, then the hit groups with one record per material
+	CRTShaderTableLayout createRendererLayout(uint32_t materialCount, uint64_t localArgumentsSize)
+	{
+		CRTShaderTableLayout layout;
+		CRT_CHECK_EQUAL(layout.addTable(1, 0), 0);
+		CRT_CHECK_EQUAL(layout.addTable(1, 0), 1);
+		CRT_CHECK_EQUAL(layout.addTable(materialCount, localArgumentsSize), 2);
+		CRT_CHECK_EQUAL(layout.getTableCount(), 3);
+		return layout;
+	}
+
+	void testAlignUp()
+	{
+		CRT_CHECK_EQUAL(CRTShaderTableLayout::alignUp(0, 32), 0u);
+		CRT_CHECK_EQUAL(CRTShaderTableLayout::alignUp(1, 32), 32u);
+		CRT_CHECK_EQUAL(CRTShaderTableLayout::alignUp(32, 32), 32u);
+		CRT_CHECK_EQUAL(CRTShaderTableLayout::alignUp(33, 64), 64u);
+	}
+
+	void testNoMaterials()
+	{
+		const uint64_t sizes[] = { 0, 0, 20 };
+		const CRTShaderTableLayout layout = createRendererLayout(0, sizes[2]);
+		checkLayoutRules(layout, sizes);
+
+		// The empty hit group table still starts on a table boundary
+		CRT_CHECK_EQUAL(layout.getTable(2).offset, 128u);
+		CRT_CHECK_EQUAL(layout.getTable(2).getSize(), 0u);
+		CRT_CHECK_EQUAL(layout.getSize(), 128u);
+	}
+
+	void testOneMaterial()
+	{
+		const uint64_t sizes[] = { 0, 0, 20 };
+		const CRTShaderTableLayout layout = createRendererLayout(1, sizes[2]);
+		checkLayoutRules(layout, sizes);
+
+		CRT_CHECK_EQUAL(layout.getTable(0).offset, 0u);
+		CRT_CHECK_EQUAL(layout.getTable(0).recordStride, 32u);
+		CRT_CHECK_EQUAL(layout.getTable(1).offset, 64u);
+		CRT_CHECK_EQUAL(layout.getTable(2).offset, 128u);
+		CRT_CHECK_EQUAL(layout.getTable(2).recordStride, 64u); // 32 + 20 rounded up
+		CRT_CHECK_EQUAL(layout.getRecordOffset(2, 0), 128u);
+		CRT_CHECK_EQUAL(layout.getSize(), 192u);
+	}
+
+	void testManyMaterials()
+	{
+		const uint64_t sizes[] = { 0, 0, 100 };
+		const CRTShaderTableLayout layout = createRendererLayout(7, sizes[2]);
+		checkLayoutRules(layout, sizes);
+
+		CRT_CHECK_EQUAL(layout.getTable(2).recordStride, 160u); // 32 + 100 rounded up
+		CRT_CHECK_EQUAL(layout.getRecordOffset(2, 6), 128u + 6 * 160u);
+		CRT_CHECK_EQUAL(layout.getSize(), 128u + 7 * 160u);
+	}
+
+	// Several hit group tables after each other, like one per shading mode
+	void testConsecutiveTables()
+	{
+		const uint64_t sizes[] = { 0, 0, 40, 40, 8, 72 };
+		const uint32_t counts[] = { 1, 1, 3, 5, 1, 2 };
+
+		CRTShaderTableLayout layout;
+		for (int i = 0; i < 6; i++)
+			CRT_CHECK_EQUAL(layout.addTable(counts[i], sizes[i]), i);
+
+		checkLayoutRules(layout, sizes);
+
+		// 3 records of 96 bytes end at 416, the next table starts at 448
+		CRT_CHECK_EQUAL(layout.getTable(2).offset, 128u);
+		CRT_CHECK_EQUAL(layout.getTable(3).offset, 448u);
+	}
+}
+
+int main()
+{
+	testAlignUp();
+	testNoMaterials();
+	testOneMaterial();
+	testManyMaterials();
+	testConsecutiveTables();
+
+	return CRTTest::getResult();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <iostream>
+
+// Checks for the unit test executables run by ctest. A failed check is printed
+// and counted, the test goes on so one run shows every failure. Unlike assert
+// the checks stay in release builds.
+namespace CRTTest
+{
+	inline int& getFailureCount()
+	{
+		static int failureCount = 0;
+		return failureCount;
+	}
+
+	inline void fail(const char* file, int line, const char* expression)
+	{
+		std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+		getFailureCount()++;
+	}
+
+	template<typename Actual, typename Expected>
+	void checkEqual(const Actual& actual, const Expected& expected, const char* file, int line, const char* expression)
+	{
+		if (actual == expected)
+			return;
+
+		std::cerr << file << ":" << line << ": check failed: " << expression
+			<< " (" << actual << " != " << expected << ")" << std::endl;
+		getFailureCount()++;
+	}
+
+	// Exit code of the test executable
+	inline int getResult()
+	{
+		if (getFailureCount() > 0)
+			std::cerr << getFailureCount() << " checks failed" << std::endl;
+
+		return getFailureCount() > 0 ? 1 : 0;
+	}
+}
+
+#define CRT_CHECK(expression) ((expression) ? (void)0 : CRTTest::fail(__FILE__, __LINE__, #expression))
+#define CRT_CHECK_EQUAL(actual, expected) CRTTest::checkEqual((actual), (expected), __FILE__, __LINE__, #actual " == " #expected)
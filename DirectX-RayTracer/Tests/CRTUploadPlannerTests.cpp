@@ -0,0 +1,213 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "CRTTest.h"
+#include "CRTUploadPlanner.h"
+
+// Batching of buffer uploads, executed against a device which records the calls
+
+namespace
+{
+	// Stands in for DXRTUploadDevice. Every submission keeps the copies recorded
+	// since the previous one, with the staging bytes they were copied from.
+	class MockUploadDevice : public CRTUploadDevice
+	{
+	public:
+		struct RecordedCopy
+		{
+			int requestIndex;
+			uint64_t stagingOffset;
+			std::vector<uint8_t> data;
+		};
+
+		struct Submission
+		{
+			uint64_t stagingSize;
+			std::vector<RecordedCopy> copies;
+		};
+
+		void* mapStaging(uint64_t size) override
+		{
+			CRT_CHECK(!mapped); // The previous batch has to be submitted first
+			mapped = true;
+			stagingSize = size;
+			staging.assign(size, 0);
+			return staging.data();
+		}
+
+		void recordCopy(int requestIndex, uint64_t stagingOffset, uint64_t size) override
+		{
+			CRT_CHECK(mapped);
+			CRT_CHECK(stagingOffset + size <= staging.size());
+
+			// The planner has written the data before recording the copy
+			const uint8_t* source = staging.data() + stagingOffset;
+			pending.push_back({ requestIndex, stagingOffset, std::vector<uint8_t>(source, source + size) });
+		}
+
+		void submitAndWait() override
+		{
+			CRT_CHECK(mapped);
+			mapped = false;
+			submissions.push_back({ stagingSize, pending });
+			pending.clear();
+		}
+
+		std::vector<Submission> submissions;
+
+	private:
+		bool mapped = false;
+		uint64_t stagingSize = 0;
+		std::vector<uint8_t> staging;
+		std::vector<RecordedCopy> pending;
+	};
+
+	std::vector<uint8_t> makeData(size_t size, uint8_t seed)
+	{
+		std::vector<uint8_t> data(size);
+		for (size_t i = 0; i < size; i++)
+			data[i] = static_cast<uint8_t>(seed + i * 7);
+
+		return data;
+	}
+
+	void testSplitAtCapacity()
+	{
+		const std::vector<uint8_t> a = makeData(40, 1), b = makeData(40, 2), c = makeData(40, 3);
+
+		CRTUploadPlanner planner(100);
+		planner.add(a.data(), a.size(), 1);
+		planner.add(b.data(), b.size(), 1);
+		planner.add(c.data(), c.size(), 1); // 120 bytes would not fit
+
+		const std::vector<CRTUploadBatch> batches = planner.plan();
+		CRT_CHECK_EQUAL(batches.size(), 2u);
+		CRT_CHECK_EQUAL(batches[0].copies.size(), 2u);
+		CRT_CHECK_EQUAL(batches[0].stagingSize, 80u);
+		CRT_CHECK_EQUAL(batches[1].copies.size(), 1u);
+		CRT_CHECK_EQUAL(batches[1].copies[0].requestIndex, 2);
+		CRT_CHECK_EQUAL(batches[1].copies[0].stagingOffset, 0u);
+
+		// Filling the capacity exactly stays one batch
+		CRTUploadPlanner exact(80);
+		exact.add(a.data(), a.size(), 1);
+		exact.add(b.data(), b.size(), 1);
+		CRT_CHECK_EQUAL(exact.plan().size(), 1u);
+	}
+
+	void testOversizedRequest()
+	{
+		const std::vector<uint8_t> small = makeData(16, 4), large = makeData(500, 5);
+
+		CRTUploadPlanner planner(100);
+		planner.add(small.data(), small.size());
+		planner.add(large.data(), large.size());
+		planner.add(small.data(), small.size());
+
+		const std::vector<CRTUploadBatch> batches = planner.plan();
+		CRT_CHECK_EQUAL(batches.size(), 3u);
+		CRT_CHECK_EQUAL(batches[1].copies.size(), 1u);
+		CRT_CHECK_EQUAL(batches[1].copies[0].requestIndex, 1);
+		CRT_CHECK_EQUAL(batches[1].stagingSize, 500u);
+		CRT_CHECK_EQUAL(batches[2].copies[0].requestIndex, 2);
+	}
+
+	void testAlignment()
+	{
+		const std::vector<uint8_t> data = makeData(10, 6);
+
+		CRTUploadPlanner planner(1024);
+		planner.add(data.data(), 10, 1);
+		planner.add(data.data(), 10, 16);
+		planner.add(data.data(), 10, 256);
+		planner.add(data.data(), 10, 4);
+
+		const std::vector<CRTUploadBatch> batches = planner.plan();
+		CRT_CHECK_EQUAL(batches.size(), 1u);
+		CRT_CHECK_EQUAL(batches[0].copies[0].stagingOffset, 0u);
+		CRT_CHECK_EQUAL(batches[0].copies[1].stagingOffset, 16u);
+		CRT_CHECK_EQUAL(batches[0].copies[2].stagingOffset, 256u);
+		CRT_CHECK_EQUAL(batches[0].copies[3].stagingOffset, 268u);
+		CRT_CHECK_EQUAL(batches[0].stagingSize, 278u);
+
+		// The padding counts against the capacity
+		CRTUploadPlanner tight(300);
+		tight.add(data.data(), 10, 1);
+		tight.add(data.data(), 50, 256);
+		CRT_CHECK_EQUAL(tight.plan().size(), 2u);
+	}
+
+	void testZeroSizeRequests()
+	{
+		const std::vector<uint8_t> data = makeData(32, 7);
+
+		CRTUploadPlanner planner(1024);
+		const int empty = planner.add(data.data(), 0);
+		const int full = planner.add(data.data(), data.size());
+		planner.add(nullptr, 0);
+
+		CRT_CHECK_EQUAL(planner.getRequestCount(), 3);
+		CRT_CHECK_EQUAL(planner.getTotalSize(), 32u);
+
+		const std::vector<CRTUploadBatch> batches = planner.plan();
+		CRT_CHECK_EQUAL(batches.size(), 1u);
+		CRT_CHECK_EQUAL(batches[0].copies.size(), 1u);
+		CRT_CHECK_EQUAL(batches[0].copies[0].requestIndex, full);
+		CRT_CHECK(batches[0].copies[0].requestIndex != empty);
+
+		// Nothing to upload, nothing submitted
+		CRTUploadPlanner nothing;
+		nothing.add(nullptr, 0);
+		MockUploadDevice device;
+		CRT_CHECK_EQUAL(nothing.execute(device), 0);
+		CRT_CHECK(device.submissions.empty());
+	}
+
+	void testExecute()
+	{
+		std::vector<std::vector<uint8_t>> data;
+		for (int i = 0; i < 7; i++)
+			data.push_back(makeData(30 + i * 10, static_cast<uint8_t>(i)));
+
+		CRTUploadPlanner planner(128);
+		for (const std::vector<uint8_t>& bytes : data)
+			planner.add(bytes.data(), bytes.size(), 8);
+
+		const std::vector<CRTUploadBatch> batches = planner.plan();
+
+		MockUploadDevice device;
+		const int submissions = planner.execute(device);
+
+		// One submission per batch, with the copies and staging size of the plan
+		CRT_CHECK_EQUAL(submissions, static_cast<int>(batches.size()));
+		CRT_CHECK_EQUAL(device.submissions.size(), batches.size());
+
+		int copied = 0;
+		for (size_t i = 0; i < batches.size() && i < device.submissions.size(); i++)
+		{
+			const MockUploadDevice::Submission& submission = device.submissions[i];
+			CRT_CHECK_EQUAL(submission.stagingSize, batches[i].stagingSize);
+			CRT_CHECK_EQUAL(submission.copies.size(), batches[i].copies.size());
+
+			for (const MockUploadDevice::RecordedCopy& copy : submission.copies)
+			{
+				CRT_CHECK_EQUAL(copy.stagingOffset % 8, 0u);
+				CRT_CHECK(copy.data == data[copy.requestIndex]);
+				copied++;
+			}
+		}
+
+		CRT_CHECK_EQUAL(copied, 7);
+	}
+}
+
+int main()
+{
+	testSplitAtCapacity();
+	testOversizedRequest();
+	testAlignment();
+	testZeroSizeRequests();
+	testExecute();
+
+	return CRTTest::getResult();
+}
@@ -0,0 +1,106 @@
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "CRTSceneGenerator.h"
+
+// Writes a synthetic .crtscene, the same file for the same arguments on one platform
+
+namespace
+{
+	void printUsage(const char* program)
+	{
+		std::cerr << "Usage: " << program << " [options] output.crtscene\n"
+			<< "  --seed N                 random seed (default 1)\n"
+			<< "  --layout NAME            grid, soup or long-thin (default grid)\n"
+			<< "  --objects N              placed objects (default 16)\n"
+			<< "  --triangles-per-object N (default 10000)\n"
+			<< "  --instancing R           placements per unique mesh (default 1, no instancing)\n"
+			<< "  --lights N               (default 2)\n"
+			<< "  --materials N            (default 4)\n"
+			<< "  --textures N             procedural textures for the first materials (default 0)\n"
+			<< "  --size W H               image size (default 1920 1080)\n"
+			<< "Counts and sizes have to be at least 1, lights and textures at least 0.\n";
+	}
+
+	// The whole argument has to be a number, atoi would read "abc" as 0
+	bool parseInt(const char* text, int& value)
+	{
+		char* end = nullptr;
+		const long parsed = strtol(text, &end, 10);
+		if (end == text || *end != '\0' || parsed < INT_MIN || parsed > INT_MAX)
+			return false;
+
+		value = static_cast<int>(parsed);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	CRTSceneGeneratorSettings settings;
+	std::string output;
+	bool valid = true; // False after an argument which is not a number
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (strcmp(arg, "--seed") == 0 && hasValue)
+			settings.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		else if (strcmp(arg, "--layout") == 0 && hasValue)
+		{
+			if (!CRTSceneGenerator::parseLayout(argv[++i], settings.layout))
+			{
+				std::cerr << "Unknown layout " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else if (strcmp(arg, "--objects") == 0 && hasValue)
+			valid = parseInt(argv[++i], settings.objectCount) && valid;
+		else if (strcmp(arg, "--triangles-per-object") == 0 && hasValue)
+			valid = parseInt(argv[++i], settings.trianglesPerObject) && valid;
+		else if (strcmp(arg, "--instancing") == 0 && hasValue)
+			settings.instancingRatio = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(arg, "--lights") == 0 && hasValue)
+			valid = parseInt(argv[++i], settings.lightCount) && valid;
+		else if (strcmp(arg, "--materials") == 0 && hasValue)
+			valid = parseInt(argv[++i], settings.materialCount) && valid;
+		else if (strcmp(arg, "--textures") == 0 && hasValue)
+			valid = parseInt(argv[++i], settings.textureCount) && valid;
+		else if (strcmp(arg, "--size") == 0 && i + 2 < argc)
+		{
+			valid = parseInt(argv[++i], settings.imageWidth) && valid;
+			valid = parseInt(argv[++i], settings.imageHeight) && valid;
+		}
+		else if (arg[0] != '-' && output.empty())
+			output = arg;
+		else
+		{
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	// Rejected here, the generator would clamp them to a scene that was not asked for
+	if (!valid || output.empty() || settings.objectCount < 1 || settings.trianglesPerObject < 1 || !(settings.instancingRatio >= 1.f) ||
+		settings.lightCount < 0 || settings.materialCount < 1 || settings.textureCount < 0 || settings.imageWidth < 1 || settings.imageHeight < 1)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	CRTSceneGenerator generator(settings);
+	if (!generator.write(output))
+	{
+		std::cerr << "Cannot write " << output << std::endl;
+		return 1;
+	}
+
+	std::cout << output << ": " << CRTSceneGenerator::getLayoutName(settings.layout) << ", "
+		<< generator.getMeshCount() << " meshes, " << generator.getTriangleCount() << " triangles" << std::endl;
+
+	return 0;
+}
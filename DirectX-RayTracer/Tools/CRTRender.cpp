@@ -0,0 +1,260 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "CRTDebugShading.h"
+#include "CRTRenderer.h"
+#include "CRTScene.h"
+
+// Renders a .crtscene with the CPU tracer and writes the image, without Qt or a
+// GPU, so scenes can be rendered from scripts and on headless machines
+
+namespace
+{
+	enum class OutputFormat
+	{
+		PPM,
+		PFM
+	};
+
+	struct RenderCommand
+	{
+		std::string scene;
+		std::string output;
+		bool hasFormat = false;
+		OutputFormat format = OutputFormat::PPM;
+
+		bool debugView = false; // One of the debug views instead of the lit image
+		CRTShadingMode shadingMode = CRTShadingMode::TRIANGLE_COLORS;
+
+		int width = 0; // 0 keeps the size of the scene settings
+		int height = 0;
+		CRTRenderSettings renderSettings;
+	};
+
+	void printUsage(const char* program)
+	{
+		std::cerr << "Usage: " << program << " [options] scene.crtscene\n"
+			<< "  --output PATH         image to write (default the scene name with the format extension)\n"
+			<< "  --format NAME         ppm or pfm (default from the output extension, else ppm)\n"
+			<< "  --shading NAME        lit, or a debug view: ";
+
+		for (int i = 0; i < static_cast<int>(CRTShadingMode::COUNT); i++)
+			std::cerr << (i ? ", " : "") << CRTDebugShading::getModeName(static_cast<CRTShadingMode>(i));
+
+		std::cerr << " (default lit)\n"
+			<< "  --threads N           worker threads, 0 for all (default 0)\n"
+			<< "  --samples N           samples per pixel, turns adaptive sampling off\n"
+			<< "  --adaptive MIN MAX    adaptive sampling between MIN and MAX samples (default 4 64)\n"
+			<< "  --tile N              tile size in pixels (default 32)\n"
+			<< "  --depth N             reflection and refraction bounces (default 5)\n"
+			<< "  --seed N              sampler seed (default 0)\n"
+			<< "  --time-budget S       no new sampling pass after S seconds, 0 for none (default 0)\n"
+			<< "  --size W H            render size instead of the one of the scene\n"
+			<< "The options from --threads to --time-budget apply to lit shading only, the debug views\n"
+			<< "render one sample per pixel on all cores and reject them.\n";
+	}
+
+	bool parseFormat(const std::string& name, OutputFormat& format)
+	{
+		if (name == "ppm")
+			format = OutputFormat::PPM;
+		else if (name == "pfm")
+			format = OutputFormat::PFM;
+		else
+			return false;
+
+		return true;
+	}
+
+	bool parseArguments(int argc, char** argv, RenderCommand& command)
+	{
+		CRTRenderSettings& renderSettings = command.renderSettings;
+		const char* litOption = nullptr; // The last option which only the lit render uses
+
+		for (int i = 1; i < argc; i++)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			for (const char* name : { "--threads", "--samples", "--adaptive", "--tile", "--depth", "--seed", "--time-budget" })
+			{
+				if (strcmp(arg, name) == 0)
+					litOption = name;
+			}
+
+			if (strcmp(arg, "--output") == 0 && hasValue)
+				command.output = argv[++i];
+			else if (strcmp(arg, "--format") == 0 && hasValue)
+			{
+				if (!parseFormat(argv[++i], command.format))
+				{
+					std::cerr << "Unknown format " << argv[i] << std::endl;
+					return false;
+				}
+				command.hasFormat = true;
+			}
+			else if (strcmp(arg, "--shading") == 0 && hasValue)
+			{
+				command.debugView = strcmp(argv[++i], "lit") != 0;
+				if (command.debugView && !CRTDebugShading::parseMode(argv[i], command.shadingMode))
+				{
+					std::cerr << "Unknown shading mode " << argv[i] << std::endl;
+					return false;
+				}
+			}
+			else if (strcmp(arg, "--threads") == 0 && hasValue)
+				renderSettings.threadCount = atoi(argv[++i]);
+			else if (strcmp(arg, "--samples") == 0 && hasValue)
+			{
+				renderSettings.minSamples = atoi(argv[++i]);
+				renderSettings.maxSamples = renderSettings.minSamples;
+			}
+			else if (strcmp(arg, "--adaptive") == 0 && i + 2 < argc)
+			{
+				renderSettings.minSamples = atoi(argv[++i]);
+				renderSettings.maxSamples = atoi(argv[++i]);
+			}
+			else if (strcmp(arg, "--tile") == 0 && hasValue)
+				renderSettings.tileSize = atoi(argv[++i]);
+			else if (strcmp(arg, "--depth") == 0 && hasValue)
+				renderSettings.maxDepth = atoi(argv[++i]);
+			else if (strcmp(arg, "--seed") == 0 && hasValue)
+				renderSettings.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+			else if (strcmp(arg, "--time-budget") == 0 && hasValue)
+				renderSettings.timeBudgetSeconds = static_cast<float>(atof(argv[++i]));
+			else if (strcmp(arg, "--size") == 0 && i + 2 < argc)
+			{
+				command.width = atoi(argv[++i]);
+				command.height = atoi(argv[++i]);
+			}
+			else if (arg[0] != '-' && command.scene.empty())
+				command.scene = arg;
+			else
+			{
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+
+		if (command.scene.empty() || renderSettings.threadCount < 0 || renderSettings.tileSize < 1 || renderSettings.maxDepth < 0 ||
+			renderSettings.minSamples < 1 || renderSettings.maxSamples < renderSettings.minSamples || command.width < 0 || command.height < 0)
+		{
+			printUsage(argv[0]);
+			return false;
+		}
+
+		// The debug renderer has none of these settings, ignoring them would hide a typo in --shading
+		if (command.debugView && litOption)
+		{
+			std::cerr << litOption << " only applies to --shading lit, not to " << CRTDebugShading::getModeName(command.shadingMode) << std::endl;
+			return false;
+		}
+
+		if (command.output.empty())
+		{
+			const char* extension = command.format == OutputFormat::PFM ? ".pfm" : ".ppm";
+			command.output = std::filesystem::path(command.scene).stem().string() + extension;
+		}
+		else if (!command.hasFormat && std::filesystem::path(command.output).extension() == ".pfm")
+			command.format = OutputFormat::PFM;
+
+		return true;
+	}
+
+	float secondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	RenderCommand command;
+	if (!parseArguments(argc, argv, command))
+		return 1;
+
+	if (!std::filesystem::exists(command.scene))
+	{
+		std::cerr << "Cannot open " << command.scene << std::endl;
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	CRTScene scene(command.scene);
+	const float loadSeconds = secondsSince(start);
+
+	if (!scene.isLoaded())
+	{
+		std::cerr << "Cannot load " << command.scene << std::endl;
+		return 1;
+	}
+
+	if (command.width > 0 && command.height > 0)
+	{
+		scene.getSettings().imageWidth = command.width;
+		scene.getSettings().imageHeight = command.height;
+	}
+
+	if (scene.getSettings().imageWidth <= 0 || scene.getSettings().imageHeight <= 0)
+	{
+		std::cerr << command.scene << " has no image size, pass --size W H" << std::endl;
+		return 1;
+	}
+
+	CRTImage image;
+	CRTRenderStats stats;
+	float buildSeconds = 0.f;
+	float renderSeconds = 0.f;
+
+	if (command.debugView)
+	{
+		start = std::chrono::steady_clock::now();
+		CRTDebugRenderer renderer(scene);
+		buildSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		renderer.render(command.shadingMode, image);
+		renderSeconds = secondsSince(start);
+	}
+	else
+	{
+		start = std::chrono::steady_clock::now();
+		CRTRenderer renderer(scene);
+		buildSeconds = secondsSince(start);
+
+		renderer.render(command.renderSettings);
+		image = renderer.getImage();
+		stats = renderer.getStats();
+		renderSeconds = stats.renderSeconds;
+	}
+
+	start = std::chrono::steady_clock::now();
+	const bool written = command.format == OutputFormat::PFM ? image.writePFM(command.output) : image.writePPM(command.output);
+	const float writeSeconds = secondsSince(start);
+
+	if (!written)
+	{
+		std::cerr << "Cannot write " << command.output << std::endl;
+		return 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< command.output << ": " << image.getWidth() << "x" << image.getHeight() << ", "
+		<< (command.debugView ? CRTDebugShading::getModeName(command.shadingMode) : "lit") << "\n"
+		<< "  load     " << loadSeconds << " s\n"
+		<< "  build    " << buildSeconds << " s\n"
+		<< "  render   " << renderSeconds << " s\n"
+		<< "  write    " << writeSeconds << " s\n";
+
+	if (!command.debugView)
+	{
+		std::cout << "  samples  " << stats.totalSamples << " in " << stats.passes << " passes\n"
+			<< "  rays     " << stats.raysTraced << ", " << std::setprecision(2) << stats.raysPerSecond / 1e6f << " M/s\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,233 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "CRTCameraPath.h"
+#include "CRTScene.h"
+#include "CRTSequenceRenderer.h"
+
+// Renders a camera path through a .crtscene into numbered images. The scene is
+// loaded and its BVH built once, the frames are rendered in parallel and written
+// in order while the next ones render.
+
+namespace
+{
+	struct SequenceCommand
+	{
+		std::string scene;
+		std::string pathFile;
+		float turntableSeconds = 0.f; // Turntable around the scene instead of a path file
+		float framesPerSecond = 0.f; // 0 keeps the one of the path
+		int firstFrame = 0;
+		int frameCount = 0; // 0 renders up to the end of the path
+
+		std::string outputDir = "frames";
+		bool pfm = false;
+
+		int width = 0; // 0 keeps the size of the scene settings
+		int height = 0;
+		CRTSequenceSettings sequenceSettings;
+	};
+
+	void printUsage(const char* program)
+	{
+		std::cerr << "Usage: " << program << " [options] scene.crtscene\n"
+			<< "  --path FILE           camera path JSON with keyframes\n"
+			<< "  --turntable SECONDS   one turn of the scene camera around the middle of the scene instead\n"
+			<< "  --fps N               frames per second of the path (default from the path, else 24)\n"
+			<< "  --first N             first frame to render (default 0)\n"
+			<< "  --count N             frames to render (default up to the end of the path)\n"
+			<< "  --output DIR          directory of the frame_NNNN images (default frames)\n"
+			<< "  --format NAME         ppm or pfm (default ppm)\n"
+			<< "  --parallel-frames N   frames rendered at the same time, 0 for auto (default 0)\n"
+			<< "  --threads N           worker threads per frame, 0 to split the hardware threads (default 0)\n"
+			<< "  --samples N           samples per pixel (default 4)\n"
+			<< "  --tile N              tile size in pixels (default 32)\n"
+			<< "  --queue N             frames waiting for the writer before rendering waits (default 8)\n"
+			<< "  --size W H            render size instead of the one of the scene\n";
+	}
+
+	bool parseArguments(int argc, char** argv, SequenceCommand& command)
+	{
+		CRTRenderSettings& renderSettings = command.sequenceSettings.renderSettings;
+		renderSettings.maxSamples = renderSettings.minSamples;
+		renderSettings.aovMask = 0;
+
+		for (int i = 1; i < argc; i++)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (strcmp(arg, "--path") == 0 && hasValue)
+				command.pathFile = argv[++i];
+			else if (strcmp(arg, "--turntable") == 0 && hasValue)
+				command.turntableSeconds = static_cast<float>(atof(argv[++i]));
+			else if (strcmp(arg, "--fps") == 0 && hasValue)
+				command.framesPerSecond = static_cast<float>(atof(argv[++i]));
+			else if (strcmp(arg, "--first") == 0 && hasValue)
+				command.firstFrame = atoi(argv[++i]);
+			else if (strcmp(arg, "--count") == 0 && hasValue)
+				command.frameCount = atoi(argv[++i]);
+			else if (strcmp(arg, "--output") == 0 && hasValue)
+				command.outputDir = argv[++i];
+			else if (strcmp(arg, "--format") == 0 && hasValue)
+			{
+				const std::string format = argv[++i];
+				if (format != "ppm" && format != "pfm")
+				{
+					std::cerr << "Unknown format " << format << std::endl;
+					return false;
+				}
+				command.pfm = format == "pfm";
+			}
+			else if (strcmp(arg, "--parallel-frames") == 0 && hasValue)
+				command.sequenceSettings.parallelFrames = atoi(argv[++i]);
+			else if (strcmp(arg, "--threads") == 0 && hasValue)
+				renderSettings.threadCount = atoi(argv[++i]);
+			else if (strcmp(arg, "--samples") == 0 && hasValue)
+			{
+				renderSettings.minSamples = atoi(argv[++i]);
+				renderSettings.maxSamples = renderSettings.minSamples;
+			}
+			else if (strcmp(arg, "--tile") == 0 && hasValue)
+				renderSettings.tileSize = atoi(argv[++i]);
+			else if (strcmp(arg, "--queue") == 0 && hasValue)
+				command.sequenceSettings.maxQueuedFrames = atoi(argv[++i]);
+			else if (strcmp(arg, "--size") == 0 && i + 2 < argc)
+			{
+				command.width = atoi(argv[++i]);
+				command.height = atoi(argv[++i]);
+			}
+			else if (arg[0] != '-' && command.scene.empty())
+				command.scene = arg;
+			else
+			{
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+
+		if (command.scene.empty() || command.pathFile.empty() == (command.turntableSeconds <= 0.f) ||
+			command.framesPerSecond < 0.f || command.firstFrame < 0 || command.frameCount < 0 ||
+			renderSettings.minSamples < 1 || renderSettings.tileSize < 1 || renderSettings.threadCount < 0 ||
+			command.sequenceSettings.parallelFrames < 0 || command.sequenceSettings.maxQueuedFrames < 1 ||
+			command.width < 0 || command.height < 0)
+		{
+			printUsage(argv[0]);
+			return false;
+		}
+
+		return true;
+	}
+
+	float secondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SequenceCommand command;
+	if (!parseArguments(argc, argv, command))
+		return 1;
+
+	if (!std::filesystem::exists(command.scene))
+	{
+		std::cerr << "Cannot open " << command.scene << std::endl;
+		return 1;
+	}
+
+	CRTCameraPath path;
+	if (!command.pathFile.empty() && !path.load(command.pathFile))
+	{
+		std::cerr << "Cannot read the camera path " << command.pathFile << std::endl;
+		return 1;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	CRTScene scene(command.scene);
+	const float loadSeconds = secondsSince(start);
+
+	if (!scene.isLoaded())
+	{
+		std::cerr << "Cannot load " << command.scene << std::endl;
+		return 1;
+	}
+
+	if (command.width > 0 && command.height > 0)
+	{
+		scene.getSettings().imageWidth = command.width;
+		scene.getSettings().imageHeight = command.height;
+	}
+
+	if (scene.getSettings().imageWidth <= 0 || scene.getSettings().imageHeight <= 0)
+	{
+		std::cerr << command.scene << " has no image size, pass --size W H" << std::endl;
+		return 1;
+	}
+
+	CRTSequenceRenderer renderer(scene);
+
+	if (command.turntableSeconds > 0.f)
+		path = CRTCameraPath::createTurntable(scene.getCamera().getPosition(), renderer.getSceneBounds().getCenter(), command.turntableSeconds);
+
+	if (command.framesPerSecond > 0.f)
+		path.setFramesPerSecond(command.framesPerSecond);
+
+	const int pathFrames = path.getFrameCount();
+	const int lastFrame = command.frameCount > 0 ? command.firstFrame + command.frameCount : pathFrames;
+	if (command.firstFrame >= lastFrame)
+	{
+		std::cerr << "The path has " << pathFrames << " frames, none to render from frame " << command.firstFrame << std::endl;
+		return 1;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(command.outputDir, error);
+	if (error)
+	{
+		std::cerr << "Cannot create " << command.outputDir << std::endl;
+		return 1;
+	}
+
+	auto writeFrame = [&command](int frame, const CRTImage& image)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "frame_%04d.%s", frame, command.pfm ? "pfm" : "ppm");
+
+			const std::string fileName = (std::filesystem::path(command.outputDir) / name).string();
+			return command.pfm ? image.writePFM(fileName) : image.writePPM(fileName);
+		};
+
+	const bool written = renderer.render(path, command.firstFrame, lastFrame, command.sequenceSettings, writeFrame);
+	const CRTSequenceStats& stats = renderer.getStats();
+
+	float slowestFrame = 0.f;
+	for (float seconds : stats.frameSeconds)
+		slowestFrame = slowestFrame > seconds ? slowestFrame : seconds;
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< stats.frames << " frames " << command.firstFrame << "-" << lastFrame - 1 << " of " << pathFrames
+		<< " into " << command.outputDir << ", " << stats.parallelFrames << " in parallel\n"
+		<< "  load          " << loadSeconds << " s\n"
+		<< "  build         " << stats.buildSeconds << " s\n"
+		<< "  sequence      " << stats.totalSeconds << " s, " << std::setprecision(2) << stats.getFramesPerSecond() << " frames/s\n"
+		<< std::setprecision(3)
+		<< "  slowest frame " << slowestFrame << " s\n"
+		<< "  writer wait   " << stats.writerWaitSeconds << " s\n"
+		<< "  rays          " << stats.raysTraced << ", " << std::setprecision(2)
+		<< (stats.totalSeconds > 0.f ? stats.raysTraced / stats.totalSeconds / 1e6f : 0.f) << " M/s\n";
+
+	if (!written)
+	{
+		std::cerr << "Cannot write the frames to " << command.outputDir << std::endl;
+		return 1;
+	}
+
+	return 0;
+}